@@ -39,6 +39,17 @@ class Agent {
   void set_query(const char *ptr, std::size_t length);
   void set_query(std::size_t key_id);
 
+  // extend_query() replaces the query with a longer one that begins with the
+  // current query, such as the text of a search box after a keystroke. If
+  // the agent is in a predictive search, the next predictive search
+  // continues from the node that the current query reached, instead of
+  // walking the query from the root again. Otherwise, this is the same as
+  // set_query(). Only MARISA_LOUDS_TRIE makes use of the kept state.
+  void extend_query(std::string_view str) {
+    extend_query(str.data(), str.length());
+  }
+  void extend_query(const char *ptr, std::size_t length);
+
   const grimoire::trie::State &state() const {
     return *state_;
   }
@@ -0,0 +1,151 @@
+#ifndef MARISA_ASYNC_TRIE_H_
+#define MARISA_ASYNC_TRIE_H_
+
+// AsyncTrie requires C++20 coroutines.
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+ #define MARISA_HAS_ASYNC_TRIE 1
+
+ #include <atomic>
+ #include <coroutine>
+ #include <exception>
+ #include <memory>
+ #include <utility>
+
+ #include "marisa/trie.h"
+
+namespace marisa {
+namespace grimoire::io {
+
+class Residency;
+
+}  // namespace grimoire::io
+
+// LookupTask is a lookup started by AsyncTrie::lookup(). It runs only while
+// resumed, until it finishes or would block on a page fault.
+class LookupTask {
+ public:
+  struct promise_type {
+    bool found = false;
+    std::exception_ptr exception;
+
+    LookupTask get_return_object() {
+      return LookupTask(
+          std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() noexcept {
+      return {};
+    }
+    std::suspend_always final_suspend() noexcept {
+      return {};
+    }
+    void return_value(bool value) noexcept {
+      found = value;
+    }
+    void unhandled_exception() noexcept {
+      exception = std::current_exception();
+    }
+  };
+
+  LookupTask() = default;
+  ~LookupTask() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  LookupTask(const LookupTask &) = delete;
+  LookupTask &operator=(const LookupTask &) = delete;
+
+  LookupTask(LookupTask &&other) noexcept : handle_(other.handle_) {
+    other.handle_ = nullptr;
+  }
+  LookupTask &operator=(LookupTask &&other) noexcept {
+    LookupTask(std::move(other)).swap(*this);
+    return *this;
+  }
+
+  // done() returns true if the lookup has finished or there is no lookup.
+  bool done() const {
+    return !handle_ || handle_.done();
+  }
+  // resume() runs the lookup until it finishes or suspends.
+  void resume() {
+    handle_.resume();
+    if (handle_.done() && handle_.promise().exception) {
+      std::rethrow_exception(handle_.promise().exception);
+    }
+  }
+  // found() returns the result of a finished lookup.
+  bool found() const {
+    return handle_.promise().found;
+  }
+
+  void swap(LookupTask &rhs) noexcept {
+    std::swap(handle_, rhs.handle_);
+  }
+
+ private:
+  std::coroutine_handle<promise_type> handle_;
+
+  explicit LookupTask(std::coroutine_handle<promise_type> handle)
+      : handle_(handle) {}
+};
+
+// AsyncTrie runs lookups on a memory-mapped Trie without blocking on page
+// faults. Before each step of a traversal, a lookup checks whether the pages
+// it reads next are resident, using a bitmap seeded by mincore(). If not, it
+// asks the kernel to read them ahead and suspends, so that the caller can run
+// other lookups meanwhile. A lookup on a trie that is not memory-mapped never
+// suspends.
+//
+// An AsyncTrie refers to a Trie, which must outlive it and its tasks. The
+// constructor throws std::logic_error unless the Trie is a MARISA_LOUDS_TRIE.
+class AsyncTrie {
+ public:
+  enum {
+    DEFAULT_MAX_IN_FLIGHT = 16,
+    // A lookup stops waiting and takes the page fault after this number of
+    // suspensions in a step, e.g. when the page cache is under pressure.
+    MAX_SUSPENSIONS_PER_STEP = 1024
+  };
+
+  explicit AsyncTrie(const Trie &trie);
+  ~AsyncTrie();
+
+  AsyncTrie(const AsyncTrie &) = delete;
+  AsyncTrie &operator=(const AsyncTrie &) = delete;
+
+  // lookup() returns a suspended task that works like Trie::lookup() when
+  // resumed until done(). `agent` must outlive the task.
+  LookupTask lookup(Agent &agent) const;
+
+  // This overload looks up `num_agents` queries with up to `max_in_flight`
+  // tasks interleaved, stores the results in `found` and returns the number
+  // of keys found.
+  std::size_t lookup(Agent *agents, bool *found, std::size_t num_agents,
+                     std::size_t max_in_flight = DEFAULT_MAX_IN_FLIGHT) const;
+
+  const Trie &trie() const {
+    return trie_;
+  }
+
+  // num_suspensions() counts the suspensions of all the lookups.
+  std::size_t num_suspensions() const {
+    return num_suspensions_.load(std::memory_order_relaxed);
+  }
+  // num_resident_pages() and num_pages() tell how much of the file is known
+  // to be resident.
+  std::size_t num_resident_pages() const;
+  std::size_t num_pages() const;
+
+ private:
+  const Trie &trie_;
+  std::unique_ptr<grimoire::io::Residency> residency_;
+  mutable std::atomic<std::size_t> num_suspensions_{0};
+};
+
+}  // namespace marisa
+
+#endif  // defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#endif  // MARISA_ASYNC_TRIE_H_
@@ -0,0 +1,55 @@
+#ifndef MARISA_BUILD_PROGRESS_H_
+#define MARISA_BUILD_PROGRESS_H_
+
+#include <functional>
+#include <stdexcept>
+
+#include "marisa/base.h"
+
+namespace marisa {
+
+// BuildProgress is passed to a BuildCallback during Trie::build(). name() and
+// trie_id() identify the phase as in BuildPhase, and done() counts up to
+// total() within the phase. Progress is reported for "sort", "louds",
+// "tail", "paths" and "dfuds", in units of keys.
+class BuildProgress {
+ public:
+  BuildProgress() = default;
+  BuildProgress(const char *name, std::size_t trie_id, std::size_t done,
+                std::size_t total)
+      : name_(name), trie_id_(trie_id), done_(done), total_(total) {}
+
+  const char *name() const {
+    return name_;
+  }
+  std::size_t trie_id() const {
+    return trie_id_;
+  }
+  std::size_t done() const {
+    return done_;
+  }
+  std::size_t total() const {
+    return total_;
+  }
+
+ private:
+  const char *name_ = "";
+  std::size_t trie_id_ = 0;
+  std::size_t done_ = 0;
+  std::size_t total_ = 0;
+};
+
+// A BuildCallback is called periodically during Trie::build(). It returns
+// false to cancel the build, in which case Trie::build() throws
+// BuildCancelled and leaves the trie and the keyset unchanged. If the library
+// is built without exceptions, a cancelled build aborts instead.
+using BuildCallback = std::function<bool(const BuildProgress &)>;
+
+class BuildCancelled : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+}  // namespace marisa
+
+#endif  // MARISA_BUILD_PROGRESS_H_
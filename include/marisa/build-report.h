@@ -0,0 +1,129 @@
+#ifndef MARISA_BUILD_REPORT_H_
+#define MARISA_BUILD_REPORT_H_
+
+#include <vector>
+
+#include "marisa/base.h"
+
+namespace marisa {
+
+// BuildPhase describes one phase of Trie::build() for one trie of the
+// recursion. Phases are named as follows:
+//  "keys":      copying keys from a Keyset.
+//  "sort":      sorting keys.
+//  "louds":     the breadth-first construction of LOUDS and labels.
+//  "tail":      building TAIL.
+//  "links":     building link flags and extras.
+//  "cache":     filling the cache.
+//  "terminals": building terminal flags and assigning key IDs.
+//  "paths":     the construction of a MARISA_CENTROID_TRIE after "sort".
+//  "dfuds":     the construction of a MARISA_DFUDS_TRIE after "sort", which
+//               is followed by "tail".
+class BuildPhase {
+ public:
+  BuildPhase() = default;
+
+  void set_name(const char *name) {
+    name_ = name;
+  }
+  void set_trie_id(std::size_t trie_id) {
+    trie_id_ = trie_id;
+  }
+  void set_seconds(double seconds) {
+    seconds_ = seconds;
+  }
+  void set_allocated_bytes(std::size_t allocated_bytes) {
+    allocated_bytes_ = allocated_bytes;
+  }
+  void set_peak_resident(std::size_t peak_resident) {
+    peak_resident_ = peak_resident;
+  }
+
+  // name() returns one of the above static strings.
+  const char *name() const {
+    return name_;
+  }
+  // trie_id() starts at 1 for the first trie of the recursion.
+  std::size_t trie_id() const {
+    return trie_id_;
+  }
+  // seconds() returns the wall time of the phase.
+  double seconds() const {
+    return seconds_;
+  }
+  // allocated_bytes() returns the bytes allocated for vectors in the phase.
+  std::size_t allocated_bytes() const {
+    return allocated_bytes_;
+  }
+  // peak_resident() returns the peak resident set size of the process at the
+  // end of the phase, or 0 if it is not available on the platform.
+  std::size_t peak_resident() const {
+    return peak_resident_;
+  }
+
+ private:
+  const char *name_ = "";
+  std::size_t trie_id_ = 0;
+  double seconds_ = 0.0;
+  std::size_t allocated_bytes_ = 0;
+  std::size_t peak_resident_ = 0;
+};
+
+// BuildReport collects BuildPhases in the order of completion.
+class BuildReport {
+ public:
+  BuildReport() = default;
+
+  void push_back(const BuildPhase &phase) {
+    phases_.push_back(phase);
+  }
+
+  const std::vector<BuildPhase> &phases() const {
+    return phases_;
+  }
+
+  double total_seconds() const {
+    double total = 0.0;
+    for (const BuildPhase &phase : phases_) {
+      total += phase.seconds();
+    }
+    return total;
+  }
+  std::size_t total_allocated_bytes() const {
+    std::size_t total = 0;
+    for (const BuildPhase &phase : phases_) {
+      total += phase.allocated_bytes();
+    }
+    return total;
+  }
+  std::size_t peak_resident() const {
+    std::size_t peak = 0;
+    for (const BuildPhase &phase : phases_) {
+      if (phase.peak_resident() > peak) {
+        peak = phase.peak_resident();
+      }
+    }
+    return peak;
+  }
+
+  bool empty() const {
+    return phases_.empty();
+  }
+  std::size_t size() const {
+    return phases_.size();
+  }
+
+  void clear() noexcept {
+    phases_.clear();
+  }
+  void swap(BuildReport &rhs) noexcept {
+    phases_.swap(rhs.phases_);
+  }
+
+ private:
+  std::vector<BuildPhase> phases_;
+};
+
+}  // namespace marisa
+
+#endif  // MARISA_BUILD_REPORT_H_
@@ -0,0 +1,138 @@
+#ifndef MARISA_C_API_H_
+#define MARISA_C_API_H_
+
+// The C API wraps marisa::Trie for other languages. Functions never throw or
+// abort; they return MARISA_OK or another marisa_error_code, and
+// marisa_last_error() returns the message of the last error on the calling
+// thread. Results are written to buffers owned by the caller, and batch
+// functions process many keys per call so that the cost of crossing a
+// language boundary is paid per batch rather than per key. If the library is
+// built without exceptions (MARISA_USE_EXCEPTIONS == 0), the query functions
+// still return their errors, but the other functions abort on errors.
+//
+// A batch of keys is passed as one buffer `keys` and `num_keys` + 1 offsets,
+// where key i is [keys + offsets[i], keys + offsets[i + 1]).
+//
+// Functions that only read a trie may be called from multiple threads at the
+// same time, like the const member functions of marisa::Trie.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "marisa/enums.h"  // IWYU pragma: export
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+typedef struct marisa_trie marisa_trie;
+typedef struct marisa_predictive_iter marisa_predictive_iter;
+
+// marisa_last_error() returns the message of the last error on the calling
+// thread, or "" if no error has occurred. The message stays valid until the
+// next call of a function that fails on the same thread.
+const char *marisa_last_error(void);
+
+// marisa_trie_new() creates an empty trie, which must be freed with
+// marisa_trie_free(). marisa_trie_free(NULL) does nothing.
+int marisa_trie_new(marisa_trie **trie);
+void marisa_trie_free(marisa_trie *trie);
+
+// marisa_trie_build() builds a dictionary from a batch of keys. `weights`
+// may be NULL. If `ids` is not NULL, ids[i] receives the ID of key i.
+int marisa_trie_build(marisa_trie *trie, const char *keys,
+                      const size_t *offsets, size_t num_keys,
+                      const float *weights, int config_flags, uint32_t *ids);
+
+// marisa_trie_mmap() maps a dictionary file, and `flags` is a combination of
+// marisa_map_flags. marisa_trie_map() uses the caller's memory, which must
+// stay valid until the trie is freed or replaced.
+int marisa_trie_mmap(marisa_trie *trie, const char *filename, int flags);
+int marisa_trie_map(marisa_trie *trie, const void *ptr, size_t size);
+int marisa_trie_load(marisa_trie *trie, const char *filename);
+// `flags` is a combination of marisa_save_flags.
+int marisa_trie_save(const marisa_trie *trie, const char *filename,
+                     int flags);
+
+// These return 0 for an empty trie.
+size_t marisa_trie_num_keys(const marisa_trie *trie);
+size_t marisa_trie_num_nodes(const marisa_trie *trie);
+size_t marisa_trie_io_size(const marisa_trie *trie);
+
+// marisa_trie_lookup_batch() writes the ID of key i to ids[i], or
+// MARISA_INVALID_KEY_ID if key i is not registered.
+int marisa_trie_lookup_batch(const marisa_trie *trie, const char *keys,
+                             const size_t *offsets, size_t num_keys,
+                             uint32_t *ids);
+
+// marisa_trie_reverse_lookup_batch() restores the keys of `ids` in order into
+// `buf` of `buf_size` bytes as a batch of keys, and stops before the first key
+// that doesn't fit. `offsets` needs `num_ids` + 1 elements. *num_restored
+// receives the number of restored keys, and the caller continues with the
+// rest. If not even the first key fits, this fails with MARISA_SIZE_ERROR.
+int marisa_trie_reverse_lookup_batch(const marisa_trie *trie,
+                                     const uint32_t *ids, size_t num_ids,
+                                     char *buf, size_t buf_size,
+                                     size_t *offsets, size_t *num_restored);
+
+// marisa_trie_common_prefix_search_batch() finds the registered prefixes of
+// the keys of a batch. The results of key i are [result_offsets[i],
+// result_offsets[i + 1]) of `ids` and `lengths`, where lengths are the
+// prefix lengths, and `result_offsets` needs `num_keys` + 1 elements. This
+// stops before the first key whose results don't fit in `capacity`, and
+// *num_searched receives the number of searched keys. If the results of the
+// first key don't fit, this fails with MARISA_SIZE_ERROR.
+int marisa_trie_common_prefix_search_batch(
+    const marisa_trie *trie, const char *keys, const size_t *offsets,
+    size_t num_keys, uint32_t *ids, size_t *lengths, size_t capacity,
+    size_t *result_offsets, size_t *num_searched);
+
+// marisa_trie_predictive_iter() starts a predictive search for the keys that
+// begin with `prefix`. The iterator refers to `trie` and must be freed with
+// marisa_predictive_iter_free() before the trie. Freeing NULL does nothing.
+int marisa_trie_predictive_iter(const marisa_trie *trie, const char *prefix,
+                                size_t length, marisa_predictive_iter **iter);
+void marisa_predictive_iter_free(marisa_predictive_iter *iter);
+
+// marisa_predictive_iter_extend() appends `suffix` to the prefix of `iter`
+// and restarts it for the longer prefix, such as after a keystroke. The
+// search continues from the node that the old prefix reached, see
+// marisa::Agent::extend_query().
+int marisa_predictive_iter_extend(marisa_predictive_iter *iter,
+                                  const char *suffix, size_t length);
+
+// marisa_predictive_iter_next() writes up to `max_results` next results to
+// `ids` and, as a batch of keys, to `buf` of `buf_size` bytes. `offsets` needs
+// `max_results` + 1 elements. *num_results receives the number of results,
+// which is 0 only at the end. If the next key doesn't fit in `buf`, this
+// fails with MARISA_SIZE_ERROR and the key is returned by the next call.
+int marisa_predictive_iter_next(marisa_predictive_iter *iter, uint32_t *ids,
+                                char *buf, size_t buf_size, size_t *offsets,
+                                size_t max_results, size_t *num_results);
+
+// marisa_predictive_iter_next_front_coded() is the same as
+// marisa_predictive_iter_next(), but writes the keys to `buf` as a block of
+// front coding, where each key is written as the length of the prefix that
+// it shares with the previous key and the rest, see "marisa/front-coding.h".
+// Results of a predictive search often share long prefixes, so the block is
+// much smaller than a batch of keys. *block_size receives its size.
+int marisa_predictive_iter_next_front_coded(marisa_predictive_iter *iter,
+                                            uint32_t *ids, char *buf,
+                                            size_t buf_size,
+                                            size_t max_results,
+                                            size_t *num_results,
+                                            size_t *block_size);
+
+// marisa_front_coded_decode() decodes up to `max_keys` keys of a block of
+// front coding into a batch of keys in `buf` of `buf_size` bytes. `offsets`
+// needs `max_keys` + 1 elements. This fails with MARISA_FORMAT_ERROR if the
+// block is broken, or with MARISA_SIZE_ERROR if `buf` is too small.
+int marisa_front_coded_decode(const char *block, size_t block_size, char *buf,
+                              size_t buf_size, size_t *offsets,
+                              size_t max_keys, size_t *num_keys);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // MARISA_C_API_H_
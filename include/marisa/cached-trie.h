@@ -0,0 +1,78 @@
+#ifndef MARISA_CACHED_TRIE_H_
+#define MARISA_CACHED_TRIE_H_
+
+#include <memory>
+#include <vector>
+
+#include "marisa/trie.h"
+
+namespace marisa {
+namespace grimoire::trie {
+
+class QueryCache;
+
+}  // namespace grimoire::trie
+
+// CachedTrie puts a result cache for frequent queries in front of a Trie.
+// Results of lookup(), including misses, are stored in one direct-mapped
+// table, and results of common_prefix_search() in another, each bounded in
+// bytes. The tables are not sharded; they are shared by all threads without
+// locks: readers only read, and a writer skips a slot that another writer
+// holds. Only the hit/miss counters are sharded by thread. Keys longer than
+// 48 bytes bypass the cache.
+//
+// A CachedTrie refers to a Trie, which must outlive it and must not be
+// modified while it is used. Each thread needs its own Agent as usual.
+class CachedTrie {
+ public:
+  enum {
+    DEFAULT_LOOKUP_CACHE_SIZE = 1 << 20,
+    DEFAULT_PREFIX_CACHE_SIZE = 1 << 18
+  };
+
+  // Stats counts hits and misses since construction or clear().
+  struct Stats {
+    std::size_t lookup_hits = 0;
+    std::size_t lookup_misses = 0;
+    std::size_t prefix_hits = 0;
+    std::size_t prefix_misses = 0;
+  };
+
+  explicit CachedTrie(
+      const Trie &trie,
+      std::size_t lookup_cache_size = DEFAULT_LOOKUP_CACHE_SIZE,
+      std::size_t prefix_cache_size = DEFAULT_PREFIX_CACHE_SIZE);
+  ~CachedTrie();
+
+  CachedTrie(const CachedTrie &) = delete;
+  CachedTrie &operator=(const CachedTrie &) = delete;
+
+  // lookup() works like Trie::lookup().
+  bool lookup(Agent &agent) const;
+
+  // common_prefix_search() stores all the keys that are prefixes of
+  // agent.query() in `keys` in ascending order of length and returns the
+  // number of them. The keys point to the query.
+  std::size_t common_prefix_search(Agent &agent, std::vector<Key> *keys) const;
+
+  const Trie &trie() const {
+    return trie_;
+  }
+
+  Stats stats() const;
+  std::size_t total_size() const;
+
+  // clear() drops cached results and counters. It may be called concurrently
+  // with searches, in which case it is best effort: a slot that is being
+  // written is skipped and may keep a result, and counters may count searches
+  // that started before it. Kept results are still correct for the Trie.
+  void clear();
+
+ private:
+  const Trie &trie_;
+  std::unique_ptr<grimoire::trie::QueryCache> cache_;
+};
+
+}  // namespace marisa
+
+#endif  // MARISA_CACHED_TRIE_H_
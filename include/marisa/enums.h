@@ -0,0 +1,204 @@
+#ifndef MARISA_ENUMS_H_
+#define MARISA_ENUMS_H_
+
+// This header is valid C as well as C++, so that "marisa/c-api.h" shares the
+// following constants and enumerations with the C++ API.
+
+#include <stdint.h>
+
+#define MARISA_INVALID_LINK_ID UINT32_MAX
+#define MARISA_INVALID_KEY_ID  UINT32_MAX
+#define MARISA_INVALID_EXTRA   (UINT32_MAX >> 8)
+
+// Error codes are defined as members of marisa_error_code. This library throws
+// an exception with one of the error codes when an error occurs, and the C
+// API returns one of them instead.
+enum marisa_error_code {
+  // MARISA_OK means that a requested operation has succeeded. In practice, an
+  // exception never has MARISA_OK because it is not an error.
+  MARISA_OK = 0,
+
+  // MARISA_STATE_ERROR means that an object was not ready for a requested
+  // operation. For example, an operation to modify a fixed vector throws an
+  // exception with MARISA_STATE_ERROR.
+  MARISA_STATE_ERROR = 1,
+
+  // MARISA_NULL_ERROR means that an invalid nullptr has been given.
+  MARISA_NULL_ERROR = 2,
+
+  // MARISA_BOUND_ERROR means that an operation has tried to access an out of
+  // range address.
+  MARISA_BOUND_ERROR = 3,
+
+  // MARISA_RANGE_ERROR means that an out of range value has appeared in
+  // operation.
+  MARISA_RANGE_ERROR = 4,
+
+  // MARISA_CODE_ERROR means that an undefined code has appeared in operation.
+  MARISA_CODE_ERROR = 5,
+
+  // MARISA_RESET_ERROR means that a smart pointer has tried to reset itself.
+  MARISA_RESET_ERROR = 6,
+
+  // MARISA_SIZE_ERROR means that a size has exceeded a library limitation.
+  MARISA_SIZE_ERROR = 7,
+
+  // MARISA_MEMORY_ERROR means that a memory allocation has failed.
+  MARISA_MEMORY_ERROR = 8,
+
+  // MARISA_IO_ERROR means that an I/O operation has failed.
+  MARISA_IO_ERROR = 9,
+
+  // MARISA_FORMAT_ERROR means that input was in invalid format.
+  MARISA_FORMAT_ERROR = 10,
+};
+
+// Flags for memory mapping are defined as members of marisa_map_flags.
+// Trie::open() accepts a combination of these flags.
+enum marisa_map_flags {
+  // MARISA_MAP_POPULATE specifies MAP_POPULATE.
+  MARISA_MAP_POPULATE = 1 << 0,
+};
+
+// Flags for saving dictionaries are defined as members of marisa_save_flags.
+// TrieSerializer::save() and write() accept a combination of these flags.
+enum marisa_save_flags {
+  // MARISA_SAVE_HOT_FIRST places the cache, LOUDS, flags and labels of the
+  // first trie at the beginning of the file, and TAIL and the other tries
+  // after a page boundary, so that memory-mapped lookups touch fewer pages.
+  // Readers detect the layout from the header, but older versions of this
+  // library cannot read such files.
+  MARISA_SAVE_HOT_FIRST = 1 << 0,
+  // MARISA_SAVE_ATOMIC writes a temporary file in the same directory with
+  // large buffered writes, flushes it to the disk and renames it to the
+  // target, so that a crash never leaves a partially written dictionary.
+  // Only save() and save_compressed() accept this flag.
+  MARISA_SAVE_ATOMIC = 1 << 1,
+};
+
+// Flags for warming up dictionaries are defined as members of
+// marisa_warmup_flags. Trie::warmup() accepts a combination of these flags
+// and processes them in this order.
+enum marisa_warmup_flags {
+  // MARISA_WARMUP_HOT faults in the cache, LOUDS, flags and labels of all the
+  // tries, which most lookups read.
+  MARISA_WARMUP_HOT = 1 << 0,
+  // MARISA_WARMUP_SAMPLE replays lookups of a query sample, which faults in
+  // the pages of TAIL that the queries read.
+  MARISA_WARMUP_SAMPLE = 1 << 1,
+  // MARISA_WARMUP_ALL faults in all the remaining pages.
+  MARISA_WARMUP_ALL = 1 << 2,
+};
+
+// Codecs for compressed dictionaries are defined as members of marisa_codec.
+// TrieSerializer::save_compressed() accepts one of them. A codec is available
+// only if the library is built with it (ENABLE_ZSTD or ENABLE_LZ4).
+enum marisa_codec {
+  // MARISA_DEFAULT_CODEC selects zstd if available, and LZ4 otherwise.
+  MARISA_DEFAULT_CODEC = 0,
+  MARISA_ZSTD_CODEC = 1,
+  MARISA_LZ4_CODEC = 2,
+};
+
+// Kinds of differences between dictionaries are defined as members of
+// marisa_diff_type. Trie::diff() reports each key with one of them.
+enum marisa_diff_type {
+  // MARISA_KEY_ADDED is a key only in the new dictionary.
+  MARISA_KEY_ADDED = 1,
+  // MARISA_KEY_REMOVED is a key only in the old dictionary.
+  MARISA_KEY_REMOVED = 2,
+  // MARISA_KEY_MOVED is a key in both dictionaries with different IDs.
+  MARISA_KEY_MOVED = 3,
+};
+
+// Min/max values, flags and masks for dictionary settings are defined below.
+// Please note that unspecified settings will be replaced with the default
+// settings. For example, 0 is equivalent to (MARISA_DEFAULT_NUM_TRIES |
+// MARISA_DEFAULT_TRIE | MARISA_DEFAULT_TAIL | MARISA_DEFAULT_ORDER).
+
+// A dictionary consists of 3 tries in default. Usually more tries make a
+// dictionary space-efficient but time-inefficient.
+enum marisa_num_tries {
+  MARISA_MIN_NUM_TRIES = 0x00001,
+  MARISA_MAX_NUM_TRIES = 0x0007F,
+  MARISA_DEFAULT_NUM_TRIES = 0x00003,
+};
+
+// This library uses a cache technique to accelerate search functions. The
+// following enumerated type marisa_cache_level gives a list of available cache
+// size options. A larger cache enables faster search but takes a more space.
+enum marisa_cache_level {
+  MARISA_HUGE_CACHE = 0x00080,
+  MARISA_LARGE_CACHE = 0x00100,
+  MARISA_NORMAL_CACHE = 0x00200,
+  MARISA_SMALL_CACHE = 0x00400,
+  MARISA_TINY_CACHE = 0x00800,
+  MARISA_DEFAULT_CACHE = MARISA_NORMAL_CACHE
+};
+
+// This library provides 2 kinds of TAIL implementations.
+enum marisa_tail_mode {
+  // MARISA_TEXT_TAIL merges last labels as zero-terminated strings. So, it is
+  // available if and only if the last labels do not contain a NULL character.
+  // If MARISA_TEXT_TAIL is specified and a NULL character exists in the last
+  // labels, the setting is automatically switched to MARISA_BINARY_TAIL.
+  MARISA_TEXT_TAIL = 0x01000,
+
+  // MARISA_BINARY_TAIL also merges last labels but as byte sequences. It uses
+  // a bit vector to detect the end of a sequence, instead of NULL characters.
+  // So, MARISA_BINARY_TAIL requires a larger space if the average length of
+  // labels is greater than 8.
+  MARISA_BINARY_TAIL = 0x02000,
+
+  MARISA_DEFAULT_TAIL = MARISA_TEXT_TAIL,
+};
+
+// The arrangement of nodes affects the time cost of matching and the order of
+// predictive search.
+enum marisa_node_order {
+  // MARISA_LABEL_ORDER arranges nodes in ascending label order.
+  // MARISA_LABEL_ORDER is useful if an application needs to predict keys in
+  // label order.
+  MARISA_LABEL_ORDER = 0x10000,
+
+  // MARISA_WEIGHT_ORDER arranges nodes in descending weight order.
+  // MARISA_WEIGHT_ORDER is generally a better choice because it enables faster
+  // matching.
+  MARISA_WEIGHT_ORDER = 0x20000,
+
+  MARISA_DEFAULT_ORDER = MARISA_WEIGHT_ORDER,
+};
+
+// A dictionary is a LOUDS trie by default, which the settings above apply
+// to.
+enum marisa_trie_type {
+  MARISA_LOUDS_TRIE = 0x100000,
+
+  // MARISA_CENTROID_TRIE builds a path-decomposed trie, which ignores the
+  // settings above. A lookup visits O(log(#keys)) nodes instead of a node
+  // per branch, which makes it faster for long keys with long common
+  // prefixes, such as URLs and file paths, but the dictionary is larger
+  // because labels are not compressed by the tries of the recursion.
+  MARISA_CENTROID_TRIE = 0x200000,
+
+  // MARISA_DFUDS_TRIE builds a trie of a single level in DFUDS, which keeps
+  // the children of a node and the subtrees below them contiguous in
+  // preorder. It respects the tail mode but ignores the other settings above.
+  // A predictive search reads the tree sequentially instead of jumping to
+  // the next level for each node, which makes it faster to enumerate many
+  // keys, but a lookup is slower than with MARISA_LOUDS_TRIE.
+  MARISA_DFUDS_TRIE = 0x300000,
+
+  MARISA_DEFAULT_TRIE_TYPE = MARISA_LOUDS_TRIE,
+};
+
+enum marisa_config_mask {
+  MARISA_NUM_TRIES_MASK = 0x0007F,
+  MARISA_CACHE_LEVEL_MASK = 0x00F80,
+  MARISA_TAIL_MODE_MASK = 0x0F000,
+  MARISA_NODE_ORDER_MASK = 0xF0000,
+  MARISA_TRIE_TYPE_MASK = 0xF00000,
+  MARISA_CONFIG_MASK = 0xFFFFFF
+};
+
+#endif  // MARISA_ENUMS_H_
@@ -0,0 +1,90 @@
+#ifndef MARISA_FRONT_CODING_H_
+#define MARISA_FRONT_CODING_H_
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "marisa/base.h"
+
+namespace marisa {
+
+// Front coding writes a sequence of keys, such as the results of a
+// predictive search, as the length of the prefix that each key shares with
+// the previous one and the rest of the key. A block is a sequence of entries
+//   varint prefix_length, varint suffix_length, suffix
+// where a varint has 7 bits per byte from the lowest, and the highest bit is
+// set in all but the last byte. The first key of a block shares no prefix,
+// so a block is decoded by itself.
+
+// FrontCodedWriter appends keys to a block in a buffer of the caller.
+class FrontCodedWriter {
+ public:
+  FrontCodedWriter() = default;
+  FrontCodedWriter(char *buf, std::size_t buf_size) {
+    reset(buf, buf_size);
+  }
+
+  FrontCodedWriter(const FrontCodedWriter &) = delete;
+  FrontCodedWriter &operator=(const FrontCodedWriter &) = delete;
+
+  // reset() starts a new block in `buf` of `buf_size` bytes.
+  void reset(char *buf, std::size_t buf_size);
+
+  // append() writes `key` and returns true, or writes nothing and returns
+  // false if `key` does not fit in the rest of the buffer.
+  bool append(std::string_view key);
+
+  // size() returns the number of bytes written.
+  std::size_t size() const {
+    return pos_;
+  }
+  std::size_t num_keys() const {
+    return num_keys_;
+  }
+
+ private:
+  char *buf_ = nullptr;
+  std::size_t buf_size_ = 0;
+  std::size_t pos_ = 0;
+  std::size_t num_keys_ = 0;
+  // last_ is the last key written, which the next key is compared with.
+  std::string last_;
+};
+
+// FrontCodedReader decodes the keys of a block in order.
+class FrontCodedReader {
+ public:
+  FrontCodedReader() = default;
+  FrontCodedReader(const char *ptr, std::size_t size)
+      : ptr_(ptr), avail_(size) {}
+
+  // next() decodes the next key and returns true, or returns false at the
+  // end of the block. It throws std::runtime_error if the block is broken.
+  bool next();
+  // try_next() is the same as next() but never throws. It returns MARISA_OK,
+  // MARISA_FORMAT_ERROR if the block is broken, or MARISA_MEMORY_ERROR if
+  // key() fails to grow, which aborts instead in a build without exceptions.
+  // `found` receives the result on success.
+  ErrorCode try_next(bool *found) noexcept;
+
+  // key() is the last key decoded, and is valid until the next call of
+  // next().
+  std::string_view key() const {
+    return key_;
+  }
+
+ private:
+  const char *ptr_ = nullptr;
+  std::size_t avail_ = 0;
+  std::string key_;
+
+  // next_() returns false if the block is broken, and read_varint() returns
+  // false if the varint is truncated or does not fit in std::size_t.
+  bool next_(bool *found);
+  bool read_varint(std::size_t *value) noexcept;
+};
+
+}  // namespace marisa
+
+#endif  // MARISA_FRONT_CODING_H_
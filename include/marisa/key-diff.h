@@ -0,0 +1,46 @@
+#ifndef MARISA_KEY_DIFF_H_
+#define MARISA_KEY_DIFF_H_
+
+#include <functional>
+#include <string_view>
+
+#include "marisa/base.h"
+
+namespace marisa {
+
+// KeyDiff is passed to a DiffCallback by Trie::diff() for each key that is
+// added, removed or moved. old_id() is MARISA_INVALID_KEY_ID for an added key
+// and new_id() is MARISA_INVALID_KEY_ID for a removed key. key() is valid
+// only during the callback.
+class KeyDiff {
+ public:
+  KeyDiff() = default;
+  KeyDiff(DiffType type, std::string_view key, std::size_t old_id,
+          std::size_t new_id)
+      : type_(type), key_(key), old_id_(old_id), new_id_(new_id) {}
+
+  DiffType type() const {
+    return type_;
+  }
+  std::string_view key() const {
+    return key_;
+  }
+  std::size_t old_id() const {
+    return old_id_;
+  }
+  std::size_t new_id() const {
+    return new_id_;
+  }
+
+ private:
+  DiffType type_ = MARISA_KEY_ADDED;
+  std::string_view key_;
+  std::size_t old_id_ = MARISA_INVALID_KEY_ID;
+  std::size_t new_id_ = MARISA_INVALID_KEY_ID;
+};
+
+using DiffCallback = std::function<void(const KeyDiff &)>;
+
+}  // namespace marisa
+
+#endif  // MARISA_KEY_DIFF_H_
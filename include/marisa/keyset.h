@@ -31,6 +31,19 @@ public:
   void push_back(const char *str);
   void push_back(const char *ptr, std::size_t length, float weight = 1.0);
 
+  // deduplicate() removes duplicate keys and adds their weights to the first
+  // occurrences, which keep their order. This shrinks the input of build() if
+  // the same key is pushed many times. It must be called before build(),
+  // which overwrites weights with IDs, and the memory of removed keys is not
+  // released. `num_threads` == 0 means the number of hardware threads.
+  // Returns the number of removed keys.
+  std::size_t deduplicate(std::size_t num_threads = 0);
+
+  // append() moves the keys of `other` to the end of this keyset without
+  // copying their bytes, and leaves `other` empty. This merges keysets that
+  // are filled by different threads.
+  void append(Keyset &other);
+
   const Key &operator[](std::size_t i) const {
     assert(i < size_);
     return key_blocks_[i / KEY_BLOCK_SIZE][i % KEY_BLOCK_SIZE];
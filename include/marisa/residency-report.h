@@ -0,0 +1,100 @@
+#ifndef MARISA_RESIDENCY_REPORT_H_
+#define MARISA_RESIDENCY_REPORT_H_
+
+#include <vector>
+
+#include "marisa/base.h"
+
+namespace marisa {
+
+// SectionResidency tells how much of a section of a dictionary is in memory.
+// Sections are named after the members of a trie of the recursion:
+//  "cache":          the search cache.
+//  "louds":          the LOUDS bit vector.
+//  "terminal_flags": terminal flags, only in the first trie.
+//  "link_flags":     link flags.
+//  "bases":          labels and the lower bits of links.
+//  "extras":         the upper bits of links.
+//  "tail":           TAIL, only in the last trie.
+class SectionResidency {
+ public:
+  SectionResidency() = default;
+  SectionResidency(const char *name, std::size_t trie_id, std::size_t size,
+                   std::size_t resident_size)
+      : name_(name),
+        trie_id_(trie_id),
+        size_(size),
+        resident_size_(resident_size) {}
+
+  // name() returns one of the above static strings.
+  const char *name() const {
+    return name_;
+  }
+  // trie_id() starts at 1 for the first trie of the recursion.
+  std::size_t trie_id() const {
+    return trie_id_;
+  }
+  // size() and resident_size() are in bytes.
+  std::size_t size() const {
+    return size_;
+  }
+  std::size_t resident_size() const {
+    return resident_size_;
+  }
+
+ private:
+  const char *name_ = "";
+  std::size_t trie_id_ = 0;
+  std::size_t size_ = 0;
+  std::size_t resident_size_ = 0;
+};
+
+// ResidencyReport collects SectionResidencies, trie by trie.
+class ResidencyReport {
+ public:
+  ResidencyReport() = default;
+
+  void push_back(const SectionResidency &section) {
+    sections_.push_back(section);
+  }
+
+  const std::vector<SectionResidency> &sections() const {
+    return sections_;
+  }
+
+  std::size_t total_size() const {
+    std::size_t total = 0;
+    for (const SectionResidency &section : sections_) {
+      total += section.size();
+    }
+    return total;
+  }
+  std::size_t total_resident_size() const {
+    std::size_t total = 0;
+    for (const SectionResidency &section : sections_) {
+      total += section.resident_size();
+    }
+    return total;
+  }
+
+  bool empty() const {
+    return sections_.empty();
+  }
+  std::size_t size() const {
+    return sections_.size();
+  }
+
+  void clear() noexcept {
+    sections_.clear();
+  }
+  void swap(ResidencyReport &rhs) noexcept {
+    sections_.swap(rhs.sections_);
+  }
+
+ private:
+  std::vector<SectionResidency> sections_;
+};
+
+}  // namespace marisa
+
+#endif  // MARISA_RESIDENCY_REPORT_H_
@@ -2,25 +2,52 @@
 #define MARISA_TRIE_H_
 
 #include <memory>
-
-#include "marisa/agent.h"   // IWYU pragma: export
-#include "marisa/keyset.h"  // IWYU pragma: export
+#include <stdexcept>
+#include <string_view>
+#if __has_include(<span>)
+ #include <span>
+#endif  // __has_include(<span>)
+
+#include "marisa/agent.h"             // IWYU pragma: export
+#include "marisa/build-progress.h"    // IWYU pragma: export
+#include "marisa/build-report.h"      // IWYU pragma: export
+#include "marisa/front-coding.h"      // IWYU pragma: export
+#include "marisa/key-diff.h"          // IWYU pragma: export
+#include "marisa/keyset.h"            // IWYU pragma: export
+#include "marisa/residency-report.h"  // IWYU pragma: export
 
 namespace marisa {
+namespace grimoire::io {
+
+class Mapper;
+class Reader;
+class Writer;
+
+}  // namespace grimoire::io
+
 namespace grimoire::trie {
 
+class BuildMonitor;
+class CentroidTrie;
+class DfudsTrie;
 class LoudsTrie;
 
 }  // namespace grimoire::trie
 
+class AsyncTrie;
 class TrieSerializer;
 
 class Trie {
+  friend class AsyncTrie;
   friend class TrieIO;
   friend class TrieSerializer;
 
 public:
   Trie();
+  // This constructor maps a dictionary image in memory, such as an array
+  // generated by marisa-embed, without copying it. `ptr` must be aligned to
+  // 8 bytes and outlive the trie.
+  Trie(const void *ptr, std::size_t size);
   ~Trie();
 
   Trie(const Trie &) = delete;
@@ -30,29 +57,126 @@ public:
   Trie &operator=(Trie &&) noexcept;
 
   void build(Keyset &keyset, int config_flags = 0);
+  // This overload also records the time and memory of each build phase in
+  // `report`.
+  void build(Keyset &keyset, int config_flags, BuildReport &report);
+  // This overload calls `callback` periodically and throws BuildCancelled
+  // when it returns false. `report` is filled only if the build completes.
+  void build(Keyset &keyset, int config_flags, const BuildCallback &callback,
+             BuildReport *report = nullptr);
+  // This overload builds a dictionary from `num_keys` keys without copying
+  // them into a Keyset, so the keys must stay valid during the build.
+  // `weights` may be nullptr, in which case every weight is 1.0. If `ids` is
+  // not nullptr, ids[i] receives the ID of keys[i].
+  void build(const std::string_view *keys, std::size_t num_keys,
+             const float *weights, int config_flags, uint32_t *ids);
+#ifdef __cpp_lib_span
+  // `weights` and `ids` must be empty or as long as `keys`.
+  void build(std::span<const std::string_view> keys,
+             std::span<const float> weights = {}, int config_flags = 0,
+             std::span<uint32_t> ids = {}) {
+    MARISA_THROW_IF(!weights.empty() && (weights.size() != keys.size()),
+                    std::invalid_argument);
+    MARISA_THROW_IF(!ids.empty() && (ids.size() != keys.size()),
+                    std::invalid_argument);
+    build(keys.data(), keys.size(), weights.empty() ? nullptr : weights.data(),
+          config_flags, ids.empty() ? nullptr : ids.data());
+  }
+#endif  // __cpp_lib_span
 
   bool lookup(Agent &agent) const;
   void reverse_lookup(Agent &agent) const;
   bool common_prefix_search(Agent &agent) const;
   bool predictive_search(Agent &agent) const;
+  // predictive_count() returns the number of keys that predictive_search()
+  // finds for the query of `agent`, and resets the search of `agent`. A
+  // MARISA_DFUDS_TRIE gives the keys below a node consecutive IDs, so it
+  // counts them with a rank at each end of the subtree, while the other
+  // tries enumerate them.
+  std::size_t predictive_count(Agent &agent) const;
+
+  // The try_ versions of the above never throw and are safe to call from
+  // code built without exceptions. They return MARISA_OK, MARISA_STATE_ERROR
+  // for a trie that is neither built nor loaded, MARISA_BOUND_ERROR for a key
+  // ID out of range, or MARISA_MEMORY_ERROR if the agent fails to grow its
+  // buffers, which aborts instead in a build without exceptions.
+  // `found` receives the result on success.
+  ErrorCode try_lookup(Agent &agent, bool *found) const noexcept;
+  ErrorCode try_reverse_lookup(Agent &agent) const noexcept;
+  ErrorCode try_common_prefix_search(Agent &agent, bool *found) const noexcept;
+  ErrorCode try_predictive_search(Agent &agent, bool *found) const noexcept;
 
   std::size_t num_tries() const;
   std::size_t num_keys() const;
   std::size_t num_nodes() const;
 
+  // A trie built with MARISA_CENTROID_TRIE reports 1 trie, MARISA_BINARY_TAIL
+  // and MARISA_LABEL_ORDER, and one built with MARISA_DFUDS_TRIE reports 1
+  // trie, its tail mode and MARISA_LABEL_ORDER.
   TailMode tail_mode() const;
   NodeOrder node_order() const;
+  TrieType trie_type() const;
 
   bool empty() const;
   std::size_t size() const;
   std::size_t total_size() const;
   std::size_t io_size() const;
 
+  // rebuild_cache() replaces the search cache, built with the cache level
+  // given to build(), by a heap-allocated one of `cache_level`. This is
+  // useful for a memory-mapped dictionary. clear_cache() minimizes the cache.
+  // Keys are weighted by the number of keys sharing their prefixes, because
+  // weights are not stored. Neither is thread-safe with searches. If either
+  // throws, the cache is unchanged. Both do nothing for a MARISA_CENTROID_TRIE
+  // or a MARISA_DFUDS_TRIE, which have no cache.
+  void rebuild_cache(CacheLevel cache_level);
+  void clear_cache();
+
+  // warmup() faults in the pages of a dictionary in priority order, so that
+  // the first queries after startup do not wait for disk reads. `flags` is a
+  // combination of marisa_warmup_flags, and MARISA_WARMUP_SAMPLE requires
+  // `sample`, whose keys are looked up.
+  void warmup(int flags = MARISA_WARMUP_HOT,
+              const Keyset *sample = nullptr) const;
+  // residency() reports the bytes of each section that are in memory.
+  ResidencyReport residency() const;
+
+  // diff() walks `old_trie` and `new_trie` in lockstep and calls `callback`
+  // for each key that is added, removed or moved to another ID, in
+  // lexicographic order. Keys with the same IDs are not reported. The tries
+  // may be built with different settings, but must be MARISA_LOUDS_TRIE.
+  static void diff(const Trie &old_trie, const Trie &new_trie,
+                   const DiffCallback &callback);
+
   void clear() noexcept;
   void swap(Trie &rhs) noexcept;
 
 private:
+  // trie_ is always allocated, and centroid_trie_ or dfuds_trie_ replaces it
+  // if the dictionary is a MARISA_CENTROID_TRIE or a MARISA_DFUDS_TRIE.
   std::unique_ptr<grimoire::trie::LoudsTrie> trie_;
+  std::unique_ptr<grimoire::trie::CentroidTrie> centroid_trie_;
+  std::unique_ptr<grimoire::trie::DfudsTrie> dfuds_trie_;
+
+  bool is_louds_() const {
+    return (centroid_trie_ == nullptr) && (dfuds_trie_ == nullptr);
+  }
+  // is_built_() returns false for a trie that is neither built nor loaded,
+  // whose queries, statistics and serialization throw std::logic_error.
+  bool is_built_() const;
+  // build_() builds the backend that `config_flags` specify from `keys`,
+  // a Keyset or an array of keys, and replaces this trie with it.
+  template <typename Keys>
+  void build_(Keys &keys, int config_flags,
+              grimoire::trie::BuildMonitor &monitor);
+  // dispatch_() calls `f` with the trie in use.
+  template <typename F>
+  decltype(auto) dispatch_(F &&f) const;
+
+  // These read the header and load either trie, and write the one in use.
+  void map_(grimoire::io::Mapper &mapper);
+  void read_(grimoire::io::Reader &reader);
+  void write_(grimoire::io::Writer &writer, int flags) const;
 };
 
 class TrieSerializer {
@@ -66,8 +190,23 @@ public:
   void load(const char *filename);
   void read(int fd);
 
-  void save(const char *filename) const;
-  void write(int fd) const;
+  // `flags` is a combination of marisa_save_flags. write() does not accept
+  // MARISA_SAVE_ATOMIC.
+  void save(const char *filename, int flags = 0) const;
+  void write(int fd, int flags = 0) const;
+
+  // save_compressed() saves a dictionary as independently compressed chunks
+  // and load_compressed() decompresses them in parallel into one image that
+  // the trie maps without copying. `num_threads` == 0 means the number of
+  // hardware threads. These throw std::invalid_argument if the codec is not
+  // available, see has_codec().
+  void save_compressed(const char *filename, int flags = 0,
+                       Codec codec = MARISA_DEFAULT_CODEC,
+                       std::size_t num_threads = 0) const;
+  void load_compressed(const char *filename, std::size_t num_threads = 0);
+
+  // has_codec() returns true if the library is built with `codec`.
+  static bool has_codec(Codec codec);
 
 private:
   Trie& trie_;
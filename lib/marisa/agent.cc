@@ -15,6 +15,7 @@ void UpdateAgentAfterCopyingState(const grimoire::trie::State &state,
   // Point the agent's key to the newly copied buffer if necessary.
   switch (state.status_code()) {
     case grimoire::trie::MARISA_READY_TO_PREDICTIVE_SEARCH:
+    case grimoire::trie::MARISA_READY_TO_EXTEND_PREDICTIVE_SEARCH:
     case grimoire::trie::MARISA_END_OF_PREDICTIVE_SEARCH:
       // In states corresponding to predictive_search, the agent's
       // key points into the state key buffer. We need to repoint
@@ -75,6 +76,25 @@ void Agent::set_query(const char *ptr, std::size_t length) {
   query_.set_str(ptr, length);
 }
 
+void Agent::extend_query(const char *ptr, std::size_t length) {
+  MARISA_THROW_IF((ptr == nullptr) && (length != 0), std::invalid_argument);
+  MARISA_THROW_IF(length < query_.length(), std::invalid_argument);
+  if (state_ != nullptr) {
+    switch (state_->status_code()) {
+      case grimoire::trie::MARISA_READY_TO_PREDICTIVE_SEARCH:
+      case grimoire::trie::MARISA_READY_TO_EXTEND_PREDICTIVE_SEARCH:
+      case grimoire::trie::MARISA_END_OF_PREDICTIVE_SEARCH:
+        state_->set_status_code(
+            grimoire::trie::MARISA_READY_TO_EXTEND_PREDICTIVE_SEARCH);
+        break;
+      default:
+        state_->reset();
+        break;
+    }
+  }
+  query_.set_str(ptr, length);
+}
+
 void Agent::set_query(std::size_t key_id) {
   if (state_ != nullptr) {
     state_->reset();
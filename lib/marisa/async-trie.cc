@@ -0,0 +1,92 @@
+#include "marisa/async-trie.h"
+
+#ifdef MARISA_HAS_ASYNC_TRIE
+
+ #include <algorithm>
+ #include <stdexcept>
+ #include <vector>
+
+ #include "marisa/grimoire/trie.h"
+
+namespace marisa {
+
+AsyncTrie::AsyncTrie(const Trie &trie)
+    : trie_(trie), residency_(new grimoire::io::Residency) {
+  MARISA_THROW_IF(!trie_.is_built_(), std::logic_error);
+  MARISA_THROW_IF(!trie_.is_louds_(), std::logic_error);
+  const grimoire::io::Mapper &mapper = trie_.trie_->mapper();
+  residency_->reset(mapper.file_data(), mapper.file_size());
+}
+
+AsyncTrie::~AsyncTrie() = default;
+
+LookupTask AsyncTrie::lookup(Agent &agent) const {
+  const grimoire::trie::LoudsTrie &trie = *trie_.trie_;
+  trie.lookup_init(agent);
+  bool found = false;
+  do {
+    for (std::size_t i = 0; (i < MAX_SUSPENSIONS_PER_STEP) &&
+                            !trie.prefetch_step(agent, *residency_);
+         ++i) {
+      num_suspensions_.fetch_add(1, std::memory_order_relaxed);
+      co_await std::suspend_always();
+    }
+  } while (trie.lookup_step(agent, &found));
+  co_return found;
+}
+
+std::size_t AsyncTrie::lookup(Agent *agents, bool *found,
+                              std::size_t num_agents,
+                              std::size_t max_in_flight) const {
+  MARISA_THROW_IF((agents == nullptr) && (num_agents != 0),
+                  std::invalid_argument);
+  MARISA_THROW_IF((found == nullptr) && (num_agents != 0),
+                  std::invalid_argument);
+  MARISA_THROW_IF(max_in_flight == 0, std::invalid_argument);
+
+  std::vector<LookupTask> tasks(std::min(num_agents, max_in_flight));
+  std::vector<std::size_t> ids(tasks.size());
+  std::size_t next_id = 0;
+  for (std::size_t i = 0; i < tasks.size(); ++i) {
+    tasks[i] = lookup(agents[next_id]);
+    ids[i] = next_id++;
+  }
+
+  // Tasks are resumed in round-robin order, and a finished task is replaced
+  // by the next query.
+  std::size_t num_found = 0;
+  std::size_t num_running = tasks.size();
+  while (num_running != 0) {
+    for (std::size_t i = 0; i < tasks.size(); ++i) {
+      if (tasks[i].done()) {
+        continue;
+      }
+      tasks[i].resume();
+      if (!tasks[i].done()) {
+        continue;
+      }
+      found[ids[i]] = tasks[i].found();
+      num_found += found[ids[i]] ? 1 : 0;
+      if (next_id < num_agents) {
+        tasks[i] = lookup(agents[next_id]);
+        ids[i] = next_id++;
+      } else {
+        tasks[i] = LookupTask();
+        --num_running;
+      }
+    }
+  }
+  return num_found;
+}
+
+std::size_t AsyncTrie::num_resident_pages() const {
+  return residency_->num_resident_pages();
+}
+
+std::size_t AsyncTrie::num_pages() const {
+  return residency_->num_pages();
+}
+
+}  // namespace marisa
+
+#endif  // MARISA_HAS_ASYNC_TRIE
@@ -0,0 +1,14 @@
+#include "marisa/base.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace marisa {
+
+void fail(const char *message) noexcept {
+  std::fputs(message, stderr);
+  std::fputc('\n', stderr);
+  std::abort();
+}
+
+}  // namespace marisa
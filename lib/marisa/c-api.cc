@@ -0,0 +1,535 @@
+#include "marisa/c-api.h"
+
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "marisa/trie.h"
+
+struct marisa_trie {
+  marisa::Trie trie;
+};
+
+struct marisa_predictive_iter {
+  const marisa::Trie *trie = nullptr;
+  std::string prefix;
+  marisa::Agent agent;
+  // `pending` means that the current key of `agent` has not been returned.
+  bool pending = false;
+  bool done = false;
+  // `writer` is kept to reuse the buffer of its last key.
+  marisa::FrontCodedWriter writer;
+};
+
+namespace {
+
+thread_local std::string last_error;
+
+int set_error(int error_code, const char *message) noexcept {
+#if MARISA_USE_EXCEPTIONS
+  try {
+    last_error = message;
+  } catch (...) {
+    last_error.clear();
+  }
+#else   // MARISA_USE_EXCEPTIONS
+  last_error = message;
+#endif  // MARISA_USE_EXCEPTIONS
+  return error_code;
+}
+
+#if MARISA_USE_EXCEPTIONS
+// handle_exception() converts the current exception into an error code.
+int handle_exception() noexcept {
+  try {
+    throw;
+  } catch (const std::bad_alloc &ex) {
+    return set_error(MARISA_MEMORY_ERROR, ex.what());
+  } catch (const std::system_error &ex) {
+    return set_error(MARISA_IO_ERROR, ex.what());
+  } catch (const std::out_of_range &ex) {
+    return set_error(MARISA_BOUND_ERROR, ex.what());
+  } catch (const std::length_error &ex) {
+    return set_error(MARISA_SIZE_ERROR, ex.what());
+  } catch (const std::invalid_argument &ex) {
+    return set_error(MARISA_NULL_ERROR, ex.what());
+  } catch (const std::logic_error &ex) {
+    return set_error(MARISA_STATE_ERROR, ex.what());
+  } catch (const std::runtime_error &ex) {
+    return set_error(MARISA_FORMAT_ERROR, ex.what());
+  } catch (const std::exception &ex) {
+    return set_error(MARISA_STATE_ERROR, ex.what());
+  } catch (...) {
+    return set_error(MARISA_STATE_ERROR, "unknown exception");
+  }
+}
+#endif  // MARISA_USE_EXCEPTIONS
+
+// invoke() calls `func`, which returns an error code, and converts an
+// exception into an error code. If the library is built without exceptions,
+// only the errors that `func` returns are reported, and the others abort.
+template <typename Func>
+int invoke(const Func &func) noexcept {
+#if MARISA_USE_EXCEPTIONS
+  try {
+    return func();
+  } catch (...) {
+    return handle_exception();
+  }
+#else   // MARISA_USE_EXCEPTIONS
+  return func();
+#endif  // MARISA_USE_EXCEPTIONS
+}
+
+// The query functions report their errors without exceptions, so that they
+// work in the same way if the library is built without exceptions.
+
+int null_error(const char *message) noexcept {
+  return set_error(MARISA_NULL_ERROR, message);
+}
+
+int query_error(marisa::ErrorCode error_code) noexcept {
+  switch (error_code) {
+    case MARISA_STATE_ERROR:
+      return set_error(error_code, "trie not built");
+    case MARISA_BOUND_ERROR:
+      return set_error(error_code, "key ID out of range");
+    case MARISA_FORMAT_ERROR:
+      return set_error(error_code, "broken front-coded block");
+    default:
+      return set_error(error_code, "failed to allocate memory");
+  }
+}
+
+int size_error() noexcept {
+  return set_error(MARISA_SIZE_ERROR, "buffer too small for the next result");
+}
+
+// fetch_next() moves `iter` to the next key unless the current one is
+// pending, and `found` receives false at the end.
+int fetch_next(marisa_predictive_iter *iter, bool *found) noexcept {
+  if (iter->pending) {
+    *found = true;
+    return MARISA_OK;
+  }
+  *found = false;
+  if (!iter->done) {
+    const marisa::ErrorCode query_code =
+        iter->trie->try_predictive_search(iter->agent, found);
+    if (query_code != MARISA_OK) {
+      return query_error(query_code);
+    }
+  }
+  iter->done = !*found;
+  iter->pending = *found;
+  return MARISA_OK;
+}
+
+// check_batch() validates a batch of keys.
+int check_batch(const char *keys, const size_t *offsets,
+                size_t num_keys) noexcept {
+  if (num_keys == 0) {
+    return MARISA_OK;
+  }
+  if (offsets == nullptr) {
+    return null_error("offsets == nullptr");
+  }
+  if ((keys == nullptr) && (offsets[num_keys] != offsets[0])) {
+    return null_error("keys == nullptr");
+  }
+  for (size_t i = 0; i < num_keys; ++i) {
+    if (offsets[i] > offsets[i + 1]) {
+      return null_error("offsets[i] > offsets[i + 1]");
+    }
+  }
+  return MARISA_OK;
+}
+
+std::string_view get_key(const char *keys, const size_t *offsets, size_t i) {
+  return std::string_view(keys + offsets[i], offsets[i + 1] - offsets[i]);
+}
+
+}  // namespace
+
+const char *marisa_last_error(void) {
+  return last_error.c_str();
+}
+
+int marisa_trie_new(marisa_trie **trie) {
+  return invoke([&]() -> int {
+    if (trie == nullptr) {
+      return null_error("trie == nullptr");
+    }
+    // A new trie is an empty dictionary rather than an unbuilt one, whose
+    // queries would fail.
+    std::unique_ptr<marisa_trie> temp(new marisa_trie);
+    marisa::Keyset keyset;
+    temp->trie.build(keyset);
+    *trie = temp.release();
+    return MARISA_OK;
+  });
+}
+
+void marisa_trie_free(marisa_trie *trie) {
+  delete trie;
+}
+
+int marisa_trie_build(marisa_trie *trie, const char *keys,
+                      const size_t *offsets, size_t num_keys,
+                      const float *weights, int config_flags, uint32_t *ids) {
+  return invoke([&]() -> int {
+    if (trie == nullptr) {
+      return null_error("trie == nullptr");
+    }
+    const int error_code = check_batch(keys, offsets, num_keys);
+    if (error_code != MARISA_OK) {
+      return error_code;
+    }
+    std::vector<std::string_view> key_views(num_keys);
+    for (size_t i = 0; i < num_keys; ++i) {
+      key_views[i] = get_key(keys, offsets, i);
+    }
+    trie->trie.build(key_views.data(), key_views.size(), weights, config_flags,
+                     ids);
+    return MARISA_OK;
+  });
+}
+
+int marisa_trie_mmap(marisa_trie *trie, const char *filename, int flags) {
+  return invoke([&]() -> int {
+    if (trie == nullptr) {
+      return null_error("trie == nullptr");
+    }
+    marisa::TrieSerializer(trie->trie).mmap(filename, flags);
+    return MARISA_OK;
+  });
+}
+
+int marisa_trie_map(marisa_trie *trie, const void *ptr, size_t size) {
+  return invoke([&]() -> int {
+    if (trie == nullptr) {
+      return null_error("trie == nullptr");
+    }
+    marisa::TrieSerializer(trie->trie).map(ptr, size);
+    return MARISA_OK;
+  });
+}
+
+int marisa_trie_load(marisa_trie *trie, const char *filename) {
+  return invoke([&]() -> int {
+    if (trie == nullptr) {
+      return null_error("trie == nullptr");
+    }
+    marisa::TrieSerializer(trie->trie).load(filename);
+    return MARISA_OK;
+  });
+}
+
+int marisa_trie_save(const marisa_trie *trie, const char *filename,
+                     int flags) {
+  return invoke([&]() -> int {
+    if (trie == nullptr) {
+      return null_error("trie == nullptr");
+    }
+    // TrieSerializer takes a non-const reference for loading, but save()
+    // doesn't modify the trie.
+    marisa::TrieSerializer(const_cast<marisa::Trie &>(trie->trie))
+        .save(filename, flags);
+    return MARISA_OK;
+  });
+}
+
+size_t marisa_trie_num_keys(const marisa_trie *trie) {
+  return (trie != nullptr) ? trie->trie.num_keys() : 0;
+}
+
+size_t marisa_trie_num_nodes(const marisa_trie *trie) {
+  return (trie != nullptr) ? trie->trie.num_nodes() : 0;
+}
+
+size_t marisa_trie_io_size(const marisa_trie *trie) {
+  return (trie != nullptr) ? trie->trie.io_size() : 0;
+}
+
+int marisa_trie_lookup_batch(const marisa_trie *trie, const char *keys,
+                             const size_t *offsets, size_t num_keys,
+                             uint32_t *ids) {
+  return invoke([&]() -> int {
+    if (trie == nullptr) {
+      return null_error("trie == nullptr");
+    }
+    if ((ids == nullptr) && (num_keys != 0)) {
+      return null_error("ids == nullptr");
+    }
+    const int error_code = check_batch(keys, offsets, num_keys);
+    if (error_code != MARISA_OK) {
+      return error_code;
+    }
+    marisa::Agent agent;
+    for (size_t i = 0; i < num_keys; ++i) {
+      agent.set_query(get_key(keys, offsets, i));
+      bool found;
+      const marisa::ErrorCode query_code = trie->trie.try_lookup(agent, &found);
+      if (query_code != MARISA_OK) {
+        return query_error(query_code);
+      }
+      ids[i] = found ? static_cast<uint32_t>(agent.key().id())
+                     : MARISA_INVALID_KEY_ID;
+    }
+    return MARISA_OK;
+  });
+}
+
+int marisa_trie_reverse_lookup_batch(const marisa_trie *trie,
+                                     const uint32_t *ids, size_t num_ids,
+                                     char *buf, size_t buf_size,
+                                     size_t *offsets, size_t *num_restored) {
+  return invoke([&]() -> int {
+    if ((trie == nullptr) || (offsets == nullptr) ||
+        (num_restored == nullptr)) {
+      return null_error("trie, offsets or num_restored == nullptr");
+    }
+    if (((ids == nullptr) && (num_ids != 0)) ||
+        ((buf == nullptr) && (buf_size != 0))) {
+      return null_error("ids or buf == nullptr");
+    }
+    *num_restored = 0;
+    offsets[0] = 0;
+    marisa::Agent agent;
+    size_t pos = 0;
+    for (size_t i = 0; i < num_ids; ++i) {
+      agent.set_query(static_cast<std::size_t>(ids[i]));
+      const marisa::ErrorCode query_code = trie->trie.try_reverse_lookup(agent);
+      if (query_code != MARISA_OK) {
+        return query_error(query_code);
+      }
+      const std::string_view key = agent.key().str();
+      if (key.length() > (buf_size - pos)) {
+        return (i == 0) ? size_error() : MARISA_OK;
+      }
+      if (!key.empty()) {
+        std::memcpy(buf + pos, key.data(), key.length());
+      }
+      pos += key.length();
+      offsets[i + 1] = pos;
+      *num_restored = i + 1;
+    }
+    return MARISA_OK;
+  });
+}
+
+int marisa_trie_common_prefix_search_batch(
+    const marisa_trie *trie, const char *keys, const size_t *offsets,
+    size_t num_keys, uint32_t *ids, size_t *lengths, size_t capacity,
+    size_t *result_offsets, size_t *num_searched) {
+  return invoke([&]() -> int {
+    if ((trie == nullptr) || (result_offsets == nullptr) ||
+        (num_searched == nullptr)) {
+      return null_error("trie, result_offsets or num_searched == nullptr");
+    }
+    if (((ids == nullptr) || (lengths == nullptr)) && (capacity != 0)) {
+      return null_error("ids or lengths == nullptr");
+    }
+    const int error_code = check_batch(keys, offsets, num_keys);
+    if (error_code != MARISA_OK) {
+      return error_code;
+    }
+    *num_searched = 0;
+    result_offsets[0] = 0;
+    marisa::Agent agent;
+    size_t num_results = 0;
+    for (size_t i = 0; i < num_keys; ++i) {
+      agent.set_query(get_key(keys, offsets, i));
+      // The results of a key that don't fit are discarded as a whole.
+      size_t end = num_results;
+      for (;;) {
+        bool found;
+        const marisa::ErrorCode query_code =
+            trie->trie.try_common_prefix_search(agent, &found);
+        if (query_code != MARISA_OK) {
+          return query_error(query_code);
+        }
+        if (!found) {
+          break;
+        }
+        if (end == capacity) {
+          return (i == 0) ? size_error() : MARISA_OK;
+        }
+        ids[end] = static_cast<uint32_t>(agent.key().id());
+        lengths[end] = agent.key().length();
+        ++end;
+      }
+      num_results = end;
+      result_offsets[i + 1] = num_results;
+      *num_searched = i + 1;
+    }
+    return MARISA_OK;
+  });
+}
+
+int marisa_trie_predictive_iter(const marisa_trie *trie, const char *prefix,
+                                size_t length, marisa_predictive_iter **iter) {
+  return invoke([&]() -> int {
+    if ((trie == nullptr) || (iter == nullptr)) {
+      return null_error("trie or iter == nullptr");
+    }
+    if ((prefix == nullptr) && (length != 0)) {
+      return null_error("prefix == nullptr");
+    }
+    std::unique_ptr<marisa_predictive_iter> temp(new marisa_predictive_iter);
+    temp->trie = &trie->trie;
+    // The agent refers to the query, so the iterator keeps a copy of it.
+    temp->prefix.assign(prefix, length);
+    temp->agent.set_query(temp->prefix);
+    *iter = temp.release();
+    return MARISA_OK;
+  });
+}
+
+void marisa_predictive_iter_free(marisa_predictive_iter *iter) {
+  delete iter;
+}
+
+int marisa_predictive_iter_extend(marisa_predictive_iter *iter,
+                                  const char *suffix, size_t length) {
+  return invoke([&]() -> int {
+    if (iter == nullptr) {
+      return null_error("iter == nullptr");
+    }
+    if ((suffix == nullptr) && (length != 0)) {
+      return null_error("suffix == nullptr");
+    }
+    if (length != 0) {
+      iter->prefix.append(suffix, length);
+    }
+    iter->agent.extend_query(iter->prefix);
+    iter->pending = false;
+    iter->done = false;
+    return MARISA_OK;
+  });
+}
+
+int marisa_predictive_iter_next(marisa_predictive_iter *iter, uint32_t *ids,
+                                char *buf, size_t buf_size, size_t *offsets,
+                                size_t max_results, size_t *num_results) {
+  return invoke([&]() -> int {
+    if ((iter == nullptr) || (offsets == nullptr) ||
+        (num_results == nullptr)) {
+      return null_error("iter, offsets or num_results == nullptr");
+    }
+    if (((ids == nullptr) && (max_results != 0)) ||
+        ((buf == nullptr) && (buf_size != 0))) {
+      return null_error("ids or buf == nullptr");
+    }
+    *num_results = 0;
+    offsets[0] = 0;
+    size_t pos = 0;
+    for (size_t i = 0; i < max_results; ++i) {
+      bool found = false;
+      const int error_code = fetch_next(iter, &found);
+      if (error_code != MARISA_OK) {
+        return error_code;
+      }
+      if (!found) {
+        break;
+      }
+      const std::string_view key = iter->agent.key().str();
+      if (key.length() > (buf_size - pos)) {
+        return (i == 0) ? size_error() : MARISA_OK;
+      }
+      if (!key.empty()) {
+        std::memcpy(buf + pos, key.data(), key.length());
+      }
+      ids[i] = static_cast<uint32_t>(iter->agent.key().id());
+      pos += key.length();
+      offsets[i + 1] = pos;
+      iter->pending = false;
+      *num_results = i + 1;
+    }
+    return MARISA_OK;
+  });
+}
+
+int marisa_predictive_iter_next_front_coded(marisa_predictive_iter *iter,
+                                            uint32_t *ids, char *buf,
+                                            size_t buf_size,
+                                            size_t max_results,
+                                            size_t *num_results,
+                                            size_t *block_size) {
+  return invoke([&]() -> int {
+    if ((iter == nullptr) || (num_results == nullptr) ||
+        (block_size == nullptr)) {
+      return null_error("iter, num_results or block_size == nullptr");
+    }
+    if (((ids == nullptr) && (max_results != 0)) ||
+        ((buf == nullptr) && (buf_size != 0))) {
+      return null_error("ids or buf == nullptr");
+    }
+    *num_results = 0;
+    *block_size = 0;
+    iter->writer.reset(buf, buf_size);
+    for (size_t i = 0; i < max_results; ++i) {
+      bool found = false;
+      const int error_code = fetch_next(iter, &found);
+      if (error_code != MARISA_OK) {
+        return error_code;
+      }
+      if (!found) {
+        break;
+      }
+      if (!iter->writer.append(iter->agent.key().str())) {
+        return (i == 0) ? size_error() : MARISA_OK;
+      }
+      ids[i] = static_cast<uint32_t>(iter->agent.key().id());
+      iter->pending = false;
+      *num_results = i + 1;
+      *block_size = iter->writer.size();
+    }
+    return MARISA_OK;
+  });
+}
+
+int marisa_front_coded_decode(const char *block, size_t block_size, char *buf,
+                              size_t buf_size, size_t *offsets,
+                              size_t max_keys, size_t *num_keys) {
+  return invoke([&]() -> int {
+    if ((offsets == nullptr) || (num_keys == nullptr)) {
+      return null_error("offsets or num_keys == nullptr");
+    }
+    if (((block == nullptr) && (block_size != 0)) ||
+        ((buf == nullptr) && (buf_size != 0))) {
+      return null_error("block or buf == nullptr");
+    }
+    *num_keys = 0;
+    offsets[0] = 0;
+    size_t pos = 0;
+    marisa::FrontCodedReader reader(block, block_size);
+    for (size_t i = 0; i < max_keys; ++i) {
+      bool found;
+      const marisa::ErrorCode read_code = reader.try_next(&found);
+      if (read_code != MARISA_OK) {
+        return query_error(read_code);
+      }
+      if (!found) {
+        break;
+      }
+      const std::string_view key = reader.key();
+      if (key.length() > (buf_size - pos)) {
+        return set_error(MARISA_SIZE_ERROR, "buffer too small for a key");
+      }
+      if (!key.empty()) {
+        std::memcpy(buf + pos, key.data(), key.length());
+      }
+      pos += key.length();
+      offsets[i + 1] = pos;
+      *num_keys = i + 1;
+    }
+    return MARISA_OK;
+  });
+}
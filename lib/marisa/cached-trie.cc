@@ -0,0 +1,235 @@
+#include "marisa/cached-trie.h"
+
+#include <atomic>
+#include <cstring>
+
+#include "marisa/grimoire/trie/seqlock-table.h"
+
+namespace marisa {
+namespace grimoire::trie {
+namespace {
+
+// Keys up to MAX_KEY_LENGTH bytes are stored in KEY_WORDS words.
+constexpr std::size_t MAX_KEY_LENGTH = 48;
+constexpr std::size_t KEY_WORDS = MAX_KEY_LENGTH / sizeof(uint64_t);
+
+// Queries with more prefix keys than this are not cached.
+constexpr std::size_t MAX_PREFIXES = 8;
+
+// Counters are sharded by thread to avoid contention.
+constexpr std::size_t NUM_SHARDS = 64;
+
+uint64_t hash_key(const uint64_t *words) {
+  uint64_t hash = 0;
+  for (std::size_t i = 0; i < KEY_WORDS; ++i) {
+    hash = (hash ^ words[i]) * 0x9E3779B97F4A7C15ULL;
+    hash ^= hash >> 29;
+  }
+  hash ^= hash >> 32;
+  hash *= 0xD6E8FEB86659FD93ULL;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+std::size_t get_shard_id() {
+  static std::atomic<std::size_t> num_threads{0};
+  thread_local const std::size_t shard_id =
+      num_threads.fetch_add(1, std::memory_order_relaxed) % NUM_SHARDS;
+  return shard_id;
+}
+
+}  // namespace
+
+// QueryCache holds the tables of CachedTrie. The first word of a slot is
+// packed as follows:
+//  lookup: 1 | (found << 1) | (key length << 8) | (key ID << 32)
+//  common prefix search: 1 | (number of keys << 8) | (query length << 16)
+// and followed by the zero-padded query. The slot of common prefix search
+// ends with (key ID | (key length << 32)) for each prefix key.
+class QueryCache {
+ public:
+  using LookupTable = SeqlockTable<1 + KEY_WORDS>;
+  using PrefixTable = SeqlockTable<1 + KEY_WORDS + MAX_PREFIXES>;
+
+  struct alignas(64) Shard {
+    std::atomic<std::size_t> lookup_hits{0};
+    std::atomic<std::size_t> lookup_misses{0};
+    std::atomic<std::size_t> prefix_hits{0};
+    std::atomic<std::size_t> prefix_misses{0};
+  };
+
+  QueryCache(std::size_t lookup_cache_size, std::size_t prefix_cache_size) {
+    lookups_.reset(lookup_cache_size);
+    prefixes_.reset(prefix_cache_size);
+  }
+
+  QueryCache(const QueryCache &) = delete;
+  QueryCache &operator=(const QueryCache &) = delete;
+
+  LookupTable &lookups() {
+    return lookups_;
+  }
+  PrefixTable &prefixes() {
+    return prefixes_;
+  }
+  Shard &shard() {
+    return shards_[get_shard_id()];
+  }
+
+  CachedTrie::Stats stats() const {
+    CachedTrie::Stats stats;
+    for (const Shard &shard : shards_) {
+      stats.lookup_hits += shard.lookup_hits.load(std::memory_order_relaxed);
+      stats.lookup_misses +=
+          shard.lookup_misses.load(std::memory_order_relaxed);
+      stats.prefix_hits += shard.prefix_hits.load(std::memory_order_relaxed);
+      stats.prefix_misses +=
+          shard.prefix_misses.load(std::memory_order_relaxed);
+    }
+    return stats;
+  }
+
+  std::size_t total_size() const {
+    return lookups_.total_size() + prefixes_.total_size() + sizeof(shards_);
+  }
+
+  void clear() {
+    lookups_.erase();
+    prefixes_.erase();
+    for (Shard &shard : shards_) {
+      shard.lookup_hits.store(0, std::memory_order_relaxed);
+      shard.lookup_misses.store(0, std::memory_order_relaxed);
+      shard.prefix_hits.store(0, std::memory_order_relaxed);
+      shard.prefix_misses.store(0, std::memory_order_relaxed);
+    }
+  }
+
+ private:
+  LookupTable lookups_;
+  PrefixTable prefixes_;
+  Shard shards_[NUM_SHARDS];
+};
+
+}  // namespace grimoire::trie
+
+namespace {
+
+using grimoire::trie::KEY_WORDS;
+using grimoire::trie::MAX_KEY_LENGTH;
+using grimoire::trie::MAX_PREFIXES;
+
+// pack_query() copies a query into zero-padded words.
+void pack_query(const Query &query, uint64_t *words) {
+  std::memset(words, 0, MAX_KEY_LENGTH);
+  if (query.length() != 0) {
+    std::memcpy(words, query.ptr(), query.length());
+  }
+}
+
+}  // namespace
+
+CachedTrie::CachedTrie(const Trie &trie, std::size_t lookup_cache_size,
+                       std::size_t prefix_cache_size)
+    : trie_(trie),
+      cache_(new grimoire::trie::QueryCache(lookup_cache_size,
+                                            prefix_cache_size)) {}
+
+CachedTrie::~CachedTrie() = default;
+
+bool CachedTrie::lookup(Agent &agent) const {
+  const Query &query = agent.query();
+  if (query.length() > MAX_KEY_LENGTH) {
+    return trie_.lookup(agent);
+  }
+
+  uint64_t words[1 + KEY_WORDS];
+  pack_query(query, words + 1);
+  const uint64_t hash = grimoire::trie::hash_key(words + 1);
+
+  uint64_t cached[1 + KEY_WORDS];
+  if (cache_->lookups().load(hash, cached) &&
+      (((cached[0] >> 8) & 0xFF) == query.length()) &&
+      (std::memcmp(cached + 1, words + 1, MAX_KEY_LENGTH) == 0)) {
+    cache_->shard().lookup_hits.fetch_add(1, std::memory_order_relaxed);
+    if ((cached[0] & 2) == 0) {
+      return false;
+    }
+    agent.set_key(query.ptr(), query.length());
+    agent.set_key(static_cast<std::size_t>(cached[0] >> 32));
+    return true;
+  }
+  cache_->shard().lookup_misses.fetch_add(1, std::memory_order_relaxed);
+
+  const bool found = trie_.lookup(agent);
+  words[0] = 1 | (uint64_t{found} << 1) | (uint64_t{query.length()} << 8);
+  if (found) {
+    words[0] |= uint64_t{agent.key().id()} << 32;
+  }
+  cache_->lookups().store(hash, words);
+  return found;
+}
+
+std::size_t CachedTrie::common_prefix_search(Agent &agent,
+                                             std::vector<Key> *keys) const {
+  MARISA_THROW_IF(keys == nullptr, std::invalid_argument);
+
+  const Query &query = agent.query();
+  keys->clear();
+  if (query.length() > MAX_KEY_LENGTH) {
+    while (trie_.common_prefix_search(agent)) {
+      keys->push_back(agent.key());
+    }
+    return keys->size();
+  }
+
+  uint64_t words[1 + KEY_WORDS + MAX_PREFIXES];
+  pack_query(query, words + 1);
+  const uint64_t hash = grimoire::trie::hash_key(words + 1);
+
+  uint64_t cached[1 + KEY_WORDS + MAX_PREFIXES];
+  if (cache_->prefixes().load(hash, cached) &&
+      (((cached[0] >> 16) & 0xFF) == query.length()) &&
+      (std::memcmp(cached + 1, words + 1, MAX_KEY_LENGTH) == 0)) {
+    cache_->shard().prefix_hits.fetch_add(1, std::memory_order_relaxed);
+    const std::size_t num_keys = (cached[0] >> 8) & 0xFF;
+    for (std::size_t i = 0; i < num_keys; ++i) {
+      const uint64_t result = cached[1 + KEY_WORDS + i];
+      Key key;
+      key.set_str(query.ptr(), static_cast<std::size_t>(result >> 32));
+      key.set_id(static_cast<std::size_t>(result & 0xFFFFFFFFU));
+      keys->push_back(key);
+    }
+    return num_keys;
+  }
+  cache_->shard().prefix_misses.fetch_add(1, std::memory_order_relaxed);
+
+  while (trie_.common_prefix_search(agent)) {
+    keys->push_back(agent.key());
+  }
+  if (keys->size() <= MAX_PREFIXES) {
+    words[0] = 1 | (uint64_t{keys->size()} << 8) |
+               (uint64_t{query.length()} << 16);
+    for (std::size_t i = 0; i < MAX_PREFIXES; ++i) {
+      words[1 + KEY_WORDS + i] =
+          (i < keys->size())
+              ? ((*keys)[i].id() | (uint64_t{(*keys)[i].length()} << 32))
+              : 0;
+    }
+    cache_->prefixes().store(hash, words);
+  }
+  return keys->size();
+}
+
+CachedTrie::Stats CachedTrie::stats() const {
+  return cache_->stats();
+}
+
+std::size_t CachedTrie::total_size() const {
+  return cache_->total_size();
+}
+
+void CachedTrie::clear() {
+  cache_->clear();
+}
+
+}  // namespace marisa
@@ -0,0 +1,134 @@
+#include "marisa/front-coding.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <stdexcept>
+
+namespace marisa {
+namespace {
+
+constexpr std::size_t SIZE_DIGITS = std::numeric_limits<std::size_t>::digits;
+
+// A varint of a std::size_t takes at most 10 bytes on a 64-bit platform.
+constexpr std::size_t MAX_VARINT_SIZE = (SIZE_DIGITS + 6) / 7;
+
+std::size_t varint_size(std::size_t value) {
+  std::size_t size = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    ++size;
+  }
+  return size;
+}
+
+char *put_varint(char *ptr, std::size_t value) {
+  while (value >= 0x80) {
+    *ptr++ = static_cast<char>((value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+  *ptr++ = static_cast<char>(value);
+  return ptr;
+}
+
+}  // namespace
+
+void FrontCodedWriter::reset(char *buf, std::size_t buf_size) {
+  MARISA_THROW_IF((buf == nullptr) && (buf_size != 0), std::invalid_argument);
+  buf_ = buf;
+  buf_size_ = buf_size;
+  pos_ = 0;
+  num_keys_ = 0;
+  last_.clear();
+}
+
+bool FrontCodedWriter::append(std::string_view key) {
+  const std::size_t max_prefix_length = std::min(key.length(), last_.length());
+  std::size_t prefix_length = 0;
+  while ((prefix_length < max_prefix_length) &&
+         (key[prefix_length] == last_[prefix_length])) {
+    ++prefix_length;
+  }
+  const std::size_t suffix_length = key.length() - prefix_length;
+  const std::size_t entry_size = varint_size(prefix_length) +
+                                 varint_size(suffix_length) + suffix_length;
+  if (entry_size > (buf_size_ - pos_)) {
+    return false;
+  }
+
+  char *ptr = buf_ + pos_;
+  ptr = put_varint(ptr, prefix_length);
+  ptr = put_varint(ptr, suffix_length);
+  if (suffix_length != 0) {
+    std::memcpy(ptr, key.data() + prefix_length, suffix_length);
+  }
+  pos_ += entry_size;
+  ++num_keys_;
+
+  last_.resize(prefix_length);
+  last_.append(key.data() + prefix_length, suffix_length);
+  return true;
+}
+
+bool FrontCodedReader::next() {
+  bool found = false;
+  MARISA_THROW_IF(!next_(&found), std::runtime_error);
+  return found;
+}
+
+ErrorCode FrontCodedReader::try_next(bool *found) noexcept {
+  assert(found != nullptr);
+#if MARISA_USE_EXCEPTIONS
+  try {
+    return next_(found) ? MARISA_OK : MARISA_FORMAT_ERROR;
+  } catch (const std::bad_alloc &) {
+    return MARISA_MEMORY_ERROR;
+  }
+#else   // MARISA_USE_EXCEPTIONS
+  return next_(found) ? MARISA_OK : MARISA_FORMAT_ERROR;
+#endif  // MARISA_USE_EXCEPTIONS
+}
+
+bool FrontCodedReader::next_(bool *found) {
+  *found = false;
+  if (avail_ == 0) {
+    return true;
+  }
+  std::size_t prefix_length;
+  std::size_t suffix_length;
+  if (!read_varint(&prefix_length) || !read_varint(&suffix_length) ||
+      (prefix_length > key_.length()) || (suffix_length > avail_)) {
+    return false;
+  }
+  key_.resize(prefix_length);
+  key_.append(ptr_, suffix_length);
+  ptr_ += suffix_length;
+  avail_ -= suffix_length;
+  *found = true;
+  return true;
+}
+
+bool FrontCodedReader::read_varint(std::size_t *value) noexcept {
+  *value = 0;
+  for (std::size_t i = 0; (i < MAX_VARINT_SIZE) && (avail_ != 0); ++i) {
+    const auto byte = static_cast<unsigned char>(*ptr_);
+    ++ptr_;
+    --avail_;
+    const std::size_t bits = byte & 0x7F;
+    const std::size_t shift = 7 * i;
+    // The last byte has room for fewer than 7 bits.
+    if (((SIZE_DIGITS - shift) < 7) &&
+        ((bits >> (SIZE_DIGITS - shift)) != 0)) {
+      return false;
+    }
+    *value |= bits << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace marisa
@@ -0,0 +1,76 @@
+#ifndef MARISA_GRIMOIRE_ALGORITHM_PARALLEL_H_
+#define MARISA_GRIMOIRE_ALGORITHM_PARALLEL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "marisa/base.h"
+
+namespace marisa::grimoire::algorithm {
+
+// num_hardware_threads() returns the number of hardware threads, or 1 if it
+// is unknown.
+inline std::size_t num_hardware_threads() {
+  return std::max(1U, std::thread::hardware_concurrency());
+}
+
+// run_in_parallel() calls task(i) for i in [0, num_tasks) on up to
+// `num_threads` threads, including the calling thread, and rethrows the first
+// exception. `num_threads` == 0 means the number of hardware threads. A task
+// that takes two arguments is called as task(worker_id, i) instead, where
+// `worker_id` in [0, num_threads) is the thread, 0 being the calling one.
+template <typename Task>
+void run_in_parallel(std::size_t num_tasks, std::size_t num_threads,
+                     const Task &task) {
+  if (num_threads == 0) {
+    num_threads = num_hardware_threads();
+  }
+  num_threads = std::min(num_threads, num_tasks);
+
+  std::atomic<std::size_t> next_task{0};
+  std::atomic<bool> failed{false};
+  std::exception_ptr exception;
+  const auto call = [&task](std::size_t worker_id, std::size_t i) {
+    if constexpr (std::is_invocable_v<const Task &, std::size_t,
+                                      std::size_t>) {
+      task(worker_id, i);
+    } else {
+      task(i);
+    }
+  };
+  const auto worker = [&](std::size_t worker_id) {
+    for (std::size_t i = next_task++; (i < num_tasks) && !failed;
+         i = next_task++) {
+#if MARISA_USE_EXCEPTIONS
+      try {
+        call(worker_id, i);
+      } catch (...) {
+        if (!failed.exchange(true)) {
+          exception = std::current_exception();
+        }
+      }
+#else   // MARISA_USE_EXCEPTIONS
+      call(worker_id, i);
+#endif  // MARISA_USE_EXCEPTIONS
+    }
+  };
+  std::vector<std::thread> threads;
+  for (std::size_t i = 1; i < num_threads; ++i) {
+    threads.emplace_back(worker, i);
+  }
+  worker(0);
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  if (exception) {
+    std::rethrow_exception(exception);
+  }
+}
+
+}  // namespace marisa::grimoire::algorithm
+
+#endif  // MARISA_GRIMOIRE_ALGORITHM_PARALLEL_H_
@@ -12,6 +12,11 @@ enum {
   MARISA_INSERTION_SORT_THRESHOLD = 10
 };
 
+// NullObserver ignores the progress of sort().
+struct NullObserver {
+  void operator()(std::size_t) const {}
+};
+
 template <typename T>
 int get_label(const T &unit, std::size_t depth) {
   assert(depth <= unit.length());
@@ -76,8 +81,11 @@ std::size_t insertion_sort(Iterator l, Iterator r, std::size_t depth) {
   return count;
 }
 
-template <typename Iterator>
-std::size_t sort(Iterator l, Iterator r, std::size_t depth) {
+// `observer` is called with the number of elements that have reached their
+// final positions, so the sum of its arguments is `r - l` in the end.
+template <typename Iterator, typename Observer>
+std::size_t sort(Iterator l, Iterator r, std::size_t depth,
+                 Observer &observer) {
   assert(l <= r);
 
   std::size_t count = 0;
@@ -125,40 +133,46 @@ std::size_t sort(Iterator l, Iterator r, std::size_t depth) {
     if (((pl - l) > (pr - pl)) || ((r - pr) > (pr - pl))) {
       if ((pr - pl) == 1) {
         ++count;
+        observer(1);
       } else if ((pr - pl) > 1) {
         if (pivot == -1) {
           ++count;
+          observer(static_cast<std::size_t>(pr - pl));
         } else {
-          count += sort(pl, pr, depth + 1);
+          count += sort(pl, pr, depth + 1, observer);
         }
       }
 
       if ((pl - l) < (r - pr)) {
         if ((pl - l) == 1) {
           ++count;
+          observer(1);
         } else if ((pl - l) > 1) {
-          count += sort(l, pl, depth);
+          count += sort(l, pl, depth, observer);
         }
         l = pr;
       } else {
         if ((r - pr) == 1) {
           ++count;
+          observer(1);
         } else if ((r - pr) > 1) {
-          count += sort(pr, r, depth);
+          count += sort(pr, r, depth, observer);
         }
         r = pl;
       }
     } else {
       if ((pl - l) == 1) {
         ++count;
+        observer(1);
       } else if ((pl - l) > 1) {
-        count += sort(l, pl, depth);
+        count += sort(l, pl, depth, observer);
       }
 
       if ((r - pr) == 1) {
         ++count;
+        observer(1);
       } else if ((r - pr) > 1) {
-        count += sort(pr, r, depth);
+        count += sort(pr, r, depth, observer);
       }
 
       l = pl, r = pr;
@@ -166,6 +180,7 @@ std::size_t sort(Iterator l, Iterator r, std::size_t depth) {
         ++count;
       } else if ((pr - pl) > 1) {
         if (pivot == -1) {
+          observer(static_cast<std::size_t>(r - l));
           l = r;
           ++count;
         } else {
@@ -178,6 +193,9 @@ std::size_t sort(Iterator l, Iterator r, std::size_t depth) {
   if ((r - l) > 1) {
     count += insertion_sort(l, r, depth);
   }
+  if (r > l) {
+    observer(static_cast<std::size_t>(r - l));
+  }
   return count;
 }
 
@@ -186,7 +204,14 @@ std::size_t sort(Iterator l, Iterator r, std::size_t depth) {
 template <typename Iterator>
 std::size_t sort(Iterator begin, Iterator end) {
   assert(begin <= end);
-  return details::sort(begin, end, 0);
+  details::NullObserver observer;
+  return details::sort(begin, end, 0, observer);
+}
+
+template <typename Iterator, typename Observer>
+std::size_t sort(Iterator begin, Iterator end, Observer &observer) {
+  assert(begin <= end);
+  return details::sort(begin, end, 0, observer);
 }
 
 }  // namespace marisa::grimoire::algorithm
@@ -1,14 +1,20 @@
 #ifndef MARISA_GRIMOIRE_IO_H_
 #define MARISA_GRIMOIRE_IO_H_
 
+#include "marisa/grimoire/io/atomic-file.h"
+#include "marisa/grimoire/io/compressor.h"
 #include "marisa/grimoire/io/mapper.h"
 #include "marisa/grimoire/io/reader.h"
+#include "marisa/grimoire/io/residency.h"
 #include "marisa/grimoire/io/writer.h"
 
 namespace marisa::grimoire {
 
+using io::AtomicFile;
+using io::Compressor;
 using io::Mapper;
 using io::Reader;
+using io::Residency;
 using io::Writer;
 
 }  // namespace marisa::grimoire
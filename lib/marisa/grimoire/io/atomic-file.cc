@@ -0,0 +1,163 @@
+#if (defined _WIN32) || (defined _WIN64)
+ #include <fcntl.h>
+ #include <io.h>
+ #include <process.h>
+ #include <sys/stat.h>
+ #include <windows.h>
+#else  // (defined _WIN32) || (defined _WIN64)
+ #include <fcntl.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+#endif  // (defined _WIN32) || (defined _WIN64)
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "marisa/grimoire/io/atomic-file.h"
+
+namespace marisa::grimoire::io {
+namespace {
+
+// A temporary file is named "FILENAME.tmp.PID.COUNTER" and open() gives up
+// after this number of names in use.
+constexpr int MAX_NUM_ATTEMPTS = 100;
+
+std::atomic<unsigned int> temp_counter{0};
+
+std::string make_temp_filename(const char *filename) {
+#if (defined _WIN32) || (defined _WIN64)
+  const int pid = ::_getpid();
+#else   // (defined _WIN32) || (defined _WIN64)
+  const long pid = static_cast<long>(::getpid());
+#endif  // (defined _WIN32) || (defined _WIN64)
+  return std::string(filename) + ".tmp." + std::to_string(pid) + "." +
+         std::to_string(temp_counter++);
+}
+
+#if !(defined _WIN32) && !(defined _WIN64)
+// sync_parent_directory() makes a rename in the directory of `filename`
+// durable.
+void sync_parent_directory(const std::string &filename) {
+  const std::size_t pos = filename.find_last_of('/');
+  std::string dirname = ".";
+  if (pos == 0) {
+    dirname = "/";
+  } else if (pos != std::string::npos) {
+    dirname = filename.substr(0, pos);
+  }
+  const int fd = ::open(dirname.c_str(), O_RDONLY);
+  MARISA_THROW_SYSTEM_ERROR_IF(fd == -1, errno, std::generic_category(),
+                               "open");
+  // Some file systems do not support fsync() on directories.
+  const bool failed = (::fsync(fd) != 0) && (errno != EINVAL);
+  const int error_value = errno;
+  ::close(fd);
+  MARISA_THROW_SYSTEM_ERROR_IF(failed, error_value, std::generic_category(),
+                               "fsync");
+}
+#endif  // !(defined _WIN32) && !(defined _WIN64)
+
+}  // namespace
+
+AtomicFile::~AtomicFile() {
+  if (fd_ != -1) {
+#if (defined _WIN32) || (defined _WIN64)
+    ::_close(fd_);
+#else   // (defined _WIN32) || (defined _WIN64)
+    ::close(fd_);
+#endif  // (defined _WIN32) || (defined _WIN64)
+  }
+  if (!temp_filename_.empty()) {
+    std::remove(temp_filename_.c_str());
+  }
+}
+
+void AtomicFile::open(const char *filename) {
+  MARISA_THROW_IF(filename == nullptr, std::invalid_argument);
+
+  AtomicFile temp;
+  temp.open_(filename);
+  swap(temp);
+}
+
+void AtomicFile::commit() {
+  MARISA_THROW_IF(!is_open(), std::logic_error);
+
+#if (defined _WIN32) || (defined _WIN64)
+  MARISA_THROW_SYSTEM_ERROR_IF(::_commit(fd_) != 0, errno,
+                               std::generic_category(), "_commit");
+  const int fd = std::exchange(fd_, -1);
+  MARISA_THROW_SYSTEM_ERROR_IF(::_close(fd) != 0, errno,
+                               std::generic_category(), "_close");
+  MARISA_THROW_SYSTEM_ERROR_IF(
+      !::MoveFileExA(temp_filename_.c_str(), filename_.c_str(),
+                     MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH),
+      ::GetLastError(), std::system_category(), "MoveFileExA");
+  temp_filename_.clear();
+#else   // (defined _WIN32) || (defined _WIN64)
+ #ifdef __APPLE__
+  // fsync() on macOS does not flush the disk cache.
+  MARISA_THROW_SYSTEM_ERROR_IF(::fcntl(fd_, F_FULLFSYNC) == -1, errno,
+                               std::generic_category(), "fcntl");
+ #else   // __APPLE__
+  MARISA_THROW_SYSTEM_ERROR_IF(::fdatasync(fd_) != 0, errno,
+                               std::generic_category(), "fdatasync");
+ #endif  // __APPLE__
+  const int fd = std::exchange(fd_, -1);
+  MARISA_THROW_SYSTEM_ERROR_IF(::close(fd) != 0, errno,
+                               std::generic_category(), "close");
+  MARISA_THROW_SYSTEM_ERROR_IF(
+      ::rename(temp_filename_.c_str(), filename_.c_str()) != 0, errno,
+      std::generic_category(), "rename");
+  temp_filename_.clear();
+  sync_parent_directory(filename_);
+#endif  // (defined _WIN32) || (defined _WIN64)
+}
+
+void AtomicFile::clear() noexcept {
+  AtomicFile().swap(*this);
+}
+
+void AtomicFile::swap(AtomicFile &rhs) noexcept {
+  filename_.swap(rhs.filename_);
+  temp_filename_.swap(rhs.temp_filename_);
+  std::swap(fd_, rhs.fd_);
+}
+
+void AtomicFile::open_(const char *filename) {
+  for (int i = 1;; ++i) {
+    std::string temp_filename = make_temp_filename(filename);
+#if (defined _WIN32) || (defined _WIN64)
+    const int fd =
+        ::_open(temp_filename.c_str(),
+                _O_WRONLY | _O_CREAT | _O_EXCL | _O_BINARY | _O_NOINHERIT,
+                _S_IREAD | _S_IWRITE);
+#else   // (defined _WIN32) || (defined _WIN64)
+    const int fd = ::open(temp_filename.c_str(),
+                          O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+#endif  // (defined _WIN32) || (defined _WIN64)
+    if (fd != -1) {
+      filename_ = filename;
+      temp_filename_ = std::move(temp_filename);
+      fd_ = fd;
+#if !(defined _WIN32) && !(defined _WIN64)
+      // The new file keeps the permission bits of the file it replaces.
+      struct stat target;
+      if (::stat(filename, &target) == 0) {
+        MARISA_THROW_SYSTEM_ERROR_IF(
+            ::fchmod(fd_, target.st_mode & 07777) != 0, errno,
+            std::generic_category(), "fchmod");
+      }
+#endif  // !(defined _WIN32) && !(defined _WIN64)
+      return;
+    }
+    MARISA_THROW_SYSTEM_ERROR_IF((errno != EEXIST) || (i == MAX_NUM_ATTEMPTS),
+                                 errno, std::generic_category(), "open");
+  }
+}
+
+}  // namespace marisa::grimoire::io
@@ -0,0 +1,47 @@
+#ifndef MARISA_GRIMOIRE_IO_ATOMIC_FILE_H_
+#define MARISA_GRIMOIRE_IO_ATOMIC_FILE_H_
+
+#include <string>
+
+#include "marisa/base.h"
+
+namespace marisa::grimoire::io {
+
+// AtomicFile replaces a file atomically. open() creates a temporary file next
+// to the target and commit() flushes it to the disk and renames it to the
+// target, so that readers see either the old file or the complete new one,
+// even after a crash. The temporary file is removed unless committed. On
+// POSIX systems, it gets the permission bits of the target if it exists.
+class AtomicFile {
+ public:
+  AtomicFile() = default;
+  ~AtomicFile();
+
+  AtomicFile(const AtomicFile &) = delete;
+  AtomicFile &operator=(const AtomicFile &) = delete;
+
+  void open(const char *filename);
+  void commit();
+
+  // fd() returns the file descriptor of the temporary file.
+  int fd() const {
+    return fd_;
+  }
+  bool is_open() const {
+    return fd_ != -1;
+  }
+
+  void clear() noexcept;
+  void swap(AtomicFile &rhs) noexcept;
+
+ private:
+  std::string filename_;
+  std::string temp_filename_;
+  int fd_ = -1;
+
+  void open_(const char *filename);
+};
+
+}  // namespace marisa::grimoire::io
+
+#endif  // MARISA_GRIMOIRE_IO_ATOMIC_FILE_H_
@@ -0,0 +1,244 @@
+#include "marisa/grimoire/io/compressor.h"
+
+#ifdef MARISA_USE_ZSTD
+ #include <zstd.h>
+#endif  // MARISA_USE_ZSTD
+#ifdef MARISA_USE_LZ4
+ #include <lz4.h>
+#endif  // MARISA_USE_LZ4
+
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+#include <vector>
+
+#include "marisa/grimoire/algorithm/parallel.h"
+
+namespace marisa::grimoire::io {
+namespace {
+
+using algorithm::run_in_parallel;
+
+const char COMPRESSED_HEADER[Compressor::HEADER_SIZE] = "We pack Marisa.";
+
+// Chunks larger than this are rejected, so that a broken header does not
+// cause a huge allocation before decompression fails.
+constexpr uint64_t MAX_CHUNK_SIZE = uint64_t{1} << 30;
+
+#ifdef MARISA_USE_ZSTD
+// Higher levels compress a dictionary only a little better and are much
+// slower, e.g. level 19 takes minutes for a large dictionary.
+constexpr int ZSTD_LEVEL = 3;
+#endif  // MARISA_USE_ZSTD
+
+marisa_codec resolve_codec(marisa_codec codec) {
+  if (codec != MARISA_DEFAULT_CODEC) {
+    return codec;
+  }
+#if defined(MARISA_USE_ZSTD)
+  return MARISA_ZSTD_CODEC;
+#elif defined(MARISA_USE_LZ4)
+  return MARISA_LZ4_CODEC;
+#else
+  return MARISA_DEFAULT_CODEC;
+#endif
+}
+
+// The parameters are unused if the library is built without codecs.
+std::size_t compress_bound(marisa_codec codec,
+                           [[maybe_unused]] std::size_t size) {
+  switch (codec) {
+#ifdef MARISA_USE_ZSTD
+    case MARISA_ZSTD_CODEC: {
+      return ZSTD_compressBound(size);
+    }
+#endif  // MARISA_USE_ZSTD
+#ifdef MARISA_USE_LZ4
+    case MARISA_LZ4_CODEC: {
+      return static_cast<std::size_t>(
+          LZ4_compressBound(static_cast<int>(size)));
+    }
+#endif  // MARISA_USE_LZ4
+    default: {
+      MARISA_THROW(std::invalid_argument, "unsupported codec");
+    }
+  }
+}
+
+// Returns the compressed size.
+std::size_t compress(marisa_codec codec, [[maybe_unused]] const char *src,
+                     [[maybe_unused]] std::size_t size,
+                     [[maybe_unused]] char *dst,
+                     [[maybe_unused]] std::size_t capacity) {
+  switch (codec) {
+#ifdef MARISA_USE_ZSTD
+    case MARISA_ZSTD_CODEC: {
+      const std::size_t result =
+          ZSTD_compress(dst, capacity, src, size, ZSTD_LEVEL);
+      MARISA_THROW_IF(ZSTD_isError(result), std::runtime_error);
+      return result;
+    }
+#endif  // MARISA_USE_ZSTD
+#ifdef MARISA_USE_LZ4
+    case MARISA_LZ4_CODEC: {
+      const int result =
+          LZ4_compress_default(src, dst, static_cast<int>(size),
+                               static_cast<int>(capacity));
+      MARISA_THROW_IF(result <= 0, std::runtime_error);
+      return static_cast<std::size_t>(result);
+    }
+#endif  // MARISA_USE_LZ4
+    default: {
+      MARISA_THROW(std::invalid_argument, "unsupported codec");
+    }
+  }
+}
+
+// Throws std::runtime_error unless `src` is decompressed into exactly `size`
+// bytes.
+void decompress(marisa_codec codec, [[maybe_unused]] const char *src,
+                [[maybe_unused]] std::size_t src_size,
+                [[maybe_unused]] char *dst, [[maybe_unused]] std::size_t size) {
+  switch (codec) {
+#ifdef MARISA_USE_ZSTD
+    case MARISA_ZSTD_CODEC: {
+      const std::size_t result = ZSTD_decompress(dst, size, src, src_size);
+      MARISA_THROW_IF(ZSTD_isError(result) || (result != size),
+                      std::runtime_error);
+      return;
+    }
+#endif  // MARISA_USE_ZSTD
+#ifdef MARISA_USE_LZ4
+    case MARISA_LZ4_CODEC: {
+      const int result =
+          LZ4_decompress_safe(src, dst, static_cast<int>(src_size),
+                              static_cast<int>(size));
+      MARISA_THROW_IF(static_cast<std::size_t>(result) != size,
+                      std::runtime_error);
+      return;
+    }
+#endif  // MARISA_USE_LZ4
+    default: {
+      MARISA_THROW(std::runtime_error, "unsupported codec");
+    }
+  }
+}
+
+}  // namespace
+
+bool Compressor::has_codec(marisa_codec codec) {
+  switch (resolve_codec(codec)) {
+#ifdef MARISA_USE_ZSTD
+    case MARISA_ZSTD_CODEC: {
+      return true;
+    }
+#endif  // MARISA_USE_ZSTD
+#ifdef MARISA_USE_LZ4
+    case MARISA_LZ4_CODEC: {
+      return true;
+    }
+#endif  // MARISA_USE_LZ4
+    default: {
+      return false;
+    }
+  }
+}
+
+void Compressor::write(Writer &writer, const char *image, std::size_t size,
+                       marisa_codec codec, std::size_t num_threads,
+                       std::size_t chunk_size) {
+  MARISA_THROW_IF((image == nullptr) && (size != 0), std::invalid_argument);
+  MARISA_THROW_IF((chunk_size == 0) || (chunk_size > MAX_CHUNK_SIZE) ||
+                      (chunk_size > static_cast<std::size_t>(INT_MAX / 2)),
+                  std::invalid_argument);
+  codec = resolve_codec(codec);
+  MARISA_THROW_IF(!has_codec(codec), std::invalid_argument);
+
+  const std::size_t num_chunks = (size + chunk_size - 1) / chunk_size;
+  std::vector<std::vector<char>> chunks(num_chunks);
+  run_in_parallel(num_chunks, num_threads, [&](std::size_t i) {
+    const std::size_t offset = i * chunk_size;
+    const std::size_t length = std::min(chunk_size, size - offset);
+    std::vector<char> &chunk = chunks[i];
+    chunk.resize(compress_bound(codec, length));
+    chunk.resize(
+        compress(codec, image + offset, length, chunk.data(), chunk.size()));
+  });
+
+  writer.write(COMPRESSED_HEADER, HEADER_SIZE);
+  writer.write(static_cast<uint32_t>(codec));
+  writer.write(static_cast<uint32_t>(0));
+  writer.write(static_cast<uint64_t>(size));
+  writer.write(static_cast<uint64_t>(chunk_size));
+  writer.write(static_cast<uint64_t>(num_chunks));
+  for (const std::vector<char> &chunk : chunks) {
+    writer.write(static_cast<uint64_t>(chunk.size()));
+  }
+  for (const std::vector<char> &chunk : chunks) {
+    writer.write(chunk.data(), chunk.size());
+  }
+}
+
+std::unique_ptr<uint64_t[]> Compressor::read(Reader &reader, std::size_t *size,
+                                             std::size_t num_threads) {
+  MARISA_THROW_IF(size == nullptr, std::invalid_argument);
+
+  char header[HEADER_SIZE];
+  reader.read(header, HEADER_SIZE);
+  MARISA_THROW_IF(!std::equal(header, header + HEADER_SIZE, COMPRESSED_HEADER),
+                  std::runtime_error);
+
+  uint32_t temp_codec;
+  reader.read(&temp_codec);
+  const marisa_codec codec = static_cast<marisa_codec>(temp_codec);
+  MARISA_THROW_IF((codec == MARISA_DEFAULT_CODEC) || !has_codec(codec),
+                  std::runtime_error);
+  uint32_t reserved;
+  reader.read(&reserved);
+
+  uint64_t image_size;
+  uint64_t chunk_size;
+  uint64_t num_chunks;
+  reader.read(&image_size);
+  reader.read(&chunk_size);
+  reader.read(&num_chunks);
+  MARISA_THROW_IF(image_size > (SIZE_MAX - 7), std::runtime_error);
+  MARISA_THROW_IF((chunk_size == 0) || (chunk_size > MAX_CHUNK_SIZE),
+                  std::runtime_error);
+  MARISA_THROW_IF(num_chunks != ((image_size / chunk_size) +
+                                  ((image_size % chunk_size) != 0)),
+                  std::runtime_error);
+
+  std::vector<uint64_t> chunk_sizes(static_cast<std::size_t>(num_chunks));
+  reader.read(chunk_sizes.data(), chunk_sizes.size());
+  // A chunk is no larger than the bound of its codec, so the chunks take no
+  // more memory than the image size implies.
+  std::vector<std::size_t> offsets(chunk_sizes.size() + 1, 0);
+  for (std::size_t i = 0; i < chunk_sizes.size(); ++i) {
+    const std::size_t length = static_cast<std::size_t>(
+        std::min(chunk_size, image_size - (i * chunk_size)));
+    MARISA_THROW_IF(chunk_sizes[i] > compress_bound(codec, length),
+                    std::runtime_error);
+    MARISA_THROW_IF(chunk_sizes[i] > (SIZE_MAX - offsets[i]),
+                    std::runtime_error);
+    offsets[i + 1] = offsets[i] + static_cast<std::size_t>(chunk_sizes[i]);
+  }
+  std::vector<char> chunks(offsets.back());
+  reader.read(chunks.data(), chunks.size());
+
+  std::unique_ptr<uint64_t[]> image(
+      new uint64_t[static_cast<std::size_t>((image_size + 7) / 8)]);
+  char *const bytes = reinterpret_cast<char *>(image.get());
+  run_in_parallel(chunk_sizes.size(), num_threads, [&](std::size_t i) {
+    const std::size_t offset = i * static_cast<std::size_t>(chunk_size);
+    const std::size_t length = std::min(
+        static_cast<std::size_t>(chunk_size),
+        static_cast<std::size_t>(image_size) - offset);
+    decompress(codec, chunks.data() + offsets[i], offsets[i + 1] - offsets[i],
+               bytes + offset, length);
+  });
+  *size = static_cast<std::size_t>(image_size);
+  return image;
+}
+
+}  // namespace marisa::grimoire::io
@@ -0,0 +1,49 @@
+#ifndef MARISA_GRIMOIRE_IO_COMPRESSOR_H_
+#define MARISA_GRIMOIRE_IO_COMPRESSOR_H_
+
+#include <memory>
+
+#include "marisa/base.h"
+#include "marisa/grimoire/io/reader.h"
+#include "marisa/grimoire/io/writer.h"
+
+namespace marisa::grimoire::io {
+
+// A compressed dictionary consists of the following fields:
+//  char[16] header ("We pack Marisa.")
+//  uint32_t codec (marisa_codec)
+//  uint32_t reserved (0)
+//  uint64_t image size
+//  uint64_t chunk size
+//  uint64_t number of chunks
+//  uint64_t[] compressed sizes of chunks
+//  chunks
+// Chunks are compressed independently, so that they are decompressed in
+// parallel. The image is an uncompressed dictionary as written by
+// LoudsTrie::write().
+class Compressor {
+ public:
+  enum {
+    HEADER_SIZE = 16,
+    DEFAULT_CHUNK_SIZE = 1 << 20
+  };
+
+  // has_codec() returns true if the library is built with `codec`.
+  // MARISA_DEFAULT_CODEC is available if any codec is.
+  static bool has_codec(marisa_codec codec);
+
+  // write() compresses `size` bytes of `image` with `num_threads` threads.
+  // `num_threads` == 0 means the number of hardware threads.
+  static void write(Writer &writer, const char *image, std::size_t size,
+                    marisa_codec codec, std::size_t num_threads = 0,
+                    std::size_t chunk_size = DEFAULT_CHUNK_SIZE);
+
+  // read() decompresses an image into an 8-byte aligned buffer, which is
+  // suitable for Mapper, and stores its size in `size`.
+  static std::unique_ptr<uint64_t[]> read(Reader &reader, std::size_t *size,
+                                          std::size_t num_threads = 0);
+};
+
+}  // namespace marisa::grimoire::io
+
+#endif  // MARISA_GRIMOIRE_IO_COMPRESSOR_H_
@@ -66,6 +66,15 @@ void Mapper::open(const void *ptr, std::size_t size) {
   swap(temp);
 }
 
+void Mapper::open(std::unique_ptr<uint64_t[]> buf, std::size_t size) {
+  MARISA_THROW_IF((buf == nullptr) && (size != 0), std::invalid_argument);
+
+  Mapper temp;
+  temp.open_(buf.get(), size);
+  temp.buf_.swap(buf);
+  swap(temp);
+}
+
 void Mapper::seek(std::size_t size) {
   MARISA_THROW_IF(!is_open(), std::logic_error);
   MARISA_THROW_IF(size > avail_, std::runtime_error);
@@ -77,6 +86,20 @@ bool Mapper::is_open() const {
   return ptr_ != nullptr;
 }
 
+#if (defined _WIN32) || (defined _WIN64)
+const void *Mapper::file_data() const {
+  return origin_;
+}
+#else   // (defined _WIN32) || (defined _WIN64)
+const void *Mapper::file_data() const {
+  return (origin_ != MAP_FAILED) ? origin_ : nullptr;
+}
+#endif  // (defined _WIN32) || (defined _WIN64)
+
+std::size_t Mapper::file_size() const {
+  return (file_data() != nullptr) ? size_ : 0;
+}
+
 void Mapper::clear() noexcept {
   Mapper().swap(*this);
 }
@@ -86,6 +109,8 @@ void Mapper::swap(Mapper &rhs) noexcept {
   std::swap(avail_, rhs.avail_);
   std::swap(origin_, rhs.origin_);
   std::swap(size_, rhs.size_);
+  buf_.swap(rhs.buf_);
+  std::swap(legacy_padding_, rhs.legacy_padding_);
 #if (defined _WIN32) || (defined _WIN64)
   std::swap(file_, rhs.file_);
   std::swap(map_, rhs.map_);
@@ -2,6 +2,7 @@
 #define MARISA_GRIMOIRE_IO_MAPPER_H_
 
 #include <cstdio>
+#include <memory>
 #include <stdexcept>
 
 #include "marisa/base.h"
@@ -18,6 +19,8 @@ class Mapper {
 
   void open(const char *filename, int flags = 0);
   void open(const void *ptr, std::size_t size);
+  // This overload takes ownership of `buf`, which holds `size` bytes.
+  void open(std::unique_ptr<uint64_t[]> buf, std::size_t size);
 
   template <typename T>
   void map(T *obj) {
@@ -35,8 +38,22 @@ class Mapper {
 
   void seek(std::size_t size);
 
+  // A dictionary in the legacy layout pads 8-byte aligned vectors with 8
+  // extra bytes. Header::map() sets this from the header.
+  void set_legacy_padding(bool legacy_padding) {
+    legacy_padding_ = legacy_padding;
+  }
+  bool legacy_padding() const {
+    return legacy_padding_;
+  }
+
   bool is_open() const;
 
+  // file_data() and file_size() return the memory-mapped file, or nullptr and
+  // 0 if the mapper was opened with a memory block.
+  const void *file_data() const;
+  std::size_t file_size() const;
+
   void clear() noexcept;
   void swap(Mapper &rhs) noexcept;
 
@@ -45,6 +62,8 @@ class Mapper {
   void *origin_ = nullptr;
   std::size_t avail_ = 0;
   std::size_t size_ = 0;
+  std::unique_ptr<uint64_t[]> buf_;
+  bool legacy_padding_ = false;
 #if (defined _WIN32) || (defined _WIN64)
   void *file_ = nullptr;
   void *map_ = nullptr;
@@ -59,6 +59,7 @@ void Reader::swap(Reader &rhs) noexcept {
   std::swap(fd_, rhs.fd_);
   std::swap(stream_, rhs.stream_);
   std::swap(needs_fclose_, rhs.needs_fclose_);
+  std::swap(legacy_padding_, rhs.legacy_padding_);
 }
 
 void Reader::seek(std::size_t size) {
@@ -38,6 +38,15 @@ class Reader {
 
   void seek(std::size_t size);
 
+  // A dictionary in the legacy layout pads 8-byte aligned vectors with 8
+  // extra bytes. Header::read() sets this from the header.
+  void set_legacy_padding(bool legacy_padding) {
+    legacy_padding_ = legacy_padding;
+  }
+  bool legacy_padding() const {
+    return legacy_padding_;
+  }
+
   bool is_open() const;
 
   void clear() noexcept;
@@ -48,6 +57,7 @@ class Reader {
   int fd_ = -1;
   std::istream *stream_ = nullptr;
   bool needs_fclose_ = false;
+  bool legacy_padding_ = false;
 
   void open_(const char *filename);
   void open_(std::FILE *file);
@@ -0,0 +1,188 @@
+#if !(defined _WIN32) && !(defined _WIN64)
+ #include <sys/mman.h>
+ #include <unistd.h>
+#endif  // !(defined _WIN32) && !(defined _WIN64)
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "marisa/grimoire/io/residency.h"
+#include "marisa/grimoire/vector/pop-count.h"
+
+namespace marisa::grimoire::io {
+namespace {
+
+#if !(defined _WIN32) && !(defined _WIN64)
+ #ifdef __linux__
+using MincoreVec = unsigned char;
+ #else   // __linux__
+using MincoreVec = char;
+ #endif  // __linux__
+
+std::size_t get_page_size() {
+  return static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+}
+#endif  // !(defined _WIN32) && !(defined _WIN64)
+
+}  // namespace
+
+#if (defined _WIN32) || (defined _WIN64)
+void Residency::reset(const void *, std::size_t) {
+  clear();
+}
+
+bool Residency::request(const void *) const {
+  return true;
+}
+
+bool Residency::query(std::size_t) const {
+  return true;
+}
+#else   // (defined _WIN32) || (defined _WIN64)
+void Residency::reset(const void *ptr, std::size_t size) {
+  MARISA_THROW_IF((ptr == nullptr) && (size != 0), std::invalid_argument);
+
+  Residency temp;
+  temp.ptr_ = static_cast<const char *>(ptr);
+  temp.size_ = size;
+  temp.page_size_ = get_page_size();
+  MARISA_THROW_IF(
+      (reinterpret_cast<std::uintptr_t>(ptr) % temp.page_size_) != 0,
+      std::invalid_argument);
+  temp.num_pages_ = (size + temp.page_size_ - 1) / temp.page_size_;
+
+  const std::size_t num_words = (temp.num_pages_ + 63) / 64;
+  temp.bits_.reset(new std::atomic<uint64_t>[num_words]);
+  std::vector<MincoreVec> vec(temp.num_pages_);
+  MARISA_THROW_SYSTEM_ERROR_IF(
+      (size != 0) && (::mincore(const_cast<char *>(temp.ptr_), size,
+                                vec.data()) != 0),
+      errno, std::generic_category(), "mincore");
+  for (std::size_t i = 0; i < num_words; ++i) {
+    uint64_t word = 0;
+    for (std::size_t j = 0; (j < 64) && ((i * 64) + j < temp.num_pages_); ++j) {
+      if ((vec[(i * 64) + j] & 1) != 0) {
+        word |= uint64_t{1} << j;
+      }
+    }
+    temp.bits_[i].store(word, std::memory_order_relaxed);
+  }
+  swap(temp);
+}
+
+bool Residency::request(const void *addr) const {
+  const char *const p = static_cast<const char *>(addr);
+  if ((p < ptr_) || (p >= (ptr_ + size_))) {
+    return true;
+  }
+  const std::size_t page_id = static_cast<std::size_t>(p - ptr_) / page_size_;
+  const uint64_t mask = uint64_t{1} << (page_id % 64);
+  if ((bits_[page_id / 64].load(std::memory_order_relaxed) & mask) != 0) {
+    return true;
+  }
+  if (query(page_id)) {
+    bits_[page_id / 64].fetch_or(mask, std::memory_order_relaxed);
+    return true;
+  }
+  const std::size_t offset = page_id * page_size_;
+  const std::size_t length = std::min(READAHEAD_SIZE, size_ - offset);
+  ::madvise(const_cast<char *>(ptr_ + offset), length, MADV_WILLNEED);
+  return false;
+}
+
+bool Residency::query(std::size_t page_id) const {
+  MincoreVec vec = 0;
+  if (::mincore(const_cast<char *>(ptr_ + (page_id * page_size_)), page_size_,
+                &vec) != 0) {
+    // The page cannot be examined, so it is left to the page fault handler.
+    return true;
+  }
+  return (vec & 1) != 0;
+}
+#endif  // (defined _WIN32) || (defined _WIN64)
+
+#if (defined _WIN32) || (defined _WIN64)
+std::size_t resident_size(const void *, std::size_t size) {
+  return size;
+}
+
+void prefault(const void *ptr, std::size_t size) {
+  const char *const begin = static_cast<const char *>(ptr);
+  for (std::size_t offset = 0; offset < size; offset += 4096) {
+    static_cast<void>(*static_cast<const volatile char *>(begin + offset));
+  }
+}
+#else   // (defined _WIN32) || (defined _WIN64)
+std::size_t resident_size(const void *ptr, std::size_t size) {
+  if (size == 0) {
+    return 0;
+  }
+  const std::size_t page_size = get_page_size();
+  const std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(ptr);
+  const std::uintptr_t end = begin + size;
+  const std::uintptr_t first_page = begin - (begin % page_size);
+  const std::size_t num_pages = (end - first_page + page_size - 1) / page_size;
+
+  std::vector<MincoreVec> vec(num_pages);
+  MARISA_THROW_SYSTEM_ERROR_IF(
+      ::mincore(reinterpret_cast<void *>(first_page), num_pages * page_size,
+                vec.data()) != 0,
+      errno, std::generic_category(), "mincore");
+
+  // The first and the last pages may be shared with other data.
+  std::size_t resident = 0;
+  for (std::size_t i = 0; i < num_pages; ++i) {
+    if ((vec[i] & 1) != 0) {
+      const std::uintptr_t page_begin = first_page + (i * page_size);
+      resident += std::min<std::uintptr_t>(end, page_begin + page_size) -
+                  std::max<std::uintptr_t>(begin, page_begin);
+    }
+  }
+  return resident;
+}
+
+void prefault(const void *ptr, std::size_t size) {
+  if (size == 0) {
+    return;
+  }
+  const std::size_t page_size = get_page_size();
+  const std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(ptr);
+  const std::uintptr_t first_page = begin - (begin % page_size);
+  // madvise() fails for memory that is not mapped from a file, which is
+  // harmless.
+  ::madvise(reinterpret_cast<void *>(first_page), begin + size - first_page,
+            MADV_WILLNEED);
+  const char *const bytes = static_cast<const char *>(ptr);
+  static_cast<void>(*static_cast<const volatile char *>(bytes));
+  for (std::uintptr_t page = first_page + page_size; page < (begin + size);
+       page += page_size) {
+    static_cast<void>(
+        *static_cast<const volatile char *>(bytes + (page - begin)));
+  }
+}
+#endif  // (defined _WIN32) || (defined _WIN64)
+
+std::size_t Residency::num_resident_pages() const {
+  std::size_t count = 0;
+  for (std::size_t i = 0; i < ((num_pages_ + 63) / 64); ++i) {
+    count += vector::popcount(bits_[i].load(std::memory_order_relaxed));
+  }
+  return count;
+}
+
+void Residency::clear() noexcept {
+  Residency().swap(*this);
+}
+
+void Residency::swap(Residency &rhs) noexcept {
+  std::swap(ptr_, rhs.ptr_);
+  std::swap(size_, rhs.size_);
+  std::swap(page_size_, rhs.page_size_);
+  std::swap(num_pages_, rhs.num_pages_);
+  bits_.swap(rhs.bits_);
+}
+
+}  // namespace marisa::grimoire::io
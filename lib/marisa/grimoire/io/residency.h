@@ -0,0 +1,65 @@
+#ifndef MARISA_GRIMOIRE_IO_RESIDENCY_H_
+#define MARISA_GRIMOIRE_IO_RESIDENCY_H_
+
+#include <atomic>
+#include <memory>
+
+#include "marisa/base.h"
+
+namespace marisa::grimoire::io {
+
+// Residency tracks which pages of a memory-mapped file are in memory. The
+// bitmap is seeded by mincore() and a page is marked once it is found to be
+// resident. Pages evicted later are not noticed, so a query may still block
+// on them. On platforms without mincore(), every page is reported resident.
+class Residency {
+ public:
+  // READAHEAD_SIZE is the number of bytes requested for a missing page.
+  static constexpr std::size_t READAHEAD_SIZE = 128 << 10;
+
+  Residency() = default;
+
+  Residency(const Residency &) = delete;
+  Residency &operator=(const Residency &) = delete;
+
+  // reset() tracks [ptr, ptr + size), which must be page-aligned.
+  void reset(const void *ptr, std::size_t size);
+
+  // request() returns true if the page of `addr` is resident or not tracked.
+  // Otherwise, it asks the kernel to read the page and the following ones
+  // ahead and returns false. It is safe to call concurrently.
+  bool request(const void *addr) const;
+
+  std::size_t page_size() const {
+    return page_size_;
+  }
+  std::size_t num_pages() const {
+    return num_pages_;
+  }
+  // num_resident_pages() counts the pages marked resident.
+  std::size_t num_resident_pages() const;
+
+  void clear() noexcept;
+  void swap(Residency &rhs) noexcept;
+
+ private:
+  const char *ptr_ = nullptr;
+  std::size_t size_ = 0;
+  std::size_t page_size_ = 0;
+  std::size_t num_pages_ = 0;
+  std::unique_ptr<std::atomic<uint64_t>[]> bits_;
+
+  bool query(std::size_t page_id) const;
+};
+
+// resident_size() returns the number of bytes of [ptr, ptr + size) that are
+// in memory. It returns `size` on platforms without mincore().
+std::size_t resident_size(const void *ptr, std::size_t size);
+
+// prefault() asks the kernel to read [ptr, ptr + size) ahead and then reads a
+// byte of each page, so that later reads of the range do not fault.
+void prefault(const void *ptr, std::size_t size);
+
+}  // namespace marisa::grimoire::io
+
+#endif  // MARISA_GRIMOIRE_IO_RESIDENCY_H_
@@ -15,6 +15,15 @@ namespace marisa::grimoire::io {
 Writer::Writer() = default;
 
 Writer::~Writer() {
+#if MARISA_USE_EXCEPTIONS
+  try {
+    flush();
+  } catch (...) {
+    // Errors are reported only by an explicit flush().
+  }
+#else   // MARISA_USE_EXCEPTIONS
+  flush();
+#endif  // MARISA_USE_EXCEPTIONS
   if (needs_fclose_) {
     std::fclose(file_);
   }
@@ -44,6 +53,15 @@ void Writer::open(int fd) {
   swap(temp);
 }
 
+void Writer::open(int fd, std::size_t buffer_size) {
+  MARISA_THROW_IF(fd == -1, std::invalid_argument);
+  MARISA_THROW_IF(buffer_size == 0, std::invalid_argument);
+
+  Writer temp;
+  temp.open_(fd, buffer_size);
+  swap(temp);
+}
+
 void Writer::open(std::ostream &stream) {
   Writer temp;
   temp.open_(stream);
@@ -59,6 +77,8 @@ void Writer::swap(Writer &rhs) noexcept {
   std::swap(fd_, rhs.fd_);
   std::swap(stream_, rhs.stream_);
   std::swap(needs_fclose_, rhs.needs_fclose_);
+  buf_.swap(rhs.buf_);
+  std::swap(buffer_size_, rhs.buffer_size_);
 }
 
 void Writer::seek(std::size_t size) {
@@ -79,6 +99,14 @@ void Writer::seek(std::size_t size) {
   }
 }
 
+void Writer::flush() {
+  if (buf_.empty()) {
+    return;
+  }
+  write_fd(buf_.data(), buf_.size());
+  buf_.clear();
+}
+
 bool Writer::is_open() const {
   return (file_ != nullptr) || (fd_ != -1) || (stream_ != nullptr);
 }
@@ -106,6 +134,12 @@ void Writer::open_(int fd) {
   fd_ = fd;
 }
 
+void Writer::open_(int fd, std::size_t buffer_size) {
+  buf_.reserve(buffer_size);
+  fd_ = fd;
+  buffer_size_ = buffer_size;
+}
+
 void Writer::open_(std::ostream &stream) {
   stream_ = &stream;
 }
@@ -115,24 +149,18 @@ void Writer::write_data(const void *data, std::size_t size) {
   if (size == 0) {
     return;
   }
-  if (fd_ != -1) {
-    while (size != 0) {
-#ifdef _WIN32
-      constexpr std::size_t CHUNK_SIZE = std::numeric_limits<int>::max();
-      const unsigned int count = (size < CHUNK_SIZE) ? size : CHUNK_SIZE;
-      const int size_written = ::_write(fd_, data, count);
-      MARISA_THROW_SYSTEM_ERROR_IF(size_written <= 0, errno,
-                                   std::generic_category(), "_write");
-#else   // _WIN32
-      constexpr std::size_t CHUNK_SIZE = std::numeric_limits< ::ssize_t>::max();
-      const ::size_t count = (size < CHUNK_SIZE) ? size : CHUNK_SIZE;
-      const ::ssize_t size_written = ::write(fd_, data, count);
-      MARISA_THROW_SYSTEM_ERROR_IF(size_written <= 0, errno,
-                                   std::generic_category(), "write");
-#endif  // _WIN32
-      data = static_cast<const char *>(data) + size_written;
-      size -= static_cast<std::size_t>(size_written);
+  if (buffer_size_ != 0) {
+    if ((buf_.size() + size) > buffer_size_) {
+      flush();
+    }
+    if (size >= buffer_size_) {
+      write_fd(data, size);
+    } else {
+      const char *bytes = static_cast<const char *>(data);
+      buf_.insert(buf_.end(), bytes, bytes + size);
     }
+  } else if (fd_ != -1) {
+    write_fd(data, size);
   } else if (file_ != nullptr) {
     MARISA_THROW_SYSTEM_ERROR_IF(std::fwrite(data, 1, size, file_) != size,
                                  errno, std::generic_category(), "std::fwrite");
@@ -146,4 +174,24 @@ void Writer::write_data(const void *data, std::size_t size) {
   }
 }
 
+void Writer::write_fd(const void *data, std::size_t size) {
+  while (size != 0) {
+#ifdef _WIN32
+    constexpr std::size_t CHUNK_SIZE = std::numeric_limits<int>::max();
+    const unsigned int count = (size < CHUNK_SIZE) ? size : CHUNK_SIZE;
+    const int size_written = ::_write(fd_, data, count);
+    MARISA_THROW_SYSTEM_ERROR_IF(size_written <= 0, errno,
+                                 std::generic_category(), "_write");
+#else   // _WIN32
+    constexpr std::size_t CHUNK_SIZE = std::numeric_limits< ::ssize_t>::max();
+    const ::size_t count = (size < CHUNK_SIZE) ? size : CHUNK_SIZE;
+    const ::ssize_t size_written = ::write(fd_, data, count);
+    MARISA_THROW_SYSTEM_ERROR_IF(size_written <= 0, errno,
+                                 std::generic_category(), "write");
+#endif  // _WIN32
+    data = static_cast<const char *>(data) + size_written;
+    size -= static_cast<std::size_t>(size_written);
+  }
+}
+
 }  // namespace marisa::grimoire::io
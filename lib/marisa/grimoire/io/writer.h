@@ -4,6 +4,7 @@
 #include <cstdio>
 #include <iostream>
 #include <stdexcept>
+#include <vector>
 
 #include "marisa/base.h"
 
@@ -20,6 +21,10 @@ class Writer {
   void open(const char *filename);
   void open(std::FILE *file);
   void open(int fd);
+  // This overload collects writes into `buffer_size` bytes before passing
+  // them to `fd`. flush() should be called at the end because errors in the
+  // destructor are ignored.
+  void open(int fd, std::size_t buffer_size);
   void open(std::ostream &stream);
 
   template <typename T>
@@ -37,6 +42,9 @@ class Writer {
 
   void seek(std::size_t size);
 
+  // flush() writes buffered data, if any.
+  void flush();
+
   bool is_open() const;
 
   void clear() noexcept;
@@ -47,13 +55,17 @@ class Writer {
   int fd_ = -1;
   std::ostream *stream_ = nullptr;
   bool needs_fclose_ = false;
+  std::vector<char> buf_;
+  std::size_t buffer_size_ = 0;
 
   void open_(const char *filename);
   void open_(std::FILE *file);
   void open_(int fd);
+  void open_(int fd, std::size_t buffer_size);
   void open_(std::ostream &stream);
 
   void write_data(const void *data, std::size_t size);
+  void write_fd(const void *data, std::size_t size);
 };
 
 }  // namespace marisa::grimoire::io
@@ -0,0 +1,27 @@
+#ifndef MARISA_GRIMOIRE_PROBE_H_
+#define MARISA_GRIMOIRE_PROBE_H_
+
+// MARISA_PROBEn(name, ...) defines a USDT probe marisa:name with n arguments
+// if the library is built with ENABLE_USDT. A probe is a single nop until a
+// tracer such as bpftrace or SystemTap attaches to it, for example:
+//
+//   bpftrace -e 'usdt:./libmarisa.so:marisa:lookup__return
+//                { @hops = hist(arg1); }'
+//
+// Otherwise, the arguments are not evaluated and the probes vanish.
+
+#ifdef MARISA_USE_USDT
+ #include <sys/sdt.h>
+
+ #define MARISA_PROBE1(name, a1) DTRACE_PROBE1(marisa, name, a1)
+ #define MARISA_PROBE2(name, a1, a2) DTRACE_PROBE2(marisa, name, a1, a2)
+ #define MARISA_PROBE3(name, a1, a2, a3) \
+   DTRACE_PROBE3(marisa, name, a1, a2, a3)
+#else  // MARISA_USE_USDT
+ #define MARISA_PROBE1(name, a1) ((void)sizeof(a1))
+ #define MARISA_PROBE2(name, a1, a2) ((void)sizeof(a1), (void)sizeof(a2))
+ #define MARISA_PROBE3(name, a1, a2, a3) \
+   ((void)sizeof(a1), (void)sizeof(a2), (void)sizeof(a3))
+#endif  // MARISA_USE_USDT
+
+#endif  // MARISA_GRIMOIRE_PROBE_H_
@@ -1,11 +1,17 @@
 #ifndef MARISA_GRIMOIRE_TRIE_H_
 #define MARISA_GRIMOIRE_TRIE_H_
 
+#include "marisa/grimoire/trie/centroid-trie.h"
+#include "marisa/grimoire/trie/dfuds-trie.h"
+#include "marisa/grimoire/trie/diff-walker.h"
 #include "marisa/grimoire/trie/louds-trie.h"
 #include "marisa/grimoire/trie/state.h"
 
 namespace marisa::grimoire {
 
+using trie::CentroidTrie;
+using trie::DfudsTrie;
+using trie::DiffWalker;
 using trie::LoudsTrie;
 using trie::State;
 
@@ -0,0 +1,120 @@
+#if (defined _WIN32) || (defined _WIN64)
+ #include <windows.h>
+ #include <psapi.h>
+#else  // (defined _WIN32) || (defined _WIN64)
+ #include <sys/resource.h>
+#endif  // (defined _WIN32) || (defined _WIN64)
+
+#include "marisa/grimoire/trie/build-monitor.h"
+
+#include <cstdint>
+#include <exception>
+#include <new>
+
+#include "marisa/grimoire/probe.h"
+#include "marisa/grimoire/vector/vector.h"
+
+namespace marisa::grimoire::trie {
+namespace {
+
+// Returns the peak resident set size of the process in bytes, or 0 if it is
+// not available.
+std::size_t get_peak_resident() {
+#if (defined _WIN32) || (defined _WIN64)
+  PROCESS_MEMORY_COUNTERS counters;
+  if (!::K32GetProcessMemoryInfo(::GetCurrentProcess(), &counters,
+                                 sizeof(counters))) {
+    return 0;
+  }
+  return counters.PeakWorkingSetSize;
+#else   // (defined _WIN32) || (defined _WIN64)
+  struct rusage usage;
+  if (::getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+ #ifdef __APPLE__
+  // ru_maxrss is in bytes on macOS.
+  return static_cast<std::size_t>(usage.ru_maxrss);
+ #else   // __APPLE__
+  // ru_maxrss is in kilobytes on Linux and BSDs.
+  return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+ #endif  // __APPLE__
+#endif  // (defined _WIN32) || (defined _WIN64)
+}
+
+}  // namespace
+
+BuildMonitor::Phase::Phase(BuildMonitor &monitor, const char *name,
+                           std::size_t trie_id)
+    : monitor_(monitor),
+      name_(name),
+      trie_id_(trie_id),
+      uncaught_exceptions_(std::uncaught_exceptions()) {
+  MARISA_PROBE2(build__phase__entry, name_, trie_id_);
+  if (monitor_.enabled()) {
+    begin_ = std::chrono::steady_clock::now();
+    allocated_bytes_ = vector::allocated_bytes();
+  }
+}
+
+BuildMonitor::Phase::~Phase() {
+  MARISA_PROBE2(build__phase__return, name_, trie_id_);
+  if (!monitor_.enabled()) {
+    return;
+  }
+  // A phase is not recorded if it is left by an exception. Comparing with
+  // the count at construction still records a phase that runs during stack
+  // unwinding, such as a build in the destructor of another object.
+  if (std::uncaught_exceptions() > uncaught_exceptions_) {
+    return;
+  }
+  BuildPhase phase;
+  phase.set_name(name_);
+  phase.set_trie_id(trie_id_);
+  phase.set_seconds(std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - begin_)
+                        .count());
+  phase.set_allocated_bytes(vector::allocated_bytes() - allocated_bytes_);
+  phase.set_peak_resident(get_peak_resident());
+#if MARISA_USE_EXCEPTIONS
+  try {
+    monitor_.report_->push_back(phase);
+  } catch (const std::bad_alloc &) {
+    // A missing entry is better than std::terminate() in a destructor.
+  }
+#else   // MARISA_USE_EXCEPTIONS
+  monitor_.report_->push_back(phase);
+#endif  // MARISA_USE_EXCEPTIONS
+}
+
+BuildMonitor::Progress::Progress(BuildMonitor &monitor, const char *name,
+                                 std::size_t trie_id, std::size_t total)
+    : monitor_(monitor),
+      name_(name),
+      trie_id_(trie_id),
+      total_(total),
+      next_(SIZE_MAX) {
+  report();
+}
+
+void BuildMonitor::Progress::report() {
+  if (!monitor_.has_callback()) {
+    return;
+  }
+  // The callback never sees done() > total().
+  monitor_.check(BuildProgress(name_, trie_id_,
+                               (done_ < total_) ? done_ : total_, total_));
+  next_ = done_ + DEFAULT_INTERVAL;
+}
+
+void BuildMonitor::check(const BuildProgress &progress) const {
+  if ((callback_ != nullptr) && !(*callback_)(progress)) {
+#if MARISA_USE_EXCEPTIONS
+    throw BuildCancelled("marisa::Trie::build() is cancelled");
+#else   // MARISA_USE_EXCEPTIONS
+    fail("marisa::Trie::build() is cancelled");
+#endif  // MARISA_USE_EXCEPTIONS
+  }
+}
+
+}  // namespace marisa::grimoire::trie
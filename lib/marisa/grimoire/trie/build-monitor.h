@@ -0,0 +1,95 @@
+#ifndef MARISA_GRIMOIRE_TRIE_BUILD_MONITOR_H_
+#define MARISA_GRIMOIRE_TRIE_BUILD_MONITOR_H_
+
+#include <chrono>
+
+#include "marisa/build-progress.h"
+#include "marisa/build-report.h"
+
+namespace marisa::grimoire::trie {
+
+// BuildMonitor observes the phases of LoudsTrie::build_(). It is passed down
+// the recursion together with Config, and does nothing if neither a report
+// nor a callback is requested.
+class BuildMonitor {
+ public:
+  // Phase measures a build phase from its construction to its destruction.
+  class Phase {
+   public:
+    Phase(BuildMonitor &monitor, const char *name, std::size_t trie_id);
+    ~Phase();
+
+    Phase(const Phase &) = delete;
+    Phase &operator=(const Phase &) = delete;
+
+   private:
+    BuildMonitor &monitor_;
+    const char *name_;
+    std::size_t trie_id_;
+    std::chrono::steady_clock::time_point begin_;
+    std::size_t allocated_bytes_ = 0;
+    int uncaught_exceptions_;
+  };
+
+  // Progress counts the keys processed in a phase and passes the count to
+  // the callback every `interval` keys. It can be used as an observer of
+  // algorithm::sort().
+  class Progress {
+   public:
+    enum { DEFAULT_INTERVAL = 1 << 16 };
+
+    Progress(BuildMonitor &monitor, const char *name, std::size_t trie_id,
+             std::size_t total);
+
+    Progress(const Progress &) = delete;
+    Progress &operator=(const Progress &) = delete;
+
+    void operator()(std::size_t count) {
+      done_ += count;
+      if (done_ >= next_) {
+        report();
+      }
+    }
+    // report() passes the current count to the callback immediately.
+    void report();
+
+    std::size_t done() const {
+      return done_;
+    }
+
+   private:
+    BuildMonitor &monitor_;
+    const char *name_;
+    std::size_t trie_id_;
+    std::size_t done_ = 0;
+    std::size_t total_;
+    std::size_t next_;
+  };
+
+  BuildMonitor() = default;
+  explicit BuildMonitor(BuildReport *report,
+                        const BuildCallback *callback = nullptr)
+      : report_(report),
+        callback_(((callback != nullptr) && *callback) ? callback : nullptr) {}
+
+  BuildMonitor(const BuildMonitor &) = delete;
+  BuildMonitor &operator=(const BuildMonitor &) = delete;
+
+  bool enabled() const {
+    return report_ != nullptr;
+  }
+  bool has_callback() const {
+    return callback_ != nullptr;
+  }
+
+  // check() calls the callback and throws BuildCancelled if it returns false.
+  void check(const BuildProgress &progress) const;
+
+ private:
+  BuildReport *report_ = nullptr;
+  const BuildCallback *callback_ = nullptr;
+};
+
+}  // namespace marisa::grimoire::trie
+
+#endif  // MARISA_GRIMOIRE_TRIE_BUILD_MONITOR_H_
@@ -0,0 +1,570 @@
+#include "marisa/grimoire/trie/centroid-trie.h"
+
+#include <algorithm>
+#include <cassert>
+#include <queue>
+#include <stdexcept>
+
+#include "marisa/grimoire/algorithm/sort.h"
+#include "marisa/grimoire/trie/range.h"
+#include "marisa/grimoire/trie/state.h"
+
+namespace marisa::grimoire::trie {
+
+CentroidTrie::CentroidTrie() = default;
+
+CentroidTrie::CentroidTrie(Keyset &keyset, BuildMonitor &monitor) {
+  Vector<Key> keys;
+  {
+    BuildMonitor::Phase phase(monitor, "keys", 1);
+    keys.resize(keyset.size());
+    for (std::size_t i = 0; i < keyset.size(); ++i) {
+      keys[i].set_str(keyset[i].ptr(), keyset[i].length());
+    }
+  }
+
+  CentroidTrie temp;
+  temp.build_(keys, monitor);
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    keyset[keys[i].id()].set_id(keys[i].terminal());
+  }
+  swap(temp);
+}
+
+CentroidTrie::CentroidTrie(const std::string_view *keys, std::size_t num_keys,
+                           uint32_t *ids, BuildMonitor &monitor) {
+  MARISA_THROW_IF((keys == nullptr) && (num_keys != 0), std::invalid_argument);
+  MARISA_THROW_IF(num_keys > UINT32_MAX, std::length_error);
+
+  Vector<Key> temp_keys;
+  {
+    BuildMonitor::Phase phase(monitor, "keys", 1);
+    temp_keys.resize(num_keys);
+    for (std::size_t i = 0; i < num_keys; ++i) {
+      MARISA_THROW_IF(keys[i].length() > UINT32_MAX, std::invalid_argument);
+      temp_keys[i].set_str(keys[i].data(), keys[i].length());
+    }
+  }
+
+  CentroidTrie temp;
+  temp.build_(temp_keys, monitor);
+  if (ids != nullptr) {
+    for (std::size_t i = 0; i < temp_keys.size(); ++i) {
+      ids[temp_keys[i].id()] = temp_keys[i].terminal();
+    }
+  }
+  swap(temp);
+}
+
+CentroidTrie::~CentroidTrie() = default;
+
+void CentroidTrie::map(Mapper &mapper, const Header &header) {
+  MARISA_THROW_IF(header.layout() != Header::CENTROID_LAYOUT,
+                  std::runtime_error);
+
+  CentroidTrie temp;
+  temp.map_(mapper);
+  temp.mapper_.swap(mapper);
+  swap(temp);
+}
+
+void CentroidTrie::read(Reader &reader, const Header &header) {
+  MARISA_THROW_IF(header.layout() != Header::CENTROID_LAYOUT,
+                  std::runtime_error);
+
+  CentroidTrie temp;
+  temp.read_(reader);
+  swap(temp);
+}
+
+void CentroidTrie::write(Writer &writer) const {
+  Header(Header::CENTROID_LAYOUT).write(writer);
+  louds_.write(writer);
+  branch_offsets_.write(writer);
+  branch_labels_.write(writer);
+  leaf_flags_.write(writer);
+  slot_offsets_.write(writer);
+  label_ends_.write(writer);
+  labels_.write(writer);
+}
+
+bool CentroidTrie::lookup(Agent &agent) const {
+  assert(agent.has_state());
+
+  State &state = agent.state();
+  state.lookup_init();
+  if (empty()) {
+    return false;
+  }
+
+  std::size_t node_id = 0;
+  for (;;) {
+    const std::size_t query_pos = state.query_pos();
+    const std::size_t length = label_ends_[node_id] - label_begin(node_id);
+    const std::size_t offset = match(agent, node_id, query_pos, 0, length);
+    if ((query_pos + offset) == agent.query().length()) {
+      const std::size_t slot = find_slot(node_id, offset);
+      if (slot == MARISA_INVALID_KEY_ID) {
+        return false;
+      }
+      state.set_query_pos(query_pos + offset);
+      agent.set_key(agent.query().ptr(), agent.query().length());
+      agent.set_key(slot);
+      return true;
+    }
+    if (offset == length) {
+      return false;
+    }
+    node_id = find_child(
+        node_id, offset,
+        static_cast<uint8_t>(agent.query()[query_pos + offset]));
+    if (node_id == 0) {
+      return false;
+    }
+    state.set_query_pos(query_pos + offset + 1);
+  }
+}
+
+void CentroidTrie::reverse_lookup(Agent &agent) const {
+  assert(agent.has_state());
+  MARISA_THROW_IF(agent.query().id() >= size(), std::out_of_range);
+
+  State &state = agent.state();
+  state.reverse_lookup_init();
+
+  // The key is restored backward from its slot to the root.
+  std::size_t node_id = leaf_flags_.rank1(agent.query().id());
+  std::size_t length = slot_offsets_[agent.query().id()];
+  for (;;) {
+    const char *const label = labels_.begin() + label_begin(node_id);
+    for (std::size_t i = length; i > 0; --i) {
+      state.key_buf().push_back(label[i - 1]);
+    }
+    if (node_id == 0) {
+      break;
+    }
+    state.key_buf().push_back(static_cast<char>(branch_labels_[node_id]));
+    length = branch_offsets_[node_id];
+    node_id = louds_.select1(node_id) - node_id - 1;
+  }
+  std::reverse(state.key_buf().begin(), state.key_buf().end());
+  agent.set_key(state.key_buf().data(), state.key_buf().size());
+  agent.set_key(agent.query().id());
+}
+
+bool CentroidTrie::common_prefix_search(Agent &agent) const {
+  assert(agent.has_state());
+
+  State &state = agent.state();
+  if (state.status_code() == MARISA_END_OF_COMMON_PREFIX_SEARCH) {
+    return false;
+  }
+
+  // history_pos() is the next key slot to test.
+  if (state.status_code() != MARISA_READY_TO_COMMON_PREFIX_SEARCH) {
+    state.common_prefix_search_init();
+    state.set_history_pos(0);
+    if (empty()) {
+      state.set_status_code(MARISA_END_OF_COMMON_PREFIX_SEARCH);
+      return false;
+    }
+  }
+
+  for (;;) {
+    const std::size_t node_id = state.node_id();
+    const std::size_t query_pos = state.query_pos();
+    const std::size_t slot = state.history_pos();
+    const std::size_t leaf_slot = leaf_flags_.select1(node_id);
+    if (slot > leaf_slot) {
+      break;
+    }
+
+    // The keys of the previous slots of the node have been matched.
+    const std::size_t slot_offset = slot_offsets_[slot];
+    const std::size_t offset =
+        match(agent, node_id, query_pos,
+              (slot != slot_begin(node_id)) ? slot_offsets_[slot - 1] : 0,
+              slot_offset);
+    if (offset == slot_offset) {
+      state.set_history_pos(slot + 1);
+      agent.set_key(agent.query().ptr(), query_pos + slot_offset);
+      agent.set_key(slot);
+      return true;
+    }
+    if ((query_pos + offset) == agent.query().length()) {
+      break;
+    }
+    const std::size_t child_id = find_child(
+        node_id, offset,
+        static_cast<uint8_t>(agent.query()[query_pos + offset]));
+    if (child_id == 0) {
+      break;
+    }
+    state.set_node_id(child_id);
+    state.set_query_pos(query_pos + offset + 1);
+    state.set_history_pos(slot_begin(child_id));
+  }
+  state.set_status_code(MARISA_END_OF_COMMON_PREFIX_SEARCH);
+  return false;
+}
+
+// A history entry of predictive_search() is a node whose label follows
+// key_pos() in the key buffer. key_id() is the next key slot to report,
+// louds_pos() is the next child to visit, and link_id() is the length of the
+// label that is still in the key buffer.
+bool CentroidTrie::predictive_search(Agent &agent) const {
+  assert(agent.has_state());
+
+  State &state = agent.state();
+  if (state.status_code() == MARISA_END_OF_PREDICTIVE_SEARCH) {
+    return false;
+  }
+
+  if (state.status_code() != MARISA_READY_TO_PREDICTIVE_SEARCH) {
+    state.predictive_search_init();
+    if (empty()) {
+      state.set_status_code(MARISA_END_OF_PREDICTIVE_SEARCH);
+      return false;
+    }
+
+    std::size_t node_id = 0;
+    std::size_t query_pos = 0;
+    std::size_t offset = 0;
+    for (;;) {
+      const std::size_t length = label_ends_[node_id] - label_begin(node_id);
+      offset = match(agent, node_id, query_pos, 0, length);
+      if ((query_pos + offset) == agent.query().length()) {
+        break;
+      }
+      const std::size_t child_id =
+          (offset == length)
+              ? 0
+              : find_child(node_id, offset,
+                           static_cast<uint8_t>(
+                               agent.query()[query_pos + offset]));
+      if (child_id == 0) {
+        state.set_status_code(MARISA_END_OF_PREDICTIVE_SEARCH);
+        return false;
+      }
+      node_id = child_id;
+      query_pos += offset + 1;
+    }
+
+    // Only the slots and the children from `offset` have the query as a
+    // prefix, and the first such slot, if any, is the query itself.
+    const std::size_t first_slot = slot_begin(node_id);
+    const std::size_t leaf_slot = leaf_flags_.select1(node_id);
+    std::size_t slot = first_slot;
+    while ((slot < leaf_slot) && (slot_offsets_[slot] < offset)) {
+      ++slot;
+    }
+    const std::size_t begin = louds_.select0(node_id) - node_id;
+    const std::size_t end = louds_.select0(node_id + 1) - node_id - 1;
+    std::size_t child_id = begin;
+    while ((child_id < end) && (branch_offsets_[child_id] < offset)) {
+      ++child_id;
+    }
+
+    const std::size_t label_begin = this->label_begin(node_id);
+    state.key_buf().insert(state.key_buf().end(), agent.query().ptr(),
+                           agent.query().ptr() + query_pos);
+    state.key_buf().insert(state.key_buf().end(), labels_.begin() + label_begin,
+                           labels_.begin() + label_ends_[node_id]);
+
+    History history;
+    history.set_node_id(node_id);
+    history.set_key_pos(query_pos);
+    history.set_key_id(slot);
+    history.set_louds_pos(child_id);
+    history.set_link_id(label_ends_[node_id] - label_begin);
+    state.history().push_back(history);
+  }
+
+  while (!state.history().empty()) {
+    History &current = state.history().back();
+    const std::size_t node_id = current.node_id();
+    const std::size_t slot = current.key_id();
+    if (slot <= leaf_flags_.select1(node_id)) {
+      // The key buffer is cut to the key, because a copy of the agent
+      // points its key to the whole buffer.
+      const std::size_t length = slot_offsets_[slot];
+      const std::size_t kept = std::min(length, current.link_id());
+      const char *const label = labels_.begin() + label_begin(node_id);
+      state.key_buf().resize(current.key_pos() + kept);
+      state.key_buf().insert(state.key_buf().end(), label + kept,
+                             label + length);
+      current.set_key_id(slot + 1);
+      current.set_link_id(length);
+      agent.set_key(state.key_buf().data(), state.key_buf().size());
+      agent.set_key(slot);
+      return true;
+    }
+
+    const std::size_t child_id = current.louds_pos();
+    if (child_id == (louds_.select0(node_id + 1) - node_id - 1)) {
+      state.history().pop_back();
+      continue;
+    }
+    current.set_louds_pos(child_id + 1);
+
+    // The labels of the previous children have overwritten the label of
+    // the node after their offsets.
+    const std::size_t offset = branch_offsets_[child_id];
+    const std::size_t kept = std::min(offset, current.link_id());
+    const char *const label = labels_.begin() + label_begin(node_id);
+    state.key_buf().resize(current.key_pos() + kept);
+    state.key_buf().insert(state.key_buf().end(), label + kept,
+                           label + offset);
+    current.set_link_id(offset);
+    state.key_buf().push_back(static_cast<char>(branch_labels_[child_id]));
+
+    const std::size_t child_label_begin = label_begin(child_id);
+    History next;
+    next.set_node_id(child_id);
+    next.set_key_pos(state.key_buf().size());
+    next.set_key_id(slot_begin(child_id));
+    next.set_louds_pos(louds_.select0(child_id) - child_id);
+    next.set_link_id(label_ends_[child_id] - child_label_begin);
+    state.key_buf().insert(state.key_buf().end(),
+                           labels_.begin() + child_label_begin,
+                           labels_.begin() + label_ends_[child_id]);
+    state.history().push_back(next);
+  }
+  state.set_status_code(MARISA_END_OF_PREDICTIVE_SEARCH);
+  return false;
+}
+
+void CentroidTrie::get_sections(std::vector<Section> *sections) const {
+  assert(sections != nullptr);
+
+  const auto add = [sections](const char *name) {
+    return [sections, name](const void *ptr, std::size_t size) {
+      if (size != 0) {
+        sections->push_back(Section{name, 1, true, ptr, size});
+      }
+    };
+  };
+  louds_.for_each_block(add("louds"));
+  branch_offsets_.for_each_block(add("branch_offsets"));
+  add("branch_labels")(branch_labels_.begin(), branch_labels_.total_size());
+  leaf_flags_.for_each_block(add("leaf_flags"));
+  slot_offsets_.for_each_block(add("slot_offsets"));
+  label_ends_.for_each_block(add("label_ends"));
+  add("labels")(labels_.begin(), labels_.total_size());
+}
+
+std::size_t CentroidTrie::total_size() const {
+  return louds_.total_size() + branch_offsets_.total_size() +
+         branch_labels_.total_size() + leaf_flags_.total_size() +
+         slot_offsets_.total_size() + label_ends_.total_size() +
+         labels_.total_size();
+}
+
+std::size_t CentroidTrie::io_size() const {
+  return Header().io_size() + louds_.io_size() + branch_offsets_.io_size() +
+         branch_labels_.io_size() + leaf_flags_.io_size() +
+         slot_offsets_.io_size() + label_ends_.io_size() + labels_.io_size();
+}
+
+void CentroidTrie::clear() noexcept {
+  CentroidTrie().swap(*this);
+}
+
+void CentroidTrie::swap(CentroidTrie &rhs) noexcept {
+  louds_.swap(rhs.louds_);
+  branch_offsets_.swap(rhs.branch_offsets_);
+  branch_labels_.swap(rhs.branch_labels_);
+  leaf_flags_.swap(rhs.leaf_flags_);
+  slot_offsets_.swap(rhs.slot_offsets_);
+  label_ends_.swap(rhs.label_ends_);
+  labels_.swap(rhs.labels_);
+  mapper_.swap(rhs.mapper_);
+}
+
+// build_() decomposes the compacted trie of the sorted keys into heavy
+// paths in BFS order, and sets the key slot of each key as its terminal.
+void CentroidTrie::build_(Vector<Key> &keys, BuildMonitor &monitor) {
+  {
+    BuildMonitor::Phase phase(monitor, "sort", 1);
+    BuildMonitor::Progress progress(monitor, "sort", 1, keys.size());
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      keys[i].set_id(i);
+    }
+    algorithm::sort(keys.begin(), keys.end(), progress);
+    progress.report();
+  }
+  if (keys.empty()) {
+    return;
+  }
+
+  BuildMonitor::Phase phase(monitor, "paths", 1);
+  BuildMonitor::Progress progress(monitor, "paths", 1, keys.size());
+
+  Vector<uint32_t> branch_offsets;
+  Vector<uint32_t> slot_offsets;
+  Vector<uint32_t> label_ends;
+  louds_.push_back(true);
+  louds_.push_back(false);
+  branch_offsets.push_back(0);
+  branch_labels_.push_back(0);
+
+  std::queue<Range> queue;
+  Vector<Range> groups;
+  queue.push(make_range(0, keys.size(), 0));
+  while (!queue.empty()) {
+    const Range path = queue.front();
+    queue.pop();
+
+    const std::size_t label_begin = labels_.size();
+    std::size_t begin = path.begin();
+    std::size_t end = path.end();
+    std::size_t key_pos = path.key_pos();
+    for (;;) {
+      // The first and the last keys share the prefix of the range.
+      const Key &first = keys[begin];
+      const Key &last = keys[end - 1];
+      while ((key_pos < first.length()) && (first[key_pos] == last[key_pos])) {
+        labels_.push_back(first[key_pos]);
+        ++key_pos;
+      }
+      const std::size_t offset = labels_.size() - label_begin;
+
+      std::size_t i = begin;
+      while ((i < end) && (keys[i].length() == key_pos)) {
+        keys[i].set_terminal(slot_offsets.size());
+        ++i;
+      }
+      if (i != begin) {
+        progress(i - begin);
+        leaf_flags_.push_back(i == end);
+        slot_offsets.push_back(static_cast<uint32_t>(offset));
+        if (i == end) {
+          break;
+        }
+        begin = i;
+      }
+
+      groups.clear();
+      for (i = begin + 1; i < end; ++i) {
+        if (keys[i - 1][key_pos] != keys[i][key_pos]) {
+          groups.push_back(make_range(begin, i, key_pos));
+          begin = i;
+        }
+      }
+      groups.push_back(make_range(begin, end, key_pos));
+
+      std::size_t heavy = 0;
+      for (i = 1; i < groups.size(); ++i) {
+        if ((groups[i].end() - groups[i].begin()) >
+            (groups[heavy].end() - groups[heavy].begin())) {
+          heavy = i;
+        }
+      }
+      for (i = 0; i < groups.size(); ++i) {
+        if (i != heavy) {
+          const uint8_t label =
+              static_cast<uint8_t>(keys[groups[i].begin()][key_pos]);
+          queue.push(make_range(groups[i].begin(), groups[i].end(),
+                                key_pos + 1));
+          louds_.push_back(true);
+          branch_offsets.push_back(static_cast<uint32_t>(offset));
+          branch_labels_.push_back(label);
+        }
+      }
+
+      labels_.push_back(keys[groups[heavy].begin()][key_pos]);
+      begin = groups[heavy].begin();
+      end = groups[heavy].end();
+      ++key_pos;
+    }
+    louds_.push_back(false);
+    MARISA_THROW_IF(labels_.size() > UINT32_MAX, std::length_error);
+    label_ends.push_back(static_cast<uint32_t>(labels_.size()));
+  }
+  progress.report();
+
+  louds_.build(true, true);
+  branch_offsets_.build(branch_offsets);
+  branch_labels_.shrink();
+  leaf_flags_.build(false, true);
+  slot_offsets_.build(slot_offsets);
+  label_ends_.build(label_ends);
+  labels_.shrink();
+}
+
+void CentroidTrie::map_(Mapper &mapper) {
+  louds_.map(mapper);
+  branch_offsets_.map(mapper);
+  branch_labels_.map(mapper);
+  leaf_flags_.map(mapper);
+  slot_offsets_.map(mapper);
+  label_ends_.map(mapper);
+  labels_.map(mapper);
+}
+
+void CentroidTrie::read_(Reader &reader) {
+  louds_.read(reader);
+  branch_offsets_.read(reader);
+  branch_labels_.read(reader);
+  leaf_flags_.read(reader);
+  slot_offsets_.read(reader);
+  label_ends_.read(reader);
+  labels_.read(reader);
+}
+
+std::size_t CentroidTrie::match(const Agent &agent, std::size_t node_id,
+                                std::size_t query_pos, std::size_t offset,
+                                std::size_t end) const {
+  const char *const label = labels_.begin() + label_begin(node_id);
+  end = std::min(end, agent.query().length() - query_pos);
+  while ((offset < end) &&
+         (label[offset] == agent.query()[query_pos + offset])) {
+    ++offset;
+  }
+  return offset;
+}
+
+std::size_t CentroidTrie::find_child(std::size_t node_id, std::size_t offset,
+                                     uint8_t label) const {
+  // Children are sorted by (offset, label).
+  const std::size_t last = louds_.select0(node_id + 1) - node_id - 1;
+  std::size_t begin = louds_.select0(node_id) - node_id;
+  std::size_t end = last;
+  while (begin < end) {
+    const std::size_t middle = begin + ((end - begin) / 2);
+    const std::size_t middle_offset = branch_offsets_[middle];
+    if ((middle_offset < offset) ||
+        ((middle_offset == offset) && (branch_labels_[middle] < label))) {
+      begin = middle + 1;
+    } else {
+      end = middle;
+    }
+  }
+  if ((begin < last) && (branch_offsets_[begin] == offset) &&
+      (branch_labels_[begin] == label)) {
+    return begin;
+  }
+  return 0;
+}
+
+std::size_t CentroidTrie::find_slot(std::size_t node_id,
+                                    std::size_t offset) const {
+  // Slots are sorted by offset, and the last one ends the label.
+  const std::size_t last = leaf_flags_.select1(node_id) + 1;
+  std::size_t begin = slot_begin(node_id);
+  std::size_t end = last;
+  while (begin < end) {
+    const std::size_t middle = begin + ((end - begin) / 2);
+    if (slot_offsets_[middle] < offset) {
+      begin = middle + 1;
+    } else {
+      end = middle;
+    }
+  }
+  if ((begin < last) && (slot_offsets_[begin] == offset)) {
+    return begin;
+  }
+  return MARISA_INVALID_KEY_ID;
+}
+
+}  // namespace marisa::grimoire::trie
@@ -0,0 +1,125 @@
+#ifndef MARISA_GRIMOIRE_TRIE_CENTROID_TRIE_H_
+#define MARISA_GRIMOIRE_TRIE_CENTROID_TRIE_H_
+
+#include <string_view>
+#include <vector>
+
+#include "marisa/agent.h"
+#include "marisa/grimoire/trie/build-monitor.h"
+#include "marisa/grimoire/trie/header.h"
+#include "marisa/grimoire/trie/key.h"
+#include "marisa/grimoire/trie/louds-trie.h"
+#include "marisa/grimoire/vector.h"
+#include "marisa/keyset.h"
+
+namespace marisa::grimoire::trie {
+
+// CentroidTrie is a path-decomposed trie. Each node of the tree is a path of
+// the compacted trie that always descends to the child with the most keys,
+// so a lookup leaves a node only at a branch to a lighter child, which at
+// least halves the number of keys below. A lookup therefore visits at most
+// log2(#keys) + 1 nodes however long the keys are, and compares the label
+// of each node as one string.
+//
+// A node stores its label, and its children are stored in LOUDS order with
+// the offset in the label and the byte at which they branch off. Keys that
+// end in the middle of a node are kept in the node as key slots. Key IDs are
+// the slots in node order, so a key has a larger ID than its prefixes, as in
+// LoudsTrie.
+class CentroidTrie {
+ public:
+  using Section = LoudsTrie::Section;
+
+  CentroidTrie();
+  CentroidTrie(Keyset &keyset, BuildMonitor &monitor);
+  // This constructor builds a trie from `num_keys` keys without a Keyset.
+  // If `ids` is not nullptr, it receives the IDs.
+  CentroidTrie(const std::string_view *keys, std::size_t num_keys,
+               uint32_t *ids, BuildMonitor &monitor);
+  ~CentroidTrie();
+
+  CentroidTrie(const CentroidTrie &) = delete;
+  CentroidTrie &operator=(const CentroidTrie &) = delete;
+
+  // map() and read() take the header read by the caller.
+  void map(Mapper &mapper, const Header &header);
+  void read(Reader &reader, const Header &header);
+  void write(Writer &writer) const;
+
+  bool lookup(Agent &agent) const;
+  void reverse_lookup(Agent &agent) const;
+  bool common_prefix_search(Agent &agent) const;
+  bool predictive_search(Agent &agent) const;
+
+  const Mapper &mapper() const {
+    return mapper_;
+  }
+
+  // get_sections() appends the non-empty blocks of the trie.
+  void get_sections(std::vector<Section> *sections) const;
+
+  std::size_t num_keys() const {
+    return size();
+  }
+  std::size_t num_nodes() const {
+    return leaf_flags_.num_1s();
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+  std::size_t size() const {
+    return leaf_flags_.size();
+  }
+  std::size_t total_size() const;
+  std::size_t io_size() const;
+
+  void clear() noexcept;
+  void swap(CentroidTrie &rhs) noexcept;
+
+ private:
+  // louds_ is the tree in LOUDS. branch_offsets_ and branch_labels_ tell
+  // where in the label of its parent a node branches off and with which
+  // byte. leaf_flags_ has a bit per key slot, and the last slot of a node,
+  // which is the whole path, is 1. slot_offsets_ is the length of the key
+  // of a slot in the label of its node. label_ends_ is the end of the label
+  // of each node in labels_.
+  BitVector louds_;
+  FlatVector branch_offsets_;
+  Vector<uint8_t> branch_labels_;
+  BitVector leaf_flags_;
+  FlatVector slot_offsets_;
+  FlatVector label_ends_;
+  Vector<char> labels_;
+  Mapper mapper_;
+
+  void build_(Vector<Key> &keys, BuildMonitor &monitor);
+
+  void map_(Mapper &mapper);
+  void read_(Reader &reader);
+
+  std::size_t label_begin(std::size_t node_id) const {
+    return (node_id == 0) ? 0 : label_ends_[node_id - 1];
+  }
+  std::size_t slot_begin(std::size_t node_id) const {
+    return (node_id == 0) ? 0 : (leaf_flags_.select1(node_id - 1) + 1);
+  }
+
+  // match() compares the label of `node_id` with the query from `query_pos`
+  // in [offset, end), and returns the offset of the first mismatch, of the
+  // end of the query, or `end`.
+  std::size_t match(const Agent &agent, std::size_t node_id,
+                    std::size_t query_pos, std::size_t offset,
+                    std::size_t end) const;
+  // find_child() returns the child of `node_id` that branches off at
+  // `offset` with `label`, or 0 if there is no such child.
+  std::size_t find_child(std::size_t node_id, std::size_t offset,
+                         uint8_t label) const;
+  // find_slot() returns the key slot of `node_id` whose key ends at `offset`
+  // of the label, or MARISA_INVALID_KEY_ID.
+  std::size_t find_slot(std::size_t node_id, std::size_t offset) const;
+};
+
+}  // namespace marisa::grimoire::trie
+
+#endif  // MARISA_GRIMOIRE_TRIE_CENTROID_TRIE_H_
@@ -20,10 +20,14 @@ class Config {
     MARISA_THROW_IF((config_flags & ~MARISA_CONFIG_MASK) != 0,
                     std::invalid_argument);
 
-    parse_num_tries(config_flags);
-    parse_cache_level(config_flags);
-    parse_tail_mode(config_flags);
-    parse_node_order(config_flags);
+    Config temp;
+    temp.flags_ = config_flags;
+    temp.parse_num_tries(config_flags);
+    temp.parse_cache_level(config_flags);
+    temp.parse_tail_mode(config_flags);
+    temp.parse_node_order(config_flags);
+    temp.parse_trie_type(config_flags);
+    swap(temp);
   }
 
   int flags() const {
@@ -42,6 +46,20 @@ class Config {
   NodeOrder node_order() const {
     return static_cast<NodeOrder>(flags_ & MARISA_NODE_ORDER_MASK);
   }
+  // trie_type() is not stored in a dictionary, so 0 means the default.
+  TrieType trie_type() const {
+    switch (flags_ & MARISA_TRIE_TYPE_MASK) {
+      case MARISA_CENTROID_TRIE: {
+        return MARISA_CENTROID_TRIE;
+      }
+      case MARISA_DFUDS_TRIE: {
+        return MARISA_DFUDS_TRIE;
+      }
+      default: {
+        return MARISA_LOUDS_TRIE;
+      }
+    }
+  }
 
   void clear() noexcept {
     Config().swap(*this);
@@ -55,6 +73,9 @@ class Config {
         | MARISA_DEFAULT_TAIL | MARISA_DEFAULT_ORDER;
 
   void parse_num_tries(int config_flags) {
+    if ((config_flags & MARISA_NUM_TRIES_MASK) == 0) {
+      flags_ |= MARISA_DEFAULT_NUM_TRIES;
+    }
   }
 
   void parse_cache_level(int config_flags) {
@@ -102,6 +123,20 @@ class Config {
     }
   }
 
+  void parse_trie_type(int config_flags) {
+    switch (config_flags & MARISA_TRIE_TYPE_MASK) {
+      case 0:
+      case MARISA_LOUDS_TRIE:
+      case MARISA_CENTROID_TRIE:
+      case MARISA_DFUDS_TRIE: {
+        break;
+      }
+      default: {
+        MARISA_THROW(std::invalid_argument, "undefined trie type");
+      }
+    }
+  }
+
   void parse_node_order(int config_flags) {
     switch (config_flags & MARISA_NODE_ORDER_MASK) {
       case 0: {
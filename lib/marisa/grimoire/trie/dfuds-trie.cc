@@ -0,0 +1,533 @@
+#include "marisa/grimoire/trie/dfuds-trie.h"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <stdexcept>
+
+#include "marisa/grimoire/algorithm/sort.h"
+#include "marisa/grimoire/trie/config.h"
+#include "marisa/grimoire/trie/range.h"
+#include "marisa/grimoire/trie/state.h"
+
+namespace marisa::grimoire::trie {
+
+DfudsTrie::DfudsTrie() = default;
+
+DfudsTrie::DfudsTrie(Keyset &keyset, int flags, BuildMonitor &monitor) {
+  Config config;
+  config.parse(flags);
+
+  Vector<Key> keys;
+  {
+    BuildMonitor::Phase phase(monitor, "keys", 1);
+    keys.resize(keyset.size());
+    for (std::size_t i = 0; i < keyset.size(); ++i) {
+      keys[i].set_str(keyset[i].ptr(), keyset[i].length());
+    }
+  }
+
+  DfudsTrie temp;
+  temp.build_(keys, config.tail_mode(), monitor);
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    keyset[keys[i].id()].set_id(keys[i].terminal());
+  }
+  swap(temp);
+}
+
+DfudsTrie::DfudsTrie(const std::string_view *keys, std::size_t num_keys,
+                     uint32_t *ids, int flags, BuildMonitor &monitor) {
+  MARISA_THROW_IF((keys == nullptr) && (num_keys != 0), std::invalid_argument);
+  MARISA_THROW_IF(num_keys > UINT32_MAX, std::length_error);
+
+  Config config;
+  config.parse(flags);
+
+  Vector<Key> temp_keys;
+  {
+    BuildMonitor::Phase phase(monitor, "keys", 1);
+    temp_keys.resize(num_keys);
+    for (std::size_t i = 0; i < num_keys; ++i) {
+      MARISA_THROW_IF(keys[i].length() > UINT32_MAX, std::invalid_argument);
+      temp_keys[i].set_str(keys[i].data(), keys[i].length());
+    }
+  }
+
+  DfudsTrie temp;
+  temp.build_(temp_keys, config.tail_mode(), monitor);
+  if (ids != nullptr) {
+    for (std::size_t i = 0; i < temp_keys.size(); ++i) {
+      ids[temp_keys[i].id()] = temp_keys[i].terminal();
+    }
+  }
+  swap(temp);
+}
+
+DfudsTrie::~DfudsTrie() = default;
+
+void DfudsTrie::map(Mapper &mapper, const Header &header) {
+  MARISA_THROW_IF(header.layout() != Header::DFUDS_LAYOUT, std::runtime_error);
+
+  DfudsTrie temp;
+  temp.map_(mapper);
+  temp.mapper_.swap(mapper);
+  swap(temp);
+}
+
+void DfudsTrie::read(Reader &reader, const Header &header) {
+  MARISA_THROW_IF(header.layout() != Header::DFUDS_LAYOUT, std::runtime_error);
+
+  DfudsTrie temp;
+  temp.read_(reader);
+  swap(temp);
+}
+
+void DfudsTrie::write(Writer &writer) const {
+  Header(Header::DFUDS_LAYOUT).write(writer);
+  dfuds_.write(writer);
+  labels_.write(writer);
+  link_flags_.write(writer);
+  links_.write(writer);
+  terminal_flags_.write(writer);
+  tail_.write(writer);
+}
+
+bool DfudsTrie::lookup(Agent &agent) const {
+  assert(agent.has_state());
+
+  State &state = agent.state();
+  state.lookup_init();
+  if (empty()) {
+    return false;
+  }
+
+  std::size_t pos = 1;
+  std::size_t node_id = 0;
+  while (state.query_pos() < agent.query().length()) {
+    if (!find_child(agent, &pos, &node_id, false)) {
+      return false;
+    }
+  }
+  if (!terminal_flags_[node_id]) {
+    return false;
+  }
+  agent.set_key(agent.query().ptr(), agent.query().length());
+  agent.set_key(terminal_flags_.rank1(node_id));
+  return true;
+}
+
+void DfudsTrie::reverse_lookup(Agent &agent) const {
+  assert(agent.has_state());
+  MARISA_THROW_IF(agent.query().id() >= size(), std::out_of_range);
+
+  State &state = agent.state();
+  state.reverse_lookup_init();
+
+  // The key is restored backward from its node to the root. The edge of a
+  // node is the 1 that matches the 0 before it.
+  std::size_t node_id = terminal_flags_.select1(agent.query().id());
+  while (node_id != 0) {
+    const std::size_t pos = dfuds_.find_open(node_pos(node_id) - 1);
+    const std::size_t parent_id = dfuds_.rank0(pos);
+    const std::size_t edge_id = pos - parent_id - 1;
+    if (link_flags_[edge_id]) {
+      const std::size_t prev_key_pos = state.key_buf().size();
+      tail_.restore(agent, get_link(edge_id));
+      std::reverse(state.key_buf().begin() + prev_key_pos,
+                   state.key_buf().end());
+    }
+    state.key_buf().push_back(static_cast<char>(labels_[edge_id]));
+    node_id = parent_id;
+  }
+  std::reverse(state.key_buf().begin(), state.key_buf().end());
+  agent.set_key(state.key_buf().data(), state.key_buf().size());
+  agent.set_key(agent.query().id());
+}
+
+bool DfudsTrie::common_prefix_search(Agent &agent) const {
+  assert(agent.has_state());
+
+  State &state = agent.state();
+  if (state.status_code() == MARISA_END_OF_COMMON_PREFIX_SEARCH) {
+    return false;
+  }
+
+  // node_id() is the position of the last matched node, and history_pos()
+  // is its node ID.
+  if (state.status_code() != MARISA_READY_TO_COMMON_PREFIX_SEARCH) {
+    state.common_prefix_search_init();
+    if (empty()) {
+      state.set_status_code(MARISA_END_OF_COMMON_PREFIX_SEARCH);
+      return false;
+    }
+    state.set_node_id(1);
+    state.set_history_pos(0);
+    if (terminal_flags_[0]) {
+      agent.set_key(agent.query().ptr(), 0);
+      agent.set_key(static_cast<std::size_t>(0));
+      return true;
+    }
+  }
+
+  while (state.query_pos() < agent.query().length()) {
+    std::size_t pos = state.node_id();
+    std::size_t node_id = state.history_pos();
+    if (!find_child(agent, &pos, &node_id, false)) {
+      break;
+    }
+    state.set_node_id(pos);
+    state.set_history_pos(node_id);
+    if (terminal_flags_[node_id]) {
+      agent.set_key(agent.query().ptr(), state.query_pos());
+      agent.set_key(terminal_flags_.rank1(node_id));
+      return true;
+    }
+  }
+  state.set_status_code(MARISA_END_OF_COMMON_PREFIX_SEARCH);
+  return false;
+}
+
+// predictive_search() walks the subtree of the query in preorder with a
+// cursor, whose position is node_id() and whose node ID is history_pos().
+// The front history entry keeps the next key ID in key_id() and the number of
+// links in the 1s of the nodes before the cursor in link_id(), both of which
+// are counted up in preorder, so that no rank is needed during the walk. Each
+// other entry is a node whose key ends at key_pos() in the key buffer.
+// node_id() is its node ID, louds_pos() is the end of its 1s that have not
+// been visited, and link_id() is the number of links before louds_pos().
+bool DfudsTrie::predictive_search(Agent &agent) const {
+  assert(agent.has_state());
+
+  State &state = agent.state();
+  if (state.status_code() == MARISA_END_OF_PREDICTIVE_SEARCH) {
+    return false;
+  }
+
+  if (state.status_code() != MARISA_READY_TO_PREDICTIVE_SEARCH) {
+    state.predictive_search_init();
+    if (empty()) {
+      state.set_status_code(MARISA_END_OF_PREDICTIVE_SEARCH);
+      return false;
+    }
+
+    std::size_t pos = 1;
+    std::size_t node_id = 0;
+    while (state.query_pos() < agent.query().length()) {
+      if (!find_child(agent, &pos, &node_id, true)) {
+        state.set_status_code(MARISA_END_OF_PREDICTIVE_SEARCH);
+        return false;
+      }
+    }
+
+    History counters;
+    counters.set_key_id(terminal_flags_.rank1(node_id));
+    // rank1() may read the unit after the last one for the last 1.
+    const std::size_t edge_begin = pos - node_id - 1;
+    counters.set_link_id((edge_begin < link_flags_.size())
+                             ? link_flags_.rank1(edge_begin)
+                             : link_flags_.num_1s());
+    state.history().push_back(counters);
+    state.set_node_id(pos);
+    state.set_history_pos(node_id);
+    if (visit_cursor(agent)) {
+      return true;
+    }
+  }
+
+  while (state.history().size() > 1) {
+    // The children are visited in label order, which is backward in the 1s,
+    // until the 1 before the node, or the first 1 of the sequence.
+    History &current = state.history().back();
+    const std::size_t edge_pos = current.louds_pos() - 1;
+    if ((edge_pos == 0) || !dfuds_[edge_pos]) {
+      state.history().pop_back();
+      continue;
+    }
+    const std::size_t edge_id = edge_pos - current.node_id() - 1;
+    current.set_louds_pos(edge_pos);
+    state.key_buf().resize(current.key_pos());
+    state.key_buf().push_back(static_cast<char>(labels_[edge_id]));
+    if (link_flags_[edge_id]) {
+      current.set_link_id(current.link_id() - 1);
+      tail_.restore(agent, links_[current.link_id()]);
+    }
+    if (visit_cursor(agent)) {
+      return true;
+    }
+  }
+  state.set_status_code(MARISA_END_OF_PREDICTIVE_SEARCH);
+  return false;
+}
+
+// The subtree of a node ends with the first 0 that makes the excess lower
+// than at the node, and has a 1 per node except the node itself. Its nodes
+// have consecutive IDs, so the keys in it are counted by ranks of the first
+// node and the node after the subtree.
+std::size_t DfudsTrie::predictive_count(Agent &agent) const {
+  assert(agent.has_state());
+
+  State &state = agent.state();
+  state.predictive_search_init();
+  std::size_t count = 0;
+  if (!empty()) {
+    std::size_t pos = 1;
+    std::size_t node_id = 0;
+    bool found = true;
+    while (found && (state.query_pos() < agent.query().length())) {
+      found = find_child(agent, &pos, &node_id, true);
+    }
+    if (found) {
+      const std::ptrdiff_t excess = static_cast<std::ptrdiff_t>(pos) -
+                                    static_cast<std::ptrdiff_t>(2 * node_id);
+      const std::size_t end = dfuds_.fwd_search(pos, excess, excess - 1);
+      const std::size_t end_id = node_id + ((end + 2 - pos) / 2);
+      // rank1() may read the unit after the last one for the last node.
+      const std::size_t end_key_id = (end_id < terminal_flags_.size())
+                                         ? terminal_flags_.rank1(end_id)
+                                         : terminal_flags_.num_1s();
+      count = end_key_id - terminal_flags_.rank1(node_id);
+    }
+  }
+  state.reset();
+  return count;
+}
+
+void DfudsTrie::get_sections(std::vector<Section> *sections) const {
+  assert(sections != nullptr);
+
+  const auto add = [sections](const char *name, bool hot) {
+    return [sections, name, hot](const void *ptr, std::size_t size) {
+      if (size != 0) {
+        sections->push_back(Section{name, 1, hot, ptr, size});
+      }
+    };
+  };
+  dfuds_.for_each_block(add("dfuds", true));
+  add("labels", true)(labels_.begin(), labels_.total_size());
+  link_flags_.for_each_block(add("link_flags", true));
+  links_.for_each_block(add("links", true));
+  terminal_flags_.for_each_block(add("terminal_flags", true));
+  tail_.for_each_block(add("tail", false));
+}
+
+std::size_t DfudsTrie::total_size() const {
+  return dfuds_.total_size() + labels_.total_size() +
+         link_flags_.total_size() + links_.total_size() +
+         terminal_flags_.total_size() + tail_.total_size();
+}
+
+std::size_t DfudsTrie::io_size() const {
+  return Header().io_size() + dfuds_.io_size() + labels_.io_size() +
+         link_flags_.io_size() + links_.io_size() +
+         terminal_flags_.io_size() + tail_.io_size();
+}
+
+void DfudsTrie::clear() noexcept {
+  DfudsTrie().swap(*this);
+}
+
+void DfudsTrie::swap(DfudsTrie &rhs) noexcept {
+  dfuds_.swap(rhs.dfuds_);
+  labels_.swap(rhs.labels_);
+  link_flags_.swap(rhs.link_flags_);
+  links_.swap(rhs.links_);
+  terminal_flags_.swap(rhs.terminal_flags_);
+  tail_.swap(rhs.tail_);
+  mapper_.swap(rhs.mapper_);
+}
+
+// build_() builds the compacted trie of the sorted keys in preorder with a
+// stack, and sets the key ID of each key as its terminal.
+void DfudsTrie::build_(Vector<Key> &keys, TailMode tail_mode,
+                       BuildMonitor &monitor) {
+  {
+    BuildMonitor::Phase phase(monitor, "sort", 1);
+    BuildMonitor::Progress progress(monitor, "sort", 1, keys.size());
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      keys[i].set_id(i);
+    }
+    algorithm::sort(keys.begin(), keys.end(), progress);
+    progress.report();
+  }
+
+  Vector<Entry> entries;
+  {
+    BuildMonitor::Phase phase(monitor, "dfuds", 1);
+    BuildMonitor::Progress progress(monitor, "dfuds", 1, keys.size());
+
+    Vector<Range> stack;
+    Vector<Range> children;
+    std::size_t num_keys = 0;
+    dfuds_.push_back(true);
+    stack.push_back(make_range(0, keys.size(), 0));
+    while (!stack.empty()) {
+      const Range node = stack.back();
+      stack.pop_back();
+
+      std::size_t begin = node.begin();
+      const std::size_t end = node.end();
+      const std::size_t key_pos = node.key_pos();
+      std::size_t i = begin;
+      while ((i < end) && (keys[i].length() == key_pos)) {
+        keys[i].set_terminal(num_keys);
+        ++i;
+      }
+      terminal_flags_.push_back(i != begin);
+      if (i != begin) {
+        progress(i - begin);
+        ++num_keys;
+        begin = i;
+      }
+
+      children.clear();
+      if (begin != end) {
+        for (i = begin + 1; i < end; ++i) {
+          if (keys[i - 1][key_pos] != keys[i][key_pos]) {
+            children.push_back(make_range(begin, i, key_pos));
+            begin = i;
+          }
+        }
+        children.push_back(make_range(begin, end, key_pos));
+      }
+
+      // The children are pushed in reverse label order, both as 1s and to
+      // the stack, so that the first child is the next node in preorder.
+      for (i = children.size(); i > 0; --i) {
+        Range &child = children[i - 1];
+        const Key &first = keys[child.begin()];
+        const Key &last = keys[child.end() - 1];
+        std::size_t label_end = key_pos + 1;
+        while ((label_end < first.length()) &&
+               (first[label_end] == last[label_end])) {
+          ++label_end;
+        }
+        dfuds_.push_back(true);
+        labels_.push_back(static_cast<uint8_t>(first[key_pos]));
+        link_flags_.push_back(label_end != (key_pos + 1));
+        if (label_end != (key_pos + 1)) {
+          Entry entry;
+          entry.set_str(first.ptr() + key_pos + 1, label_end - key_pos - 1);
+          entries.push_back(entry);
+        }
+        child.set_key_pos(label_end);
+        stack.push_back(child);
+      }
+      dfuds_.push_back(false);
+    }
+    progress.report();
+
+    dfuds_.build();
+    labels_.shrink();
+    link_flags_.build(false, false);
+    terminal_flags_.build(false, true);
+  }
+
+  BuildMonitor::Phase phase(monitor, "tail", 1);
+  Vector<uint32_t> offsets;
+  tail_.build(entries, offsets, tail_mode, monitor, 1);
+  links_.build(offsets);
+}
+
+void DfudsTrie::map_(Mapper &mapper) {
+  dfuds_.map(mapper);
+  labels_.map(mapper);
+  link_flags_.map(mapper);
+  links_.map(mapper);
+  terminal_flags_.map(mapper);
+  tail_.map(mapper);
+}
+
+void DfudsTrie::read_(Reader &reader) {
+  dfuds_.read(reader);
+  labels_.read(reader);
+  link_flags_.read(reader);
+  links_.read(reader);
+  terminal_flags_.read(reader);
+  tail_.read(reader);
+}
+
+bool DfudsTrie::visit_cursor(Agent &agent) const {
+  State &state = agent.state();
+  const std::size_t pos = state.node_id();
+  const std::size_t node_id = state.history_pos();
+  const std::size_t end = dfuds_.next0(pos);
+  state.set_node_id(end + 1);
+  state.set_history_pos(node_id + 1);
+
+  History &counters = state.history().front();
+  if (end != pos) {
+    const std::size_t edge_begin = pos - node_id - 1;
+    std::size_t link_id = counters.link_id();
+    for (std::size_t i = edge_begin; i < (edge_begin + (end - pos)); ++i) {
+      link_id += link_flags_[i] ? 1 : 0;
+    }
+    counters.set_link_id(link_id);
+
+    History next;
+    next.set_node_id(node_id);
+    next.set_key_pos(state.key_buf().size());
+    next.set_louds_pos(end);
+    next.set_link_id(link_id);
+    state.history().push_back(next);
+  }
+
+  if (!terminal_flags_[node_id]) {
+    return false;
+  }
+  History &first = state.history().front();
+  agent.set_key(state.key_buf().data(), state.key_buf().size());
+  agent.set_key(first.key_id());
+  first.set_key_id(first.key_id() + 1);
+  return true;
+}
+
+bool DfudsTrie::find_child(Agent &agent, std::size_t *pos,
+                           std::size_t *node_id, bool restore) const {
+  State &state = agent.state();
+  const uint8_t label = static_cast<uint8_t>(agent.query()[state.query_pos()]);
+
+  // The labels of a node are in descending order.
+  const std::size_t edge_begin = *pos - *node_id - 1;
+  const uint8_t *const labels = labels_.begin() + edge_begin;
+  const uint8_t *const labels_end = labels + (dfuds_.next0(*pos) - *pos);
+  const uint8_t *const it =
+      std::lower_bound(labels, labels_end, label, std::greater<uint8_t>());
+  if ((it == labels_end) || (*it != label)) {
+    return false;
+  }
+  const std::size_t edge_id = static_cast<std::size_t>(it - labels_.begin());
+
+  state.set_query_pos(state.query_pos() + 1);
+  if (restore) {
+    state.key_buf().push_back(static_cast<char>(label));
+  }
+  if (link_flags_[edge_id]) {
+    const std::size_t link = get_link(edge_id);
+    if (state.query_pos() == agent.query().length()) {
+      if (!restore) {
+        return false;
+      }
+      tail_.restore(agent, link);
+    } else if (restore ? !tail_.prefix_match(agent, link)
+                       : !tail_.match(agent, link)) {
+      return false;
+    }
+  }
+
+  // The first child follows the 0 of the node. Another child follows the 0
+  // that matches its 1, and has the same excess as the 1.
+  const std::size_t edge_pos = *pos + (edge_id - edge_begin);
+  if (!dfuds_[edge_pos + 1]) {
+    *pos = edge_pos + 2;
+    ++*node_id;
+  } else {
+    const std::ptrdiff_t excess = static_cast<std::ptrdiff_t>(edge_pos) -
+                                  static_cast<std::ptrdiff_t>(2 * *node_id);
+    *pos = dfuds_.find_close(edge_pos, excess) + 1;
+    *node_id = static_cast<std::size_t>(
+        (static_cast<std::ptrdiff_t>(*pos) - excess) / 2);
+  }
+  return true;
+}
+
+}  // namespace marisa::grimoire::trie
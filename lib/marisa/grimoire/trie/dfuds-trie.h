@@ -0,0 +1,127 @@
+#ifndef MARISA_GRIMOIRE_TRIE_DFUDS_TRIE_H_
+#define MARISA_GRIMOIRE_TRIE_DFUDS_TRIE_H_
+
+#include <string_view>
+#include <vector>
+
+#include "marisa/agent.h"
+#include "marisa/grimoire/trie/build-monitor.h"
+#include "marisa/grimoire/trie/header.h"
+#include "marisa/grimoire/trie/key.h"
+#include "marisa/grimoire/trie/louds-trie.h"
+#include "marisa/grimoire/trie/tail.h"
+#include "marisa/grimoire/vector.h"
+#include "marisa/keyset.h"
+
+namespace marisa::grimoire::trie {
+
+// DfudsTrie is a compacted trie in DFUDS (depth-first unary degree sequence).
+// The sequence starts with a 1, and each node in preorder appends a 1 per
+// child and a 0. The subtree of a node is therefore a contiguous range of
+// the sequence, and a predictive search walks it from left to right instead
+// of jumping from level to level as in LOUDS. Key IDs are given in preorder,
+// so the keys below a node also have consecutive IDs, and a key has a larger
+// ID than its prefixes, as in LoudsTrie.
+//
+// The 1s of a node are its children in reverse label order, so that the
+// first child follows the node right after its 0. Each 1 has the first byte
+// of the label of the edge, and the rest of the label, if any, is in TAIL.
+class DfudsTrie {
+ public:
+  using Section = LoudsTrie::Section;
+
+  DfudsTrie();
+  DfudsTrie(Keyset &keyset, int flags, BuildMonitor &monitor);
+  // This constructor builds a trie from `num_keys` keys without a Keyset.
+  // If `ids` is not nullptr, it receives the IDs.
+  DfudsTrie(const std::string_view *keys, std::size_t num_keys, uint32_t *ids,
+            int flags, BuildMonitor &monitor);
+  ~DfudsTrie();
+
+  DfudsTrie(const DfudsTrie &) = delete;
+  DfudsTrie &operator=(const DfudsTrie &) = delete;
+
+  // map() and read() take the header read by the caller.
+  void map(Mapper &mapper, const Header &header);
+  void read(Reader &reader, const Header &header);
+  void write(Writer &writer) const;
+
+  bool lookup(Agent &agent) const;
+  void reverse_lookup(Agent &agent) const;
+  bool common_prefix_search(Agent &agent) const;
+  bool predictive_search(Agent &agent) const;
+  // predictive_count() returns the number of keys below the node of the
+  // query, and resets the search of `agent`.
+  std::size_t predictive_count(Agent &agent) const;
+
+  const Mapper &mapper() const {
+    return mapper_;
+  }
+
+  // get_sections() appends the non-empty blocks of the trie.
+  void get_sections(std::vector<Section> *sections) const;
+
+  TailMode tail_mode() const {
+    return tail_.mode();
+  }
+
+  std::size_t num_keys() const {
+    return size();
+  }
+  std::size_t num_nodes() const {
+    return terminal_flags_.size();
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+  std::size_t size() const {
+    return terminal_flags_.num_1s();
+  }
+  std::size_t total_size() const;
+  std::size_t io_size() const;
+
+  void clear() noexcept;
+  void swap(DfudsTrie &rhs) noexcept;
+
+ private:
+  // dfuds_ is the tree. labels_ and link_flags_ have an element per 1 of
+  // dfuds_ except the first one, and links_ is the offset in tail_ of each
+  // edge whose link flag is 1. terminal_flags_ has a bit per node in
+  // preorder.
+  BpVector dfuds_;
+  Vector<uint8_t> labels_;
+  BitVector link_flags_;
+  FlatVector links_;
+  BitVector terminal_flags_;
+  Tail tail_;
+  Mapper mapper_;
+
+  void build_(Vector<Key> &keys, TailMode tail_mode, BuildMonitor &monitor);
+
+  void map_(Mapper &mapper);
+  void read_(Reader &reader);
+
+  // node_pos() returns the position of `node_id`.
+  std::size_t node_pos(std::size_t node_id) const {
+    return (node_id == 0) ? 1 : (dfuds_.select0(node_id - 1) + 1);
+  }
+  std::size_t get_link(std::size_t edge_id) const {
+    return links_[link_flags_.rank1(edge_id)];
+  }
+
+  // find_child() moves `*pos` and `*node_id` to the child of the node whose
+  // label matches the query from query_pos(). If `restore` is true, the label
+  // is appended to the key buffer, and the query may end inside the label.
+  // A node has `*node_id` 0s before it, so its 1s are found without rank.
+  bool find_child(Agent &agent, std::size_t *pos, std::size_t *node_id,
+                  bool restore) const;
+  // visit_cursor() enters the node at the cursor of predictive_search(),
+  // moves the cursor to the next node in preorder, and reports the key of
+  // the node if any.
+  bool visit_cursor(Agent &agent) const;
+};
+
+}  // namespace marisa::grimoire::trie
+
+#endif  // MARISA_GRIMOIRE_TRIE_DFUDS_TRIE_H_
@@ -0,0 +1,196 @@
+#include "marisa/grimoire/trie/diff-walker.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "marisa/grimoire/trie/state.h"
+
+namespace marisa::grimoire::trie {
+
+DiffWalker::DiffWalker(const LoudsTrie &old_trie, const LoudsTrie &new_trie)
+    : tries_{&old_trie, &new_trie} {}
+
+void DiffWalker::run(const DiffCallback &callback) {
+  if (tries_[0] == tries_[1]) {
+    return;
+  }
+
+  depth_ = 0;
+  key_.clear();
+  Frame &root = push(0, std::string_view());
+  for (std::size_t i = 0; i < 2; ++i) {
+    // A trie that is neither built nor loaded has no root.
+    set_side(root.sides[i], tries_[i]->louds_.empty() ? NO_NODE : 0,
+             std::string_view());
+  }
+
+  while (depth_ != 0) {
+    Frame &frame = frames_[depth_ - 1];
+    if (!frame.entered) {
+      enter(frame, callback);
+    } else {
+      key_.resize(frame.key_pos + frame.edge.size());
+    }
+    step(frame);
+  }
+}
+
+DiffWalker::Frame &DiffWalker::push(std::size_t key_pos,
+                                    std::string_view edge) {
+  if (depth_ == frames_.size()) {
+    frames_.emplace_back();
+  }
+  Frame &frame = frames_[depth_++];
+  frame.key_pos = key_pos;
+  frame.edge.assign(edge.data(), edge.size());
+  frame.entered = false;
+  return frame;
+}
+
+void DiffWalker::set_side(Side &side, std::size_t node_id,
+                          std::string_view rest) const {
+  side.node_id = node_id;
+  side.rest.assign(rest.data(), rest.size());
+}
+
+void DiffWalker::enter(Frame &frame, const DiffCallback &callback) {
+  key_.resize(frame.key_pos);
+  key_ += frame.edge;
+
+  std::size_t ids[2];
+  for (std::size_t i = 0; i < 2; ++i) {
+    const Side &side = frame.sides[i];
+    ids[i] = MARISA_INVALID_KEY_ID;
+    if ((side.node_id != NO_NODE) && side.rest.empty() &&
+        tries_[i]->terminal_flags_[side.node_id]) {
+      ids[i] = tries_[i]->terminal_flags_.rank1(side.node_id);
+    }
+  }
+  if (ids[0] != ids[1]) {
+    if (ids[0] == MARISA_INVALID_KEY_ID) {
+      callback(KeyDiff(MARISA_KEY_ADDED, key_, ids[0], ids[1]));
+    } else if (ids[1] == MARISA_INVALID_KEY_ID) {
+      callback(KeyDiff(MARISA_KEY_REMOVED, key_, ids[0], ids[1]));
+    } else {
+      callback(KeyDiff(MARISA_KEY_MOVED, key_, ids[0], ids[1]));
+    }
+  }
+
+  get_edges(0, frame.sides[0]);
+  get_edges(1, frame.sides[1]);
+  frame.entered = true;
+}
+
+void DiffWalker::get_edges(std::size_t side_id, Side &side) {
+  side.labels.clear();
+  side.edges.clear();
+  side.edge_id = 0;
+  if (side.node_id == NO_NODE) {
+    return;
+  }
+  if (!side.rest.empty()) {
+    side.labels = side.rest;
+    side.edges.push_back(Edge{side.node_id, 0, side.rest.size()});
+    return;
+  }
+
+  const LoudsTrie &trie = *tries_[side_id];
+  Agent &agent = agents_[side_id];
+  std::size_t louds_pos = trie.louds_.select0(side.node_id) + 1;
+  std::size_t node_id = louds_pos - side.node_id - 1;
+  std::size_t link_id = MARISA_INVALID_LINK_ID;
+  for (; trie.louds_[louds_pos]; ++louds_pos, ++node_id) {
+    agent.state().key_buf().clear();
+    trie.restore_edge(agent, node_id, &link_id);
+    const std::vector<char> &labels = agent.state().key_buf();
+    side.edges.push_back(Edge{node_id, side.labels.size(), labels.size()});
+    side.labels.append(labels.data(), labels.size());
+  }
+
+  // Siblings are in weight order unless the trie is built with
+  // MARISA_LABEL_ORDER. They have distinct first labels.
+  const auto first_label = [&side](const Edge &edge) {
+    return static_cast<uint8_t>(side.labels[edge.offset]);
+  };
+  const auto less = [&first_label](const Edge &lhs, const Edge &rhs) {
+    return first_label(lhs) < first_label(rhs);
+  };
+  if (!std::is_sorted(side.edges.begin(), side.edges.end(), less)) {
+    std::sort(side.edges.begin(), side.edges.end(), less);
+  }
+}
+
+void DiffWalker::step(Frame &frame) {
+  Side &old_side = frame.sides[0];
+  Side &new_side = frame.sides[1];
+  const bool has_old = old_side.edge_id < old_side.edges.size();
+  const bool has_new = new_side.edge_id < new_side.edges.size();
+  if (!has_old && !has_new) {
+    --depth_;
+    return;
+  }
+
+  const std::size_t key_pos = key_.size();
+  const auto edge_labels = [](const Side &side) {
+    const Edge &edge = side.edges[side.edge_id];
+    return std::string_view(side.labels).substr(edge.offset, edge.length);
+  };
+  const std::string_view old_edge =
+      has_old ? edge_labels(old_side) : std::string_view();
+  const std::string_view new_edge =
+      has_new ? edge_labels(new_side) : std::string_view();
+  const std::size_t old_node_id =
+      has_old ? old_side.edges[old_side.edge_id].node_id : NO_NODE;
+  const std::size_t new_node_id =
+      has_new ? new_side.edges[new_side.edge_id].node_id : NO_NODE;
+
+  // The frames of a std::deque are not moved by push().
+  if (!has_new || (has_old && (static_cast<uint8_t>(old_edge[0]) <
+                               static_cast<uint8_t>(new_edge[0])))) {
+    Frame &child = push(key_pos, old_edge);
+    set_side(child.sides[0], old_node_id, std::string_view());
+    set_side(child.sides[1], NO_NODE, std::string_view());
+    ++old_side.edge_id;
+    return;
+  }
+  if (!has_old || (static_cast<uint8_t>(new_edge[0]) <
+                   static_cast<uint8_t>(old_edge[0]))) {
+    Frame &child = push(key_pos, new_edge);
+    set_side(child.sides[0], NO_NODE, std::string_view());
+    set_side(child.sides[1], new_node_id, std::string_view());
+    ++new_side.edge_id;
+    return;
+  }
+
+  ++old_side.edge_id;
+  ++new_side.edge_id;
+  const std::size_t length = std::min(old_edge.length(), new_edge.length());
+  std::size_t pos = 1;
+  while ((pos < length) && (old_edge[pos] == new_edge[pos])) {
+    ++pos;
+  }
+  if (pos == length) {
+    // One edge is a prefix of the other, so the side with the longer edge
+    // stops in its middle.
+    const std::string_view edge = old_edge.substr(0, length);
+    Frame &child = push(key_pos, edge);
+    set_side(child.sides[0], old_node_id, old_edge.substr(length));
+    set_side(child.sides[1], new_node_id, new_edge.substr(length));
+    return;
+  }
+
+  // The edges diverge, so the subtrees have no keys in common. The frame of
+  // the smaller edge is pushed last to be visited first.
+  const bool old_first = static_cast<uint8_t>(old_edge[pos]) <
+                         static_cast<uint8_t>(new_edge[pos]);
+  for (std::size_t i = 0; i < 2; ++i) {
+    const bool is_old = (i == 0) != old_first;
+    Frame &child = push(key_pos, is_old ? old_edge : new_edge);
+    set_side(child.sides[0], is_old ? old_node_id : NO_NODE,
+             std::string_view());
+    set_side(child.sides[1], is_old ? NO_NODE : new_node_id,
+             std::string_view());
+  }
+}
+
+}  // namespace marisa::grimoire::trie
@@ -0,0 +1,75 @@
+#ifndef MARISA_GRIMOIRE_TRIE_DIFF_WALKER_H_
+#define MARISA_GRIMOIRE_TRIE_DIFF_WALKER_H_
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "marisa/agent.h"
+#include "marisa/key-diff.h"
+#include "marisa/grimoire/trie/louds-trie.h"
+
+namespace marisa::grimoire::trie {
+
+// DiffWalker walks two tries in lockstep in lexicographic order of keys. A
+// subtree that exists on only one side is enumerated without comparisons,
+// and edges are compared only where both tries have children with the same
+// first byte. Edges of the two tries may be split at different positions
+// because of TAIL and the tries of the recursion, so a side may stop in the
+// middle of an edge until the other side catches up.
+class DiffWalker {
+ public:
+  DiffWalker(const LoudsTrie &old_trie, const LoudsTrie &new_trie);
+
+  DiffWalker(const DiffWalker &) = delete;
+  DiffWalker &operator=(const DiffWalker &) = delete;
+
+  // run() calls `callback` for each added, removed or moved key in
+  // lexicographic order.
+  void run(const DiffCallback &callback);
+
+ private:
+  // An edge refers to a child and a range of the edge labels of a frame.
+  struct Edge {
+    std::size_t node_id;
+    std::size_t offset;
+    std::size_t length;
+  };
+
+  // A side is a position in one of the tries. If `rest` is not empty, the
+  // position is in the middle of the edge to `node_id` and `rest` is the
+  // remaining part of the edge. `node_id` == NO_NODE means that the trie does
+  // not have the prefix.
+  struct Side {
+    std::size_t node_id;
+    std::string rest;
+    std::string labels;
+    std::vector<Edge> edges;
+    std::size_t edge_id;
+  };
+
+  struct Frame {
+    std::size_t key_pos;
+    std::string edge;
+    bool entered;
+    Side sides[2];
+  };
+
+  static constexpr std::size_t NO_NODE = SIZE_MAX;
+
+  const LoudsTrie *tries_[2];
+  Agent agents_[2];
+  std::deque<Frame> frames_;
+  std::size_t depth_ = 0;
+  std::string key_;
+
+  Frame &push(std::size_t key_pos, std::string_view edge);
+  void set_side(Side &side, std::size_t node_id, std::string_view rest) const;
+  void enter(Frame &frame, const DiffCallback &callback);
+  void get_edges(std::size_t side_id, Side &side);
+  void step(Frame &frame);
+};
+
+}  // namespace marisa::grimoire::trie
+
+#endif  // MARISA_GRIMOIRE_TRIE_DIFF_WALKER_H_
@@ -1,6 +1,7 @@
 #ifndef MARISA_GRIMOIRE_TRIE_HEADER_H_
 #define MARISA_GRIMOIRE_TRIE_HEADER_H_
 
+#include <cassert>
 #include <stdexcept>
 
 #include "marisa/grimoire/io.h"
@@ -13,7 +14,22 @@ class Header {
     HEADER_SIZE = 16
   };
 
+  // The header also tells the order of sections. See LoudsTrie::write().
+  // CENTROID_LAYOUT is a CentroidTrie and DFUDS_LAYOUT is a DfudsTrie
+  // instead of a LoudsTrie. LEGACY_LAYOUT is the standard layout of older
+  // versions, which padded 8-byte aligned vectors with 8 extra bytes. It is
+  // read but never written.
+  enum Layout {
+    STANDARD_LAYOUT = 0,
+    HOT_FIRST_LAYOUT = 1,
+    CENTROID_LAYOUT = 2,
+    DFUDS_LAYOUT = 3,
+    LEGACY_LAYOUT = 4,
+    NUM_LAYOUTS = 5
+  };
+
   Header() = default;
+  explicit Header(Layout layout) : layout_(layout) {}
 
   Header(const Header &) = delete;
   Header &operator=(const Header &) = delete;
@@ -21,15 +37,22 @@ class Header {
   void map(Mapper &mapper) {
     const char *ptr;
     mapper.map(&ptr, HEADER_SIZE);
-    MARISA_THROW_IF(!test_header(ptr), std::runtime_error);
+    layout_ = test_header(ptr);
+    mapper.set_legacy_padding(layout_ == LEGACY_LAYOUT);
   }
   void read(Reader &reader) {
     char buf[HEADER_SIZE];
     reader.read(buf, HEADER_SIZE);
-    MARISA_THROW_IF(!test_header(buf), std::runtime_error);
+    layout_ = test_header(buf);
+    reader.set_legacy_padding(layout_ == LEGACY_LAYOUT);
   }
   void write(Writer &writer) const {
-    writer.write(get_header(), HEADER_SIZE);
+    assert(layout_ != LEGACY_LAYOUT);
+    writer.write(get_header(layout_), HEADER_SIZE);
+  }
+
+  Layout layout() const {
+    return layout_;
   }
 
   std::size_t io_size() const {
@@ -37,18 +60,27 @@ class Header {
   }
 
  private:
-  static const char *get_header() {
-    static const char buf[HEADER_SIZE] = "We love Marisa.";
-    return buf;
+  Layout layout_ = STANDARD_LAYOUT;
+
+  static const char *get_header(Layout layout) {
+    static const char bufs[NUM_LAYOUTS][HEADER_SIZE] = {
+        "We love Marisa2", "We love Marisa!", "We love Marisa?",
+        "We love Marisa*", "We love Marisa."};
+    return bufs[layout];
   }
 
-  static bool test_header(const char *ptr) {
-    for (std::size_t i = 0; i < HEADER_SIZE; ++i) {
-      if (ptr[i] != get_header()[i]) {
-        return false;
+  static Layout test_header(const char *ptr) {
+    for (int layout = 0; layout < NUM_LAYOUTS; ++layout) {
+      const char *const header = get_header(static_cast<Layout>(layout));
+      std::size_t i = 0;
+      while ((i < HEADER_SIZE) && (ptr[i] == header[i])) {
+        ++i;
+      }
+      if (i == HEADER_SIZE) {
+        return static_cast<Layout>(layout);
       }
     }
-    return true;
+    MARISA_THROW(std::runtime_error, "invalid header");
   }
 };
 
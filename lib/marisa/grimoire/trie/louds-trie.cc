@@ -16,34 +16,77 @@ namespace marisa::grimoire::trie {
 LoudsTrie::LoudsTrie() = default;
 
 LoudsTrie::LoudsTrie(Keyset &keyset, int flags) {
+  BuildMonitor monitor;
   LoudsTrie temp;
-  temp.build_(keyset, Config(flags));
+  temp.build_(keyset, Config(flags), monitor);
+  swap(temp);
+}
+
+LoudsTrie::LoudsTrie(Keyset &keyset, int flags, BuildMonitor &monitor) {
+  LoudsTrie temp;
+  temp.build_(keyset, Config(flags), monitor);
+  swap(temp);
+}
+
+LoudsTrie::LoudsTrie(const std::string_view *keys, std::size_t num_keys,
+                     const float *weights, uint32_t *ids, int flags,
+                     BuildMonitor &monitor) {
+  LoudsTrie temp;
+  temp.build_(keys, num_keys, weights, ids, Config(flags), monitor);
   swap(temp);
 }
 
 LoudsTrie::~LoudsTrie() = default;
 
 void LoudsTrie::map(Mapper &mapper) {
-  Header().map(mapper);
+  Header header;
+  header.map(mapper);
+  map(mapper, header);
+}
+
+void LoudsTrie::map(Mapper &mapper, const Header &header) {
+  MARISA_THROW_IF((header.layout() == Header::CENTROID_LAYOUT) ||
+                      (header.layout() == Header::DFUDS_LAYOUT),
+                  std::runtime_error);
 
   LoudsTrie temp;
-  temp.map_(mapper);
+  if (header.layout() == Header::HOT_FIRST_LAYOUT) {
+    temp.map_hot_first_(mapper);
+  } else {
+    temp.map_(mapper);
+  }
   temp.mapper_.swap(mapper);
   swap(temp);
 }
 
 void LoudsTrie::read(Reader &reader) {
-  Header().read(reader);
+  Header header;
+  header.read(reader);
+  read(reader, header);
+}
+
+void LoudsTrie::read(Reader &reader, const Header &header) {
+  MARISA_THROW_IF((header.layout() == Header::CENTROID_LAYOUT) ||
+                      (header.layout() == Header::DFUDS_LAYOUT),
+                  std::runtime_error);
 
   LoudsTrie temp;
-  temp.read_(reader);
+  if (header.layout() == Header::HOT_FIRST_LAYOUT) {
+    temp.read_hot_first_(reader);
+  } else {
+    temp.read_(reader);
+  }
   swap(temp);
 }
 
-void LoudsTrie::write(Writer &writer) const {
-  Header().write(writer);
-
-  write_(writer);
+void LoudsTrie::write(Writer &writer, int flags) const {
+  if ((flags & MARISA_SAVE_HOT_FIRST) != 0) {
+    Header(Header::HOT_FIRST_LAYOUT).write(writer);
+    write_hot_first_(writer);
+  } else {
+    Header().write(writer);
+    write_(writer);
+  }
 }
 
 bool LoudsTrie::lookup(Agent &agent) const {
@@ -64,6 +107,90 @@ bool LoudsTrie::lookup(Agent &agent) const {
   return true;
 }
 
+void LoudsTrie::lookup_init(Agent &agent) const {
+  assert(agent.has_state());
+
+  agent.state().lookup_init();
+}
+
+bool LoudsTrie::lookup_step(Agent &agent, bool *found) const {
+  assert(found != nullptr);
+
+  State &state = agent.state();
+  if (state.query_pos() < agent.query().length()) {
+    if (find_child(agent)) {
+      return true;
+    }
+    *found = false;
+    return false;
+  }
+  *found = terminal_flags_[state.node_id()];
+  if (*found) {
+    agent.set_key(agent.query().ptr(), agent.query().length());
+    agent.set_key(terminal_flags_.rank1(state.node_id()));
+  }
+  return false;
+}
+
+// prefetch_step() follows find_child() as far as the data is resident. The
+// pages of a step are requested together, so that their reads overlap.
+bool LoudsTrie::prefetch_step(const Agent &agent,
+                              const Residency &residency) const {
+  const State &state = agent.state();
+  const std::size_t node_id = state.node_id();
+  if (state.query_pos() >= agent.query().length()) {
+    const bool unit_resident =
+        residency.request(terminal_flags_.unit_ptr(node_id));
+    return residency.request(terminal_flags_.rank_ptr(node_id)) &&
+           unit_resident;
+  }
+
+  const Cache &cache =
+      cache_[get_cache_id(node_id, agent.query()[state.query_pos()])];
+  if (!residency.request(&cache)) {
+    return false;
+  }
+  if (node_id == cache.parent()) {
+    return (cache.extra() == MARISA_INVALID_EXTRA) ||
+           prefetch_link(cache.link(), residency);
+  }
+
+  if (!residency.request(louds_.select0_ptr(node_id))) {
+    return false;
+  }
+  const std::size_t hint = louds_.select0_hint(node_id);
+  const bool unit_resident = residency.request(louds_.unit_ptr(hint));
+  if (!residency.request(louds_.rank_ptr(hint)) || !unit_resident) {
+    return false;
+  }
+  const std::size_t louds_pos = louds_.select0(node_id) + 1;
+  if (!residency.request(louds_.unit_ptr(louds_pos))) {
+    return false;
+  }
+  if (!louds_[louds_pos]) {
+    return true;
+  }
+  const std::size_t child_id = louds_pos - node_id - 1;
+  const bool base_resident = residency.request(&bases_[child_id]);
+  const bool flag_resident =
+      residency.request(link_flags_.unit_ptr(child_id));
+  return residency.request(link_flags_.rank_ptr(child_id)) && base_resident &&
+         flag_resident;
+}
+
+bool LoudsTrie::prefetch_link(std::size_t link,
+                              const Residency &residency) const {
+  if (next_trie_ == nullptr) {
+    return residency.request(&tail_[link]);
+  }
+  const LoudsTrie &next = *next_trie_;
+  const bool cache_resident =
+      residency.request(&next.cache_[next.get_cache_id(link)]);
+  const bool base_resident = residency.request(&next.bases_[link]);
+  return residency.request(next.link_flags_.unit_ptr(link)) &&
+         cache_resident && base_resident;
+}
+
 void LoudsTrie::reverse_lookup(Agent &agent) const {
   assert(agent.has_state());
   MARISA_THROW_IF(agent.query().id() >= size(), std::out_of_range);
@@ -139,7 +266,14 @@ bool LoudsTrie::predictive_search(Agent &agent) const {
   }
 
   if (state.status_code() != MARISA_READY_TO_PREDICTIVE_SEARCH) {
-    state.predictive_search_init();
+    if (state.status_code() == MARISA_READY_TO_EXTEND_PREDICTIVE_SEARCH) {
+      if (!predictive_search_extend(agent)) {
+        state.set_status_code(MARISA_END_OF_PREDICTIVE_SEARCH);
+        return false;
+      }
+    } else {
+      state.predictive_search_init();
+    }
     while (state.query_pos() < agent.query().length()) {
       if (!predictive_find_child(agent)) {
         state.set_status_code(MARISA_END_OF_PREDICTIVE_SEARCH);
@@ -222,6 +356,57 @@ std::size_t LoudsTrie::io_size() const {
          cache_.io_size() + (sizeof(uint32_t) * 2);
 }
 
+void LoudsTrie::get_sections(std::vector<Section> *sections,
+                             std::size_t trie_id) const {
+  assert(sections != nullptr);
+
+  const auto add = [sections, trie_id](const char *name, bool hot) {
+    return [sections, trie_id, name, hot](const void *ptr, std::size_t size) {
+      if (size != 0) {
+        sections->push_back(Section{name, trie_id, hot, ptr, size});
+      }
+    };
+  };
+  add("cache", true)(cache_.begin(), cache_.total_size());
+  louds_.for_each_block(add("louds", true));
+  terminal_flags_.for_each_block(add("terminal_flags", true));
+  link_flags_.for_each_block(add("link_flags", true));
+  add("bases", true)(bases_.begin(), bases_.total_size());
+  extras_.for_each_block(add("extras", true));
+  tail_.for_each_block(add("tail", false));
+  if (next_trie_ != nullptr) {
+    next_trie_->get_sections(sections, trie_id + 1);
+  }
+}
+
+void LoudsTrie::rebuild_cache(CacheLevel cache_level) {
+  Config temp_config;
+  temp_config.parse(cache_level);
+  if (bases_.empty()) {
+    return;
+  }
+
+  Vector<float> weights;
+  weights.resize(bases_.size());
+  for (std::size_t i = 0; i < weights.size(); ++i) {
+    weights[i] = terminal_flags_[i] ? 1.0F : 0.0F;
+  }
+  rebuild_cache_(temp_config.cache_level(), 1, size(), weights);
+}
+
+void LoudsTrie::clear_cache() {
+  // A cache with an unreachable entry never hits.
+  Vector<Cache> temp_cache;
+  temp_cache.resize(1);
+  temp_cache[0].set_parent(UINT32_MAX);
+  temp_cache[0].set_child(UINT32_MAX);
+  if (next_trie_ != nullptr) {
+    next_trie_->clear_cache();
+  }
+  cache_.swap(temp_cache);
+  cache_mask_ = 0;
+}
+
 void LoudsTrie::clear() noexcept {
   LoudsTrie().swap(*this);
 }
@@ -241,17 +426,54 @@ void LoudsTrie::swap(LoudsTrie &rhs) noexcept {
   mapper_.swap(rhs.mapper_);
 }
 
-void LoudsTrie::build_(Keyset &keyset, const Config &config) {
+void LoudsTrie::build_(Keyset &keyset, const Config &config,
+                       BuildMonitor &monitor) {
   Vector<Key> keys;
-  keys.resize(keyset.size());
-  for (std::size_t i = 0; i < keyset.size(); ++i) {
-    keys[i].set_str(keyset[i].ptr(), keyset[i].length());
-    keys[i].set_weight(keyset[i].weight());
+  {
+    BuildMonitor::Phase phase(monitor, "keys", 1);
+    keys.resize(keyset.size());
+    for (std::size_t i = 0; i < keyset.size(); ++i) {
+      keys[i].set_str(keyset[i].ptr(), keyset[i].length());
+      keys[i].set_weight(keyset[i].weight());
+    }
   }
 
+  build_keys_(keys, config, monitor, [&](std::size_t i, std::size_t id) {
+    keyset[i].set_id(id);
+  });
+}
+
+void LoudsTrie::build_(const std::string_view *keys, std::size_t num_keys,
+                       const float *weights, uint32_t *ids,
+                       const Config &config, BuildMonitor &monitor) {
+  MARISA_THROW_IF((keys == nullptr) && (num_keys != 0), std::invalid_argument);
+  MARISA_THROW_IF(num_keys > UINT32_MAX, std::length_error);
+
+  Vector<Key> temp_keys;
+  {
+    BuildMonitor::Phase phase(monitor, "keys", 1);
+    temp_keys.resize(num_keys);
+    for (std::size_t i = 0; i < num_keys; ++i) {
+      MARISA_THROW_IF(keys[i].length() > UINT32_MAX, std::invalid_argument);
+      temp_keys[i].set_str(keys[i].data(), keys[i].length());
+      temp_keys[i].set_weight((weights != nullptr) ? weights[i] : 1.0F);
+    }
+  }
+
+  build_keys_(temp_keys, config, monitor, [&](std::size_t i, std::size_t id) {
+    if (ids != nullptr) {
+      ids[i] = static_cast<uint32_t>(id);
+    }
+  });
+}
+
+template <typename SetId>
+void LoudsTrie::build_keys_(Vector<Key> &keys, const Config &config,
+                            BuildMonitor &monitor, const SetId &set_id) {
   Vector<uint32_t> terminals;
-  build_trie(keys, terminals, config, 1);
+  build_trie(keys, terminals, config, 1, monitor);
 
+  BuildMonitor::Phase phase(monitor, "terminals", 1);
   using TerminalIdPair = std::pair<uint32_t, uint32_t>;
   const std::size_t pairs_size = terminals.size();
   std::unique_ptr<TerminalIdPair[]> pairs(new TerminalIdPair[pairs_size]);
@@ -264,66 +486,78 @@ void LoudsTrie::build_(Keyset &keyset, const Config &config) {
 
   std::size_t node_id = 0;
   for (std::size_t i = 0; i < pairs_size; ++i) {
-    while (node_id < pairs[i].first) {
-      terminal_flags_.push_back(false);
-      ++node_id;
+    if (node_id < pairs[i].first) {
+      terminal_flags_.push_back_run(false, pairs[i].first - node_id);
+      node_id = pairs[i].first;
     }
     if (node_id == pairs[i].first) {
       terminal_flags_.push_back(true);
       ++node_id;
     }
   }
-  while (node_id < bases_.size()) {
-    terminal_flags_.push_back(false);
-    ++node_id;
-  }
-  terminal_flags_.push_back(false);
+  terminal_flags_.push_back_run(false, bases_.size() - node_id + 1);
   terminal_flags_.build(false, true);
 
-  for (std::size_t i = 0; i < keyset.size(); ++i) {
-    keyset[pairs[i].second].set_id(terminal_flags_.rank1(pairs[i].first));
+  for (std::size_t i = 0; i < pairs_size; ++i) {
+    set_id(pairs[i].second, terminal_flags_.rank1(pairs[i].first));
   }
 }
 
 template <typename T>
 void LoudsTrie::build_trie(Vector<T> &keys, Vector<uint32_t> &terminals,
-                           const Config &config, std::size_t trie_id) {
-  build_current_trie(keys, terminals, config, trie_id);
+                           const Config &config, std::size_t trie_id,
+                           BuildMonitor &monitor) {
+  build_current_trie(keys, terminals, config, trie_id, monitor);
 
   Vector<uint32_t> next_terminals;
   if (!keys.empty()) {
-    build_next_trie(keys, next_terminals, config, trie_id);
+    build_next_trie(keys, next_terminals, config, trie_id, monitor);
   }
 
-  int flags = (next_trie_ != nullptr)
-                ? static_cast<int>((next_trie_->num_tries() + 1)) |
-                  next_trie_->tail_mode() | next_trie_->node_order()
-                : 1 | tail_.mode() | config.node_order() |
-                  config.cache_level();
-  config_.parse(flags);
-
-  link_flags_.build(false, false);
-  std::size_t node_id = 0;
-  for (std::size_t i = 0; i < next_terminals.size(); ++i) {
-    while (!link_flags_[node_id]) {
+  {
+    BuildMonitor::Phase phase(monitor, "links", trie_id);
+    int flags = (next_trie_ != nullptr)
+                  ? static_cast<int>((next_trie_->num_tries() + 1)) |
+                    next_trie_->tail_mode() | next_trie_->node_order()
+                  : 1 | tail_.mode() | config.node_order() |
+                    config.cache_level();
+    config_.parse(flags);
+
+    link_flags_.build(false, false);
+    std::size_t node_id = 0;
+    for (std::size_t i = 0; i < next_terminals.size(); ++i) {
+      while (!link_flags_[node_id]) {
+        ++node_id;
+      }
+      bases_[node_id] = static_cast<uint8_t>(next_terminals[i] % 256);
+      next_terminals[i] /= 256;
       ++node_id;
     }
-    bases_[node_id] = static_cast<uint8_t>(next_terminals[i] % 256);
-    next_terminals[i] /= 256;
-    ++node_id;
+    extras_.build(next_terminals);
   }
-  extras_.build(next_terminals);
+
+  BuildMonitor::Phase phase(monitor, "cache", trie_id);
   fill_cache();
 }
 
 template <typename T>
 void LoudsTrie::build_current_trie(Vector<T> &keys, Vector<uint32_t> &terminals,
-                                   const Config &config, std::size_t trie_id) {
-  for (std::size_t i = 0; i < keys.size(); ++i) {
-    keys[i].set_id(i);
+                                   const Config &config, std::size_t trie_id,
+                                   BuildMonitor &monitor) {
+  std::size_t num_keys;
+  {
+    BuildMonitor::Phase phase(monitor, "sort", trie_id);
+    BuildMonitor::Progress progress(monitor, "sort", trie_id, keys.size());
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      keys[i].set_id(i);
+    }
+    num_keys = algorithm::sort(keys.begin(), keys.end(), progress);
+    progress.report();
   }
-  const std::size_t num_keys = algorithm::sort(keys.begin(), keys.end());
-  reserve_cache(config, trie_id, num_keys);
+
+  BuildMonitor::Phase phase(monitor, "louds", trie_id);
+  BuildMonitor::Progress progress(monitor, "louds", trie_id, keys.size());
+  reserve_cache(config.cache_level(), trie_id, num_keys);
 
   louds_.push_back(true);
   louds_.push_back(false);
@@ -335,8 +569,14 @@ void LoudsTrie::build_current_trie(Vector<T> &keys, Vector<uint32_t> &terminals,
   Vector<WeightedRange> w_ranges;
 
   queue.push(make_range(0, keys.size(), 0));
+  std::size_t level_end = 1;
   while (!queue.empty()) {
     const std::size_t node_id = link_flags_.size() - queue.size();
+    if (node_id == level_end) {
+      // All the nodes of the next level are in the queue.
+      progress.report();
+      level_end = link_flags_.size();
+    }
 
     Range range = queue.front();
     queue.pop();
@@ -345,6 +585,7 @@ void LoudsTrie::build_current_trie(Vector<T> &keys, Vector<uint32_t> &terminals,
            (keys[range.begin()].length() == range.key_pos())) {
       keys[range.begin()].set_terminal(node_id);
       range.set_begin(range.begin() + 1);
+      progress(1);
     }
 
     if (range.begin() == range.end()) {
@@ -409,10 +650,11 @@ void LoudsTrie::build_current_trie(Vector<T> &keys, Vector<uint32_t> &terminals,
       }
       w_range.set_key_pos(key_pos);
       queue.push(w_range.range());
-      louds_.push_back(true);
     }
+    louds_.push_back_run(true, w_ranges.size());
     louds_.push_back(false);
   }
+  progress.report();
 
   louds_.push_back(false);
   louds_.build(trie_id == 1, true);
@@ -424,14 +666,16 @@ void LoudsTrie::build_current_trie(Vector<T> &keys, Vector<uint32_t> &terminals,
 
 template <>
 void LoudsTrie::build_next_trie(Vector<Key> &keys, Vector<uint32_t> &terminals,
-                                const Config &config, std::size_t trie_id) {
+                                const Config &config, std::size_t trie_id,
+                                BuildMonitor &monitor) {
   if (trie_id == config.num_tries()) {
+    BuildMonitor::Phase phase(monitor, "tail", trie_id);
     Vector<Entry> entries;
     entries.resize(keys.size());
     for (std::size_t i = 0; i < keys.size(); ++i) {
       entries[i].set_str(keys[i].ptr(), keys[i].length());
     }
-    tail_.build(entries, terminals, config.tail_mode());
+    tail_.build(entries, terminals, config.tail_mode(), monitor, trie_id);
     return;
   }
   Vector<ReverseKey> reverse_keys;
@@ -442,24 +686,27 @@ void LoudsTrie::build_next_trie(Vector<Key> &keys, Vector<uint32_t> &terminals,
   }
   keys.clear();
   next_trie_.reset(new LoudsTrie);
-  next_trie_->build_trie(reverse_keys, terminals, config, trie_id + 1);
+  next_trie_->build_trie(reverse_keys, terminals, config, trie_id + 1,
+                         monitor);
 }
 
 template <>
 void LoudsTrie::build_next_trie(Vector<ReverseKey> &keys,
                                 Vector<uint32_t> &terminals,
-                                const Config &config, std::size_t trie_id) {
+                                const Config &config, std::size_t trie_id,
+                                BuildMonitor &monitor) {
   if (trie_id == config.num_tries()) {
+    BuildMonitor::Phase phase(monitor, "tail", trie_id);
     Vector<Entry> entries;
     entries.resize(keys.size());
     for (std::size_t i = 0; i < keys.size(); ++i) {
       entries[i].set_str(keys[i].ptr(), keys[i].length());
     }
-    tail_.build(entries, terminals, config.tail_mode());
+    tail_.build(entries, terminals, config.tail_mode(), monitor, trie_id);
     return;
   }
   next_trie_.reset(new LoudsTrie);
-  next_trie_->build_trie(keys, terminals, config, trie_id + 1);
+  next_trie_->build_trie(keys, terminals, config, trie_id + 1, monitor);
 }
 
 template <typename T>
@@ -486,12 +733,19 @@ void LoudsTrie::cache<Key>(std::size_t parent, std::size_t child, float weight,
   }
 }
 
-void LoudsTrie::reserve_cache(const Config &config, std::size_t trie_id,
-                              std::size_t num_keys) {
+std::size_t LoudsTrie::get_cache_size(CacheLevel cache_level,
+                                      std::size_t trie_id,
+                                      std::size_t num_keys) {
   std::size_t cache_size = (trie_id == 1) ? 256 : 1;
-  while (cache_size < (num_keys / config.cache_level())) {
+  while (cache_size < (num_keys / cache_level)) {
     cache_size *= 2;
   }
+  return cache_size;
+}
+
+void LoudsTrie::reserve_cache(CacheLevel cache_level, std::size_t trie_id,
+                              std::size_t num_keys) {
+  const std::size_t cache_size = get_cache_size(cache_level, trie_id, num_keys);
   cache_.resize(cache_size);
   cache_mask_ = cache_size - 1;
 }
@@ -510,10 +764,12 @@ void LoudsTrie::cache<ReverseKey>(std::size_t parent, std::size_t child,
 }
 
 void LoudsTrie::fill_cache() {
+  // `bases_` is read-only if the cache is rebuilt for a mapped trie.
+  const Vector<uint8_t> &bases = bases_;
   for (std::size_t i = 0; i < cache_.size(); ++i) {
     const std::size_t node_id = cache_[i].child();
     if (node_id != 0) {
-      cache_[i].set_base(bases_[node_id]);
+      cache_[i].set_base(bases[node_id]);
       cache_[i].set_extra(!link_flags_[node_id]
                               ? MARISA_INVALID_EXTRA
                               : extras_[link_flags_.rank1(node_id)]);
@@ -524,6 +780,74 @@ void LoudsTrie::fill_cache() {
   }
 }
 
+// `weights` gives the weights of the keys ending at each node, and then the
+// sums over subtrees are used as the weights of nodes.
+//
+// All the memory of this trie is allocated before the next tries are
+// rebuilt, and nothing after that throws. So if an allocation fails, no trie
+// is modified, and otherwise all the tries get caches of `cache_level`.
+void LoudsTrie::rebuild_cache_(CacheLevel cache_level, std::size_t trie_id,
+                               std::size_t num_keys, Vector<float> &weights) {
+  // Nodes are numbered in BFS order, so the parents are given by a scan of
+  // LOUDS, and the weights of subtrees by a reverse scan.
+  const std::size_t num_nodes = bases_.size();
+  Vector<uint32_t> parents;
+  parents.resize(num_nodes);
+  {
+    std::size_t parent = 0;
+    std::size_t child = 1;
+    for (std::size_t i = 2; child < num_nodes; ++i) {
+      if (louds_[i]) {
+        parents[child++] = static_cast<uint32_t>(parent);
+      } else {
+        ++parent;
+      }
+    }
+  }
+  for (std::size_t i = num_nodes - 1; i > 0; --i) {
+    weights[parents[i]] += weights[i];
+  }
+
+  Vector<Cache> temp_cache;
+  temp_cache.resize(get_cache_size(cache_level, trie_id, num_keys));
+
+  // The keys of the next trie are the labels of links.
+  if (next_trie_ != nullptr) {
+    Vector<float> next_weights;
+    next_weights.resize(next_trie_->bases_.size(), 0.0F);
+    std::size_t link_id = 0;
+    for (std::size_t i = 1; i < num_nodes; ++i) {
+      if (link_flags_[i]) {
+        next_weights[get_link(i, link_id++)] += weights[i];
+      }
+    }
+    next_trie_->rebuild_cache_(cache_level, trie_id + 1, link_id,
+                               next_weights);
+  }
+
+  cache_.swap(temp_cache);
+  cache_mask_ = cache_.size() - 1;
+  config_.parse((config_.flags() & ~MARISA_CACHE_LEVEL_MASK) | cache_level);
+
+  for (std::size_t i = 1; i < num_nodes; ++i) {
+    if (trie_id == 1) {
+      cache<Key>(parents[i], i, weights[i], get_label(i));
+    } else {
+      cache<ReverseKey>(parents[i], i, weights[i], '\0');
+    }
+  }
+  fill_cache();
+}
+
+// get_label() returns the first byte of the label of the edge to `node_id`.
+char LoudsTrie::get_label(std::size_t node_id) const {
+  if (!link_flags_[node_id]) {
+    return static_cast<char>(bases_[node_id]);
+  }
+  const std::size_t link = get_link(node_id);
+  return (next_trie_ != nullptr) ? next_trie_->get_label(link) : tail_[link];
+}
+
 void LoudsTrie::map_(Mapper &mapper) {
   louds_.map(mapper);
   terminal_flags_.map(mapper);
@@ -589,6 +913,86 @@ void LoudsTrie::write_(Writer &writer) const {
   writer.write(static_cast<uint32_t>(config_.flags()));
 }
 
+// The hot-first layout moves the sections used by every search of the first
+// trie to the front and pads them to a page boundary. TAIL and the next tries
+// follow in the standard layout.
+void LoudsTrie::map_hot_first_(Mapper &mapper) {
+  cache_.map(mapper);
+  cache_mask_ = cache_.size() - 1;
+  louds_.map(mapper);
+  terminal_flags_.map(mapper);
+  link_flags_.map(mapper);
+  bases_.map(mapper);
+  extras_.map(mapper);
+  {
+    uint32_t temp_num_l1_nodes;
+    mapper.map(&temp_num_l1_nodes);
+    num_l1_nodes_ = temp_num_l1_nodes;
+  }
+  {
+    uint32_t temp_config_flags;
+    mapper.map(&temp_config_flags);
+    config_.parse(static_cast<int>(temp_config_flags));
+  }
+  mapper.seek(hot_padding());
+  tail_.map(mapper);
+  if ((link_flags_.num_1s() != 0) && tail_.empty()) {
+    next_trie_.reset(new LoudsTrie);
+    next_trie_->map_(mapper);
+  }
+}
+
+void LoudsTrie::read_hot_first_(Reader &reader) {
+  cache_.read(reader);
+  cache_mask_ = cache_.size() - 1;
+  louds_.read(reader);
+  terminal_flags_.read(reader);
+  link_flags_.read(reader);
+  bases_.read(reader);
+  extras_.read(reader);
+  {
+    uint32_t temp_num_l1_nodes;
+    reader.read(&temp_num_l1_nodes);
+    num_l1_nodes_ = temp_num_l1_nodes;
+  }
+  {
+    uint32_t temp_config_flags;
+    reader.read(&temp_config_flags);
+    config_.parse(static_cast<int>(temp_config_flags));
+  }
+  reader.seek(hot_padding());
+  tail_.read(reader);
+  if ((link_flags_.num_1s() != 0) && tail_.empty()) {
+    next_trie_.reset(new LoudsTrie);
+    next_trie_->read_(reader);
+  }
+}
+
+void LoudsTrie::write_hot_first_(Writer &writer) const {
+  cache_.write(writer);
+  louds_.write(writer);
+  terminal_flags_.write(writer);
+  link_flags_.write(writer);
+  bases_.write(writer);
+  extras_.write(writer);
+  writer.write(static_cast<uint32_t>(num_l1_nodes_));
+  writer.write(static_cast<uint32_t>(config_.flags()));
+  writer.seek(hot_padding());
+  tail_.write(writer);
+  if (next_trie_ != nullptr) {
+    next_trie_->write_(writer);
+  }
+}
+
+std::size_t LoudsTrie::hot_padding() const {
+  const std::size_t PAGE_SIZE = 4096;
+  const std::size_t hot_size =
+      Header().io_size() + cache_.io_size() + louds_.io_size() +
+      terminal_flags_.io_size() + link_flags_.io_size() + bases_.io_size() +
+      extras_.io_size() + (sizeof(uint32_t) * 2);
+  return (PAGE_SIZE - (hot_size % PAGE_SIZE)) % PAGE_SIZE;
+}
+
 bool LoudsTrie::find_child(Agent &agent) const {
   assert(agent.state().query_pos() < agent.query().length());
 
@@ -634,6 +1038,32 @@ bool LoudsTrie::find_child(Agent &agent) const {
   return false;
 }
 
+bool LoudsTrie::predictive_search_extend(Agent &agent) const {
+  State &state = agent.state();
+  if (state.history().empty()) {
+    return false;
+  }
+
+  // history()[0] is the node where the previous query ended, and key_buf()
+  // keeps its key, which may go beyond the query in the middle of a link.
+  const History &root = state.history()[0];
+  state.set_node_id(root.node_id());
+  state.key_buf().resize(root.key_pos());
+  state.history().resize(0);
+  state.set_history_pos(0);
+  state.set_status_code(MARISA_READY_TO_PREDICTIVE_SEARCH);
+
+  const std::size_t end =
+      std::min(state.key_buf().size(), agent.query().length());
+  for (std::size_t i = state.query_pos(); i < end; ++i) {
+    if (state.key_buf()[i] != agent.query()[i]) {
+      return false;
+    }
+  }
+  state.set_query_pos(end);
+  return true;
+}
+
 bool LoudsTrie::predictive_find_child(Agent &agent) const {
   assert(agent.state().query_pos() < agent.query().length());
 
@@ -736,6 +1166,16 @@ void LoudsTrie::restore_(Agent &agent, std::size_t node_id) const {
   }
 }
 
+void LoudsTrie::restore_edge(Agent &agent, std::size_t node_id,
+                             std::size_t *link_id) const {
+  if (link_flags_[node_id]) {
+    *link_id = update_link_id(*link_id, node_id);
+    restore(agent, get_link(node_id, *link_id));
+  } else {
+    agent.state().key_buf().push_back(static_cast<char>(bases_[node_id]));
+  }
+}
+
 bool LoudsTrie::match_(Agent &agent, std::size_t node_id) const {
   assert(agent.state().query_pos() < agent.query().length());
   assert(node_id != 0);
@@ -2,10 +2,14 @@
 #define MARISA_GRIMOIRE_TRIE_LOUDS_TRIE_H_
 
 #include <memory>
+#include <string_view>
+#include <vector>
 
 #include "marisa/agent.h"
+#include "marisa/grimoire/trie/build-monitor.h"
 #include "marisa/grimoire/trie/cache.h"
 #include "marisa/grimoire/trie/config.h"
+#include "marisa/grimoire/trie/header.h"
 #include "marisa/grimoire/trie/key.h"
 #include "marisa/grimoire/trie/tail.h"
 #include "marisa/grimoire/vector.h"
@@ -14,9 +18,17 @@
 namespace marisa::grimoire::trie {
 
 class LoudsTrie {
+  friend class DiffWalker;
+
  public:
   LoudsTrie();
   LoudsTrie(Keyset &keyset, int flags);
+  LoudsTrie(Keyset &keyset, int flags, BuildMonitor &monitor);
+  // This constructor builds a trie from `num_keys` keys without a Keyset.
+  // `weights` and `ids` may be nullptr. Otherwise, `ids` receives the IDs.
+  LoudsTrie(const std::string_view *keys, std::size_t num_keys,
+            const float *weights, uint32_t *ids, int flags,
+            BuildMonitor &monitor);
   ~LoudsTrie();
 
   LoudsTrie(const LoudsTrie &) = delete;
@@ -24,13 +36,47 @@ class LoudsTrie {
 
   void map(Mapper &mapper);
   void read(Reader &reader);
-  void write(Writer &writer) const;
+  // These overloads take the header read by the caller.
+  void map(Mapper &mapper, const Header &header);
+  void read(Reader &reader, const Header &header);
+  // `flags` is a combination of marisa_save_flags.
+  void write(Writer &writer, int flags = 0) const;
 
   bool lookup(Agent &agent) const;
   void reverse_lookup(Agent &agent) const;
   bool common_prefix_search(Agent &agent) const;
   bool predictive_search(Agent &agent) const;
 
+  // lookup_init() and lookup_step() run lookup() one edge at a time. When
+  // lookup_step() returns false, the lookup has finished with `*found`.
+  // prefetch_step() returns false if the next step would read a page that is
+  // not in memory, after asking `residency` for it.
+  void lookup_init(Agent &agent) const;
+  bool lookup_step(Agent &agent, bool *found) const;
+  bool prefetch_step(const Agent &agent, const Residency &residency) const;
+
+  const Mapper &mapper() const {
+    return mapper_;
+  }
+
+  // Section is a memory block of a trie of the recursion. Hot sections are
+  // read by most lookups, while TAIL is read only at the ends of keys.
+  struct Section {
+    const char *name;
+    std::size_t trie_id;
+    bool hot;
+    const void *ptr;
+    std::size_t size;
+  };
+  // get_sections() appends the non-empty blocks of this and the next tries.
+  void get_sections(std::vector<Section> *sections,
+                    std::size_t trie_id = 1) const;
+
+  // is_built() returns false for a trie that is neither built nor loaded.
+  bool is_built() const {
+    return !louds_.empty();
+  }
+
   std::size_t num_tries() const {
     return config_.num_tries();
   }
@@ -60,6 +106,13 @@ class LoudsTrie {
   std::size_t total_size() const;
   std::size_t io_size() const;
 
+  // rebuild_cache() replaces the caches of all the tries with heap-allocated
+  // ones of `cache_level`, and clear_cache() with empty ones. The weights of
+  // keys are not stored, so the number of keys in a subtree is used instead.
+  // If either throws, no cache is replaced.
+  void rebuild_cache(CacheLevel cache_level);
+  void clear_cache();
+
   void clear() noexcept;
   void swap(LoudsTrie &rhs) noexcept;
 
@@ -77,32 +130,61 @@ class LoudsTrie {
   std::size_t num_l1_nodes_ = 0;
   Config config_;
 
-  void build_(Keyset &keyset, const Config &config);
+  void build_(Keyset &keyset, const Config &config, BuildMonitor &monitor);
+  void build_(const std::string_view *keys, std::size_t num_keys,
+              const float *weights, uint32_t *ids, const Config &config,
+              BuildMonitor &monitor);
+  // build_keys_() builds tries from `keys` and calls set_id(i, id) for each
+  // key, where `i` is the index of the key in `keys`.
+  template <typename SetId>
+  void build_keys_(Vector<Key> &keys, const Config &config,
+                   BuildMonitor &monitor, const SetId &set_id);
 
   template <typename T>
   void build_trie(Vector<T> &keys, Vector<uint32_t> &terminals,
-                  const Config &config, std::size_t trie_id);
+                  const Config &config, std::size_t trie_id,
+                  BuildMonitor &monitor);
   template <typename T>
   void build_current_trie(Vector<T> &keys, Vector<uint32_t> &terminals,
-                          const Config &config, std::size_t trie_id);
+                          const Config &config, std::size_t trie_id,
+                          BuildMonitor &monitor);
   template <typename T>
   void build_next_trie(Vector<T> &keys, Vector<uint32_t> &terminals,
-                       const Config &config, std::size_t trie_id);
+                       const Config &config, std::size_t trie_id,
+                       BuildMonitor &monitor);
   template <typename T>
   void build_terminals(const Vector<T> &keys,
                        Vector<uint32_t> &terminals) const;
 
-  void reserve_cache(const Config &config, std::size_t trie_id,
+  static std::size_t get_cache_size(CacheLevel cache_level,
+                                    std::size_t trie_id, std::size_t num_keys);
+  void reserve_cache(CacheLevel cache_level, std::size_t trie_id,
                      std::size_t num_keys);
   template <typename T>
   void cache(std::size_t parent, std::size_t child, float weight, char label);
   void fill_cache();
 
+  void rebuild_cache_(CacheLevel cache_level, std::size_t trie_id,
+                      std::size_t num_keys, Vector<float> &weights);
+  char get_label(std::size_t node_id) const;
+
   void map_(Mapper &mapper);
   void read_(Reader &reader);
   void write_(Writer &writer) const;
 
+  void map_hot_first_(Mapper &mapper);
+  void read_hot_first_(Reader &reader);
+  void write_hot_first_(Writer &writer) const;
+  std::size_t hot_padding() const;
+
+  bool prefetch_link(std::size_t link, const Residency &residency) const;
+
   inline bool find_child(Agent &agent) const;
+  // predictive_search_extend() restores the node where the previous
+  // predictive search ended its descent, and matches the longer query with
+  // the rest of the key of the node. It returns false if the previous search
+  // found no node or the query leaves the key.
+  bool predictive_search_extend(Agent &agent) const;
   inline bool predictive_find_child(Agent &agent) const;
 
   inline void restore(Agent &agent, std::size_t node_id) const;
@@ -110,6 +192,11 @@ class LoudsTrie {
   inline bool prefix_match(Agent &agent, std::size_t node_id) const;
 
   void restore_(Agent &agent, std::size_t node_id) const;
+  // restore_edge() appends the labels of the edge to `node_id` to the key
+  // buffer. Siblings must be visited in order with `*link_id` starting at
+  // MARISA_INVALID_LINK_ID.
+  void restore_edge(Agent &agent, std::size_t node_id,
+                    std::size_t *link_id) const;
   bool match_(Agent &agent, std::size_t node_id) const;
   bool prefix_match_(Agent &agent, std::size_t node_id) const;
 
@@ -0,0 +1,110 @@
+#ifndef MARISA_GRIMOIRE_TRIE_SEQLOCK_TABLE_H_
+#define MARISA_GRIMOIRE_TRIE_SEQLOCK_TABLE_H_
+
+#include <atomic>
+#include <cassert>
+#include <memory>
+
+#include "marisa/base.h"
+
+namespace marisa::grimoire::trie {
+
+// SeqlockTable is a direct-mapped table of slots, each of which holds
+// NUM_WORDS words guarded by a sequence number. Readers never write to shared
+// memory, so hot slots are not bounced between cores, and writers skip a slot
+// that is being written instead of waiting. A slot whose first word is 0 is
+// empty.
+template <std::size_t NUM_WORDS>
+class SeqlockTable {
+ public:
+  SeqlockTable() = default;
+
+  SeqlockTable(const SeqlockTable &) = delete;
+  SeqlockTable &operator=(const SeqlockTable &) = delete;
+
+  // reset() allocates the largest power of 2 of slots within `max_bytes`.
+  void reset(std::size_t max_bytes) {
+    std::size_t num_slots = 0;
+    if (max_bytes >= sizeof(Slot)) {
+      num_slots = 1;
+      while ((num_slots * 2) <= (max_bytes / sizeof(Slot))) {
+        num_slots *= 2;
+      }
+    }
+    std::unique_ptr<Slot[]> temp_slots;
+    if (num_slots != 0) {
+      temp_slots.reset(new Slot[num_slots]);
+    }
+    slots_.swap(temp_slots);
+    mask_ = (num_slots != 0) ? (num_slots - 1) : 0;
+  }
+
+  // load() copies the words of the slot for `hash` and returns false if the
+  // slot is empty or is modified during the copy.
+  bool load(uint64_t hash, uint64_t *words) const {
+    if (slots_ == nullptr) {
+      return false;
+    }
+    const Slot &slot = slots_[hash & mask_];
+    const uint64_t seq = slot.seq.load(std::memory_order_acquire);
+    if ((seq & 1) != 0) {
+      return false;
+    }
+    for (std::size_t i = 0; i < NUM_WORDS; ++i) {
+      words[i] = slot.words[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return (slot.seq.load(std::memory_order_relaxed) == seq) &&
+           (words[0] != 0);
+  }
+
+  // store() overwrites the slot for `hash` unless another thread is writing
+  // to it.
+  void store(uint64_t hash, const uint64_t *words) {
+    if (slots_ == nullptr) {
+      return;
+    }
+    Slot &slot = slots_[hash & mask_];
+    uint64_t seq = slot.seq.load(std::memory_order_relaxed);
+    if (((seq & 1) != 0) ||
+        !slot.seq.compare_exchange_strong(seq, seq + 1,
+                                          std::memory_order_relaxed)) {
+      return;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    for (std::size_t i = 0; i < NUM_WORDS; ++i) {
+      slot.words[i].store(words[i], std::memory_order_relaxed);
+    }
+    slot.seq.store(seq + 2, std::memory_order_release);
+  }
+
+  // erase() empties all the slots. It may be called concurrently with load()
+  // and store(), but then it is best effort: it skips a slot that is being
+  // written like store() does, so that slot keeps the new words.
+  void erase() {
+    const uint64_t empty[NUM_WORDS] = {};
+    for (std::size_t i = 0; i < num_slots(); ++i) {
+      store(i, empty);
+    }
+  }
+
+  std::size_t num_slots() const {
+    return (slots_ != nullptr) ? (mask_ + 1) : 0;
+  }
+  std::size_t total_size() const {
+    return sizeof(Slot) * num_slots();
+  }
+
+ private:
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> seq{0};
+    std::atomic<uint64_t> words[NUM_WORDS] = {};
+  };
+
+  std::unique_ptr<Slot[]> slots_;
+  std::size_t mask_ = 0;
+};
+
+}  // namespace marisa::grimoire::trie
+
+#endif  // MARISA_GRIMOIRE_TRIE_SEQLOCK_TABLE_H_
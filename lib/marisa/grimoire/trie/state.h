@@ -14,6 +14,9 @@ enum StatusCode {
   MARISA_READY_TO_ALL,
   MARISA_READY_TO_COMMON_PREFIX_SEARCH,
   MARISA_READY_TO_PREDICTIVE_SEARCH,
+  // Agent::extend_query() keeps the state of a predictive search so that the
+  // next search continues from where the previous one stopped descending.
+  MARISA_READY_TO_EXTEND_PREDICTIVE_SEARCH,
   MARISA_END_OF_COMMON_PREFIX_SEARCH,
   MARISA_END_OF_PREDICTIVE_SEARCH,
 };
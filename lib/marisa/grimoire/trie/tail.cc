@@ -8,11 +8,15 @@
 
 namespace marisa::grimoire::trie {
 
-Tail::Tail(Vector<Entry> &entries, Vector<uint32_t> &offsets, TailMode mode) {
+Tail::Tail(Vector<Entry> &entries, Vector<uint32_t> &offsets, TailMode mode,
+           BuildMonitor &monitor, std::size_t trie_id) {
+  // Sorting and merging are reported as two halves of the phase.
+  BuildMonitor::Progress progress(monitor, "tail", trie_id,
+                                  entries.size() * 2);
   for (std::size_t i = 0; i < entries.size(); ++i) {
     entries[i].set_id(i);
   }
-  algorithm::sort(entries.begin(), entries.end());
+  algorithm::sort(entries.begin(), entries.end(), progress);
 
   Vector<uint32_t> temp_offsets;
   temp_offsets.resize(entries.size(), 0);
@@ -38,15 +42,15 @@ Tail::Tail(Vector<Entry> &entries, Vector<uint32_t> &offsets, TailMode mode) {
       if (mode == MARISA_TEXT_TAIL) {
         buf_.push_back('\0');
       } else {
-        for (std::size_t j = 1; j < current.length(); ++j) {
-          end_flags_.push_back(false);
-        }
+        end_flags_.push_back_run(false, current.length() - 1);
         end_flags_.push_back(true);
       }
       MARISA_THROW_IF(buf_.size() > UINT32_MAX, std::length_error);
     }
     last = &current;
+    progress(1);
   }
+  progress.report();
   buf_.shrink();
 
   offsets = std::move(temp_offsets);
@@ -64,6 +68,12 @@ Tail::Tail(Reader &reader) {
 
 void Tail::build(Vector<Entry> &entries, Vector<uint32_t> &offsets,
                  TailMode mode) {
+  BuildMonitor monitor;
+  build(entries, offsets, mode, monitor, 0);
+}
+
+void Tail::build(Vector<Entry> &entries, Vector<uint32_t> &offsets,
+                 TailMode mode, BuildMonitor &monitor, std::size_t trie_id) {
 
   switch (mode) {
     case MARISA_TEXT_TAIL: {
@@ -90,7 +100,7 @@ void Tail::build(Vector<Entry> &entries, Vector<uint32_t> &offsets,
     }
   }
 
-  Tail temp(entries, offsets, mode);
+  Tail temp(entries, offsets, mode, monitor, trie_id);
   swap(temp);
 }
 
@@ -4,6 +4,7 @@
 #include <cassert>
 
 #include "marisa/agent.h"
+#include "marisa/grimoire/trie/build-monitor.h"
 #include "marisa/grimoire/trie/entry.h"
 #include "marisa/grimoire/vector.h"
 
@@ -12,7 +13,8 @@ namespace marisa::grimoire::trie {
 class Tail {
  public:
   Tail() = default;
-  Tail(Vector<Entry> &entries, Vector<uint32_t> &offsets, TailMode mode);
+  Tail(Vector<Entry> &entries, Vector<uint32_t> &offsets, TailMode mode,
+       BuildMonitor &monitor, std::size_t trie_id);
   Tail(Mapper &mapper);
   Tail(Reader &reader);
 
@@ -20,6 +22,8 @@ class Tail {
   Tail &operator=(const Tail &) = delete;
 
   void build(Vector<Entry> &entries, Vector<uint32_t> &offsets, TailMode mode);
+  void build(Vector<Entry> &entries, Vector<uint32_t> &offsets, TailMode mode,
+             BuildMonitor &monitor, std::size_t trie_id);
 
   void map(Mapper &mapper);
   void read(Reader &reader);
@@ -51,6 +55,13 @@ class Tail {
     return buf_.io_size() + end_flags_.io_size();
   }
 
+  // for_each_block() calls f(ptr, size) for each memory block of TAIL.
+  template <typename F>
+  void for_each_block(F f) const {
+    f(buf_.begin(), buf_.total_size());
+    end_flags_.for_each_block(f);
+  }
+
   void clear() noexcept;
   void swap(Tail &rhs) noexcept;
 
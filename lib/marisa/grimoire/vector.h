@@ -2,12 +2,14 @@
 #define MARISA_GRIMOIRE_VECTOR_H_
 
 #include "marisa/grimoire/vector/bit-vector.h"
+#include "marisa/grimoire/vector/bp-vector.h"
 #include "marisa/grimoire/vector/flat-vector.h"
 #include "marisa/grimoire/vector/vector.h"
 
 namespace marisa::grimoire {
 
 using vector::BitVector;
+using vector::BpVector;
 using vector::FlatVector;
 using vector::Vector;
 
@@ -5,12 +5,19 @@
  #include <bit>
 #endif
 #include <cassert>
+#include <vector>
 
+#include "marisa/grimoire/algorithm/parallel.h"
 #include "marisa/grimoire/vector/pop-count.h"
 
 namespace marisa::grimoire::vector {
 namespace {
 
+// build_index() gives each thread at least this number of 512-bit blocks
+// unless the number of threads is specified, so that short vectors are
+// indexed without starting threads.
+constexpr std::size_t MIN_NUM_BLOCKS_PER_TASK = std::size_t{1} << 14;
+
 #if defined(__cpp_lib_bitops) && __cpp_lib_bitops >= 201907L
 
 inline std::size_t countr_zero(uint64_t x) {
@@ -800,16 +807,170 @@ std::size_t BitVector::select1(std::size_t i) const {
 
 #endif  // MARISA_WORD_SIZE == 64
 
+void BitVector::push_back_bits(uint64_t bits, std::size_t num_bits) {
+  MARISA_THROW_IF(num_bits > 64, std::invalid_argument);
+  MARISA_THROW_IF(num_bits > (UINT32_MAX - size_), std::length_error);
+  if (num_bits == 0) {
+    return;
+  }
+  if (num_bits < 64) {
+    bits &= (uint64_t{1} << num_bits) - 1;
+  }
+  resize_units(size_ + num_bits);
+  num_1s_ += popcount(bits);
+
+  std::size_t unit_id = size_ / MARISA_WORD_SIZE;
+  std::size_t offset = size_ % MARISA_WORD_SIZE;
+  std::size_t num_remaining_bits = num_bits;
+  while (num_remaining_bits != 0) {
+    units_[unit_id] |= static_cast<Unit>(bits << offset);
+    const std::size_t count =
+        std::min(num_remaining_bits, MARISA_WORD_SIZE - offset);
+    bits = (count < 64) ? (bits >> count) : 0;
+    num_remaining_bits -= count;
+    offset = 0;
+    ++unit_id;
+  }
+  size_ += num_bits;
+}
+
+void BitVector::push_back_run(bool bit, std::size_t count) {
+  MARISA_THROW_IF(count > (UINT32_MAX - size_), std::length_error);
+  resize_units(size_ + count);
+  if (bit) {
+    const std::size_t end = size_ + count;
+    for (std::size_t i = size_; i < end;) {
+      const std::size_t offset = i % MARISA_WORD_SIZE;
+      const std::size_t num_bits =
+          std::min(end - i, std::size_t{MARISA_WORD_SIZE} - offset);
+      const Unit mask = (num_bits == MARISA_WORD_SIZE)
+                            ? ~Unit{0}
+                            : static_cast<Unit>(((Unit{1} << num_bits) - 1)
+                                                << offset);
+      units_[i / MARISA_WORD_SIZE] |= mask;
+      i += num_bits;
+    }
+    num_1s_ += count;
+  }
+  size_ += count;
+}
+
 void BitVector::build_index(const BitVector &bv, bool enables_select0,
-                            bool enables_select1) {
+                            bool enables_select1, std::size_t num_threads) {
   const std::size_t num_bits = bv.size();
-  ranks_.resize((num_bits / 512) + (((num_bits % 512) != 0) ? 1 : 0) + 1);
+  const std::size_t num_blocks =
+      (num_bits / 512) + (((num_bits % 512) != 0) ? 1 : 0);
+  ranks_.resize(num_blocks + 1);
+
+  // Blocks are split into tasks, each of which is indexed by one thread.
+  std::size_t num_tasks = 1;
+  if (num_threads == 0) {
+    num_tasks = std::min(algorithm::num_hardware_threads(),
+                         num_blocks / MIN_NUM_BLOCKS_PER_TASK);
+  } else {
+    num_tasks = std::min(num_threads, num_blocks);
+  }
+  num_tasks = std::max(num_tasks, std::size_t{1});
+  // Units are allocated in 64 bits, so the last one may be unused if
+  // MARISA_WORD_SIZE is 32.
+  const std::size_t num_units =
+      (num_bits + MARISA_WORD_SIZE - 1) / MARISA_WORD_SIZE;
+  const std::size_t num_units_per_task =
+      ((num_blocks + num_tasks - 1) / num_tasks) * (512 / MARISA_WORD_SIZE);
+  const auto unit_begin = [&](std::size_t task_id) {
+    return std::min(task_id * num_units_per_task, num_units);
+  };
+
+  // The first pass counts 1s in each task and the prefix sums give the
+  // initial counts of the second pass.
+  std::vector<std::size_t> num_1s(num_tasks + 1, 0);
+  if (num_tasks > 1) {
+    algorithm::run_in_parallel(num_tasks, num_tasks, [&](std::size_t task_id) {
+      std::size_t count = 0;
+      for (std::size_t i = unit_begin(task_id); i < unit_begin(task_id + 1);
+           ++i) {
+        count += popcount(bv.units_[i]);
+      }
+      num_1s[task_id + 1] = count;
+    });
+    for (std::size_t i = 0; i < num_tasks; ++i) {
+      num_1s[i + 1] += num_1s[i];
+    }
+  }
 
-  std::size_t num_0s = 0;  // Only updated if enables_select0 is true.
-  std::size_t num_1s = 0;
+  const std::size_t total_num_1s = bv.num_1s();
+  const std::size_t total_num_0s = num_bits - total_num_1s;
+  // The last entry of select0s_ or select1s_ is num_bits.
+  if (enables_select0) {
+    select0s_.resize(((total_num_0s + 511) / 512) + 1);
+  }
+  if (enables_select1) {
+    select1s_.resize(((total_num_1s + 511) / 512) + 1);
+  }
+
+  algorithm::run_in_parallel(num_tasks, num_tasks, [&](std::size_t task_id) {
+    const std::size_t bit_id =
+        std::min(unit_begin(task_id) * MARISA_WORD_SIZE, num_bits);
+    build_index_range(bv, unit_begin(task_id), unit_begin(task_id + 1),
+                      bit_id - num_1s[task_id], num_1s[task_id],
+                      enables_select0, enables_select1);
+  });
 
-  const std::size_t num_units = bv.units_.size();
-  for (std::size_t unit_id = 0; unit_id < num_units; ++unit_id) {
+  if ((num_bits % 512) != 0) {
+    const std::size_t rank_id = (num_bits - 1) / 512;
+    switch (((num_bits - 1) / 64) % 8) {
+      case 0: {
+        ranks_[rank_id].set_rel1(total_num_1s - ranks_[rank_id].abs());
+      }
+        [[fallthrough]];
+      case 1: {
+        ranks_[rank_id].set_rel2(total_num_1s - ranks_[rank_id].abs());
+      }
+        [[fallthrough]];
+      case 2: {
+        ranks_[rank_id].set_rel3(total_num_1s - ranks_[rank_id].abs());
+      }
+        [[fallthrough]];
+      case 3: {
+        ranks_[rank_id].set_rel4(total_num_1s - ranks_[rank_id].abs());
+      }
+        [[fallthrough]];
+      case 4: {
+        ranks_[rank_id].set_rel5(total_num_1s - ranks_[rank_id].abs());
+      }
+        [[fallthrough]];
+      case 5: {
+        ranks_[rank_id].set_rel6(total_num_1s - ranks_[rank_id].abs());
+      }
+        [[fallthrough]];
+      case 6: {
+        ranks_[rank_id].set_rel7(total_num_1s - ranks_[rank_id].abs());
+        break;
+      }
+    }
+  }
+
+  size_ = num_bits;
+  num_1s_ = total_num_1s;
+
+  ranks_.back().set_abs(total_num_1s);
+  if (enables_select0) {
+    select0s_.back() = static_cast<uint32_t>(num_bits);
+  }
+  if (enables_select1) {
+    select1s_.back() = static_cast<uint32_t>(num_bits);
+  }
+}
+
+void BitVector::build_index_range(const BitVector &bv, std::size_t unit_begin,
+                                  std::size_t unit_end, std::size_t num_0s,
+                                  std::size_t num_1s, bool enables_select0,
+                                  bool enables_select1) {
+  const std::size_t num_bits = bv.size();
+  std::size_t select0_id = (num_0s + 511) / 512;
+  std::size_t select1_id = (num_1s + 511) / 512;
+
+  for (std::size_t unit_id = unit_begin; unit_id < unit_end; ++unit_id) {
     const std::size_t bit_id = unit_id * MARISA_WORD_SIZE;
 
     if ((bit_id % 64) == 0) {
@@ -867,10 +1028,10 @@ void BitVector::build_index(const BitVector &bv, bool enables_select0,
       const std::size_t zero_bit_id = (0 - num_0s) % 512;
       if (unit_num_0s > zero_bit_id) {
         // select0s_ is uint32_t, but select_bit returns size_t, so cast to
-        // suppress narrowing conversion warning.  push_back checks the
-        // size, so there is no truncation here.
-        select0s_.push_back(
-            static_cast<uint32_t>(select_bit(zero_bit_id, bit_id, ~unit)));
+        // suppress narrowing conversion warning.  The size of a BitVector
+        // is limited to UINT32_MAX, so there is no truncation here.
+        select0s_[select0_id++] =
+            static_cast<uint32_t>(select_bit(zero_bit_id, bit_id, ~unit));
       }
 
       num_0s += unit_num_0s;
@@ -880,60 +1041,13 @@ void BitVector::build_index(const BitVector &bv, bool enables_select0,
       // Note: MSVC rejects unary minus operator applied to unsigned type.
       const std::size_t one_bit_id = (0 - num_1s) % 512;
       if (unit_num_1s > one_bit_id) {
-        select1s_.push_back(
-            static_cast<uint32_t>(select_bit(one_bit_id, bit_id, unit)));
+        select1s_[select1_id++] =
+            static_cast<uint32_t>(select_bit(one_bit_id, bit_id, unit));
       }
     }
 
     num_1s += unit_num_1s;
   }
-
-  if ((num_bits % 512) != 0) {
-    const std::size_t rank_id = (num_bits - 1) / 512;
-    switch (((num_bits - 1) / 64) % 8) {
-      case 0: {
-        ranks_[rank_id].set_rel1(num_1s - ranks_[rank_id].abs());
-      }
-        [[fallthrough]];
-      case 1: {
-        ranks_[rank_id].set_rel2(num_1s - ranks_[rank_id].abs());
-      }
-        [[fallthrough]];
-      case 2: {
-        ranks_[rank_id].set_rel3(num_1s - ranks_[rank_id].abs());
-      }
-        [[fallthrough]];
-      case 3: {
-        ranks_[rank_id].set_rel4(num_1s - ranks_[rank_id].abs());
-      }
-        [[fallthrough]];
-      case 4: {
-        ranks_[rank_id].set_rel5(num_1s - ranks_[rank_id].abs());
-      }
-        [[fallthrough]];
-      case 5: {
-        ranks_[rank_id].set_rel6(num_1s - ranks_[rank_id].abs());
-      }
-        [[fallthrough]];
-      case 6: {
-        ranks_[rank_id].set_rel7(num_1s - ranks_[rank_id].abs());
-        break;
-      }
-    }
-  }
-
-  size_ = num_bits;
-  num_1s_ = bv.num_1s();
-
-  ranks_.back().set_abs(num_1s);
-  if (enables_select0) {
-    select0s_.push_back(static_cast<uint32_t>(num_bits));
-    select0s_.shrink();
-  }
-  if (enables_select1) {
-    select1s_.push_back(static_cast<uint32_t>(num_bits));
-    select1s_.shrink();
-  }
 }
 
 }  // namespace marisa::grimoire::vector
@@ -58,9 +58,13 @@ class BitVector {
   BitVector(const BitVector &) = delete;
   BitVector &operator=(const BitVector &) = delete;
 
-  void build(bool enables_select0, bool enables_select1) {
+  // build() builds the rank/select index with up to `num_threads` threads.
+  // `num_threads` == 0 means that short vectors are indexed by the calling
+  // thread and longer ones by all the hardware threads.
+  void build(bool enables_select0, bool enables_select1,
+             std::size_t num_threads = 0) {
     BitVector temp;
-    temp.build_index(*this, enables_select0, enables_select1);
+    temp.build_index(*this, enables_select0, enables_select1, num_threads);
     units_.shrink();
     temp.units_.swap(units_);
     swap(temp);
@@ -96,6 +100,11 @@ class BitVector {
     }
     ++size_;
   }
+  // push_back_bits() appends the lower `num_bits` bits of `bits`, from the
+  // least significant bit. `num_bits` must not exceed 64.
+  void push_back_bits(uint64_t bits, std::size_t num_bits);
+  // push_back_run() appends `count` copies of `bit`.
+  void push_back_run(bool bit, std::size_t count);
 
   bool operator[](std::size_t i) const {
     assert(i < size_);
@@ -103,6 +112,11 @@ class BitVector {
             (Unit{1} << (i % MARISA_WORD_SIZE))) != 0;
   }
 
+  // unit() returns the `i`-th unit of bits. Bits beyond size() are 0.
+  Unit unit(std::size_t i) const {
+    return units_[i];
+  }
+
   std::size_t rank0(std::size_t i) const {
     assert(!ranks_.empty());
     assert(i <= size_);
@@ -113,6 +127,22 @@ class BitVector {
   std::size_t select0(std::size_t i) const;
   std::size_t select1(std::size_t i) const;
 
+  // The following return what operator[](i), rank1(i) and select0(i) read
+  // first, so that residency of a mapped vector can be checked before a
+  // query touches it. select0_hint(i) is a lower bound of select0(i).
+  const void *unit_ptr(std::size_t i) const {
+    return &units_[i / MARISA_WORD_SIZE];
+  }
+  const void *rank_ptr(std::size_t i) const {
+    return &ranks_[i / 512];
+  }
+  const void *select0_ptr(std::size_t i) const {
+    return &select0s_[i / 512];
+  }
+  std::size_t select0_hint(std::size_t i) const {
+    return select0s_[i / 512];
+  }
+
   std::size_t num_0s() const {
     return size_ - num_1s_;
   }
@@ -135,6 +165,15 @@ class BitVector {
            select0s_.io_size() + select1s_.io_size();
   }
 
+  // for_each_block() calls f(ptr, size) for each memory block of the vector.
+  template <typename F>
+  void for_each_block(F f) const {
+    f(units_.begin(), units_.total_size());
+    f(ranks_.begin(), ranks_.total_size());
+    f(select0s_.begin(), select0s_.total_size());
+    f(select1s_.begin(), select1s_.total_size());
+  }
+
   void clear() noexcept {
     BitVector().swap(*this);
   }
@@ -156,7 +195,22 @@ class BitVector {
   Vector<uint32_t> select1s_;
 
   void build_index(const BitVector &bv, bool enables_select0,
-                   bool enables_select1);
+                   bool enables_select1, std::size_t num_threads);
+  // build_index_range() indexes units in [unit_begin, unit_end), which start
+  // at a rank block boundary, given the numbers of 0s and 1s before it.
+  void build_index_range(const BitVector &bv, std::size_t unit_begin,
+                         std::size_t unit_end, std::size_t num_0s,
+                         std::size_t num_1s, bool enables_select0,
+                         bool enables_select1);
+
+  // resize_units() allocates units for `num_bits` bits.
+  void resize_units(std::size_t num_bits) {
+    const std::size_t num_units =
+        ((num_bits + 63) / 64) * (64 / MARISA_WORD_SIZE);
+    if (num_units > units_.size()) {
+      units_.resize(num_units, 0);
+    }
+  }
 
   void write_(Writer &writer) const {
     units_.write(writer);
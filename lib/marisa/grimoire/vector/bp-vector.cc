@@ -0,0 +1,221 @@
+#include "marisa/grimoire/vector/bp-vector.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace marisa::grimoire::vector {
+namespace {
+
+// ByteTables gives, for each byte of parentheses from the least significant
+// bit, the excess of the byte and the minimum excess reached by a forward
+// scan (after each bit) or a backward scan (before each bit).
+struct ByteTables {
+  int8_t excess[256];
+  int8_t fwd_min[256];
+  int8_t bwd_min[256];
+};
+
+constexpr ByteTables make_byte_tables() {
+  ByteTables tables{};
+  for (int byte = 0; byte < 256; ++byte) {
+    int excess = 0;
+    int fwd_min = 8;
+    for (int i = 0; i < 8; ++i) {
+      excess += ((byte >> i) & 1) ? 1 : -1;
+      fwd_min = std::min(fwd_min, excess);
+    }
+    int bwd_excess = 0;
+    int bwd_min = 8;
+    for (int i = 7; i >= 0; --i) {
+      bwd_excess -= ((byte >> i) & 1) ? 1 : -1;
+      bwd_min = std::min(bwd_min, bwd_excess);
+    }
+    tables.excess[byte] = static_cast<int8_t>(excess);
+    tables.fwd_min[byte] = static_cast<int8_t>(fwd_min);
+    tables.bwd_min[byte] = static_cast<int8_t>(bwd_min);
+  }
+  return tables;
+}
+
+constexpr ByteTables BYTE_TABLES = make_byte_tables();
+
+}  // namespace
+
+void BpVector::build() {
+  bits_.build(true, false);
+  MARISA_THROW_IF(bits_.size() > INT32_MAX, std::length_error);
+
+  const std::size_t num_blocks = (size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  std::size_t num_leaves = 1;
+  while (num_leaves < num_blocks) {
+    num_leaves *= 2;
+  }
+
+  Vector<int32_t> mins;
+  mins.resize(num_leaves * 2, INT32_MAX);
+  std::ptrdiff_t excess = 0;
+  for (std::size_t block_id = 0; block_id < num_blocks; ++block_id) {
+    const std::size_t end = std::min((block_id + 1) * BLOCK_SIZE, size());
+    std::ptrdiff_t min_excess = excess;
+    for (std::size_t i = block_id * BLOCK_SIZE; i < end; ++i) {
+      excess += bits_[i] ? 1 : -1;
+      min_excess = std::min(min_excess, excess);
+    }
+    mins[num_leaves + block_id] = static_cast<int32_t>(min_excess);
+  }
+  for (std::size_t i = num_leaves - 1; i > 0; --i) {
+    mins[i] = std::min(mins[2 * i], mins[(2 * i) + 1]);
+  }
+  mins.shrink();
+
+  mins_.swap(mins);
+  num_leaves_ = num_leaves;
+}
+
+void BpVector::map(Mapper &mapper) {
+  BpVector temp;
+  temp.bits_.map(mapper);
+  temp.mins_.map(mapper);
+  temp.num_leaves_ = temp.mins_.size() / 2;
+  swap(temp);
+}
+
+void BpVector::read(Reader &reader) {
+  BpVector temp;
+  temp.bits_.read(reader);
+  temp.mins_.read(reader);
+  temp.num_leaves_ = temp.mins_.size() / 2;
+  swap(temp);
+}
+
+void BpVector::write(Writer &writer) const {
+  bits_.write(writer);
+  mins_.write(writer);
+}
+
+std::size_t BpVector::fwd_search(std::size_t i, std::ptrdiff_t target) const {
+  if (i >= size()) {
+    return size();
+  }
+  return fwd_search(i, excess(i), target);
+}
+
+std::size_t BpVector::fwd_search(std::size_t i, std::ptrdiff_t excess_i,
+                                 std::ptrdiff_t target) const {
+  if (i >= size()) {
+    return size();
+  }
+  std::size_t block_id = i / BLOCK_SIZE;
+  const std::size_t pos = fwd_scan(
+      i, std::min((block_id + 1) * BLOCK_SIZE, size()), excess_i, target);
+  if (pos != size()) {
+    return pos;
+  }
+
+  // The tree is climbed until a right sibling has the target, and then
+  // descended to the leftmost block with the target.
+  std::size_t node = num_leaves_ + block_id;
+  for (;;) {
+    if (node == 1) {
+      return size();
+    }
+    if (((node % 2) == 0) && (mins_[node + 1] <= target)) {
+      ++node;
+      break;
+    }
+    node /= 2;
+  }
+  while (node < num_leaves_) {
+    node *= 2;
+    if (mins_[node] > target) {
+      ++node;
+    }
+  }
+  block_id = node - num_leaves_;
+  const std::size_t begin = block_id * BLOCK_SIZE;
+  return fwd_scan(begin, std::min(begin + BLOCK_SIZE, size()), excess(begin),
+                  target);
+}
+
+std::size_t BpVector::bwd_search(std::size_t i, std::ptrdiff_t target) const {
+  assert(i < size());
+  std::size_t block_id = i / BLOCK_SIZE;
+  const std::size_t pos =
+      bwd_scan(i, block_id * BLOCK_SIZE, excess(i), target);
+  if (pos != size()) {
+    return pos;
+  }
+
+  std::size_t node = num_leaves_ + block_id;
+  for (;;) {
+    if (node == 1) {
+      return size();
+    }
+    if (((node % 2) == 1) && (mins_[node - 1] <= target)) {
+      --node;
+      break;
+    }
+    node /= 2;
+  }
+  while (node < num_leaves_) {
+    node = (node * 2) + 1;
+    if (mins_[node] > target) {
+      --node;
+    }
+  }
+  block_id = node - num_leaves_;
+  const std::size_t end = (block_id + 1) * BLOCK_SIZE;
+  return bwd_scan(end, block_id * BLOCK_SIZE, excess(end), target);
+}
+
+std::size_t BpVector::fwd_scan(std::size_t i, std::size_t end,
+                               std::ptrdiff_t excess,
+                               std::ptrdiff_t target) const {
+  // Bits are scanned one by one up to a byte boundary, then bytes are skipped
+  // while they don't reach `target`, and the last byte is scanned bit by bit.
+  for (; (i < end) && ((i % 8) != 0); ++i) {
+    excess += bits_[i] ? 1 : -1;
+    if (excess <= target) {
+      return i;
+    }
+  }
+  for (; (i + 8) <= end; i += 8) {
+    const uint8_t byte = get_byte(i);
+    if ((excess + BYTE_TABLES.fwd_min[byte]) <= target) {
+      break;
+    }
+    excess += BYTE_TABLES.excess[byte];
+  }
+  for (; i < end; ++i) {
+    excess += bits_[i] ? 1 : -1;
+    if (excess <= target) {
+      return i;
+    }
+  }
+  return size();
+}
+
+std::size_t BpVector::bwd_scan(std::size_t i, std::size_t begin,
+                               std::ptrdiff_t excess,
+                               std::ptrdiff_t target) const {
+  for (;;) {
+    if (excess <= target) {
+      return i;
+    }
+    if (i == begin) {
+      return size();
+    }
+    if (((i % 8) == 0) && ((i - 8) >= begin)) {
+      const uint8_t byte = get_byte(i - 8);
+      if ((excess + BYTE_TABLES.bwd_min[byte]) > target) {
+        excess -= BYTE_TABLES.excess[byte];
+        i -= 8;
+        continue;
+      }
+    }
+    excess -= bits_[i - 1] ? 1 : -1;
+    --i;
+  }
+}
+
+}  // namespace marisa::grimoire::vector
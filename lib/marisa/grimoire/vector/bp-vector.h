@@ -0,0 +1,151 @@
+#ifndef MARISA_GRIMOIRE_VECTOR_BP_VECTOR_H_
+#define MARISA_GRIMOIRE_VECTOR_BP_VECTOR_H_
+
+#include <cassert>
+#include <cstddef>
+#include <utility>
+
+#include "marisa/grimoire/vector/bit-vector.h"
+#include "marisa/grimoire/vector/vector.h"
+
+namespace marisa::grimoire::vector {
+
+// BpVector is a sequence of balanced parentheses, where 1 is an open
+// parenthesis and 0 is a close one. In addition to rank and select, it finds
+// matching parentheses with a range min tree over the excess, which is the
+// number of 1s minus the number of 0s, of blocks of 256 bits.
+class BpVector {
+ public:
+  BpVector() = default;
+
+  BpVector(const BpVector &) = delete;
+  BpVector &operator=(const BpVector &) = delete;
+
+  void push_back(bool bit) {
+    bits_.push_back(bit);
+  }
+  void push_back_run(bool bit, std::size_t count) {
+    bits_.push_back_run(bit, count);
+  }
+
+  // build() builds the rank/select0 index and the range min tree.
+  void build();
+
+  void map(Mapper &mapper);
+  void read(Reader &reader);
+  void write(Writer &writer) const;
+
+  bool operator[](std::size_t i) const {
+    return bits_[i];
+  }
+  std::size_t rank0(std::size_t i) const {
+    return bits_.rank0(i);
+  }
+  std::size_t rank1(std::size_t i) const {
+    return bits_.rank1(i);
+  }
+  std::size_t select0(std::size_t i) const {
+    return bits_.select0(i);
+  }
+
+  // next0() returns the position of the first 0 from `i`, which is found by
+  // a scan because runs of 1s are expected to be short.
+  std::size_t next0(std::size_t i) const {
+    while (bits_[i]) {
+      ++i;
+    }
+    return i;
+  }
+
+  // find_close() returns the position of the 0 that matches the 1 at `i`,
+  // and find_open() the position of the 1 that matches the 0 at `i`.
+  std::size_t find_close(std::size_t i) const {
+    assert(bits_[i]);
+    return fwd_search(i + 1, excess(i));
+  }
+  // This overload saves a rank if the caller knows excess(i).
+  std::size_t find_close(std::size_t i, std::ptrdiff_t excess_i) const {
+    assert(bits_[i]);
+    assert(excess_i == excess(i));
+    return fwd_search(i + 1, excess_i + 1, excess_i);
+  }
+  std::size_t find_open(std::size_t i) const {
+    assert(!bits_[i]);
+    return bwd_search(i, excess(i + 1));
+  }
+
+  // fwd_search() returns the first position j >= `i` such that
+  // excess(j + 1) <= `target`, or size() if there is no such position.
+  // bwd_search() returns the last position j <= `i` such that
+  // excess(j) <= `target`, or size() if there is no such position.
+  // fwd_search() may take excess(i) as `excess_i`.
+  std::size_t fwd_search(std::size_t i, std::ptrdiff_t target) const;
+  std::size_t fwd_search(std::size_t i, std::ptrdiff_t excess_i,
+                         std::ptrdiff_t target) const;
+  std::size_t bwd_search(std::size_t i, std::ptrdiff_t target) const;
+
+  // excess() returns the number of 1s minus the number of 0s before `i`.
+  std::ptrdiff_t excess(std::size_t i) const {
+    // rank1() may read the unit after the last one for i == size().
+    const std::size_t num_1s = (i < size()) ? bits_.rank1(i) : bits_.num_1s();
+    return static_cast<std::ptrdiff_t>(2 * num_1s) -
+           static_cast<std::ptrdiff_t>(i);
+  }
+
+  bool empty() const {
+    return bits_.empty();
+  }
+  std::size_t size() const {
+    return bits_.size();
+  }
+  std::size_t total_size() const {
+    return bits_.total_size() + mins_.total_size();
+  }
+  std::size_t io_size() const {
+    return bits_.io_size() + mins_.io_size();
+  }
+
+  // for_each_block() calls f(ptr, size) for each memory block of the vector.
+  template <typename F>
+  void for_each_block(F f) const {
+    bits_.for_each_block(f);
+    f(mins_.begin(), mins_.total_size());
+  }
+
+  void clear() noexcept {
+    BpVector().swap(*this);
+  }
+  void swap(BpVector &rhs) noexcept {
+    bits_.swap(rhs.bits_);
+    mins_.swap(rhs.mins_);
+    std::swap(num_leaves_, rhs.num_leaves_);
+  }
+
+ private:
+  static constexpr std::size_t BLOCK_SIZE = 256;
+
+  // mins_ is a complete binary tree whose leaves are the blocks and whose
+  // nodes keep the minimum excess in their blocks, including the excess at
+  // the ends of the blocks. mins_[1] is the root.
+  // num_leaves_ is not stored because it is a half of mins_.size().
+  BitVector bits_;
+  Vector<int32_t> mins_;
+  std::size_t num_leaves_ = 0;
+
+  uint8_t get_byte(std::size_t i) const {
+    assert((i % 8) == 0);
+    return static_cast<uint8_t>(bits_.unit(i / MARISA_WORD_SIZE) >>
+                                (i % MARISA_WORD_SIZE));
+  }
+
+  // fwd_scan() and bwd_scan() search [i, end) and [begin, i] within a block,
+  // given the excess at `i`.
+  std::size_t fwd_scan(std::size_t i, std::size_t end, std::ptrdiff_t excess,
+                       std::ptrdiff_t target) const;
+  std::size_t bwd_scan(std::size_t i, std::size_t begin, std::ptrdiff_t excess,
+                       std::ptrdiff_t target) const;
+};
+
+}  // namespace marisa::grimoire::vector
+
+#endif  // MARISA_GRIMOIRE_VECTOR_BP_VECTOR_H_
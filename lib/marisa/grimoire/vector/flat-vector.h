@@ -155,6 +155,12 @@ class FlatVector {
     return units_.io_size() + (sizeof(uint32_t) * 2) + sizeof(uint64_t);
   }
 
+  // for_each_block() calls f(ptr, size) for each memory block of the vector.
+  template <typename F>
+  void for_each_block(F f) const {
+    f(units_.begin(), units_.total_size());
+  }
+
   void clear() noexcept {
     FlatVector().swap(*this);
   }
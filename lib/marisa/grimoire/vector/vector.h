@@ -1,6 +1,7 @@
 #ifndef MARISA_GRIMOIRE_VECTOR_VECTOR_H_
 #define MARISA_GRIMOIRE_VECTOR_VECTOR_H_
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <memory>
@@ -13,6 +14,14 @@
 
 namespace marisa::grimoire::vector {
 
+// allocated_bytes() returns the number of bytes allocated by vectors on the
+// current thread. The counter never decreases, so a build reports the
+// difference between the beginning and the end of each phase.
+inline std::size_t &allocated_bytes() {
+  static thread_local std::size_t num_bytes = 0;
+  return num_bytes;
+}
+
 template <typename T>
 class Vector final {
 public:
@@ -42,7 +51,7 @@ public:
     MARISA_THROW_IF((total_size % sizeof(T)) != 0, std::runtime_error);
     const std::size_t size = static_cast<std::size_t>(total_size / sizeof(T));
     mapper.map(&const_objs_, size);
-    mapper.seek(static_cast<std::size_t>((8 - (total_size % 8))));
+    mapper.seek(padding(total_size, mapper.legacy_padding()));
     size_ = size;
   }
 
@@ -54,7 +63,7 @@ public:
     const std::size_t size = static_cast<std::size_t>(total_size / sizeof(T));
     resize(size);
     reader.read(objs(), size);
-    reader.seek(static_cast<std::size_t>((8 - (total_size % 8))));
+    reader.seek(padding(total_size, reader.legacy_padding()));
   }
 
   Vector &operator=(const Vector<T> &other) {
@@ -85,7 +94,7 @@ public:
   void write(Writer &writer) const {
     writer.write(static_cast<uint64_t>(total_size()));
     writer.write(const_objs_, size_);
-    writer.seek((8 - (total_size() % 8)));
+    writer.seek(padding(total_size(), false));
   }
 
   void push_back(const T &x) {
@@ -233,6 +242,14 @@ private:
   std::size_t size_ = 0;
   std::size_t capacity_ = 0;
 
+  // padding() returns the number of bytes that follow `total_size` bytes of
+  // data to align the next vector to 8 bytes. The legacy layout pads aligned
+  // data with 8 bytes.
+  static std::size_t padding(uint64_t total_size, bool legacy_padding) {
+    const std::size_t size = static_cast<std::size_t>(8 - (total_size % 8));
+    return legacy_padding ? size : (size % 8);
+  }
+
   // Copies current elements to new buffer of size `new_capacity`.
   // Requires `new_capacity >= size_`.
   void realloc(std::size_t new_capacity) {
@@ -240,6 +257,7 @@ private:
     assert(new_capacity <= max_size());
 
     std::unique_ptr<char[]> new_buf(new char[sizeof(T) * new_capacity]);
+    allocated_bytes() += sizeof(T) * new_capacity;
     T *new_objs = reinterpret_cast<T *>(new_buf.get());
 
     std::copy_n(objs(), size_, new_objs);
@@ -260,6 +278,7 @@ private:
     assert(size_ == 0);
 
     buf_ = std::unique_ptr<char[]>(new char[sizeof(T) * capacity]);
+    allocated_bytes() += sizeof(T) * capacity;
     T *new_objs = objs();
 
     std::copy_n(src, size, new_objs);
@@ -1,12 +1,27 @@
 #include "marisa/keyset.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <functional>
 #include <memory>
 #include <new>
 #include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "marisa/grimoire/algorithm/parallel.h"
 
 namespace marisa {
+namespace {
+
+// deduplicate() hashes keys in chunks of this number of keys, and then
+// assigns them to NUM_DEDUP_SHARDS shards by their hashes. Each shard has its
+// own hash table, so that shards are deduplicated in parallel without locks.
+constexpr std::size_t DEDUP_CHUNK_SIZE = std::size_t{1} << 16;
+constexpr std::size_t NUM_DEDUP_SHARDS = 256;
+
+}  // namespace
 
 
 template<typename T>
@@ -56,7 +71,7 @@ void Keyset::push_back(const char *str) {
   assert(size_ < SIZE_MAX);
   MARISA_THROW_IF(str == nullptr, std::invalid_argument);
 
-  push_back(str, std::find(str, str + SIZE_MAX, '\0') - str);
+  push_back(str, std::strlen(str));
 }
 
 void Keyset::push_back(const char *ptr, std::size_t length, float weight) {
@@ -74,6 +89,122 @@ void Keyset::push_back(const char *ptr, std::size_t length, float weight) {
   total_length_ += length;
 }
 
+std::size_t Keyset::deduplicate(std::size_t num_threads) {
+  using grimoire::algorithm::run_in_parallel;
+
+  if (size_ < 2) {
+    return 0;
+  }
+
+  // Hashes are computed and counted per shard in each chunk, and then the
+  // indices of keys are scattered into shards in ascending order.
+  const std::size_t num_chunks =
+      (size_ + DEDUP_CHUNK_SIZE - 1) / DEDUP_CHUNK_SIZE;
+  std::vector<std::size_t> hashes(size_);
+  std::vector<std::size_t> offsets(num_chunks * NUM_DEDUP_SHARDS + 1, 0);
+  run_in_parallel(num_chunks, num_threads, [&](std::size_t chunk_id) {
+    const std::size_t begin = chunk_id * DEDUP_CHUNK_SIZE;
+    const std::size_t end = std::min(begin + DEDUP_CHUNK_SIZE, size_);
+    for (std::size_t i = begin; i < end; ++i) {
+      hashes[i] = std::hash<std::string_view>()((*this)[i].str());
+      ++offsets[(hashes[i] % NUM_DEDUP_SHARDS) * num_chunks + chunk_id + 1];
+    }
+  });
+  for (std::size_t i = 1; i < offsets.size(); ++i) {
+    offsets[i] += offsets[i - 1];
+  }
+  std::vector<std::size_t> indices(size_);
+  run_in_parallel(num_chunks, num_threads, [&](std::size_t chunk_id) {
+    std::vector<std::size_t> cursors(NUM_DEDUP_SHARDS);
+    for (std::size_t i = 0; i < NUM_DEDUP_SHARDS; ++i) {
+      cursors[i] = offsets[i * num_chunks + chunk_id];
+    }
+    const std::size_t begin = chunk_id * DEDUP_CHUNK_SIZE;
+    const std::size_t end = std::min(begin + DEDUP_CHUNK_SIZE, size_);
+    for (std::size_t i = begin; i < end; ++i) {
+      indices[cursors[hashes[i] % NUM_DEDUP_SHARDS]++] = i;
+    }
+  });
+
+  // Each shard finds the first occurrences with an open addressing table and
+  // sums weights in double, as build() does for duplicates.
+  std::vector<char> is_duplicate(size_, 0);
+  run_in_parallel(NUM_DEDUP_SHARDS, num_threads, [&](std::size_t shard_id) {
+    const std::size_t begin = offsets[shard_id * num_chunks];
+    const std::size_t end = offsets[(shard_id + 1) * num_chunks];
+    if (begin == end) {
+      return;
+    }
+    std::size_t table_size = 1;
+    while (table_size < ((end - begin) * 2)) {
+      table_size *= 2;
+    }
+    std::vector<std::size_t> table(table_size, SIZE_MAX);
+    std::vector<double> weights(table_size);
+    for (std::size_t i = begin; i < end; ++i) {
+      const std::size_t key_id = indices[i];
+      const std::size_t hash = hashes[key_id];
+      const Key &key = (*this)[key_id];
+      std::size_t pos = (hash / NUM_DEDUP_SHARDS) & (table_size - 1);
+      while ((table[pos] != SIZE_MAX) &&
+             ((hashes[table[pos]] != hash) ||
+              ((*this)[table[pos]].str() != key.str()))) {
+        pos = (pos + 1) & (table_size - 1);
+      }
+      if (table[pos] == SIZE_MAX) {
+        table[pos] = key_id;
+        weights[pos] = double{key.weight()};
+      } else {
+        weights[pos] += double{key.weight()};
+        is_duplicate[key_id] = 1;
+      }
+    }
+    for (std::size_t pos = 0; pos < table_size; ++pos) {
+      if (table[pos] != SIZE_MAX) {
+        (*this)[table[pos]].set_weight(static_cast<float>(weights[pos]));
+      }
+    }
+  });
+
+  std::size_t new_size = 0;
+  std::size_t new_total_length = 0;
+  for (std::size_t i = 0; i < size_; ++i) {
+    if (!is_duplicate[i]) {
+      const Key key = (*this)[i];
+      (*this)[new_size++] = key;
+      new_total_length += key.length();
+    }
+  }
+  const std::size_t num_removed_keys = size_ - new_size;
+  size_ = new_size;
+  total_length_ = new_total_length;
+  return num_removed_keys;
+}
+
+void Keyset::append(Keyset &other) {
+  MARISA_THROW_IF(&other == this, std::invalid_argument);
+
+  // Blocks are moved as they are, so the keys of `other` keep pointing to
+  // their bytes. This keyset continues to fill its own current block.
+  for (std::size_t i = 0; i < other.base_blocks_size_; ++i) {
+    append_(base_blocks_, base_blocks_size_, base_blocks_capacity_);
+    base_blocks_[base_blocks_size_++].swap(other.base_blocks_[i]);
+  }
+  for (std::size_t i = 0; i < other.extra_blocks_size_; ++i) {
+    append_(extra_blocks_, extra_blocks_size_, extra_blocks_capacity_);
+    extra_blocks_[extra_blocks_size_++].swap(other.extra_blocks_[i]);
+  }
+  for (std::size_t i = 0; i < other.size_; ++i) {
+    if ((size_ / KEY_BLOCK_SIZE) == key_blocks_size_) {
+      append_key_block();
+    }
+    key_blocks_[size_ / KEY_BLOCK_SIZE][size_ % KEY_BLOCK_SIZE] = other[i];
+    ++size_;
+  }
+  total_length_ += other.total_length_;
+  other.clear();
+}
+
 void Keyset::clear() noexcept {
   Keyset().swap(*this);
 }
@@ -1,18 +1,162 @@
 #include "marisa/trie.h"
 
+#include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <memory>
+#include <new>
+#include <ostream>
 #include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <vector>
 
+#include "marisa/grimoire/io/atomic-file.h"
+#include "marisa/grimoire/io/compressor.h"
+#include "marisa/grimoire/probe.h"
 #include "marisa/grimoire/trie.h"
 #include "marisa/iostream.h"
 #include "marisa/stdio.h"
 
 namespace marisa {
+namespace {
+
+// An atomic save collects writes into this size, instead of the many small
+// writes of Writer::open(filename).
+constexpr std::size_t ATOMIC_SAVE_BUFFER_SIZE = 4 << 20;
+
+// save_file() opens `filename` as flags specify and calls `write(writer)`.
+template <typename F>
+void save_file(const char *filename, int flags, const F &write) {
+  if ((flags & MARISA_SAVE_ATOMIC) == 0) {
+    grimoire::Writer writer;
+    writer.open(filename);
+    write(writer);
+    return;
+  }
+
+  grimoire::io::AtomicFile file;
+  file.open(filename);
+  {
+    grimoire::Writer writer;
+    writer.open(file.fd(), ATOMIC_SAVE_BUFFER_SIZE);
+    write(writer);
+    writer.flush();
+  }
+  file.commit();
+}
+
+// ImageBuffer is a stream buffer that appends to a string, so that an image
+// is serialized once into memory that the caller reserves in advance.
+class ImageBuffer : public std::streambuf {
+ public:
+  explicit ImageBuffer(std::string *image) : image_(image) {}
+
+ protected:
+  std::streamsize xsputn(const char *s, std::streamsize n) override {
+    image_->append(s, static_cast<std::size_t>(n));
+    return n;
+  }
+  int_type overflow(int_type c) override {
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      image_->push_back(traits_type::to_char_type(c));
+    }
+    return traits_type::not_eof(c);
+  }
+
+ private:
+  std::string *image_;
+};
+
+// call_noexcept() calls a query function whose arguments are valid, so that
+// the only possible exception is a failure to allocate memory.
+template <typename Func>
+ErrorCode call_noexcept(const Func &func) noexcept {
+#if MARISA_USE_EXCEPTIONS
+  try {
+    func();
+  } catch (const std::bad_alloc &) {
+    return MARISA_MEMORY_ERROR;
+  } catch (...) {
+    return MARISA_STATE_ERROR;
+  }
+#else   // MARISA_USE_EXCEPTIONS
+  func();
+#endif  // MARISA_USE_EXCEPTIONS
+  return MARISA_OK;
+}
+
+// get_trie_type() validates `config_flags` and returns the trie type they
+// specify.
+TrieType get_trie_type(int config_flags) {
+  return grimoire::trie::Config(config_flags).trie_type();
+}
+
+// KeyArray is the input of Trie::build() without a Keyset.
+struct KeyArray {
+  const std::string_view *keys;
+  std::size_t num_keys;
+  const float *weights;
+  uint32_t *ids;
+};
+
+// These build each backend from a Keyset or a KeyArray for Trie::build_().
+// A CentroidTrie and a DfudsTrie have no cache, so weights are not used.
+grimoire::CentroidTrie *new_centroid_trie(
+    Keyset &keyset, grimoire::trie::BuildMonitor &monitor) {
+  return new grimoire::CentroidTrie(keyset, monitor);
+}
+grimoire::CentroidTrie *new_centroid_trie(
+    KeyArray &keys, grimoire::trie::BuildMonitor &monitor) {
+  return new grimoire::CentroidTrie(keys.keys, keys.num_keys, keys.ids,
+                                    monitor);
+}
+grimoire::DfudsTrie *new_dfuds_trie(Keyset &keyset, int config_flags,
+                                    grimoire::trie::BuildMonitor &monitor) {
+  return new grimoire::DfudsTrie(keyset, config_flags, monitor);
+}
+grimoire::DfudsTrie *new_dfuds_trie(KeyArray &keys, int config_flags,
+                                    grimoire::trie::BuildMonitor &monitor) {
+  return new grimoire::DfudsTrie(keys.keys, keys.num_keys, keys.ids,
+                                 config_flags, monitor);
+}
+grimoire::LoudsTrie *new_louds_trie(Keyset &keyset, int config_flags,
+                                    grimoire::trie::BuildMonitor &monitor) {
+  return new grimoire::LoudsTrie(keyset, config_flags, monitor);
+}
+grimoire::LoudsTrie *new_louds_trie(KeyArray &keys, int config_flags,
+                                    grimoire::trie::BuildMonitor &monitor) {
+  return new grimoire::LoudsTrie(keys.keys, keys.num_keys, keys.weights,
+                                 keys.ids, config_flags, monitor);
+}
+
+}  // namespace
+
+bool Trie::is_built_() const {
+  return !is_louds_() || trie_->is_built();
+}
+
+template <typename F>
+decltype(auto) Trie::dispatch_(F &&f) const {
+  MARISA_THROW_IF(!is_built_(), std::logic_error);
+  if (centroid_trie_ != nullptr) {
+    return f(*centroid_trie_);
+  } else if (dfuds_trie_ != nullptr) {
+    return f(*dfuds_trie_);
+  }
+  return f(*trie_);
+}
 
 Trie::Trie()
   : trie_(new grimoire::LoudsTrie) {
 }
 
+Trie::Trie(const void *ptr, std::size_t size) : Trie() {
+  MARISA_THROW_IF((reinterpret_cast<std::uintptr_t>(ptr) % 8) != 0,
+                  std::invalid_argument);
+  TrieSerializer(*this).map(ptr, size);
+}
+
 Trie::~Trie() = default;
 
 Trie::Trie(Trie &&other) noexcept = default;
@@ -20,60 +164,283 @@ Trie::Trie(Trie &&other) noexcept = default;
 Trie &Trie::operator=(Trie &&other) noexcept = default;
 
 void Trie::build(Keyset &keyset, int config_flags) {
-  std::unique_ptr<grimoire::LoudsTrie> temp(new grimoire::LoudsTrie(keyset, config_flags));
-  trie_.swap(temp);
+  MARISA_PROBE2(build__entry, keyset.size(), config_flags);
+  grimoire::trie::BuildMonitor monitor;
+  build_(keyset, config_flags, monitor);
+  MARISA_PROBE2(build__return, num_keys(), num_nodes());
+}
+
+void Trie::build(Keyset &keyset, int config_flags, BuildReport &report) {
+  MARISA_PROBE2(build__entry, keyset.size(), config_flags);
+  BuildReport temp_report;
+  grimoire::trie::BuildMonitor monitor(&temp_report);
+  build_(keyset, config_flags, monitor);
+  report.swap(temp_report);
+  MARISA_PROBE2(build__return, num_keys(), num_nodes());
+}
+
+void Trie::build(Keyset &keyset, int config_flags,
+                 const BuildCallback &callback, BuildReport *report) {
+  MARISA_PROBE2(build__entry, keyset.size(), config_flags);
+  BuildReport temp_report;
+  grimoire::trie::BuildMonitor monitor(
+      (report != nullptr) ? &temp_report : nullptr, &callback);
+  build_(keyset, config_flags, monitor);
+  if (report != nullptr) {
+    report->swap(temp_report);
+  }
+  MARISA_PROBE2(build__return, num_keys(), num_nodes());
+}
+
+void Trie::build(const std::string_view *keys, std::size_t num_keys,
+                 const float *weights, int config_flags, uint32_t *ids) {
+  MARISA_PROBE2(build__entry, num_keys, config_flags);
+  grimoire::trie::BuildMonitor monitor;
+  KeyArray key_array{keys, num_keys, weights, ids};
+  build_(key_array, config_flags, monitor);
+  MARISA_PROBE2(build__return, this->num_keys(), num_nodes());
 }
 
+template <typename Keys>
+void Trie::build_(Keys &keys, int config_flags,
+                  grimoire::trie::BuildMonitor &monitor) {
+  Trie temp;
+  switch (get_trie_type(config_flags)) {
+    case MARISA_CENTROID_TRIE: {
+      temp.centroid_trie_.reset(new_centroid_trie(keys, monitor));
+      break;
+    }
+    case MARISA_DFUDS_TRIE: {
+      temp.dfuds_trie_.reset(new_dfuds_trie(keys, config_flags, monitor));
+      break;
+    }
+    default: {
+      temp.trie_.reset(new_louds_trie(keys, config_flags, monitor));
+      break;
+    }
+  }
+  swap(temp);
+}
+
+// The probes of the following functions pass the query length, the number of
+// query bytes matched so far (hops), and the result.
+
 bool Trie::lookup(Agent &agent) const {
-  return trie_->lookup(agent);
+  MARISA_PROBE1(lookup__entry, agent.query().length());
+  const bool found =
+      dispatch_([&](const auto &trie) { return trie.lookup(agent); });
+  MARISA_PROBE3(lookup__return, agent.query().length(),
+                agent.state().query_pos(), found);
+  return found;
 }
 
 void Trie::reverse_lookup(Agent &agent) const {
-  trie_->reverse_lookup(agent);
+  MARISA_PROBE1(reverse_lookup__entry, agent.query().id());
+  dispatch_([&](const auto &trie) { trie.reverse_lookup(agent); });
+  MARISA_PROBE2(reverse_lookup__return, agent.query().id(),
+                agent.key().length());
 }
 
 bool Trie::common_prefix_search(Agent &agent) const {
-  return trie_->common_prefix_search(agent);
+  MARISA_PROBE1(common_prefix_search__entry, agent.query().length());
+  const bool found = dispatch_(
+      [&](const auto &trie) { return trie.common_prefix_search(agent); });
+  MARISA_PROBE3(common_prefix_search__return, agent.query().length(),
+                agent.state().query_pos(), found);
+  return found;
 }
 
 bool Trie::predictive_search(Agent &agent) const {
-  return trie_->predictive_search(agent);
+  MARISA_PROBE1(predictive_search__entry, agent.query().length());
+  const bool found = dispatch_(
+      [&](const auto &trie) { return trie.predictive_search(agent); });
+  MARISA_PROBE3(predictive_search__return, agent.query().length(),
+                agent.state().query_pos(), found);
+  return found;
+}
+
+std::size_t Trie::predictive_count(Agent &agent) const {
+  MARISA_THROW_IF(!is_built_(), std::logic_error);
+  if (dfuds_trie_ != nullptr) {
+    return dfuds_trie_->predictive_count(agent);
+  }
+  agent.state().reset();
+  std::size_t count = 0;
+  while (predictive_search(agent)) {
+    ++count;
+  }
+  agent.state().reset();
+  return count;
+}
+
+ErrorCode Trie::try_lookup(Agent &agent, bool *found) const noexcept {
+  assert(found != nullptr);
+  if (!is_built_()) {
+    return MARISA_STATE_ERROR;
+  }
+  return call_noexcept([&] { *found = lookup(agent); });
+}
+
+ErrorCode Trie::try_reverse_lookup(Agent &agent) const noexcept {
+  if (!is_built_()) {
+    return MARISA_STATE_ERROR;
+  }
+  if (agent.query().id() >= size()) {
+    return MARISA_BOUND_ERROR;
+  }
+  return call_noexcept([&] { reverse_lookup(agent); });
+}
+
+ErrorCode Trie::try_common_prefix_search(Agent &agent,
+                                         bool *found) const noexcept {
+  assert(found != nullptr);
+  if (!is_built_()) {
+    return MARISA_STATE_ERROR;
+  }
+  return call_noexcept([&] { *found = common_prefix_search(agent); });
+}
+
+ErrorCode Trie::try_predictive_search(Agent &agent,
+                                      bool *found) const noexcept {
+  assert(found != nullptr);
+  if (!is_built_()) {
+    return MARISA_STATE_ERROR;
+  }
+  return call_noexcept([&] { *found = predictive_search(agent); });
 }
 
 std::size_t Trie::num_tries() const {
-  return trie_->num_tries();
+  MARISA_THROW_IF(!is_built_(), std::logic_error);
+  return is_louds_() ? trie_->num_tries() : 1;
 }
 
 std::size_t Trie::num_keys() const {
-  return trie_->num_keys();
+  return dispatch_([](const auto &trie) { return trie.num_keys(); });
 }
 
 std::size_t Trie::num_nodes() const {
-  return trie_->num_nodes();
+  return dispatch_([](const auto &trie) { return trie.num_nodes(); });
 }
 
 TailMode Trie::tail_mode() const {
-  return trie_->tail_mode();
+  MARISA_THROW_IF(!is_built_(), std::logic_error);
+  if (dfuds_trie_ != nullptr) {
+    return dfuds_trie_->tail_mode();
+  }
+  return is_louds_() ? trie_->tail_mode() : MARISA_BINARY_TAIL;
 }
 
 NodeOrder Trie::node_order() const {
-  return trie_->node_order();
+  MARISA_THROW_IF(!is_built_(), std::logic_error);
+  return is_louds_() ? trie_->node_order() : MARISA_LABEL_ORDER;
+}
+
+TrieType Trie::trie_type() const {
+  if (centroid_trie_ != nullptr) {
+    return MARISA_CENTROID_TRIE;
+  } else if (dfuds_trie_ != nullptr) {
+    return MARISA_DFUDS_TRIE;
+  }
+  return MARISA_LOUDS_TRIE;
 }
 
 bool Trie::empty() const {
-  return trie_->empty();
+  return dispatch_([](const auto &trie) { return trie.empty(); });
 }
 
 std::size_t Trie::size() const {
-  return trie_->size();
+  return dispatch_([](const auto &trie) { return trie.size(); });
 }
 
 std::size_t Trie::total_size() const {
-  return trie_->total_size();
+  return dispatch_([](const auto &trie) { return trie.total_size(); });
 }
 
 std::size_t Trie::io_size() const {
-  return trie_->io_size();
+  return dispatch_([](const auto &trie) { return trie.io_size(); });
+}
+
+void Trie::rebuild_cache(CacheLevel cache_level) {
+  MARISA_THROW_IF(!is_built_(), std::logic_error);
+  if (is_louds_()) {
+    trie_->rebuild_cache(cache_level);
+  }
+}
+
+void Trie::clear_cache() {
+  MARISA_THROW_IF(!is_built_(), std::logic_error);
+  if (is_louds_()) {
+    trie_->clear_cache();
+  }
+}
+
+void Trie::warmup(int flags, const Keyset *sample) const {
+  MARISA_THROW_IF((flags & ~(MARISA_WARMUP_HOT | MARISA_WARMUP_SAMPLE |
+                             MARISA_WARMUP_ALL)) != 0,
+                  std::invalid_argument);
+  MARISA_THROW_IF(((flags & MARISA_WARMUP_SAMPLE) != 0) && (sample == nullptr),
+                  std::invalid_argument);
+
+  std::vector<grimoire::LoudsTrie::Section> sections;
+  dispatch_([&](const auto &trie) { trie.get_sections(&sections); });
+  if ((flags & MARISA_WARMUP_HOT) != 0) {
+    for (const grimoire::LoudsTrie::Section &section : sections) {
+      if (section.hot) {
+        grimoire::io::prefault(section.ptr, section.size);
+      }
+    }
+  }
+  if ((flags & MARISA_WARMUP_SAMPLE) != 0) {
+    Agent agent;
+    for (std::size_t i = 0; i < sample->size(); ++i) {
+      agent.set_query((*sample)[i].ptr(), (*sample)[i].length());
+      dispatch_([&](const auto &trie) { trie.lookup(agent); });
+    }
+  }
+  if ((flags & MARISA_WARMUP_ALL) != 0) {
+    for (const grimoire::LoudsTrie::Section &section : sections) {
+      if (!section.hot || ((flags & MARISA_WARMUP_HOT) == 0)) {
+        grimoire::io::prefault(section.ptr, section.size);
+      }
+    }
+  }
+}
+
+ResidencyReport Trie::residency() const {
+  std::vector<grimoire::LoudsTrie::Section> sections;
+  dispatch_([&](const auto &trie) { trie.get_sections(&sections); });
+
+  // The blocks of a section are adjacent in `sections`.
+  ResidencyReport report;
+  for (std::size_t i = 0; i < sections.size();) {
+    std::size_t size = 0;
+    std::size_t resident_size = 0;
+    std::size_t j = i;
+    for (; (j < sections.size()) &&
+           (sections[j].trie_id == sections[i].trie_id) &&
+           (std::strcmp(sections[j].name, sections[i].name) == 0);
+         ++j) {
+      size += sections[j].size;
+      resident_size +=
+          grimoire::io::resident_size(sections[j].ptr, sections[j].size);
+    }
+    report.push_back(SectionResidency(sections[i].name, sections[i].trie_id,
+                                      size, resident_size));
+    i = j;
+  }
+  return report;
+}
+
+void Trie::diff(const Trie &old_trie, const Trie &new_trie,
+                const DiffCallback &callback) {
+  MARISA_THROW_IF(!old_trie.is_built_() || !new_trie.is_built_(),
+                  std::logic_error);
+  MARISA_THROW_IF(!old_trie.is_louds_() || !new_trie.is_louds_(),
+                  std::logic_error);
+  MARISA_THROW_IF(!callback, std::invalid_argument);
+
+  grimoire::DiffWalker walker(*old_trie.trie_, *new_trie.trie_);
+  walker.run(callback);
 }
 
 void Trie::clear() noexcept {
@@ -82,6 +449,45 @@ void Trie::clear() noexcept {
 
 void Trie::swap(Trie &rhs) noexcept {
   trie_.swap(rhs.trie_);
+  centroid_trie_.swap(rhs.centroid_trie_);
+  dfuds_trie_.swap(rhs.dfuds_trie_);
+}
+
+void Trie::map_(grimoire::Mapper &mapper) {
+  grimoire::trie::Header header;
+  header.map(mapper);
+  if (header.layout() == grimoire::trie::Header::CENTROID_LAYOUT) {
+    centroid_trie_.reset(new grimoire::CentroidTrie);
+    centroid_trie_->map(mapper, header);
+  } else if (header.layout() == grimoire::trie::Header::DFUDS_LAYOUT) {
+    dfuds_trie_.reset(new grimoire::DfudsTrie);
+    dfuds_trie_->map(mapper, header);
+  } else {
+    trie_->map(mapper, header);
+  }
+}
+
+void Trie::read_(grimoire::Reader &reader) {
+  grimoire::trie::Header header;
+  header.read(reader);
+  if (header.layout() == grimoire::trie::Header::CENTROID_LAYOUT) {
+    centroid_trie_.reset(new grimoire::CentroidTrie);
+    centroid_trie_->read(reader, header);
+  } else if (header.layout() == grimoire::trie::Header::DFUDS_LAYOUT) {
+    dfuds_trie_.reset(new grimoire::DfudsTrie);
+    dfuds_trie_->read(reader, header);
+  } else {
+    trie_->read(reader, header);
+  }
+}
+
+// MARISA_SAVE_HOT_FIRST is ignored for a CentroidTrie and a DfudsTrie.
+void Trie::write_(grimoire::Writer &writer, int flags) const {
+  if (is_louds_()) {
+    trie_->write(writer, flags);
+  } else {
+    dispatch_([&](const auto &trie) { trie.write(writer); });
+  }
 }
 
 }  // namespace marisa
@@ -95,37 +501,37 @@ class TrieIO {
   static void fread(std::FILE *file, Trie *trie) {
     MARISA_THROW_IF(trie == nullptr, std::invalid_argument);
 
-    std::unique_ptr<grimoire::LoudsTrie> temp(new grimoire::LoudsTrie);
+    Trie temp;
 
     grimoire::Reader reader;
     reader.open(file);
-    temp->read(reader);
-    trie->trie_.swap(temp);
+    temp.read_(reader);
+    trie->swap(temp);
   }
   static void fwrite(std::FILE *file, const Trie &trie) {
     MARISA_THROW_IF(file == nullptr, std::invalid_argument);
-    MARISA_THROW_IF(trie.trie_ == nullptr, std::logic_error);
+    MARISA_THROW_IF(!trie.is_built_(), std::logic_error);
     grimoire::Writer writer;
     writer.open(file);
-    trie.trie_->write(writer);
+    trie.write_(writer, 0);
   }
 
   static std::istream &read(std::istream &stream, Trie *trie) {
     MARISA_THROW_IF(trie == nullptr, std::invalid_argument);
 
-    std::unique_ptr<grimoire::LoudsTrie> temp(new grimoire::LoudsTrie);
+    Trie temp;
 
     grimoire::Reader reader;
     reader.open(stream);
-    temp->read(reader);
-    trie->trie_.swap(temp);
+    temp.read_(reader);
+    trie->swap(temp);
     return stream;
   }
   static std::ostream &write(std::ostream &stream, const Trie &trie) {
-    MARISA_THROW_IF(trie.trie_ == nullptr, std::logic_error);
+    MARISA_THROW_IF(!trie.is_built_(), std::logic_error);
     grimoire::Writer writer;
     writer.open(stream);
-    trie.trie_->write(writer);
+    trie.write_(writer, 0);
     return stream;
   }
 };
@@ -162,63 +568,126 @@ std::ostream &operator<<(std::ostream &stream, const Trie &trie) {
 void TrieSerializer::mmap(const char *filename, int flags) {
   MARISA_THROW_IF(filename == nullptr, std::invalid_argument);
 
-  std::unique_ptr<grimoire::LoudsTrie> temp(new grimoire::LoudsTrie);
+  Trie temp;
 
+  MARISA_PROBE1(mmap__entry, filename);
   grimoire::Mapper mapper;
   mapper.open(filename, flags);
-  temp->map(mapper);
-  trie_.trie_.swap(temp);
+  temp.map_(mapper);
+  trie_.swap(temp);
+  MARISA_PROBE2(mmap__return, filename, trie_.io_size());
 }
 
 void TrieSerializer::map(const void *ptr, std::size_t size) {
   MARISA_THROW_IF((ptr == nullptr) && (size != 0), std::invalid_argument);
 
-  std::unique_ptr<grimoire::LoudsTrie> temp(new grimoire::LoudsTrie);
+  Trie temp;
 
+  MARISA_PROBE1(map__entry, size);
   grimoire::Mapper mapper;
   mapper.open(ptr, size);
-  temp->map(mapper);
-  trie_.trie_.swap(temp);
+  temp.map_(mapper);
+  trie_.swap(temp);
+  MARISA_PROBE1(map__return, size);
 }
 
 void TrieSerializer::load(const char *filename) {
   MARISA_THROW_IF(filename == nullptr, std::invalid_argument);
 
-  std::unique_ptr<grimoire::LoudsTrie> temp(new grimoire::LoudsTrie);
+  Trie temp;
 
+  MARISA_PROBE1(load__entry, filename);
   grimoire::Reader reader;
   reader.open(filename);
-  temp->read(reader);
-  trie_.trie_.swap(temp);
+  temp.read_(reader);
+  trie_.swap(temp);
+  MARISA_PROBE2(load__return, filename, trie_.io_size());
 }
 
 void TrieSerializer::read(int fd) {
   MARISA_THROW_IF(fd == -1, std::invalid_argument);
 
-  std::unique_ptr<grimoire::LoudsTrie> temp(new grimoire::LoudsTrie);
+  Trie temp;
 
+  MARISA_PROBE1(read__entry, fd);
   grimoire::Reader reader;
   reader.open(fd);
-  temp->read(reader);
-  trie_.trie_.swap(temp);
+  temp.read_(reader);
+  trie_.swap(temp);
+  MARISA_PROBE2(read__return, fd, trie_.io_size());
 }
 
-void TrieSerializer::save(const char *filename) const {
-  MARISA_THROW_IF(trie_.trie_ == nullptr, std::logic_error);
+void TrieSerializer::save(const char *filename, int flags) const {
+  MARISA_THROW_IF(!trie_.is_built_(), std::logic_error);
   MARISA_THROW_IF(filename == nullptr, std::invalid_argument);
+  MARISA_THROW_IF((flags & ~(MARISA_SAVE_HOT_FIRST | MARISA_SAVE_ATOMIC)) != 0,
+                  std::invalid_argument);
 
-  grimoire::Writer writer;
-  writer.open(filename);
-  trie_.trie_->write(writer);
+  save_file(filename, flags, [&](grimoire::Writer &writer) {
+    trie_.write_(writer, flags);
+  });
 }
 
-void TrieSerializer::write(int fd) const {
-  MARISA_THROW_IF(trie_.trie_ == nullptr, std::logic_error);
+void TrieSerializer::write(int fd, int flags) const {
+  MARISA_THROW_IF(!trie_.is_built_(), std::logic_error);
   MARISA_THROW_IF(fd == -1, std::invalid_argument);
+  MARISA_THROW_IF((flags & ~MARISA_SAVE_HOT_FIRST) != 0,
+                  std::invalid_argument);
 
   grimoire::Writer writer;
   writer.open(fd);
-  trie_.trie_->write(writer);
+  trie_.write_(writer, flags);
+}
+
+void TrieSerializer::save_compressed(const char *filename, int flags,
+                                     Codec codec,
+                                     std::size_t num_threads) const {
+  MARISA_THROW_IF(!trie_.is_built_(), std::logic_error);
+  MARISA_THROW_IF(filename == nullptr, std::invalid_argument);
+  MARISA_THROW_IF((flags & ~(MARISA_SAVE_HOT_FIRST | MARISA_SAVE_ATOMIC)) != 0,
+                  std::invalid_argument);
+  MARISA_THROW_IF(!has_codec(codec), std::invalid_argument);
+
+  // MARISA_SAVE_HOT_FIRST pads the first trie to a page boundary.
+  std::string image;
+  image.reserve(trie_.io_size() +
+                (((flags & MARISA_SAVE_HOT_FIRST) != 0) ? 4096 : 0));
+  {
+    ImageBuffer buffer(&image);
+    std::ostream stream(&buffer);
+    grimoire::Writer writer;
+    writer.open(stream);
+    trie_.write_(writer, flags);
+  }
+
+  save_file(filename, flags, [&](grimoire::Writer &writer) {
+    grimoire::io::Compressor::write(writer, image.data(), image.size(), codec,
+                                    num_threads);
+  });
+}
+
+void TrieSerializer::load_compressed(const char *filename,
+                                     std::size_t num_threads) {
+  MARISA_THROW_IF(filename == nullptr, std::invalid_argument);
+
+  Trie temp;
+
+  std::size_t size = 0;
+  std::unique_ptr<uint64_t[]> image;
+  {
+    grimoire::Reader reader;
+    reader.open(filename);
+    image = grimoire::io::Compressor::read(reader, &size, num_threads);
+  }
+
+  grimoire::Mapper mapper;
+  mapper.open(std::move(image), size);
+  temp.map_(mapper);
+  trie_.swap(temp);
+}
+
+bool TrieSerializer::has_codec(Codec codec) {
+  return grimoire::io::Compressor::has_codec(codec);
 }
 
 
@@ -33,6 +33,7 @@ void TestSwap() {
   TEST_END();
 }
 
+#if MARISA_USE_EXCEPTIONS
 void TestException() {
   TEST_START();
 
@@ -49,6 +50,7 @@ void TestException() {
 
   TEST_END();
 }
+#endif  // MARISA_USE_EXCEPTIONS
 
 void TestKey() {
   TEST_START();
@@ -192,7 +194,7 @@ void TestKeyset() {
     ASSERT(keyset[i].weight() == weights[i]);
   }
 
-  keyset.reset();
+  keyset.clear();
 
   ASSERT(keyset.size() == 0);
   ASSERT(keyset.total_length() == 0);
@@ -223,6 +225,107 @@ void TestKeyset() {
   TEST_END();
 }
 
+void TestKeysetDeduplicate() {
+  TEST_START();
+
+  marisa::Keyset keyset;
+  ASSERT(keyset.deduplicate() == 0);
+
+  keyset.push_back("apple", 5, 1.0F);
+  ASSERT(keyset.deduplicate() == 0);
+  ASSERT(keyset.size() == 1);
+
+  keyset.push_back("banana", 6, 2.0F);
+  keyset.push_back("apple", 5, 3.0F);
+  keyset.push_back("", 0, 4.0F);
+  keyset.push_back("banana", 6, 5.0F);
+  keyset.push_back("", 0, 6.0F);
+  keyset.push_back("cherry", 6, 7.0F);
+
+  ASSERT(keyset.deduplicate() == 3);
+  ASSERT(keyset.size() == 4);
+  ASSERT(keyset.total_length() == 17);
+  ASSERT(keyset[0].str() == "apple");
+  ASSERT(keyset[0].weight() == 4.0F);
+  ASSERT(keyset[1].str() == "banana");
+  ASSERT(keyset[1].weight() == 7.0F);
+  ASSERT(keyset[2].str() == "");
+  ASSERT(keyset[2].weight() == 10.0F);
+  ASSERT(keyset[3].str() == "cherry");
+  ASSERT(keyset[3].weight() == 7.0F);
+  ASSERT(keyset.deduplicate() == 0);
+
+  keyset.clear();
+
+  std::vector<std::string> keys(1000);
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    keys[i] = std::to_string(i);
+  }
+  std::vector<std::size_t> counts(keys.size(), 0);
+  std::vector<std::size_t> first_positions;
+  for (std::size_t i = 0; i < 200000; ++i) {
+    const std::size_t key_id = random_engine() % keys.size();
+    if (counts[key_id]++ == 0) {
+      first_positions.push_back(key_id);
+    }
+    keyset.push_back(keys[key_id]);
+  }
+
+  for (std::size_t num_threads : {1, 4}) {
+    marisa::Keyset copy;
+    for (std::size_t i = 0; i < keyset.size(); ++i) {
+      copy.push_back(keyset[i].str());
+    }
+    ASSERT(copy.deduplicate(num_threads) ==
+           (keyset.size() - first_positions.size()));
+    ASSERT(copy.size() == first_positions.size());
+    for (std::size_t i = 0; i < copy.size(); ++i) {
+      ASSERT(copy[i].str() == keys[first_positions[i]]);
+      ASSERT(copy[i].weight() ==
+             static_cast<float>(counts[first_positions[i]]));
+    }
+  }
+
+  TEST_END();
+}
+
+void TestKeysetAppend() {
+  TEST_START();
+
+  marisa::Keyset keyset;
+  marisa::Keyset other;
+  keyset.append(other);
+  ASSERT(keyset.empty());
+
+  std::vector<std::string> keys;
+  for (std::size_t i = 0; i < 5000; ++i) {
+    keys.push_back(std::string(random_engine() % 300, 'a' + (i % 26)));
+  }
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    ((i < 1234) ? keyset : other)
+        .push_back(keys[i].c_str(), keys[i].length(),
+                   static_cast<float>(i));
+  }
+  const std::size_t total_length = keyset.total_length() + other.total_length();
+
+  keyset.append(other);
+  ASSERT(other.empty());
+  ASSERT(other.total_length() == 0);
+  keyset.push_back("last");
+  keys.push_back("last");
+
+  ASSERT(keyset.size() == keys.size());
+  ASSERT(keyset.total_length() == (total_length + 4));
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    ASSERT(keyset[i].str() == keys[i]);
+  }
+  ASSERT(keyset[1234].weight() == 1234.0F);
+
+  EXCEPT(keyset.append(keyset), std::invalid_argument);
+
+  TEST_END();
+}
+
 void TestQuery() {
   TEST_START();
 
@@ -277,7 +380,8 @@ void TestAgent() {
   ASSERT(agent.key().ptr() == nullptr);
   ASSERT(agent.key().length() == 0);
 
-  ASSERT(!agent.has_state());
+  // An agent always has its state.
+  ASSERT(agent.has_state());
 
   const char *query_str = "query";
   const char *key_str = "key";
@@ -310,12 +414,6 @@ void TestAgent() {
   ASSERT(agent.key().length() == 4);
   ASSERT(agent.key().str() == std::string("key2"));
 
-  agent.init_state();
-
-  ASSERT(agent.has_state());
-
-  EXCEPT(agent.init_state(), std::logic_error);
-
   agent.clear();
 
   ASSERT(agent.query().ptr() == nullptr);
@@ -325,7 +423,7 @@ void TestAgent() {
   ASSERT(agent.key().ptr() == nullptr);
   ASSERT(agent.key().length() == 0);
 
-  ASSERT(!agent.has_state());
+  ASSERT(agent.has_state());
 
   TEST_END();
 }
@@ -334,9 +432,13 @@ void TestAgent() {
 
 int main() try {
   TestSwap();
+#if MARISA_USE_EXCEPTIONS
   TestException();
+#endif  // MARISA_USE_EXCEPTIONS
   TestKey();
   TestKeyset();
+  TestKeysetDeduplicate();
+  TestKeysetAppend();
   TestQuery();
   TestAgent();
 
@@ -0,0 +1,400 @@
+#include <marisa/c-api.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// marisa-assert.h is C++, so the same macros are defined for C here.
+#define ASSERT(cond)                                                  \
+  (void)((!!(cond)) ||                                                \
+         (printf("%d: Assertion `%s' failed.\n", __LINE__, #cond),    \
+          exit(-1), 0))
+
+#define TEST_START() printf("%s:%d: %s(): ", __FILE__, __LINE__, __func__)
+
+#define TEST_END() printf("ok\n")
+
+// The build defines MARISA_USE_EXCEPTIONS as 0 if the library is built
+// without exceptions, in which case only the query functions return errors.
+#ifndef MARISA_USE_EXCEPTIONS
+ #define MARISA_USE_EXCEPTIONS 1
+#endif  // MARISA_USE_EXCEPTIONS
+
+static const char KEYS[] = "appleapplicationappbananaban";
+static const size_t OFFSETS[] = {0, 5, 16, 19, 25, 28};
+enum { NUM_KEYS = 5 };
+
+static marisa_trie *BuildTrie(uint32_t *ids) {
+  marisa_trie *trie = NULL;
+  ASSERT(marisa_trie_new(&trie) == MARISA_OK);
+  ASSERT(marisa_trie_build(trie, KEYS, OFFSETS, NUM_KEYS, NULL,
+                           MARISA_LABEL_ORDER, ids) == MARISA_OK);
+  return trie;
+}
+
+static void TestErrors(void) {
+  TEST_START();
+
+  marisa_trie *trie = NULL;
+  ASSERT(marisa_trie_new(NULL) == MARISA_NULL_ERROR);
+  ASSERT(strlen(marisa_last_error()) != 0);
+  ASSERT(marisa_trie_new(&trie) == MARISA_OK);
+  ASSERT(marisa_trie_num_keys(trie) == 0);
+
+  const size_t bad_offsets[] = {0, 5, 3};
+  ASSERT(marisa_trie_build(trie, KEYS, bad_offsets, 2, NULL, 0, NULL) ==
+         MARISA_NULL_ERROR);
+#if MARISA_USE_EXCEPTIONS
+  ASSERT(marisa_trie_mmap(trie, "c-api-test.missing", 0) == MARISA_IO_ERROR);
+
+  const char garbage[16] = {0};
+  ASSERT(marisa_trie_map(trie, garbage, sizeof(garbage)) != MARISA_OK);
+#endif  // MARISA_USE_EXCEPTIONS
+
+  marisa_trie_free(trie);
+  marisa_trie_free(NULL);
+  marisa_predictive_iter_free(NULL);
+
+  TEST_END();
+}
+
+// The query functions report their errors in the same way if the library is
+// built without exceptions.
+static void TestQueryErrors(void) {
+  TEST_START();
+
+  marisa_trie *trie = NULL;
+  ASSERT(marisa_trie_new(&trie) == MARISA_OK);
+
+  uint32_t id = 0;
+  const size_t offsets[] = {0, 5};
+  ASSERT(marisa_trie_lookup_batch(trie, "apple", offsets, 1, &id) ==
+         MARISA_OK);
+  ASSERT(id == MARISA_INVALID_KEY_ID);
+
+  char buf[16];
+  size_t buf_offsets[3];
+  size_t num_restored = 1;
+  id = 0;
+  ASSERT(marisa_trie_reverse_lookup_batch(trie, &id, 1, buf, sizeof(buf),
+                                          buf_offsets, &num_restored) ==
+         MARISA_BOUND_ERROR);
+  ASSERT(num_restored == 0);
+  ASSERT(strlen(marisa_last_error()) != 0);
+
+  uint32_t ids[2];
+  size_t lengths[2];
+  size_t num_searched = 0;
+  ASSERT(marisa_trie_common_prefix_search_batch(trie, "apple", offsets, 1, ids,
+                                                lengths, 2, buf_offsets,
+                                                &num_searched) == MARISA_OK);
+  ASSERT(num_searched == 1);
+  ASSERT(buf_offsets[1] == 0);
+
+  marisa_predictive_iter *iter = NULL;
+  size_t num_results = 1;
+  ASSERT(marisa_trie_predictive_iter(trie, "", 0, &iter) == MARISA_OK);
+  ASSERT(marisa_predictive_iter_next(iter, ids, buf, sizeof(buf), buf_offsets,
+                                     2, &num_results) == MARISA_OK);
+  ASSERT(num_results == 0);
+  marisa_predictive_iter_free(iter);
+  marisa_trie_free(trie);
+
+  uint32_t built_ids[NUM_KEYS];
+  trie = BuildTrie(built_ids);
+  const uint32_t bad_ids[] = {NUM_KEYS, UINT32_MAX};
+  for (size_t i = 0; i < 2; ++i) {
+    ASSERT(marisa_trie_reverse_lookup_batch(trie, &bad_ids[i], 1, buf,
+                                            sizeof(buf), buf_offsets,
+                                            &num_restored) ==
+           MARISA_BOUND_ERROR);
+  }
+  marisa_trie_free(trie);
+
+  const char long_prefix[] = {1, 0};
+  size_t num_keys = 1;
+  ASSERT(marisa_front_coded_decode(long_prefix, sizeof(long_prefix), buf,
+                                   sizeof(buf), buf_offsets, 2, &num_keys) ==
+         MARISA_FORMAT_ERROR);
+  ASSERT(num_keys == 0);
+  const char truncated[] = {0, (char)0x80};
+  ASSERT(marisa_front_coded_decode(truncated, sizeof(truncated), buf,
+                                   sizeof(buf), buf_offsets, 2, &num_keys) ==
+         MARISA_FORMAT_ERROR);
+
+  TEST_END();
+}
+
+static void TestLookup(void) {
+  TEST_START();
+
+  uint32_t ids[NUM_KEYS];
+  marisa_trie *trie = BuildTrie(ids);
+  ASSERT(marisa_trie_num_keys(trie) == NUM_KEYS);
+
+  uint32_t found_ids[NUM_KEYS];
+  ASSERT(marisa_trie_lookup_batch(trie, KEYS, OFFSETS, NUM_KEYS, found_ids) ==
+         MARISA_OK);
+  for (size_t i = 0; i < NUM_KEYS; ++i) {
+    ASSERT(found_ids[i] == ids[i]);
+  }
+
+  const char queries[] = "appxban";
+  const size_t query_offsets[] = {0, 3, 4, 7, 7};
+  ASSERT(marisa_trie_lookup_batch(trie, queries, query_offsets, 4,
+                                  found_ids) == MARISA_OK);
+  ASSERT(found_ids[0] == ids[2]);
+  ASSERT(found_ids[1] == MARISA_INVALID_KEY_ID);
+  ASSERT(found_ids[2] == ids[4]);
+  ASSERT(found_ids[3] == MARISA_INVALID_KEY_ID);
+
+  char buf[16];
+  size_t offsets[NUM_KEYS + 1];
+  size_t num_restored = 0;
+  ASSERT(marisa_trie_reverse_lookup_batch(trie, ids, NUM_KEYS, buf,
+                                          sizeof(buf), offsets,
+                                          &num_restored) == MARISA_OK);
+  ASSERT(num_restored == 2);
+  ASSERT(offsets[2] == 16);
+  ASSERT(memcmp(buf, "appleapplication", 16) == 0);
+  ASSERT(marisa_trie_reverse_lookup_batch(trie, ids + 1, NUM_KEYS - 1, buf, 5,
+                                          offsets, &num_restored) ==
+         MARISA_SIZE_ERROR);
+  ASSERT(num_restored == 0);
+
+  const uint32_t bad_id = NUM_KEYS;
+  ASSERT(marisa_trie_reverse_lookup_batch(trie, &bad_id, 1, buf, sizeof(buf),
+                                          offsets, &num_restored) ==
+         MARISA_BOUND_ERROR);
+
+  marisa_trie_free(trie);
+
+  TEST_END();
+}
+
+static void TestCommonPrefixSearch(void) {
+  TEST_START();
+
+  uint32_t ids[NUM_KEYS];
+  marisa_trie *trie = BuildTrie(ids);
+
+  const char queries[] = "applicationsbanana";
+  const size_t query_offsets[] = {0, 12, 18};
+  uint32_t found_ids[4];
+  size_t lengths[4];
+  size_t result_offsets[3];
+  size_t num_searched = 0;
+  ASSERT(marisa_trie_common_prefix_search_batch(
+             trie, queries, query_offsets, 2, found_ids, lengths, 4,
+             result_offsets, &num_searched) == MARISA_OK);
+  ASSERT(num_searched == 2);
+  ASSERT(result_offsets[1] == 2);
+  ASSERT(found_ids[0] == ids[2]);
+  ASSERT(lengths[0] == 3);
+  ASSERT(found_ids[1] == ids[1]);
+  ASSERT(lengths[1] == 11);
+  ASSERT(result_offsets[2] == 4);
+  ASSERT(lengths[2] == 3);
+  ASSERT(lengths[3] == 6);
+
+  ASSERT(marisa_trie_common_prefix_search_batch(
+             trie, queries, query_offsets, 2, found_ids, lengths, 3,
+             result_offsets, &num_searched) == MARISA_OK);
+  ASSERT(num_searched == 1);
+  ASSERT(marisa_trie_common_prefix_search_batch(
+             trie, queries, query_offsets, 2, found_ids, lengths, 1,
+             result_offsets, &num_searched) == MARISA_SIZE_ERROR);
+
+  marisa_trie_free(trie);
+
+  TEST_END();
+}
+
+static void TestPredictiveIter(void) {
+  TEST_START();
+
+  uint32_t ids[NUM_KEYS];
+  marisa_trie *trie = BuildTrie(ids);
+
+  marisa_predictive_iter *iter = NULL;
+  ASSERT(marisa_trie_predictive_iter(trie, "app", 3, &iter) == MARISA_OK);
+
+  uint32_t found_ids[2];
+  char buf[11];
+  size_t offsets[3];
+  size_t num_results = 0;
+  ASSERT(marisa_predictive_iter_next(iter, found_ids, buf, sizeof(buf),
+                                     offsets, 2, &num_results) == MARISA_OK);
+  ASSERT(num_results == 2);
+  ASSERT(found_ids[0] == ids[2]);
+  ASSERT(found_ids[1] == ids[0]);
+  ASSERT(memcmp(buf, "appapple", offsets[2]) == 0);
+
+  ASSERT(marisa_predictive_iter_next(iter, found_ids, buf, 5, offsets, 2,
+                                     &num_results) == MARISA_SIZE_ERROR);
+  ASSERT(marisa_predictive_iter_next(iter, found_ids, buf, sizeof(buf),
+                                     offsets, 2, &num_results) == MARISA_OK);
+  ASSERT(num_results == 1);
+  ASSERT(found_ids[0] == ids[1]);
+  ASSERT(memcmp(buf, "application", 11) == 0);
+  ASSERT(marisa_predictive_iter_next(iter, found_ids, buf, sizeof(buf),
+                                     offsets, 2, &num_results) == MARISA_OK);
+  ASSERT(num_results == 0);
+
+  marisa_predictive_iter_free(iter);
+  marisa_trie_free(trie);
+
+  TEST_END();
+}
+
+static void TestPredictiveIterExtend(void) {
+  TEST_START();
+
+  uint32_t ids[NUM_KEYS];
+  marisa_trie *trie = BuildTrie(ids);
+
+  marisa_predictive_iter *iter = NULL;
+  ASSERT(marisa_trie_predictive_iter(trie, "", 0, &iter) == MARISA_OK);
+
+  uint32_t found_ids[NUM_KEYS];
+  char buf[32];
+  size_t offsets[NUM_KEYS + 1];
+  size_t num_results = 0;
+  ASSERT(marisa_predictive_iter_next(iter, found_ids, buf, sizeof(buf),
+                                     offsets, 1, &num_results) == MARISA_OK);
+  ASSERT(num_results == 1);
+
+  ASSERT(marisa_predictive_iter_extend(iter, "ap", 2) == MARISA_OK);
+  ASSERT(marisa_predictive_iter_next(iter, found_ids, buf, sizeof(buf),
+                                     offsets, NUM_KEYS,
+                                     &num_results) == MARISA_OK);
+  ASSERT(num_results == 3);
+  ASSERT(found_ids[0] == ids[2]);
+
+  ASSERT(marisa_predictive_iter_extend(iter, "pli", 3) == MARISA_OK);
+  ASSERT(marisa_predictive_iter_next(iter, found_ids, buf, sizeof(buf),
+                                     offsets, NUM_KEYS,
+                                     &num_results) == MARISA_OK);
+  ASSERT(num_results == 1);
+  ASSERT(found_ids[0] == ids[1]);
+
+  ASSERT(marisa_predictive_iter_extend(iter, "x", 1) == MARISA_OK);
+  ASSERT(marisa_predictive_iter_next(iter, found_ids, buf, sizeof(buf),
+                                     offsets, NUM_KEYS,
+                                     &num_results) == MARISA_OK);
+  ASSERT(num_results == 0);
+  ASSERT(marisa_predictive_iter_extend(NULL, "x", 1) == MARISA_NULL_ERROR);
+
+  marisa_predictive_iter_free(iter);
+  marisa_trie_free(trie);
+
+  TEST_END();
+}
+
+static void TestPredictiveIterFrontCoded(void) {
+  TEST_START();
+
+  uint32_t ids[NUM_KEYS];
+  marisa_trie *trie = BuildTrie(ids);
+
+  marisa_predictive_iter *iter = NULL;
+  ASSERT(marisa_trie_predictive_iter(trie, "app", 3, &iter) == MARISA_OK);
+
+  // "app" is {0, 3, "app"} and "apple" is {3, 2, "le"}.
+  uint32_t found_ids[3];
+  char block[16];
+  size_t num_results = 0;
+  size_t block_size = 0;
+  ASSERT(marisa_predictive_iter_next_front_coded(
+             iter, found_ids, block, 9, 3, &num_results, &block_size) ==
+         MARISA_OK);
+  ASSERT(num_results == 2);
+  ASSERT(block_size == 9);
+  ASSERT(found_ids[0] == ids[2]);
+  ASSERT(found_ids[1] == ids[0]);
+  ASSERT(memcmp(block, "\0\3app\3\2le", 9) == 0);
+
+  char buf[11];
+  size_t offsets[4];
+  size_t num_keys = 0;
+  ASSERT(marisa_front_coded_decode(block, block_size, buf, sizeof(buf),
+                                   offsets, 3, &num_keys) == MARISA_OK);
+  ASSERT(num_keys == 2);
+  ASSERT(offsets[1] == 3);
+  ASSERT(offsets[2] == 8);
+  ASSERT(memcmp(buf, "appapple", 8) == 0);
+  ASSERT(marisa_front_coded_decode(block, block_size, buf, 5, offsets, 3,
+                                   &num_keys) == MARISA_SIZE_ERROR);
+
+  // The next block starts with the whole key.
+  ASSERT(marisa_predictive_iter_next_front_coded(
+             iter, found_ids, block, 5, 3, &num_results, &block_size) ==
+         MARISA_SIZE_ERROR);
+  ASSERT(marisa_predictive_iter_next_front_coded(
+             iter, found_ids, block, sizeof(block), 3, &num_results,
+             &block_size) == MARISA_OK);
+  ASSERT(num_results == 1);
+  ASSERT(block_size == 13);
+  ASSERT(found_ids[0] == ids[1]);
+  ASSERT(marisa_predictive_iter_next_front_coded(
+             iter, found_ids, block, sizeof(block), 3, &num_results,
+             &block_size) == MARISA_OK);
+  ASSERT(num_results == 0);
+  ASSERT(block_size == 0);
+
+  const char broken[] = {0, 2, 'a'};
+  ASSERT(marisa_front_coded_decode(broken, sizeof(broken), buf, sizeof(buf),
+                                   offsets, 3, &num_keys) ==
+         MARISA_FORMAT_ERROR);
+
+  marisa_predictive_iter_free(iter);
+  marisa_trie_free(trie);
+
+  TEST_END();
+}
+
+static void TestSaveAndMap(void) {
+  TEST_START();
+
+  uint32_t ids[NUM_KEYS];
+  marisa_trie *trie = BuildTrie(ids);
+  ASSERT(marisa_trie_save(trie, "c-api-test.dat", 0) == MARISA_OK);
+  const size_t io_size = marisa_trie_io_size(trie);
+  marisa_trie_free(trie);
+
+  ASSERT(marisa_trie_new(&trie) == MARISA_OK);
+  ASSERT(marisa_trie_mmap(trie, "c-api-test.dat", 0) == MARISA_OK);
+  ASSERT(marisa_trie_num_keys(trie) == NUM_KEYS);
+  marisa_trie_free(trie);
+
+  FILE *file = fopen("c-api-test.dat", "rb");
+  ASSERT(file != NULL);
+  char *data = (char *)malloc(io_size);
+  ASSERT(fread(data, 1, io_size, file) == io_size);
+  fclose(file);
+
+  ASSERT(marisa_trie_new(&trie) == MARISA_OK);
+  ASSERT(marisa_trie_map(trie, data, io_size) == MARISA_OK);
+  uint32_t found_ids[NUM_KEYS];
+  ASSERT(marisa_trie_lookup_batch(trie, KEYS, OFFSETS, NUM_KEYS, found_ids) ==
+         MARISA_OK);
+  for (size_t i = 0; i < NUM_KEYS; ++i) {
+    ASSERT(found_ids[i] == ids[i]);
+  }
+  marisa_trie_free(trie);
+  free(data);
+
+  TEST_END();
+}
+
+int main(void) {
+  TestErrors();
+  TestQueryErrors();
+  TestLookup();
+  TestCommonPrefixSearch();
+  TestPredictiveIter();
+  TestPredictiveIterExtend();
+  TestPredictiveIterFrontCoded();
+  TestSaveAndMap();
+  return 0;
+}
@@ -10,9 +10,13 @@
 #include <sys/types.h>
 
 #include <cstdint>
+#include <cstring>
 #include <exception>
+#include <memory>
 #include <sstream>
 #include <stdexcept>
+#include <string>
+#include <system_error>
 
 #include "marisa-assert.h"
 
@@ -258,6 +262,169 @@ void TestStream() {
   TEST_END();
 }
 
+void TestAtomicFile() {
+  TEST_START();
+
+  {
+    marisa::grimoire::Writer writer;
+    writer.open("io-test.dat");
+    writer.write(std::uint32_t{123});
+  }
+
+  {
+    marisa::grimoire::AtomicFile file;
+    file.open("io-test.dat");
+    ASSERT(file.is_open());
+
+    marisa::grimoire::Writer writer;
+    writer.open(file.fd(), 16);
+    writer.write(std::uint32_t{234});
+    const double values[] = {3.45, 4.56, 5.67};
+    writer.write(values, 3);
+    writer.write(std::uint32_t{345});
+    writer.flush();
+
+    marisa::grimoire::Reader reader;
+    reader.open("io-test.dat");
+    std::uint32_t value;
+    reader.read(&value);
+    ASSERT(value == 123);
+
+    file.commit();
+    ASSERT(!file.is_open());
+    EXCEPT(file.commit(), std::logic_error);
+  }
+
+  {
+    marisa::grimoire::Reader reader;
+    reader.open("io-test.dat");
+
+    std::uint32_t value;
+    reader.read(&value);
+    ASSERT(value == 234);
+
+    double values[3];
+    reader.read(values, 3);
+    ASSERT(values[0] == 3.45);
+    ASSERT(values[1] == 4.56);
+    ASSERT(values[2] == 5.67);
+
+    reader.read(&value);
+    ASSERT(value == 345);
+
+    char byte;
+    EXCEPT(reader.read(&byte), std::runtime_error);
+  }
+
+  {
+    marisa::grimoire::AtomicFile file;
+    file.open("io-test.dat");
+
+    marisa::grimoire::Writer writer;
+    writer.open(file.fd(), 16);
+    writer.write(std::uint32_t{456});
+    writer.flush();
+  }
+
+  {
+    marisa::grimoire::Reader reader;
+    reader.open("io-test.dat");
+
+    std::uint32_t value;
+    reader.read(&value);
+    ASSERT(value == 234);
+  }
+
+#ifndef _MSC_VER
+  // A replaced file keeps its permission bits.
+  {
+    ASSERT(::chmod("io-test.dat", 0600) == 0);
+    marisa::grimoire::AtomicFile file;
+    file.open("io-test.dat");
+    file.commit();
+
+    struct stat st;
+    ASSERT(::stat("io-test.dat", &st) == 0);
+    ASSERT((st.st_mode & 0777) == 0600);
+  }
+#endif  // _MSC_VER
+
+  {
+    marisa::grimoire::AtomicFile file;
+    EXCEPT(file.open(nullptr), std::invalid_argument);
+    EXCEPT(file.open("io-test.d/io-test.dat"), std::system_error);
+    ASSERT(!file.is_open());
+  }
+
+  TEST_END();
+}
+
+void TestCompressor() {
+  TEST_START();
+
+  std::string image;
+  for (std::uint32_t i = 0; i < 100000; ++i) {
+    image += std::to_string(i % 1000);
+  }
+
+  if (!marisa::grimoire::Compressor::has_codec(MARISA_DEFAULT_CODEC)) {
+    marisa::grimoire::Writer writer;
+    std::stringstream stream;
+    writer.open(stream);
+    EXCEPT(marisa::grimoire::Compressor::write(writer, image.data(),
+                                               image.size(),
+                                               MARISA_DEFAULT_CODEC),
+           std::invalid_argument);
+    TEST_END();
+    return;
+  }
+
+  for (int codec = MARISA_DEFAULT_CODEC; codec <= MARISA_LZ4_CODEC; ++codec) {
+    if (!marisa::grimoire::Compressor::has_codec(
+            static_cast<marisa_codec>(codec))) {
+      continue;
+    }
+
+    std::stringstream stream;
+    {
+      marisa::grimoire::Writer writer;
+      writer.open(stream);
+      marisa::grimoire::Compressor::write(writer, image.data(), image.size(),
+                                          static_cast<marisa_codec>(codec), 4,
+                                          4096);
+    }
+    ASSERT(stream.str().size() < image.size());
+
+    {
+      marisa::grimoire::Reader reader;
+      reader.open(stream);
+      std::size_t size = 0;
+      std::unique_ptr<std::uint64_t[]> buf =
+          marisa::grimoire::Compressor::read(reader, &size, 4);
+      ASSERT(size == image.size());
+      ASSERT(std::memcmp(buf.get(), image.data(), size) == 0);
+
+      marisa::grimoire::Mapper mapper;
+      mapper.open(std::move(buf), size);
+      const char *ptr;
+      mapper.map(&ptr, size);
+      ASSERT(std::memcmp(ptr, image.data(), size) == 0);
+    }
+
+    std::string broken = stream.str();
+    broken[broken.size() / 2] ^= 0x55;
+    broken.resize(broken.size() - 1);
+    std::stringstream broken_stream(broken);
+    marisa::grimoire::Reader reader;
+    reader.open(broken_stream);
+    std::size_t size = 0;
+    EXCEPT(marisa::grimoire::Compressor::read(reader, &size),
+           std::runtime_error);
+  }
+
+  TEST_END();
+}
+
 }  // namespace
 
 int main() try {
@@ -265,6 +432,8 @@ int main() try {
   TestFd();
   TestFile();
   TestStream();
+  TestAtomicFile();
+  TestCompressor();
 
   return 0;
 } catch (const std::exception &ex) {
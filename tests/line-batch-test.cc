@@ -0,0 +1,205 @@
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "line-batch.h"
+#include "marisa-assert.h"
+
+namespace {
+
+std::random_device seed_gen;
+std::mt19937 random_engine(seed_gen());
+
+// SplitLines() is a naive split_lines().
+std::vector<std::string> SplitLines(const std::string &data) {
+  std::vector<std::string> lines;
+  std::size_t begin = 0;
+  while (begin < data.size()) {
+    std::size_t end = data.find('\n', begin);
+    if (end == std::string::npos) {
+      end = data.size();
+    }
+    lines.push_back(data.substr(begin, end - begin));
+    begin = end + 1;
+  }
+  return lines;
+}
+
+// RunLineBatch() returns the output of run_line_batch() for `input`, where
+// each line is written in brackets.
+std::string RunLineBatch(const std::string &input, std::size_t num_threads,
+                         std::size_t chunk_size) {
+  std::FILE *input_file = std::tmpfile();
+  std::FILE *output_file = std::tmpfile();
+  ASSERT(input_file != nullptr);
+  ASSERT(output_file != nullptr);
+  ASSERT(std::fwrite(input.data(), 1, input.size(), input_file) ==
+         input.size());
+  std::rewind(input_file);
+
+  run_line_batch(
+      input_file, output_file, num_threads,
+      [num_threads](std::size_t worker_id, std::string_view line,
+                    std::string *out) {
+        ASSERT(worker_id < num_threads);
+        out->push_back('[');
+        out->append(line);
+        out->append("]\n");
+      },
+      chunk_size);
+
+  std::string output(static_cast<std::size_t>(std::ftell(output_file)), '\0');
+  std::rewind(output_file);
+  ASSERT(std::fread(output.data(), 1, output.size(), output_file) ==
+         output.size());
+  std::fclose(input_file);
+  std::fclose(output_file);
+  return output;
+}
+
+std::string Bracket(const std::vector<std::string> &lines) {
+  std::string output;
+  for (const std::string &line : lines) {
+    output += "[" + line + "]\n";
+  }
+  return output;
+}
+
+void TestSplitLines() {
+  TEST_START();
+
+  const std::string data = "apple\n\nbanana\r\ncherry\n\n\ndate";
+  const std::vector<std::string> expected = SplitLines(data);
+  ASSERT(expected.size() == 7);
+  ASSERT(expected[2] == "banana\r");
+  for (std::size_t num_tasks = 1; num_tasks <= 40; ++num_tasks) {
+    // Each task keeps its lines in order, and the tasks cover the lines in
+    // order without overlap.
+    std::vector<std::vector<std::string>> tasks(num_tasks);
+    split_lines(data.data(), data.size(), num_tasks, 3,
+                [&tasks](std::size_t worker_id, std::size_t task_id,
+                         std::string_view line) {
+                  ASSERT(worker_id < 3);
+                  tasks[task_id].emplace_back(line);
+                });
+    std::vector<std::string> lines;
+    for (const std::vector<std::string> &task : tasks) {
+      lines.insert(lines.end(), task.begin(), task.end());
+    }
+    ASSERT(lines == expected);
+  }
+
+  std::size_t num_lines = 0;
+  split_lines(nullptr, 0, 4, 2,
+              [&num_lines](std::size_t, std::size_t, std::string_view) {
+                ++num_lines;
+              });
+  ASSERT(num_lines == 0);
+
+  TEST_END();
+}
+
+void TestRunLineBatch() {
+  TEST_START();
+
+  for (std::size_t num_threads = 1; num_threads <= 4; ++num_threads) {
+    for (std::size_t chunk_size = 1; chunk_size <= 8; ++chunk_size) {
+      ASSERT(RunLineBatch("", num_threads, chunk_size).empty());
+      ASSERT(RunLineBatch("a\nbc\ndef\n", num_threads, chunk_size) ==
+             "[a]\n[bc]\n[def]\n");
+
+      // The last line may lack '\n'.
+      ASSERT(RunLineBatch("a\nbc", num_threads, chunk_size) ==
+             "[a]\n[bc]\n");
+      ASSERT(RunLineBatch("abc", num_threads, chunk_size) == "[abc]\n");
+
+      // Empty lines are processed.
+      ASSERT(RunLineBatch("\n", num_threads, chunk_size) == "[]\n");
+      ASSERT(RunLineBatch("\n\na\n\n", num_threads, chunk_size) ==
+             "[]\n[]\n[a]\n[]\n");
+
+      // '\r' is a part of a line, as with std::getline().
+      ASSERT(RunLineBatch("a\r\nbc\r\n\r\n", num_threads, chunk_size) ==
+             "[a\r]\n[bc\r]\n[\r]\n");
+    }
+
+    // A line longer than a chunk is read whole.
+    const std::string long_line(1000, 'x');
+    ASSERT(RunLineBatch(long_line, num_threads, 7) == ("[" + long_line +
+                                                       "]\n"));
+    ASSERT(RunLineBatch("a\n" + long_line + "\nb\n", num_threads, 7) ==
+           ("[a]\n[" + long_line + "]\n[b]\n"));
+  }
+
+  // Random lines, including empty and long ones, come out in order.
+  for (int i = 0; i < 50; ++i) {
+    std::string input;
+    const std::size_t num_lines = random_engine() % 200;
+    for (std::size_t j = 0; j < num_lines; ++j) {
+      const std::size_t length = ((random_engine() % 10) == 0)
+                                     ? (random_engine() % 500)
+                                     : (random_engine() % 8);
+      for (std::size_t k = 0; k < length; ++k) {
+        input.push_back(static_cast<char>('a' + (random_engine() % 3)));
+      }
+      if (((j + 1) != num_lines) || ((random_engine() % 2) == 0)) {
+        input.push_back('\n');
+      }
+    }
+    const std::size_t num_threads = 1 + (random_engine() % 8);
+    const std::size_t chunk_size = 1 + (random_engine() % 256);
+    ASSERT(RunLineBatch(input, num_threads, chunk_size) ==
+           Bracket(SplitLines(input)));
+  }
+
+  TEST_END();
+}
+
+#if MARISA_USE_EXCEPTIONS
+void TestRunLineBatchError() {
+  TEST_START();
+
+  std::FILE *input_file = std::tmpfile();
+  std::FILE *output_file = std::tmpfile();
+  ASSERT(input_file != nullptr);
+  ASSERT(output_file != nullptr);
+  const std::string input = "a\nb\nerror\nc\n";
+  ASSERT(std::fwrite(input.data(), 1, input.size(), input_file) ==
+         input.size());
+  std::rewind(input_file);
+
+  // An exception thrown by a processor is rethrown.
+  EXCEPT(run_line_batch(input_file, output_file, 4,
+                        [](std::size_t, std::string_view line, std::string *) {
+                          if (line == "error") {
+                            throw std::invalid_argument("error");
+                          }
+                        }),
+         std::invalid_argument);
+  std::fclose(input_file);
+  std::fclose(output_file);
+
+  TEST_END();
+}
+#endif  // MARISA_USE_EXCEPTIONS
+
+}  // namespace
+
+int main() try {
+  TestSplitLines();
+  TestRunLineBatch();
+#if MARISA_USE_EXCEPTIONS
+  TestRunLineBatchError();
+#endif  // MARISA_USE_EXCEPTIONS
+
+  return 0;
+} catch (const std::exception &ex) {
+  std::cerr << ex.what() << "\n";
+  throw;
+}
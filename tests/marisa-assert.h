@@ -1,6 +1,8 @@
 #ifndef MARISA_ASSERT_H_
 #define MARISA_ASSERT_H_
 
+#include <marisa/base.h>
+
 #include <cstdlib>
 #include <iostream>
 
@@ -9,15 +11,27 @@
                                    << "' failed.\n"),                      \
                         std::exit(-1), 0))
 
-#define EXCEPT(code, expected_error_type)                               \
-  try {                                                                 \
-    code;                                                               \
-    std::cout << __LINE__ << ": Exception `" << #code << "' failed.\n"; \
-    std::exit(-1);                                                      \
-  } catch (const expected_error_type &) {                               \
-  } catch (...) {                                                       \
-    ASSERT(false);                                                      \
-  }
+// EXCEPT checks that `code` throws `expected_error_type`. If the library is
+// built without exceptions, errors abort instead, so `code` is compiled but
+// not run.
+#if MARISA_USE_EXCEPTIONS
+ #define EXCEPT(code, expected_error_type)                               \
+   try {                                                                 \
+     code;                                                               \
+     std::cout << __LINE__ << ": Exception `" << #code << "' failed.\n"; \
+     std::exit(-1);                                                      \
+   } catch (const expected_error_type &) {                               \
+   } catch (...) {                                                       \
+     ASSERT(false);                                                      \
+   }
+#else  // MARISA_USE_EXCEPTIONS
+ #define EXCEPT(code, expected_error_type) \
+   do {                                    \
+     if (false) {                          \
+       code;                               \
+     }                                     \
+   } while (false)
+#endif  // MARISA_USE_EXCEPTIONS
 
 #define TEST_START() \
   (std::cout << __FILE__ << ":" << __LINE__ << ": " << __FUNCTION__ << "(): ")
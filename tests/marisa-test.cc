@@ -1,13 +1,24 @@
 #include <marisa.h>
+#include <marisa/async-trie.h>
+#include <marisa/cached-trie.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
 #include <exception>
+#include <limits>
+#include <map>
+#include <memory>
 #include <random>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -23,11 +34,12 @@ void TestEmptyTrie() {
 
   marisa::Trie trie;
 
-  EXCEPT(trie.save("marisa-test.dat"), std::logic_error);
+  marisa::TrieSerializer serializer(trie);
+  EXCEPT(serializer.save("marisa-test.dat"), std::logic_error);
 #ifdef _MSC_VER
-  EXCEPT(trie.write(::_fileno(stdout)), std::logic_error);
+  EXCEPT(serializer.write(::_fileno(stdout)), std::logic_error);
 #else   // _MSC_VER
-  EXCEPT(trie.write(::fileno(stdout)), std::logic_error);
+  EXCEPT(serializer.write(::fileno(stdout)), std::logic_error);
 #endif  // _MSC_VER
   EXCEPT(std::cout << trie, std::logic_error);
   EXCEPT(marisa::fwrite(stdout, trie), std::logic_error);
@@ -92,6 +104,60 @@ void TestEmptyTrie() {
   TEST_END();
 }
 
+// The try_ queries report errors in the same way if the library is built
+// without exceptions.
+void TestTryQueryErrors() {
+  TEST_START();
+
+  marisa::Trie trie;
+  marisa::Agent agent;
+  bool found = true;
+
+  agent.set_query("apple");
+  ASSERT(trie.try_lookup(agent, &found) == MARISA_STATE_ERROR);
+  ASSERT(trie.try_common_prefix_search(agent, &found) == MARISA_STATE_ERROR);
+  ASSERT(trie.try_predictive_search(agent, &found) == MARISA_STATE_ERROR);
+  agent.set_query(std::size_t{0});
+  ASSERT(trie.try_reverse_lookup(agent) == MARISA_STATE_ERROR);
+
+  marisa::Keyset keyset;
+  trie.build(keyset);
+
+  agent.set_query("apple");
+  ASSERT(trie.try_lookup(agent, &found) == MARISA_OK);
+  ASSERT(!found);
+  found = true;
+  ASSERT(trie.try_common_prefix_search(agent, &found) == MARISA_OK);
+  ASSERT(!found);
+  found = true;
+  ASSERT(trie.try_predictive_search(agent, &found) == MARISA_OK);
+  ASSERT(!found);
+  agent.set_query(std::size_t{0});
+  ASSERT(trie.try_reverse_lookup(agent) == MARISA_BOUND_ERROR);
+
+  keyset.push_back("apple");
+  keyset.push_back("banana");
+  trie.build(keyset);
+
+  agent.set_query("apple");
+  ASSERT(trie.try_lookup(agent, &found) == MARISA_OK);
+  ASSERT(found);
+  const std::size_t id = agent.key().id();
+  agent.set_query(id);
+  ASSERT(trie.try_reverse_lookup(agent) == MARISA_OK);
+  ASSERT(agent.key().str() == "apple");
+  agent.set_query(std::size_t{2});
+  ASSERT(trie.try_reverse_lookup(agent) == MARISA_BOUND_ERROR);
+  agent.set_query(SIZE_MAX);
+  ASSERT(trie.try_reverse_lookup(agent) == MARISA_BOUND_ERROR);
+
+  trie.clear();
+  agent.set_query("apple");
+  ASSERT(trie.try_lookup(agent, &found) == MARISA_STATE_ERROR);
+
+  TEST_END();
+}
+
 void TestTinyTrie() {
   TEST_START();
 
@@ -349,6 +415,30 @@ void TestPredictiveSearchAgentMove(const marisa::Trie &trie,
   }
 }
 
+void TestTryQueries(const marisa::Trie &trie, const marisa::Keyset &keyset) {
+  marisa::Agent agent;
+  bool found = false;
+  for (std::size_t i = 0; i < keyset.size(); ++i) {
+    agent.set_query(keyset[i].ptr(), keyset[i].length());
+    ASSERT(trie.try_lookup(agent, &found) == MARISA_OK);
+    ASSERT(found);
+    ASSERT(agent.key().id() == keyset[i].id());
+
+    agent.set_query(keyset[i].id());
+    ASSERT(trie.try_reverse_lookup(agent) == MARISA_OK);
+    ASSERT(agent.key().length() == keyset[i].length());
+
+    agent.set_query(keyset[i].ptr(), keyset[i].length());
+    ASSERT(trie.try_common_prefix_search(agent, &found) == MARISA_OK);
+    ASSERT(found);
+    ASSERT(trie.try_predictive_search(agent, &found) == MARISA_OK);
+    ASSERT(found);
+  }
+
+  agent.set_query(trie.num_keys());
+  ASSERT(trie.try_reverse_lookup(agent) == MARISA_BOUND_ERROR);
+}
+
 void TestTrie(int num_tries, marisa::TailMode tail_mode,
               marisa::NodeOrder node_order, marisa::Keyset &keyset) {
   for (std::size_t i = 0; i < keyset.size(); ++i) {
@@ -370,11 +460,12 @@ void TestTrie(int num_tries, marisa::TailMode tail_mode,
   TestPredictiveSearch(trie, keyset);
   TestPredictiveSearchAgentCopy(trie, keyset);
   TestPredictiveSearchAgentMove(trie, keyset);
+  TestTryQueries(trie, keyset);
 
-  trie.save("marisa-test.dat");
+  marisa::TrieSerializer(trie).save("marisa-test.dat");
 
   trie.clear();
-  trie.load("marisa-test.dat");
+  marisa::TrieSerializer(trie).load("marisa-test.dat");
 
   ASSERT(trie.num_tries() == static_cast<std::size_t>(num_tries));
   ASSERT(trie.num_keys() <= keyset.size());
@@ -414,7 +505,7 @@ void TestTrie(int num_tries, marisa::TailMode tail_mode,
   TestLookup(trie, keyset);
 
   trie.clear();
-  trie.mmap("marisa-test.dat");
+  marisa::TrieSerializer(trie).mmap("marisa-test.dat");
 
   ASSERT(trie.num_tries() == static_cast<std::size_t>(num_tries));
   ASSERT(trie.num_keys() <= keyset.size());
@@ -467,12 +558,1326 @@ void TestTrie() {
   TestTrie(MARISA_BINARY_TAIL);
 }
 
+void TestBuildFromKeys() {
+  TEST_START();
+
+  marisa::Keyset keyset;
+  MakeKeyset(1000, MARISA_TEXT_TAIL, &keyset);
+
+  std::vector<std::string_view> keys;
+  std::vector<float> weights;
+  for (std::size_t i = 0; i < keyset.size(); ++i) {
+    keys.emplace_back(keyset[i].ptr(), keyset[i].length());
+    weights.push_back(static_cast<float>(random_engine() % 100));
+    keyset[i].set_weight(weights.back());
+  }
+
+  marisa::Trie keyset_trie;
+  keyset_trie.build(keyset, MARISA_LABEL_ORDER);
+
+  marisa::Trie trie;
+  std::vector<marisa::uint32_t> ids(keys.size());
+  trie.build(keys.data(), keys.size(), weights.data(), MARISA_LABEL_ORDER,
+             ids.data());
+
+  ASSERT(trie.num_keys() == keyset_trie.num_keys());
+  ASSERT(trie.io_size() == keyset_trie.io_size());
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    ASSERT(ids[i] == keyset[i].id());
+  }
+  TestLookup(trie, keyset);
+
+  trie.build(keys.data(), keys.size(), nullptr, 0, nullptr);
+  ASSERT(trie.num_keys() == keyset_trie.num_keys());
+
+  EXCEPT(trie.build(nullptr, 1, nullptr, 0, nullptr), std::invalid_argument);
+
+#ifdef __cpp_lib_span
+  std::vector<marisa::uint32_t> span_ids(keys.size());
+  trie.build(keys, weights, MARISA_LABEL_ORDER, span_ids);
+  ASSERT(span_ids == ids);
+
+  trie.build(keys);
+  ASSERT(trie.num_keys() == keyset_trie.num_keys());
+
+  weights.pop_back();
+  EXCEPT(trie.build(keys, weights), std::invalid_argument);
+#endif  // __cpp_lib_span
+
+  TEST_END();
+}
+
+void TestCentroidTrie() {
+  TEST_START();
+
+  // Keys with long common prefixes make long paths, and binary keys test
+  // labels with '\0'.
+  marisa::Keyset keyset;
+  MakeKeyset(1000, MARISA_BINARY_TAIL, &keyset);
+  for (std::size_t i = 0; i < 1000; ++i) {
+    std::string key = "/usr/share/doc/";
+    for (std::size_t j = random_engine() % 4; j > 0; --j) {
+      key += std::to_string(random_engine() % 10) + "/";
+    }
+    key += std::to_string(random_engine() % 100);
+    keyset.push_back(key.c_str(), key.length());
+  }
+
+  marisa::Trie trie;
+  trie.build(keyset, MARISA_CENTROID_TRIE);
+
+  ASSERT(trie.trie_type() == MARISA_CENTROID_TRIE);
+  ASSERT(trie.num_tries() == 1);
+  ASSERT(trie.num_keys() <= keyset.size());
+  ASSERT(trie.num_nodes() <= trie.num_keys());
+
+  TestLookup(trie, keyset);
+  TestCommonPrefixSearch(trie, keyset);
+  TestCommonPrefixSearchAgentCopy(trie, keyset);
+  TestPredictiveSearch(trie, keyset);
+  TestPredictiveSearchAgentCopy(trie, keyset);
+  TestPredictiveSearchAgentMove(trie, keyset);
+  TestTryQueries(trie, keyset);
+
+  // Every key is enumerated once by a predictive search for "".
+  {
+    marisa::Agent agent;
+    agent.set_query("");
+    std::vector<bool> found(trie.num_keys(), false);
+    while (trie.predictive_search(agent)) {
+      ASSERT(!found[agent.key().id()]);
+      found[agent.key().id()] = true;
+    }
+    ASSERT(std::find(found.begin(), found.end(), false) == found.end());
+  }
+
+  const std::size_t io_size = trie.io_size();
+  marisa::TrieSerializer(trie).save("marisa-test.dat");
+
+  trie.clear();
+  ASSERT(trie.trie_type() == MARISA_LOUDS_TRIE);
+  marisa::TrieSerializer(trie).load("marisa-test.dat");
+  ASSERT(trie.trie_type() == MARISA_CENTROID_TRIE);
+  ASSERT(trie.io_size() == io_size);
+  TestLookup(trie, keyset);
+
+  trie.clear();
+  marisa::TrieSerializer(trie).mmap("marisa-test.dat");
+  ASSERT(trie.trie_type() == MARISA_CENTROID_TRIE);
+  TestLookup(trie, keyset);
+  TestPredictiveSearch(trie, keyset);
+
+  {
+    std::stringstream stream;
+    stream << trie;
+    trie.clear();
+    stream >> trie;
+  }
+  ASSERT(trie.trie_type() == MARISA_CENTROID_TRIE);
+  TestLookup(trie, keyset);
+
+  std::vector<std::string_view> keys;
+  for (std::size_t i = 0; i < keyset.size(); ++i) {
+    keys.emplace_back(keyset[i].ptr(), keyset[i].length());
+  }
+  std::vector<marisa::uint32_t> ids(keys.size());
+  marisa::Trie keys_trie;
+  keys_trie.build(keys.data(), keys.size(), nullptr, MARISA_CENTROID_TRIE,
+                  ids.data());
+  ASSERT(keys_trie.io_size() == io_size);
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    ASSERT(ids[i] == keyset[i].id());
+  }
+
+  EXCEPT(marisa::Trie::diff(trie, keys_trie, [](const marisa::KeyDiff &) {}),
+         std::logic_error);
+  EXCEPT(trie.build(keyset, MARISA_TRIE_TYPE_MASK), std::invalid_argument);
+
+  TEST_END();
+}
+
+void TestDfudsTrie() {
+  TEST_START();
+
+  marisa::Keyset keyset;
+  MakeKeyset(1000, MARISA_BINARY_TAIL, &keyset);
+  for (std::size_t i = 0; i < 1000; ++i) {
+    const std::string key =
+        "/home/" + std::to_string(random_engine() % 20) + "/" +
+        std::to_string(random_engine() % 1000);
+    keyset.push_back(key.c_str(), key.length());
+  }
+
+  for (const marisa::TailMode tail_mode :
+       {MARISA_TEXT_TAIL, MARISA_BINARY_TAIL}) {
+    marisa::Trie trie;
+    trie.build(keyset, static_cast<int>(MARISA_DFUDS_TRIE) | tail_mode);
+
+    ASSERT(trie.trie_type() == MARISA_DFUDS_TRIE);
+    ASSERT(trie.num_tries() == 1);
+    ASSERT(trie.tail_mode() == MARISA_BINARY_TAIL);
+    ASSERT(trie.node_order() == MARISA_LABEL_ORDER);
+    ASSERT(trie.num_keys() <= keyset.size());
+
+    TestLookup(trie, keyset);
+    TestCommonPrefixSearch(trie, keyset);
+    TestCommonPrefixSearchAgentCopy(trie, keyset);
+    TestPredictiveSearch(trie, keyset);
+    TestPredictiveSearchAgentCopy(trie, keyset);
+    TestPredictiveSearchAgentMove(trie, keyset);
+    TestTryQueries(trie, keyset);
+  }
+
+  // Without binary keys, the tail mode is kept.
+  marisa::Keyset text_keyset;
+  for (std::size_t i = 1000; i < keyset.size(); ++i) {
+    text_keyset.push_back(keyset[i].ptr(), keyset[i].length());
+  }
+  marisa::Trie trie;
+  trie.build(text_keyset,
+             static_cast<int>(MARISA_DFUDS_TRIE) | MARISA_TEXT_TAIL);
+  ASSERT(trie.tail_mode() == MARISA_TEXT_TAIL);
+  TestLookup(trie, text_keyset);
+
+  // The keys below a node have consecutive IDs in preorder.
+  {
+    marisa::Agent agent;
+    agent.set_query("/home/1");
+    std::size_t num_keys = 0;
+    std::size_t first_id = 0;
+    while (trie.predictive_search(agent)) {
+      if (num_keys == 0) {
+        first_id = agent.key().id();
+      }
+      ASSERT(agent.key().id() == (first_id + num_keys));
+      ++num_keys;
+    }
+    ASSERT(num_keys != 0);
+  }
+
+  // predictive_count() counts the keys of the subtree, and the other tries
+  // enumerate them. Queries may end inside a label or match nothing.
+  {
+    // Building a trie sets the IDs of the keyset, so another one is used.
+    marisa::Keyset louds_keyset;
+    for (std::size_t i = 0; i < text_keyset.size(); ++i) {
+      louds_keyset.push_back(text_keyset[i].ptr(), text_keyset[i].length());
+    }
+    marisa::Trie louds_trie;
+    louds_trie.build(louds_keyset);
+    std::vector<std::string> queries = {"", "/", "/home/1", "/home/1/",
+                                        "/x", "/home/1/1000"};
+    for (std::size_t i = 0; i < text_keyset.size(); i += 37) {
+      const std::string key(text_keyset[i].ptr(), text_keyset[i].length());
+      queries.push_back(key.substr(0, random_engine() % (key.length() + 1)));
+    }
+    marisa::Agent agent;
+    for (const std::string &query : queries) {
+      agent.set_query(query);
+      std::size_t num_keys = 0;
+      while (louds_trie.predictive_search(agent)) {
+        ++num_keys;
+      }
+      ASSERT(trie.predictive_count(agent) == num_keys);
+      ASSERT(louds_trie.predictive_count(agent) == num_keys);
+      for (std::size_t j = 0; j < num_keys; ++j) {
+        ASSERT(trie.predictive_search(agent));
+      }
+      ASSERT(!trie.predictive_search(agent));
+    }
+  }
+
+  const std::size_t io_size = trie.io_size();
+  marisa::TrieSerializer(trie).save("marisa-test.dat");
+
+  trie.clear();
+  marisa::TrieSerializer(trie).load("marisa-test.dat");
+  ASSERT(trie.trie_type() == MARISA_DFUDS_TRIE);
+  ASSERT(trie.io_size() == io_size);
+  TestLookup(trie, text_keyset);
+
+  trie.clear();
+  marisa::TrieSerializer(trie).mmap("marisa-test.dat");
+  ASSERT(trie.trie_type() == MARISA_DFUDS_TRIE);
+  TestLookup(trie, text_keyset);
+  TestPredictiveSearch(trie, text_keyset);
+
+  {
+    std::stringstream stream;
+    stream << trie;
+    trie.clear();
+    stream >> trie;
+  }
+  ASSERT(trie.trie_type() == MARISA_DFUDS_TRIE);
+  TestLookup(trie, text_keyset);
+
+  std::vector<std::string_view> keys;
+  for (std::size_t i = 0; i < text_keyset.size(); ++i) {
+    keys.emplace_back(text_keyset[i].ptr(), text_keyset[i].length());
+  }
+  std::vector<marisa::uint32_t> ids(keys.size());
+  marisa::Trie keys_trie;
+  keys_trie.build(keys.data(), keys.size(), nullptr,
+                  static_cast<int>(MARISA_DFUDS_TRIE) | MARISA_TEXT_TAIL,
+                  ids.data());
+  ASSERT(keys_trie.io_size() == io_size);
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    ASSERT(ids[i] == text_keyset[i].id());
+  }
+
+  EXCEPT(marisa::Trie::diff(trie, keys_trie, [](const marisa::KeyDiff &) {}),
+         std::logic_error);
+
+  TEST_END();
+}
+
+void TestFrontCoding() {
+  TEST_START();
+
+  marisa::Keyset keyset;
+  MakeKeyset(1000, MARISA_TEXT_TAIL, &keyset);
+  marisa::Trie trie;
+  trie.build(keyset, MARISA_LABEL_ORDER);
+
+  // A block of a small buffer ends before a key that doesn't fit, and the
+  // key begins the next block.
+  std::vector<std::string> keys;
+  std::vector<std::string> decoded_keys;
+  std::size_t num_bytes = 0;
+  std::size_t num_block_bytes = 0;
+  char buf[256];
+  marisa::FrontCodedWriter writer(buf, sizeof(buf));
+  marisa::Agent agent;
+  agent.set_query("");
+  while (trie.predictive_search(agent)) {
+    keys.emplace_back(agent.key().str());
+    num_bytes += agent.key().length();
+    if (!writer.append(agent.key().str())) {
+      ASSERT(writer.num_keys() != 0);
+      marisa::FrontCodedReader reader(buf, writer.size());
+      for (std::size_t i = 0; i < writer.num_keys(); ++i) {
+        ASSERT(reader.next());
+        decoded_keys.emplace_back(reader.key());
+      }
+      ASSERT(!reader.next());
+      num_block_bytes += writer.size();
+      writer.reset(buf, sizeof(buf));
+      ASSERT(writer.append(agent.key().str()));
+    }
+  }
+  marisa::FrontCodedReader reader(buf, writer.size());
+  while (reader.next()) {
+    decoded_keys.emplace_back(reader.key());
+  }
+  num_block_bytes += writer.size();
+  ASSERT(decoded_keys == keys);
+  ASSERT(num_block_bytes < num_bytes);
+
+  writer.reset(buf, 4);
+  ASSERT(!writer.append("abc"));
+  ASSERT(writer.append("ab"));
+  ASSERT(writer.size() == 4);
+  ASSERT(writer.num_keys() == 1);
+  ASSERT(!writer.append("abc"));
+  writer.reset(nullptr, 0);
+  ASSERT(!writer.append(""));
+
+  const char long_prefix[] = {'\x01', '\x00'};
+  reader = marisa::FrontCodedReader(long_prefix, sizeof(long_prefix));
+  EXCEPT(reader.next(), std::runtime_error);
+  const char long_suffix[] = {'\x00', '\x02', 'a'};
+  reader = marisa::FrontCodedReader(long_suffix, sizeof(long_suffix));
+  EXCEPT(reader.next(), std::runtime_error);
+  const char truncated[] = {'\x00', '\x80'};
+  reader = marisa::FrontCodedReader(truncated, sizeof(truncated));
+  EXCEPT(reader.next(), std::runtime_error);
+  const char truncated_prefix[] = {'\x81', '\x80'};
+  reader = marisa::FrontCodedReader(truncated_prefix,
+                                    sizeof(truncated_prefix));
+  EXCEPT(reader.next(), std::runtime_error);
+
+  // A varint is at most as long as std::size_t needs, and its last byte
+  // must not carry bits beyond std::size_t. The overflowing varint would
+  // otherwise decode to an empty prefix.
+  const int digits = std::numeric_limits<std::size_t>::digits;
+  const std::size_t max_varint_size = (digits + 6) / 7;
+  std::string overflow(max_varint_size - 1, '\x80');
+  overflow += static_cast<char>(1 << (digits - 7 * (max_varint_size - 1)));
+  overflow += '\x00';
+  reader = marisa::FrontCodedReader(overflow.data(), overflow.size());
+  EXCEPT(reader.next(), std::runtime_error);
+  std::string overlong(max_varint_size, '\x80');
+  overlong += '\x00';
+  overlong += '\x00';
+  reader = marisa::FrontCodedReader(overlong.data(), overlong.size());
+  EXCEPT(reader.next(), std::runtime_error);
+
+  // try_next() reports the same errors without exceptions.
+  bool found = true;
+  reader = marisa::FrontCodedReader(long_prefix, sizeof(long_prefix));
+  ASSERT(reader.try_next(&found) == MARISA_FORMAT_ERROR);
+  ASSERT(!found);
+  reader = marisa::FrontCodedReader(long_suffix, sizeof(long_suffix));
+  ASSERT(reader.try_next(&found) == MARISA_FORMAT_ERROR);
+  reader = marisa::FrontCodedReader(overflow.data(), overflow.size());
+  ASSERT(reader.try_next(&found) == MARISA_FORMAT_ERROR);
+  reader = marisa::FrontCodedReader(overlong.data(), overlong.size());
+  ASSERT(reader.try_next(&found) == MARISA_FORMAT_ERROR);
+  const char block[] = {'\x00', '\x02', 'a', 'b', '\x01', '\x00'};
+  reader = marisa::FrontCodedReader(block, sizeof(block));
+  ASSERT(reader.try_next(&found) == MARISA_OK);
+  ASSERT(found);
+  ASSERT(reader.key() == "ab");
+  ASSERT(reader.try_next(&found) == MARISA_OK);
+  ASSERT(found);
+  ASSERT(reader.key() == "a");
+  ASSERT(reader.try_next(&found) == MARISA_OK);
+  ASSERT(!found);
+
+  TEST_END();
+}
+
+void TestExtendQuery() {
+  TEST_START();
+
+  marisa::Keyset keyset;
+  MakeKeyset(1000, MARISA_TEXT_TAIL, &keyset);
+
+  const int configs[] = {
+      1 | MARISA_TEXT_TAIL | MARISA_LABEL_ORDER,
+      3 | MARISA_BINARY_TAIL | MARISA_TINY_CACHE,
+      MARISA_CENTROID_TRIE,
+      MARISA_DFUDS_TRIE,
+  };
+  for (int config : configs) {
+    marisa::Trie trie;
+    trie.build(keyset, config);
+
+    // A query is typed byte by byte, and each extended search is compared
+    // with a new search. A search is stopped after a few results, or before
+    // it starts, so that it is extended in any state. A query is a key with
+    // a byte that leaves the trie, which may be in the middle of a link.
+    for (std::size_t i = 0; i < 200; ++i) {
+      std::string query(keyset[i].str());
+      query.insert(random_engine() % (query.length() + 1), 1, 'x');
+      marisa::Agent agent;
+      for (std::size_t length = 0; length <= query.length(); ++length) {
+        agent.extend_query(query.data(), length);
+        marisa::Agent new_agent;
+        new_agent.set_query(query.data(), length);
+
+        const std::size_t max_num_results = random_engine() % 4;
+        for (std::size_t j = 0; (max_num_results == 3) || (j < max_num_results);
+             ++j) {
+          const bool found = trie.predictive_search(new_agent);
+          ASSERT(trie.predictive_search(agent) == found);
+          if (!found) {
+            break;
+          }
+          ASSERT(agent.key().id() == new_agent.key().id());
+          ASSERT(agent.key().str() == new_agent.key().str());
+        }
+      }
+    }
+  }
+
+  marisa::Agent agent;
+  agent.set_query("ab");
+  EXCEPT(agent.extend_query("a"), std::invalid_argument);
+
+  TEST_END();
+}
+
+void TestBuildReport() {
+  TEST_START();
+
+  marisa::Keyset keyset;
+  MakeKeyset(20000, MARISA_TEXT_TAIL, &keyset);
+
+  const int configs[] = {
+      1 | MARISA_TEXT_TAIL,
+      3 | MARISA_BINARY_TAIL | MARISA_LABEL_ORDER,
+      MARISA_CENTROID_TRIE,
+      MARISA_DFUDS_TRIE,
+  };
+  for (int config : configs) {
+    marisa::Trie trie;
+    marisa::BuildReport report;
+    report.push_back(marisa::BuildPhase());
+    trie.build(keyset, config, report);
+
+    // Every phase takes time and belongs to a trie, and every trie has
+    // phases. The report replaces the old phases.
+    ASSERT(!report.empty());
+    std::vector<bool> has_phases(trie.num_tries() + 1, false);
+    double total_seconds = 0.0;
+    std::size_t total_allocated_bytes = 0;
+    std::size_t peak_resident = 0;
+    for (const marisa::BuildPhase &phase : report.phases()) {
+      ASSERT(std::strlen(phase.name()) != 0);
+      ASSERT(phase.seconds() > 0.0);
+      ASSERT(phase.trie_id() >= 1);
+      ASSERT(phase.trie_id() <= trie.num_tries());
+      has_phases[phase.trie_id()] = true;
+      total_seconds += phase.seconds();
+      total_allocated_bytes += phase.allocated_bytes();
+      peak_resident = std::max(peak_resident, phase.peak_resident());
+    }
+    for (std::size_t trie_id = 1; trie_id <= trie.num_tries(); ++trie_id) {
+      ASSERT(has_phases[trie_id]);
+    }
+    ASSERT(report.total_seconds() == total_seconds);
+    ASSERT(report.total_allocated_bytes() == total_allocated_bytes);
+    ASSERT(report.total_allocated_bytes() != 0);
+    ASSERT(report.peak_resident() == peak_resident);
+    TestLookup(trie, keyset);
+  }
+
+#if MARISA_USE_EXCEPTIONS
+  // A build that runs during stack unwinding still records its phases.
+  struct BuildOnUnwind {
+    marisa::Keyset &keyset;
+    marisa::BuildReport &report;
+    ~BuildOnUnwind() {
+      marisa::Trie trie;
+      trie.build(keyset, 0, report);
+    }
+  };
+  marisa::BuildReport unwind_report;
+  try {
+    BuildOnUnwind build_on_unwind{keyset, unwind_report};
+    throw std::runtime_error("unwind");
+  } catch (const std::runtime_error &) {
+  }
+  ASSERT(!unwind_report.empty());
+#endif  // MARISA_USE_EXCEPTIONS
+
+  TEST_END();
+}
+
+void TestBuildCallback() {
+  TEST_START();
+
+  marisa::Keyset keyset;
+  MakeKeyset(20000, MARISA_TEXT_TAIL, &keyset);
+
+  const int configs[] = {
+      1 | MARISA_TEXT_TAIL,
+      3 | MARISA_BINARY_TAIL | MARISA_LABEL_ORDER,
+      MARISA_CENTROID_TRIE,
+      MARISA_DFUDS_TRIE,
+  };
+  for (int config : configs) {
+    // Progress counts up to the total of each phase.
+    std::vector<marisa::BuildProgress> progresses;
+    marisa::Trie trie;
+    marisa::BuildReport report;
+    trie.build(
+        keyset, config,
+        [&](const marisa::BuildProgress &progress) {
+          ASSERT(progress.done() <= progress.total());
+          if (!progresses.empty() &&
+              (std::strcmp(progresses.back().name(), progress.name()) == 0) &&
+              (progresses.back().trie_id() == progress.trie_id())) {
+            ASSERT(progress.done() >= progresses.back().done());
+            ASSERT(progress.total() == progresses.back().total());
+          }
+          progresses.push_back(progress);
+          return true;
+        },
+        &report);
+    ASSERT(!progresses.empty());
+    ASSERT(!report.empty());
+    for (const marisa::BuildProgress &progress : progresses) {
+      ASSERT(progress.trie_id() >= 1);
+      ASSERT(progress.trie_id() <= trie.num_tries());
+    }
+
+#if MARISA_USE_EXCEPTIONS
+    // A cancelled build throws BuildCancelled and leaves the trie, the
+    // keyset and the report unchanged, wherever it is cancelled.
+    const std::size_t num_keys = trie.num_keys();
+    const std::size_t num_nodes = trie.num_nodes();
+    std::vector<std::size_t> ids(keyset.size());
+    for (std::size_t i = 0; i < keyset.size(); ++i) {
+      ids[i] = keyset[i].id();
+    }
+    const std::size_t report_size = report.size();
+    for (std::size_t cancel_at :
+         {std::size_t{0}, progresses.size() / 2, progresses.size() - 1}) {
+      std::size_t num_calls = 0;
+      EXCEPT(trie.build(
+                 keyset, config ^ MARISA_LABEL_ORDER,
+                 [&](const marisa::BuildProgress &) {
+                   return num_calls++ != cancel_at;
+                 },
+                 &report),
+             marisa::BuildCancelled);
+      ASSERT(num_calls == (cancel_at + 1));
+      ASSERT(trie.num_keys() == num_keys);
+      ASSERT(trie.num_nodes() == num_nodes);
+      ASSERT(report.size() == report_size);
+      for (std::size_t i = 0; i < keyset.size(); ++i) {
+        ASSERT(keyset[i].id() == ids[i]);
+      }
+      TestLookup(trie, keyset);
+    }
+#endif  // MARISA_USE_EXCEPTIONS
+  }
+
+  TEST_END();
+}
+
+void TestRebuildCache() {
+  TEST_START();
+
+  marisa::Keyset keyset;
+  MakeKeyset(1000, MARISA_TEXT_TAIL, &keyset);
+  {
+    marisa::Trie trie;
+    trie.build(keyset, 3 | MARISA_TEXT_TAIL | MARISA_TINY_CACHE);
+    marisa::TrieSerializer(trie).save("marisa-test.dat");
+  }
+
+  const marisa::CacheLevel cache_levels[] = {
+      MARISA_HUGE_CACHE, MARISA_LARGE_CACHE, MARISA_NORMAL_CACHE,
+      MARISA_SMALL_CACHE, MARISA_TINY_CACHE,
+  };
+  for (bool mapped : {false, true}) {
+    marisa::Trie trie;
+    if (mapped) {
+      marisa::TrieSerializer(trie).mmap("marisa-test.dat");
+    } else {
+      marisa::TrieSerializer(trie).load("marisa-test.dat");
+    }
+
+    // Searches give the same results with any cache, and without one.
+    for (marisa::CacheLevel cache_level : cache_levels) {
+      trie.rebuild_cache(cache_level);
+      TestLookup(trie, keyset);
+      TestCommonPrefixSearch(trie, keyset);
+      TestPredictiveSearch(trie, keyset);
+    }
+    trie.rebuild_cache(MARISA_HUGE_CACHE);
+    const std::size_t huge_cache_size = trie.total_size();
+    trie.clear_cache();
+    ASSERT(trie.total_size() < huge_cache_size);
+    TestLookup(trie, keyset);
+    TestCommonPrefixSearch(trie, keyset);
+    TestPredictiveSearch(trie, keyset);
+
+    // The cache is rebuilt again after it is cleared.
+    trie.rebuild_cache(MARISA_NORMAL_CACHE);
+    TestLookup(trie, keyset);
+    TestPredictiveSearch(trie, keyset);
+  }
+
+  TEST_END();
+}
+
+// ReadImage() reads a file into 8-byte aligned memory.
+std::vector<std::uint64_t> ReadImage(const char *filename, std::size_t *size) {
+  std::FILE *file;
+#ifdef _MSC_VER
+  ASSERT(::fopen_s(&file, filename, "rb") == 0);
+#else   // _MSC_VER
+  file = std::fopen(filename, "rb");
+  ASSERT(file != nullptr);
+#endif  // _MSC_VER
+  std::string bytes;
+  char buf[4096];
+  std::size_t n;
+  while ((n = std::fread(buf, 1, sizeof(buf), file)) != 0) {
+    bytes.append(buf, n);
+  }
+  std::fclose(file);
+  std::vector<std::uint64_t> image((bytes.size() + 7) / 8);
+  std::memcpy(image.data(), bytes.data(), bytes.size());
+  *size = bytes.size();
+  return image;
+}
+
+void TestHotFirst() {
+  TEST_START();
+
+  marisa::Keyset keyset;
+  MakeKeyset(1000, MARISA_BINARY_TAIL, &keyset);
+
+  const int configs[] = {
+      1 | MARISA_TEXT_TAIL | MARISA_LABEL_ORDER,
+      3 | MARISA_BINARY_TAIL | MARISA_WEIGHT_ORDER,
+      4 | MARISA_BINARY_TAIL | MARISA_TINY_CACHE,
+  };
+  for (int config : configs) {
+    marisa::Trie trie;
+    trie.build(keyset, config);
+    marisa::TrieSerializer(trie).save("marisa-test.dat");
+    marisa::TrieSerializer(trie).save("marisa-test-hot.dat",
+                                      MARISA_SAVE_HOT_FIRST);
+
+    // The hot part is padded to a page, and the header tells the layout.
+    std::size_t size = 0;
+    std::size_t hot_size = 0;
+    const std::vector<std::uint64_t> image =
+        ReadImage("marisa-test.dat", &size);
+    const std::vector<std::uint64_t> hot_image =
+        ReadImage("marisa-test-hot.dat", &hot_size);
+    ASSERT(hot_size > size);
+    ASSERT(hot_size >= 4096);
+    ASSERT(std::memcmp(image.data(), hot_image.data(), 16) != 0);
+
+    marisa::Trie hot_trie;
+    marisa::TrieSerializer(hot_trie).mmap("marisa-test-hot.dat");
+    ASSERT(hot_trie.num_tries() == trie.num_tries());
+    ASSERT(hot_trie.num_keys() == trie.num_keys());
+    ASSERT(hot_trie.tail_mode() == trie.tail_mode());
+    ASSERT(hot_trie.node_order() == trie.node_order());
+    TestLookup(hot_trie, keyset);
+    TestCommonPrefixSearch(hot_trie, keyset);
+    TestPredictiveSearch(hot_trie, keyset);
+
+    hot_trie.clear();
+    marisa::TrieSerializer(hot_trie).map(hot_image.data(), hot_size);
+    TestLookup(hot_trie, keyset);
+    TestPredictiveSearch(hot_trie, keyset);
+
+    hot_trie.clear();
+    marisa::TrieSerializer(hot_trie).load("marisa-test-hot.dat");
+    ASSERT(hot_trie.num_keys() == trie.num_keys());
+    TestLookup(hot_trie, keyset);
+    TestCommonPrefixSearch(hot_trie, keyset);
+    TestPredictiveSearch(hot_trie, keyset);
+
+    // A trie read from a hot-first file is saved in either layout again.
+    marisa::TrieSerializer(hot_trie).save("marisa-test-hot.dat");
+    std::size_t resaved_size = 0;
+    const std::vector<std::uint64_t> resaved_image =
+        ReadImage("marisa-test-hot.dat", &resaved_size);
+    ASSERT(resaved_size == size);
+    ASSERT(std::memcmp(resaved_image.data(), image.data(), size) == 0);
+    marisa::TrieSerializer(hot_trie).save("marisa-test-hot.dat",
+                                          MARISA_SAVE_HOT_FIRST);
+    const std::vector<std::uint64_t> resaved_hot_image =
+        ReadImage("marisa-test-hot.dat", &resaved_size);
+    ASSERT(resaved_size == hot_size);
+    ASSERT(resaved_hot_image == hot_image);
+  }
+
+  // MARISA_SAVE_HOT_FIRST is ignored for the other backends.
+  for (int config : {static_cast<int>(MARISA_CENTROID_TRIE),
+                     static_cast<int>(MARISA_DFUDS_TRIE)}) {
+    marisa::Trie trie;
+    trie.build(keyset, config);
+    marisa::TrieSerializer(trie).save("marisa-test.dat");
+    marisa::TrieSerializer(trie).save("marisa-test-hot.dat",
+                                      MARISA_SAVE_HOT_FIRST);
+    std::size_t size = 0;
+    std::size_t hot_size = 0;
+    ASSERT(ReadImage("marisa-test.dat", &size) ==
+           ReadImage("marisa-test-hot.dat", &hot_size));
+    ASSERT(hot_size == size);
+  }
+
+  std::remove("marisa-test-hot.dat");
+
+  TEST_END();
+}
+
+void TestLegacyLayout() {
+  TEST_START();
+
+  // legacy-layout.dat was saved from these keys with MARISA_TINY_CACHE by a
+  // version that padded 8-byte aligned vectors with 8 extra bytes.
+  const char *const legacy_filename = MARISA_TEST_DATA_DIR
+      "/legacy-layout.dat";
+  marisa::Keyset keyset;
+  for (const char *key : {"apple", "banana", "cherry", "orange", "apricot"}) {
+    keyset.push_back(key);
+  }
+  marisa::Trie trie;
+  trie.build(keyset, MARISA_TINY_CACHE);
+  marisa::TrieSerializer(trie).save("marisa-test.dat");
+  std::size_t size = 0;
+  const std::vector<std::uint64_t> image = ReadImage("marisa-test.dat", &size);
+
+  std::size_t legacy_size = 0;
+  const std::vector<std::uint64_t> legacy_image =
+      ReadImage(legacy_filename, &legacy_size);
+  ASSERT(legacy_size > size);
+  ASSERT(std::memcmp(image.data(), legacy_image.data(), 16) != 0);
+
+  marisa::Trie legacy_trie;
+  marisa::TrieSerializer(legacy_trie).mmap(legacy_filename);
+  ASSERT(legacy_trie.num_tries() == trie.num_tries());
+  ASSERT(legacy_trie.num_keys() == trie.num_keys());
+  ASSERT(legacy_trie.num_nodes() == trie.num_nodes());
+  TestLookup(legacy_trie, keyset);
+  TestCommonPrefixSearch(legacy_trie, keyset);
+  TestPredictiveSearch(legacy_trie, keyset);
+
+  legacy_trie.clear();
+  marisa::TrieSerializer(legacy_trie).map(legacy_image.data(), legacy_size);
+  TestLookup(legacy_trie, keyset);
+
+  legacy_trie.clear();
+  marisa::TrieSerializer(legacy_trie).load(legacy_filename);
+  TestLookup(legacy_trie, keyset);
+  TestPredictiveSearch(legacy_trie, keyset);
+
+  // A legacy dictionary is saved in the current layout.
+  ASSERT(legacy_trie.io_size() == size);
+  marisa::TrieSerializer(legacy_trie).save("marisa-test.dat");
+  std::size_t resaved_size = 0;
+  const std::vector<std::uint64_t> resaved_image =
+      ReadImage("marisa-test.dat", &resaved_size);
+  ASSERT(resaved_size == size);
+  ASSERT(std::memcmp(resaved_image.data(), image.data(), 16) == 0);
+  legacy_trie.clear();
+  marisa::TrieSerializer(legacy_trie).mmap("marisa-test.dat");
+  TestLookup(legacy_trie, keyset);
+
+  TEST_END();
+}
+
+void WriteImage(const char *filename, const void *data, std::size_t size) {
+  std::FILE *file;
+#ifdef _MSC_VER
+  ASSERT(::fopen_s(&file, filename, "wb") == 0);
+#else   // _MSC_VER
+  file = std::fopen(filename, "wb");
+  ASSERT(file != nullptr);
+#endif  // _MSC_VER
+  ASSERT(std::fwrite(data, 1, size, file) == size);
+  std::fclose(file);
+}
+
+void TestCompressedTrie() {
+  TEST_START();
+
+  marisa::Keyset keyset;
+  MakeKeyset(1000, MARISA_TEXT_TAIL, &keyset);
+  marisa::Trie trie;
+  trie.build(keyset);
+
+  // An uncompressed dictionary is rejected, and the trie is left unchanged.
+  marisa::TrieSerializer(trie).save("marisa-test.dat");
+  EXCEPT(marisa::TrieSerializer(trie).load_compressed("marisa-test.dat"),
+         std::runtime_error);
+  TestLookup(trie, keyset);
+
+  if (!marisa::TrieSerializer::has_codec(MARISA_DEFAULT_CODEC)) {
+    EXCEPT(marisa::TrieSerializer(trie).save_compressed("marisa-test.dat"),
+           std::invalid_argument);
+    TEST_END();
+    return;
+  }
+
+  const int configs[] = {
+      1 | MARISA_TEXT_TAIL,
+      3 | MARISA_BINARY_TAIL | MARISA_WEIGHT_ORDER,
+      MARISA_CENTROID_TRIE,
+      MARISA_DFUDS_TRIE,
+  };
+  for (int config : configs) {
+    for (int flags : {0, static_cast<int>(MARISA_SAVE_HOT_FIRST)}) {
+      marisa::Trie saved_trie;
+      saved_trie.build(keyset, config);
+      marisa::TrieSerializer(saved_trie).save_compressed("marisa-test.dat",
+                                                         flags);
+
+      marisa::Trie loaded_trie;
+      marisa::TrieSerializer(loaded_trie).load_compressed("marisa-test.dat",
+                                                          2);
+      ASSERT(loaded_trie.num_keys() == saved_trie.num_keys());
+      ASSERT(loaded_trie.io_size() == saved_trie.io_size());
+      TestLookup(loaded_trie, keyset);
+      TestPredictiveSearch(loaded_trie, keyset);
+    }
+  }
+
+  // The header is followed by the codec, a reserved field, the image size,
+  // the chunk size, the number of chunks and the size of each chunk.
+  marisa::TrieSerializer(trie).save_compressed("marisa-test.dat");
+  std::size_t size = 0;
+  const std::vector<std::uint64_t> image = ReadImage("marisa-test.dat", &size);
+  const struct {
+    std::size_t offset;
+    std::uint64_t value;
+  } corruptions[] = {
+      {0, 0},            // header
+      {16, 0},           // MARISA_DEFAULT_CODEC
+      {24, 0},           // image size
+      {24, UINT64_MAX},  // image size
+      {32, 0},           // chunk size
+      {40, 2},           // number of chunks
+      {48, UINT64_MAX},  // compressed chunk larger than the image implies
+  };
+  for (const auto &corruption : corruptions) {
+    std::vector<std::uint64_t> broken = image;
+    broken[corruption.offset / 8] = corruption.value;
+    WriteImage("marisa-test.dat", broken.data(), size);
+    marisa::Trie broken_trie;
+    EXCEPT(marisa::TrieSerializer(broken_trie)
+               .load_compressed("marisa-test.dat"),
+           std::runtime_error);
+  }
+
+  TEST_END();
+}
+
+void TestTrieFromImage() {
+  TEST_START();
+
+  marisa::Keyset keyset;
+  MakeKeyset(1000, MARISA_TEXT_TAIL, &keyset);
+
+  const int configs[] = {
+      1 | MARISA_TEXT_TAIL,
+      3 | MARISA_BINARY_TAIL,
+      MARISA_CENTROID_TRIE,
+      MARISA_DFUDS_TRIE,
+  };
+  for (int config : configs) {
+    {
+      marisa::Trie trie;
+      trie.build(keyset, config);
+      marisa::TrieSerializer(trie).save("marisa-test.dat");
+    }
+    std::size_t size = 0;
+    std::vector<std::uint64_t> image = ReadImage("marisa-test.dat", &size);
+
+    // A trie refers to the image in place.
+    {
+      const marisa::Trie trie(image.data(), size);
+      ASSERT(trie.num_keys() <= keyset.size());
+      TestLookup(trie, keyset);
+      TestCommonPrefixSearch(trie, keyset);
+      TestPredictiveSearch(trie, keyset);
+    }
+
+    // An unaligned pointer is rejected before the image is read.
+    std::vector<std::uint64_t> unaligned_image(image.size() + 1);
+    char *const unaligned =
+        reinterpret_cast<char *>(unaligned_image.data()) + 4;
+    std::memcpy(unaligned, image.data(), size);
+    EXCEPT(marisa::Trie(unaligned, size), std::invalid_argument);
+    EXCEPT(marisa::Trie(unaligned + 1, size), std::invalid_argument);
+
+    EXCEPT(marisa::Trie(image.data(), size / 2), std::runtime_error);
+  }
+  EXCEPT(marisa::Trie(nullptr, 16), std::invalid_argument);
+
+  TEST_END();
+}
+
+#ifdef MARISA_HAS_ASYNC_TRIE
+void TestAsyncTrie() {
+  TEST_START();
+
+  marisa::Keyset keyset;
+  MakeKeyset(1000, MARISA_TEXT_TAIL, &keyset);
+
+  // Queries are keys, prefixes of keys and keys with an extra byte, so that
+  // lookups fail at every step, including in links to TAIL and to the next
+  // tries.
+  std::vector<std::string> queries;
+  for (std::size_t i = 0; i < keyset.size(); ++i) {
+    const std::string key(keyset[i].str());
+    queries.push_back(key);
+    queries.push_back(key.substr(0, key.length() / 2));
+    queries.push_back(key + 'x');
+  }
+
+  const int configs[] = {
+      1 | MARISA_TEXT_TAIL,
+      1 | MARISA_BINARY_TAIL | MARISA_LABEL_ORDER,
+      3 | MARISA_TEXT_TAIL | MARISA_TINY_CACHE,
+      4 | MARISA_BINARY_TAIL,
+  };
+  for (int config : configs) {
+    marisa::Trie built_trie;
+    built_trie.build(keyset, config);
+    marisa::TrieSerializer(built_trie).save("marisa-test.dat");
+
+    for (bool mapped : {false, true}) {
+      marisa::Trie trie;
+      if (mapped) {
+        marisa::TrieSerializer(trie).mmap("marisa-test.dat");
+      } else {
+        marisa::TrieSerializer(trie).load("marisa-test.dat");
+      }
+      const marisa::AsyncTrie async_trie(trie);
+      ASSERT(&async_trie.trie() == &trie);
+
+      std::vector<marisa::Agent> agents(queries.size());
+      marisa::Agent agent;
+      std::size_t num_found = 0;
+      for (std::size_t i = 0; i < queries.size(); ++i) {
+        agent.set_query(queries[i]);
+        const bool found = trie.lookup(agent);
+        num_found += found ? 1 : 0;
+
+        agents[i].set_query(queries[i]);
+        marisa::LookupTask task = async_trie.lookup(agents[i]);
+        while (!task.done()) {
+          task.resume();
+        }
+        ASSERT(task.found() == found);
+        if (found) {
+          ASSERT(agents[i].key().id() == agent.key().id());
+          ASSERT(agents[i].key().str() == queries[i]);
+        }
+      }
+
+      // The batch overload interleaves lookups with the same results.
+      std::unique_ptr<bool[]> found(new bool[queries.size()]);
+      for (std::size_t i = 0; i < queries.size(); ++i) {
+        agents[i].set_query(queries[i]);
+      }
+      ASSERT(async_trie.lookup(agents.data(), found.get(), queries.size()) ==
+             num_found);
+      for (std::size_t i = 0; i < queries.size(); ++i) {
+        agent.set_query(queries[i]);
+        ASSERT(found[i] == trie.lookup(agent));
+        if (found[i]) {
+          ASSERT(agents[i].key().id() == agent.key().id());
+        }
+      }
+    }
+  }
+
+  marisa::Trie centroid_trie;
+  centroid_trie.build(keyset, MARISA_CENTROID_TRIE);
+  EXCEPT(marisa::AsyncTrie async_trie(centroid_trie), std::logic_error);
+  const marisa::Trie empty_trie;
+  EXCEPT(marisa::AsyncTrie async_trie(empty_trie), std::logic_error);
+
+  TEST_END();
+}
+#endif  // MARISA_HAS_ASYNC_TRIE
+
+// GetPrefixes() returns the results of common prefix search for `query`.
+std::vector<std::pair<std::size_t, std::string>> GetPrefixes(
+    const marisa::Trie &trie, std::string_view query) {
+  std::vector<std::pair<std::size_t, std::string>> prefixes;
+  marisa::Agent agent;
+  agent.set_query(query);
+  while (trie.common_prefix_search(agent)) {
+    prefixes.emplace_back(agent.key().id(), agent.key().str());
+  }
+  return prefixes;
+}
+
+std::vector<std::pair<std::size_t, std::string>> GetPrefixes(
+    const marisa::CachedTrie &cached_trie, std::string_view query) {
+  std::vector<std::pair<std::size_t, std::string>> prefixes;
+  marisa::Agent agent;
+  agent.set_query(query);
+  std::vector<marisa::Key> keys;
+  ASSERT(cached_trie.common_prefix_search(agent, &keys) == keys.size());
+  for (const marisa::Key &key : keys) {
+    prefixes.emplace_back(key.id(), key.str());
+  }
+  return prefixes;
+}
+
+void TestCachedTrie() {
+  TEST_START();
+
+  marisa::Keyset keyset;
+  const char *const keys[] = {"a", "ab", "abc", "b"};
+  for (const char *key : keys) {
+    keyset.push_back(key);
+  }
+  std::string chain;
+  for (std::size_t i = 0; i < 10; ++i) {
+    chain.push_back('c');
+    keyset.push_back(chain);
+  }
+  const std::string long_key(64, 'd');
+  keyset.push_back(long_key);
+  marisa::Trie trie;
+  trie.build(keyset);
+
+  marisa::CachedTrie cached_trie(trie);
+  ASSERT(&cached_trie.trie() == &trie);
+  ASSERT(cached_trie.total_size() != 0);
+
+  // The first lookup of a query misses and the second one hits, with the same
+  // result as Trie::lookup(), including for a query that is not found.
+  marisa::Agent agent;
+  marisa::Agent trie_agent;
+  for (std::string_view query : {"ab", "abx", ""}) {
+    trie_agent.set_query(query);
+    const bool found = trie.lookup(trie_agent);
+    for (std::size_t i = 0; i < 2; ++i) {
+      agent.set_query(query);
+      ASSERT(cached_trie.lookup(agent) == found);
+      if (found) {
+        ASSERT(agent.key().id() == trie_agent.key().id());
+        ASSERT(agent.key().str() == query);
+      }
+    }
+  }
+  marisa::CachedTrie::Stats stats = cached_trie.stats();
+  ASSERT(stats.lookup_hits == 3);
+  ASSERT(stats.lookup_misses == 3);
+  ASSERT(stats.prefix_hits == 0);
+  ASSERT(stats.prefix_misses == 0);
+
+  for (std::string_view query : {"abcd", "x", "ccc"}) {
+    for (std::size_t i = 0; i < 2; ++i) {
+      ASSERT(GetPrefixes(cached_trie, query) == GetPrefixes(trie, query));
+    }
+  }
+  stats = cached_trie.stats();
+  ASSERT(stats.prefix_hits == 3);
+  ASSERT(stats.prefix_misses == 3);
+
+  // A query with more than 8 prefix keys is searched every time, and a query
+  // longer than 48 bytes bypasses the cache and its counters.
+  for (std::size_t i = 0; i < 2; ++i) {
+    ASSERT(GetPrefixes(cached_trie, chain) == GetPrefixes(trie, chain));
+    ASSERT(GetPrefixes(cached_trie, long_key) == GetPrefixes(trie, long_key));
+    agent.set_query(long_key);
+    ASSERT(cached_trie.lookup(agent));
+    ASSERT(agent.key().str() == long_key);
+  }
+  stats = cached_trie.stats();
+  ASSERT(stats.lookup_hits == 3);
+  ASSERT(stats.lookup_misses == 3);
+  ASSERT(stats.prefix_hits == 3);
+  ASSERT(stats.prefix_misses == 5);
+
+  // clear() drops the results and the counters.
+  cached_trie.clear();
+  stats = cached_trie.stats();
+  ASSERT(stats.lookup_hits == 0);
+  ASSERT(stats.lookup_misses == 0);
+  ASSERT(stats.prefix_hits == 0);
+  ASSERT(stats.prefix_misses == 0);
+  agent.set_query("abx");
+  ASSERT(!cached_trie.lookup(agent));
+  ASSERT(GetPrefixes(cached_trie, "abcd") == GetPrefixes(trie, "abcd"));
+  stats = cached_trie.stats();
+  ASSERT(stats.lookup_hits == 0);
+  ASSERT(stats.lookup_misses == 1);
+  ASSERT(stats.prefix_hits == 0);
+  ASSERT(stats.prefix_misses == 1);
+
+  // A cache without slots works as a Trie.
+  marisa::CachedTrie uncached_trie(trie, 0, 0);
+  ASSERT(uncached_trie.total_size() < cached_trie.total_size());
+  for (std::size_t i = 0; i < 2; ++i) {
+    agent.set_query("ab");
+    ASSERT(uncached_trie.lookup(agent));
+    ASSERT(GetPrefixes(uncached_trie, "abcd") == GetPrefixes(trie, "abcd"));
+  }
+  ASSERT(uncached_trie.stats().lookup_misses == 2);
+  ASSERT(uncached_trie.stats().prefix_misses == 2);
+
+  EXCEPT(cached_trie.common_prefix_search(agent, nullptr),
+         std::invalid_argument);
+
+  TEST_END();
+}
+
+void TestCachedTrieThreads() {
+  TEST_START();
+
+  marisa::Keyset keyset;
+  MakeKeyset(1000, MARISA_TEXT_TAIL, &keyset);
+  marisa::Trie trie;
+  trie.build(keyset);
+
+  // Queries are keys and keys with an extra byte, most of which are not
+  // found. The tables have a few slots, so that threads keep overwriting the
+  // slots that other threads read, while another thread erases them.
+  std::vector<std::string> queries;
+  for (std::size_t i = 0; i < keyset.size(); ++i) {
+    queries.emplace_back(keyset[i].str());
+    queries.emplace_back(std::string(keyset[i].str()) + '5');
+  }
+  marisa::CachedTrie cached_trie(trie, 1 << 12, 1 << 12);
+
+  constexpr std::size_t NUM_THREADS = 4;
+  std::atomic<std::size_t> num_running{NUM_THREADS};
+  std::vector<std::thread> threads;
+  for (std::size_t thread_id = 0; thread_id < NUM_THREADS; ++thread_id) {
+    threads.emplace_back([&, thread_id] {
+      std::mt19937 engine(static_cast<std::mt19937::result_type>(thread_id));
+      marisa::Agent agent;
+      marisa::Agent trie_agent;
+      std::vector<marisa::Key> keys;
+      for (std::size_t i = 0; i < 20000; ++i) {
+        const std::string &query = queries[engine() % queries.size()];
+        agent.set_query(query);
+        trie_agent.set_query(query);
+        const bool found = trie.lookup(trie_agent);
+        ASSERT(cached_trie.lookup(agent) == found);
+        if (found) {
+          ASSERT(agent.key().id() == trie_agent.key().id());
+        }
+
+        agent.set_query(query);
+        trie_agent.set_query(query);
+        cached_trie.common_prefix_search(agent, &keys);
+        for (const marisa::Key &key : keys) {
+          ASSERT(trie.common_prefix_search(trie_agent));
+          ASSERT(key.id() == trie_agent.key().id());
+          ASSERT(key.str() == trie_agent.key().str());
+        }
+        ASSERT(!trie.common_prefix_search(trie_agent));
+      }
+      num_running.fetch_sub(1);
+    });
+  }
+  while (num_running.load() != 0) {
+    cached_trie.clear();
+    std::this_thread::yield();
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  TEST_END();
+}
+
 }  // namespace
 
+// GetKeys() returns the keys of `trie` with their IDs.
+std::map<std::string, std::size_t> GetKeys(const marisa::Trie &trie) {
+  std::map<std::string, std::size_t> keys;
+  marisa::Agent agent;
+  for (std::size_t i = 0; i < trie.num_keys(); ++i) {
+    agent.set_query(i);
+    trie.reverse_lookup(agent);
+    keys.emplace(std::string(agent.key().str()), i);
+  }
+  return keys;
+}
+
+void TestDiff(const marisa::Trie &old_trie, const marisa::Trie &new_trie) {
+  const std::map<std::string, std::size_t> old_keys = GetKeys(old_trie);
+  const std::map<std::string, std::size_t> new_keys = GetKeys(new_trie);
+
+  std::vector<std::pair<std::string, std::pair<std::size_t, std::size_t>>>
+      expected;
+  auto old_it = old_keys.begin();
+  auto new_it = new_keys.begin();
+  while ((old_it != old_keys.end()) || (new_it != new_keys.end())) {
+    if ((new_it == new_keys.end()) ||
+        ((old_it != old_keys.end()) && (old_it->first < new_it->first))) {
+      expected.emplace_back(
+          old_it->first, std::make_pair(old_it->second, MARISA_INVALID_KEY_ID));
+      ++old_it;
+    } else if ((old_it == old_keys.end()) || (new_it->first < old_it->first)) {
+      expected.emplace_back(
+          new_it->first, std::make_pair(MARISA_INVALID_KEY_ID, new_it->second));
+      ++new_it;
+    } else {
+      if (old_it->second != new_it->second) {
+        expected.emplace_back(old_it->first,
+                              std::make_pair(old_it->second, new_it->second));
+      }
+      ++old_it;
+      ++new_it;
+    }
+  }
+
+  std::size_t i = 0;
+  marisa::Trie::diff(old_trie, new_trie, [&](const marisa::KeyDiff &key_diff) {
+    ASSERT(i < expected.size());
+    ASSERT(key_diff.key() == expected[i].first);
+    ASSERT(key_diff.old_id() == expected[i].second.first);
+    ASSERT(key_diff.new_id() == expected[i].second.second);
+    if (key_diff.old_id() == MARISA_INVALID_KEY_ID) {
+      ASSERT(key_diff.type() == MARISA_KEY_ADDED);
+    } else if (key_diff.new_id() == MARISA_INVALID_KEY_ID) {
+      ASSERT(key_diff.type() == MARISA_KEY_REMOVED);
+    } else {
+      ASSERT(key_diff.type() == MARISA_KEY_MOVED);
+    }
+    ++i;
+  });
+  ASSERT(i == expected.size());
+}
+
+void TestDiff() {
+  TEST_START();
+
+  marisa::Keyset keyset;
+  MakeKeyset(2000, MARISA_BINARY_TAIL, &keyset);
+
+  const int configs[] = {
+      MARISA_LABEL_ORDER,
+      3 | MARISA_WEIGHT_ORDER | MARISA_BINARY_TAIL,
+      1 | MARISA_LABEL_ORDER,
+      4 | MARISA_WEIGHT_ORDER | MARISA_TINY_CACHE,
+  };
+  for (int old_config : configs) {
+    for (int new_config : configs) {
+      marisa::Keyset old_keyset;
+      marisa::Keyset new_keyset;
+      for (std::size_t i = 0; i < keyset.size(); ++i) {
+        if ((random_engine() % 4) != 0) {
+          old_keyset.push_back(keyset[i].str());
+        }
+        if ((random_engine() % 4) != 0) {
+          new_keyset.push_back(keyset[i].str());
+        }
+      }
+      marisa::Trie old_trie;
+      marisa::Trie new_trie;
+      old_trie.build(old_keyset, old_config);
+      new_trie.build(new_keyset, new_config);
+
+      TestDiff(old_trie, new_trie);
+      TestDiff(new_trie, old_trie);
+      TestDiff(old_trie, old_trie);
+    }
+  }
+
+  marisa::Keyset empty_keyset;
+  marisa::Trie empty_trie;
+  empty_trie.build(empty_keyset);
+  marisa::Trie trie;
+  trie.build(keyset);
+  TestDiff(empty_trie, trie);
+  TestDiff(trie, empty_trie);
+  EXCEPT(marisa::Trie::diff(marisa::Trie(), trie,
+                            [](const marisa::KeyDiff &) {}),
+         std::logic_error);
+
+  EXCEPT(marisa::Trie::diff(trie, trie, marisa::DiffCallback()),
+         std::invalid_argument);
+
+  TEST_END();
+}
+
 int main() try {
   TestEmptyTrie();
+  TestTryQueryErrors();
   TestTinyTrie();
   TestTrie();
+  TestBuildFromKeys();
+  TestCentroidTrie();
+  TestDfudsTrie();
+  TestDiff();
+  TestFrontCoding();
+  TestExtendQuery();
+  TestBuildReport();
+  TestBuildCallback();
+  TestRebuildCache();
+  TestHotFirst();
+  TestLegacyLayout();
+  TestCompressedTrie();
+  TestTrieFromImage();
+#ifdef MARISA_HAS_ASYNC_TRIE
+  TestAsyncTrie();
+#endif  // MARISA_HAS_ASYNC_TRIE
+  TestCachedTrie();
+  TestCachedTrieThreads();
 
   return 0;
 } catch (const std::exception &ex) {
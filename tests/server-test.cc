@@ -0,0 +1,306 @@
+#include <marisa.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "marisa-assert.h"
+#include "server-handler.h"
+
+namespace {
+
+// MakeRequest() returns the body of a request for `queries`.
+std::string MakeRequest(std::uint8_t op, std::uint32_t max_num_results,
+                        const std::vector<std::string_view> &queries) {
+  std::string body;
+  put_header(&body, op, 0);
+  put_u32(&body, max_num_results);
+  put_u32(&body, static_cast<std::uint32_t>(queries.size()));
+  for (const std::string_view query : queries) {
+    put_u32(&body, static_cast<std::uint32_t>(query.length()));
+    body.append(query);
+  }
+  return body;
+}
+
+std::string MakeFrame(const std::string &body) {
+  std::string frame;
+  put_u32(&frame, static_cast<std::uint32_t>(body.size()));
+  frame.append(body);
+  return frame;
+}
+
+// Response is a parsed response frame. An error response has a message and
+// no results.
+struct Response {
+  std::uint8_t status = 0;
+  std::uint8_t op = 0;
+  std::string message;
+  std::vector<std::vector<std::uint32_t>> ids;
+  std::vector<std::vector<std::string>> keys;
+};
+
+// ParseResponse() parses the response frame at the beginning of `frames` and
+// removes it.
+Response ParseResponse(std::string *frames) {
+  ServerReader frame_reader(frames->data(), frames->size());
+  std::uint32_t size;
+  std::string_view body;
+  ASSERT(frame_reader.read_u32(&size));
+  ASSERT(frame_reader.read_bytes(size, &body));
+
+  Response response;
+  ServerReader reader(body.data(), body.size());
+  ASSERT(reader.read_u8(&response.status));
+  ASSERT(reader.read_u8(&response.op));
+  ASSERT(reader.skip(2));
+  if (response.status == SERVER_ERROR) {
+    std::uint32_t length;
+    std::string_view message;
+    ASSERT(reader.read_u32(&length));
+    ASSERT(reader.read_bytes(length, &message));
+    response.message = message;
+  } else {
+    std::uint32_t num_queries;
+    ASSERT(reader.read_u32(&num_queries));
+    for (std::uint32_t i = 0; i < num_queries; ++i) {
+      std::uint32_t num_results;
+      ASSERT(reader.read_u32(&num_results));
+      response.ids.emplace_back();
+      response.keys.emplace_back();
+      for (std::uint32_t j = 0; j < num_results; ++j) {
+        std::uint32_t id;
+        std::uint32_t length;
+        std::string_view key;
+        ASSERT(reader.read_u32(&id));
+        ASSERT(reader.read_u32(&length));
+        ASSERT(reader.read_bytes(length, &key));
+        response.ids.back().push_back(id);
+        response.keys.back().emplace_back(key);
+      }
+    }
+  }
+  ASSERT(reader.avail() == 0);
+  frames->erase(0, 4 + size);
+  return response;
+}
+
+void BuildTrie(marisa::Trie *trie) {
+  marisa::Keyset keyset;
+  keyset.push_back("app");
+  keyset.push_back("apple");
+  keyset.push_back("application");
+  keyset.push_back("banana");
+  trie->build(keyset);
+}
+
+void TestHandleRequest() {
+  TEST_START();
+
+  marisa::Trie trie;
+  BuildTrie(&trie);
+  marisa::Agent agent;
+  const ServerLimits limits;
+
+  std::string out;
+  std::string body = MakeRequest(SERVER_LOOKUP, 0, {"apple", "apply"});
+  ASSERT(handle_request(trie, agent, limits, body.data(), body.size(), &out));
+  Response response = ParseResponse(&out);
+  ASSERT(out.empty());
+  ASSERT(response.status == SERVER_OK);
+  ASSERT(response.op == SERVER_LOOKUP);
+  ASSERT(response.ids.size() == 2);
+  ASSERT(response.ids[0].size() == 1);
+  ASSERT(response.keys[0][0].empty());
+  ASSERT(response.ids[1].empty());
+  agent.set_query("apple");
+  ASSERT(trie.lookup(agent));
+  ASSERT(response.ids[0][0] == agent.key().id());
+
+  body.clear();
+  put_header(&body, SERVER_REVERSE_LOOKUP, 0);
+  put_u32(&body, 0);
+  put_u32(&body, 1);
+  put_u32(&body, static_cast<std::uint32_t>(agent.key().id()));
+  ASSERT(handle_request(trie, agent, limits, body.data(), body.size(), &out));
+  response = ParseResponse(&out);
+  ASSERT(response.status == SERVER_OK);
+  ASSERT(response.keys.size() == 1);
+  ASSERT(response.keys[0].size() == 1);
+  ASSERT(response.keys[0][0] == "apple");
+
+  // A request gets at most `max_num_results` results for each query, and
+  // the server limit applies to a request without a limit.
+  body = MakeRequest(SERVER_PREDICTIVE_SEARCH, 2, {"app"});
+  ASSERT(handle_request(trie, agent, limits, body.data(), body.size(), &out));
+  response = ParseResponse(&out);
+  ASSERT(response.keys[0].size() == 2);
+  ServerLimits small_limits;
+  small_limits.max_num_results = 1;
+  body = MakeRequest(SERVER_COMMON_PREFIX_SEARCH, 0, {"application"});
+  ASSERT(handle_request(trie, agent, small_limits, body.data(), body.size(),
+                        &out));
+  response = ParseResponse(&out);
+  ASSERT(response.keys[0].size() == 1);
+  ASSERT(response.keys[0][0] == "app");
+
+  small_limits.max_response_size = 16;
+  body = MakeRequest(SERVER_PREDICTIVE_SEARCH, 0, {"", "a"});
+  ASSERT(handle_request(trie, agent, small_limits, body.data(), body.size(),
+                        &out));
+  response = ParseResponse(&out);
+  ASSERT(response.status == SERVER_ERROR);
+  ASSERT(response.message == "too large response");
+
+  TEST_END();
+}
+
+void TestUnknownOp() {
+  TEST_START();
+
+  marisa::Trie trie;
+  BuildTrie(&trie);
+  marisa::Agent agent;
+  const ServerLimits limits;
+
+  // An unknown operation fails the request, and the connection is kept.
+  std::string out;
+  for (const std::uint8_t op :
+       {std::uint8_t{0}, std::uint8_t{SERVER_PREDICTIVE_SEARCH + 1},
+        std::uint8_t{255}}) {
+    const std::string body = MakeRequest(op, 0, {"apple"});
+    ASSERT(
+        handle_request(trie, agent, limits, body.data(), body.size(), &out));
+    const Response response = ParseResponse(&out);
+    ASSERT(out.empty());
+    ASSERT(response.status == SERVER_ERROR);
+    ASSERT(response.op == op);
+    ASSERT(response.message == "unknown operation: " + std::to_string(op));
+  }
+
+#if MARISA_USE_EXCEPTIONS
+  // So does a key ID out of range.
+  std::string body;
+  put_header(&body, SERVER_REVERSE_LOOKUP, 0);
+  put_u32(&body, 0);
+  put_u32(&body, 1);
+  put_u32(&body, 4);
+  ASSERT(handle_request(trie, agent, limits, body.data(), body.size(), &out));
+  const Response response = ParseResponse(&out);
+  ASSERT(response.status == SERVER_ERROR);
+  ASSERT(response.op == SERVER_REVERSE_LOOKUP);
+  ASSERT(!response.message.empty());
+#endif  // MARISA_USE_EXCEPTIONS
+
+  TEST_END();
+}
+
+void TestMalformedRequest() {
+  TEST_START();
+
+  marisa::Trie trie;
+  BuildTrie(&trie);
+  marisa::Agent agent;
+  const ServerLimits limits;
+
+  const std::string body = MakeRequest(SERVER_LOOKUP, 0, {"apple", "app"});
+  std::string out;
+
+  // A body that ends in its header or in a query is malformed, and so is a
+  // body with bytes after the queries.
+  for (std::size_t size = 0; size < body.size(); ++size) {
+    ASSERT(!handle_request(trie, agent, limits, body.data(), size, &out));
+  }
+  std::string long_body = body + "x";
+  ASSERT(!handle_request(trie, agent, limits, long_body.data(),
+                         long_body.size(), &out));
+
+  // So is a body that claims more queries or a longer query than it has.
+  std::string bad_body = body;
+  set_u32(&bad_body, 8, 3);
+  ASSERT(!handle_request(trie, agent, limits, bad_body.data(),
+                         bad_body.size(), &out));
+  bad_body = body;
+  set_u32(&bad_body, SERVER_HEADER_SIZE, 0xFFFFFFFFU);
+  ASSERT(!handle_request(trie, agent, limits, bad_body.data(),
+                         bad_body.size(), &out));
+
+  TEST_END();
+}
+
+void TestHandleFrames() {
+  TEST_START();
+
+  marisa::Trie trie;
+  BuildTrie(&trie);
+  marisa::Agent agent;
+  const ServerLimits limits;
+
+  // A truncated frame is kept until the rest arrives, byte by byte here.
+  const std::string frame =
+      MakeFrame(MakeRequest(SERVER_LOOKUP, 0, {"banana"}));
+  const std::string frames = frame + frame;
+  std::string in;
+  std::string out;
+  std::size_t num_responses = 0;
+  for (const char byte : frames) {
+    in.push_back(byte);
+    ASSERT(handle_frames(trie, agent, limits, &in, &out));
+    if (!out.empty()) {
+      ASSERT(in.empty());
+      const Response response = ParseResponse(&out);
+      ASSERT(response.status == SERVER_OK);
+      ASSERT(response.ids[0].size() == 1);
+      ++num_responses;
+    }
+  }
+  ASSERT(num_responses == 2);
+
+  // Complete frames are handled together, and a truncated one is kept.
+  in = frames + frame.substr(0, 6);
+  ASSERT(handle_frames(trie, agent, limits, &in, &out));
+  ASSERT(in == frame.substr(0, 6));
+  ParseResponse(&out);
+  ParseResponse(&out);
+  ASSERT(out.empty());
+
+  // A frame larger than the limit is rejected by its size alone.
+  in.clear();
+  put_u32(&in, SERVER_MAX_REQUEST_SIZE + 1);
+  ASSERT(!handle_frames(trie, agent, limits, &in, &out));
+  in.clear();
+  put_u32(&in, 0xFFFFFFFFU);
+  ASSERT(!handle_frames(trie, agent, limits, &in, &out));
+  in.clear();
+  put_u32(&in, SERVER_MAX_REQUEST_SIZE);
+  ASSERT(handle_frames(trie, agent, limits, &in, &out));
+  ASSERT(in.size() == 4);
+  ASSERT(out.empty());
+
+  // A malformed frame after a valid one is rejected, but the response to
+  // the valid one has been appended.
+  in = frame + MakeFrame("");
+  ASSERT(!handle_frames(trie, agent, limits, &in, &out));
+  ASSERT(ParseResponse(&out).status == SERVER_OK);
+  ASSERT(out.empty());
+
+  TEST_END();
+}
+
+}  // namespace
+
+int main() try {
+  TestHandleRequest();
+  TestUnknownOp();
+  TestMalformedRequest();
+  TestHandleFrames();
+
+  return 0;
+} catch (const std::exception &ex) {
+  std::cerr << ex.what() << "\n";
+  throw;
+}
@@ -1,3 +1,6 @@
+#include <marisa.h>
+#include <marisa/grimoire/io.h>
+#include <marisa/grimoire/trie.h>
 #include <marisa/grimoire/trie/config.h>
 #include <marisa/grimoire/trie/header.h>
 #include <marisa/grimoire/trie/key.h>
@@ -10,6 +13,8 @@
 #include <cstring>
 #include <exception>
 #include <sstream>
+#include <string>
+#include <vector>
 
 #include "marisa-assert.h"
 
@@ -234,7 +239,7 @@ void TestTextTail() {
   marisa::grimoire::trie::Tail tail;
   marisa::grimoire::Vector<marisa::grimoire::trie::Entry> entries;
   marisa::grimoire::Vector<std::uint32_t> offsets;
-  tail.build(entries, &offsets, MARISA_TEXT_TAIL);
+  tail.build(entries, offsets, MARISA_TEXT_TAIL);
 
   ASSERT(tail.mode() == MARISA_TEXT_TAIL);
   ASSERT(tail.size() == 0);
@@ -248,7 +253,7 @@ void TestTextTail() {
   entry.set_str("X", 1);
   entries.push_back(entry);
 
-  tail.build(entries, &offsets, MARISA_TEXT_TAIL);
+  tail.build(entries, offsets, MARISA_TEXT_TAIL);
 
   ASSERT(tail.mode() == MARISA_TEXT_TAIL);
   ASSERT(tail.size() == 2);
@@ -275,7 +280,7 @@ void TestTextTail() {
   entry.set_str("AB", 2);
   entries.push_back(entry);
 
-  tail.build(entries, &offsets, MARISA_TEXT_TAIL);
+  tail.build(entries, offsets, MARISA_TEXT_TAIL);
   std::sort(entries.begin(), entries.end(),
             marisa::grimoire::trie::Entry::IDComparer());
 
@@ -355,7 +360,7 @@ void TestBinaryTail() {
   marisa::grimoire::trie::Tail tail;
   marisa::grimoire::Vector<marisa::grimoire::trie::Entry> entries;
   marisa::grimoire::Vector<std::uint32_t> offsets;
-  tail.build(entries, &offsets, MARISA_BINARY_TAIL);
+  tail.build(entries, offsets, MARISA_BINARY_TAIL);
 
   ASSERT(tail.mode() == MARISA_TEXT_TAIL);
   ASSERT(tail.size() == 0);
@@ -369,7 +374,7 @@ void TestBinaryTail() {
   entry.set_str("X", 1);
   entries.push_back(entry);
 
-  tail.build(entries, &offsets, MARISA_BINARY_TAIL);
+  tail.build(entries, offsets, MARISA_BINARY_TAIL);
 
   ASSERT(tail.mode() == MARISA_BINARY_TAIL);
   ASSERT(tail.size() == 1);
@@ -383,7 +388,7 @@ void TestBinaryTail() {
   const char binary_entry[] = {'N', 'P', '\0', 'T', 'r', 'i', 'e'};
   entries[0].set_str(binary_entry, sizeof(binary_entry));
 
-  tail.build(entries, &offsets, MARISA_TEXT_TAIL);
+  tail.build(entries, offsets, MARISA_TEXT_TAIL);
 
   ASSERT(tail.mode() == MARISA_BINARY_TAIL);
   ASSERT(tail.size() == entries[0].length());
@@ -405,7 +410,7 @@ void TestBinaryTail() {
   entry.set_str("AB", 2);
   entries.push_back(entry);
 
-  tail.build(entries, &offsets, MARISA_BINARY_TAIL);
+  tail.build(entries, offsets, MARISA_BINARY_TAIL);
   std::sort(entries.begin(), entries.end(),
             marisa::grimoire::trie::Entry::IDComparer());
 
@@ -487,6 +492,115 @@ void TestState() {
   TEST_END();
 }
 
+// GetSections() maps a dictionary file with the backend it was saved with,
+// and returns its sections with the adjacent blocks of each merged.
+std::vector<marisa::grimoire::LoudsTrie::Section> GetSections(
+    const char *filename) {
+  marisa::grimoire::Mapper mapper;
+  mapper.open(filename);
+  marisa::grimoire::trie::Header header;
+  header.map(mapper);
+
+  std::vector<marisa::grimoire::LoudsTrie::Section> blocks;
+  marisa::grimoire::CentroidTrie centroid_trie;
+  marisa::grimoire::DfudsTrie dfuds_trie;
+  marisa::grimoire::LoudsTrie louds_trie;
+  if (header.layout() == marisa::grimoire::trie::Header::CENTROID_LAYOUT) {
+    centroid_trie.map(mapper, header);
+    centroid_trie.get_sections(&blocks);
+  } else if (header.layout() == marisa::grimoire::trie::Header::DFUDS_LAYOUT) {
+    dfuds_trie.map(mapper, header);
+    dfuds_trie.get_sections(&blocks);
+  } else {
+    louds_trie.map(mapper, header);
+    louds_trie.get_sections(&blocks);
+  }
+
+  std::vector<marisa::grimoire::LoudsTrie::Section> sections;
+  for (const marisa::grimoire::LoudsTrie::Section &block : blocks) {
+    ASSERT(block.size != 0);
+    if (!sections.empty() && (sections.back().trie_id == block.trie_id) &&
+        (std::strcmp(sections.back().name, block.name) == 0)) {
+      ASSERT(sections.back().hot == block.hot);
+      sections.back().size += block.size;
+    } else {
+      sections.push_back(block);
+    }
+  }
+  return sections;
+}
+
+void TestWarmup() {
+  TEST_START();
+
+  marisa::Keyset keyset;
+  marisa::Keyset sample;
+  for (std::size_t i = 0; i < 5000; ++i) {
+    const std::string key = std::to_string(i * 7919) + "-key";
+    keyset.push_back(key);
+    if ((i % 10) == 0) {
+      sample.push_back(key);
+    }
+  }
+
+  const int configs[] = {
+      1 | MARISA_TEXT_TAIL,
+      3 | MARISA_BINARY_TAIL | MARISA_TINY_CACHE,
+      MARISA_CENTROID_TRIE,
+      MARISA_DFUDS_TRIE,
+  };
+  const int flags_list[] = {
+      MARISA_WARMUP_HOT,
+      MARISA_WARMUP_SAMPLE,
+      MARISA_WARMUP_ALL,
+      MARISA_WARMUP_HOT | MARISA_WARMUP_SAMPLE | MARISA_WARMUP_ALL,
+  };
+  for (int config : configs) {
+    {
+      marisa::Trie trie;
+      trie.build(keyset, config);
+      marisa::TrieSerializer(trie).save("trie-test.dat");
+    }
+    const std::vector<marisa::grimoire::LoudsTrie::Section> sections =
+        GetSections("trie-test.dat");
+    ASSERT(!sections.empty());
+
+    for (int flags : flags_list) {
+      marisa::Trie trie;
+      marisa::TrieSerializer(trie).mmap("trie-test.dat");
+      trie.warmup(flags, &sample);
+
+      // residency() reports every section in order, and the sections that
+      // warmup() faulted in are resident.
+      const marisa::ResidencyReport report = trie.residency();
+      ASSERT(report.size() == sections.size());
+      std::size_t total_size = 0;
+      for (std::size_t i = 0; i < sections.size(); ++i) {
+        const marisa::SectionResidency &section = report.sections()[i];
+        ASSERT(std::strcmp(section.name(), sections[i].name) == 0);
+        ASSERT(section.trie_id() == sections[i].trie_id);
+        ASSERT(section.size() == sections[i].size);
+        ASSERT(section.resident_size() <= section.size());
+        if (((flags & MARISA_WARMUP_ALL) != 0) ||
+            (((flags & MARISA_WARMUP_HOT) != 0) && sections[i].hot)) {
+          ASSERT(section.resident_size() == section.size());
+        }
+        total_size += section.size();
+      }
+      ASSERT(report.total_size() == total_size);
+      ASSERT(report.total_resident_size() <= total_size);
+      ASSERT(trie.total_size() >= total_size);
+    }
+  }
+
+  marisa::Trie trie;
+  marisa::TrieSerializer(trie).mmap("trie-test.dat");
+  EXCEPT(trie.warmup(MARISA_WARMUP_SAMPLE), std::invalid_argument);
+  EXCEPT(trie.warmup(1 << 3), std::invalid_argument);
+
+  TEST_END();
+}
+
 }  // namespace
 
 int main() try {
@@ -499,6 +613,7 @@ int main() try {
   TestBinaryTail();
   TestHistory();
   TestState();
+  TestWarmup();
 
   return 0;
 } catch (const std::exception &ex) {
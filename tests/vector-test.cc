@@ -4,6 +4,7 @@
 
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
 #include <exception>
 #include <random>
@@ -191,7 +192,79 @@ void TestVector() {
   vec.resize(100);
   ASSERT(vec.capacity() == 100);
 
-  ASSERT(vec.fixed());
+  // Only a mapped vector is fixed.
+  ASSERT(!vec.fixed());
+
+  TEST_END();
+}
+
+// Vector pads its data to 8 bytes, as io_size() assumes, and adds no
+// padding to data that is already 8-byte aligned.
+void TestVectorPadding() {
+  TEST_START();
+
+  marisa::grimoire::Vector<std::uint64_t> aligned;
+  for (std::uint64_t i = 0; i < 100; ++i) {
+    aligned.push_back(i * i);
+  }
+  marisa::grimoire::Vector<char> unaligned;
+  for (char c : std::string("marisa")) {
+    unaligned.push_back(c);
+  }
+  const std::uint32_t sentinel = 0x12345678;
+
+  std::stringstream stream;
+  {
+    marisa::grimoire::Writer writer;
+    writer.open(stream);
+    aligned.write(writer);
+    unaligned.write(writer);
+    aligned.write(writer);
+    writer.write(sentinel);
+  }
+  const std::string image = stream.str();
+  ASSERT(aligned.io_size() == (sizeof(std::uint64_t) * 101));
+  ASSERT(unaligned.io_size() == (sizeof(std::uint64_t) * 2));
+  ASSERT(image.size() == ((aligned.io_size() * 2) + unaligned.io_size() +
+                          sizeof(sentinel)));
+
+  {
+    std::vector<std::uint64_t> buf((image.size() + 7) / 8);
+    std::memcpy(buf.data(), image.data(), image.size());
+    marisa::grimoire::Mapper mapper;
+    mapper.open(buf.data(), image.size());
+    marisa::grimoire::Vector<std::uint64_t> vec1;
+    marisa::grimoire::Vector<char> vec2;
+    marisa::grimoire::Vector<std::uint64_t> vec3;
+    std::uint32_t value = 0;
+    vec1.map(mapper);
+    vec2.map(mapper);
+    vec3.map(mapper);
+    mapper.map(&value);
+    ASSERT(vec1.size() == aligned.size());
+    ASSERT(vec2.size() == unaligned.size());
+    ASSERT(vec3.size() == aligned.size());
+    ASSERT(static_cast<const marisa::grimoire::Vector<std::uint64_t> &>(
+               vec3)[99] == aligned[99]);
+    ASSERT(value == sentinel);
+  }
+
+  {
+    marisa::grimoire::Reader reader;
+    reader.open(stream);
+    marisa::grimoire::Vector<std::uint64_t> vec1;
+    marisa::grimoire::Vector<char> vec2;
+    marisa::grimoire::Vector<std::uint64_t> vec3;
+    std::uint32_t value = 0;
+    vec1.read(reader);
+    vec2.read(reader);
+    vec3.read(reader);
+    reader.read(&value);
+    ASSERT(vec2.size() == unaligned.size());
+    ASSERT(vec2[5] == 'a');
+    ASSERT(vec3[99] == aligned[99]);
+    ASSERT(value == sentinel);
+  }
 
   TEST_END();
 }
@@ -396,6 +469,185 @@ void TestBitVector() {
   TEST_END();
 }
 
+std::string SerializeBitVector(const marisa::grimoire::BitVector &bv) {
+  std::stringstream stream;
+  marisa::grimoire::Writer writer;
+  writer.open(stream);
+  bv.write(writer);
+  return stream.str();
+}
+
+void TestBitVectorBulk(std::size_t size, std::size_t num_threads) {
+  marisa::grimoire::BitVector bv;
+  marisa::grimoire::BitVector bulk_bv;
+
+  std::vector<bool> bits;
+  while (bits.size() < size) {
+    switch (random_engine() % 3) {
+      case 0: {
+        const bool bit = (random_engine() % 2) == 0;
+        bulk_bv.push_back(bit);
+        bits.push_back(bit);
+        break;
+      }
+      case 1: {
+        const std::uint64_t word =
+            (std::uint64_t{random_engine()} << 32) | random_engine();
+        const std::size_t num_bits = random_engine() % 65;
+        bulk_bv.push_back_bits(word, num_bits);
+        for (std::size_t i = 0; i < num_bits; ++i) {
+          bits.push_back(((word >> i) & 1) == 1);
+        }
+        break;
+      }
+      case 2: {
+        const bool bit = (random_engine() % 2) == 0;
+        const std::size_t count = random_engine() % 1024;
+        bulk_bv.push_back_run(bit, count);
+        bits.insert(bits.end(), count, bit);
+        break;
+      }
+    }
+  }
+  for (const bool bit : bits) {
+    bv.push_back(bit);
+  }
+
+  ASSERT(bulk_bv.size() == bits.size());
+  ASSERT(bulk_bv.num_1s() == bv.num_1s());
+  for (std::size_t i = 0; i < bits.size(); ++i) {
+    ASSERT(bulk_bv[i] == bits[i]);
+  }
+
+  EXCEPT(bulk_bv.push_back_bits(0, 65), std::invalid_argument);
+
+  bv.build(true, true, 1);
+  bulk_bv.build(true, true, num_threads);
+  ASSERT(SerializeBitVector(bulk_bv) == SerializeBitVector(bv));
+
+  std::size_t num_ones = 0;
+  for (std::size_t i = 0; i < bits.size(); ++i) {
+    ASSERT(bulk_bv.rank1(i) == num_ones);
+    if (bits[i]) {
+      ASSERT(bulk_bv.select1(num_ones) == i);
+      ++num_ones;
+    } else {
+      ASSERT(bulk_bv.select0(i - num_ones) == i);
+    }
+  }
+}
+
+void TestBitVectorBulk() {
+  TEST_START();
+
+  TestBitVectorBulk(0, 2);
+  TestBitVectorBulk(1, 2);
+  for (std::size_t num_threads = 1; num_threads <= 8; ++num_threads) {
+    TestBitVectorBulk(512 * num_threads, num_threads);
+    TestBitVectorBulk(512 * num_threads + 1, num_threads);
+  }
+
+  for (int i = 0; i < 100; ++i) {
+    TestBitVectorBulk(static_cast<std::size_t>(random_engine()) % 65536,
+                      static_cast<std::size_t>(random_engine()) % 8);
+  }
+
+  TEST_END();
+}
+
+// TestBpVector() compares the searches of a random sequence of `num_pairs`
+// balanced parentheses with naive scans over the excess. The probability of
+// an open parenthesis changes every 1024 bits, so that the excess rises and
+// falls far enough for the searches to climb the range min tree.
+void TestBpVector(std::size_t num_pairs) {
+  const std::size_t size = num_pairs * 2;
+  std::vector<bool> bits(size);
+  std::vector<std::ptrdiff_t> excess(size + 1, 0);
+  std::size_t num_opens = 0;
+  unsigned percent = 50;
+  for (std::size_t i = 0; i < size; ++i) {
+    if ((i % 1024) == 0) {
+      percent = 25 + (random_engine() % 51);
+    }
+    bool bit = (random_engine() % 100) < percent;
+    if (excess[i] == 0) {
+      bit = true;
+    } else if (num_opens == num_pairs) {
+      bit = false;
+    }
+    bits[i] = bit;
+    num_opens += bit ? 1 : 0;
+    excess[i + 1] = excess[i] + (bit ? 1 : -1);
+  }
+
+  marisa::grimoire::BpVector bp;
+  for (std::size_t i = 0; i < size; ++i) {
+    bp.push_back(bits[i]);
+  }
+  bp.build();
+  ASSERT(bp.size() == size);
+  for (std::size_t i = 0; i <= size; ++i) {
+    ASSERT(bp.excess(i) == excess[i]);
+  }
+
+  // Matching parentheses are found with a stack.
+  std::vector<std::size_t> stack;
+  for (std::size_t i = 0; i < size; ++i) {
+    if (bits[i]) {
+      stack.push_back(i);
+      continue;
+    }
+    const std::size_t open = stack.back();
+    stack.pop_back();
+    ASSERT(bp.find_close(open) == i);
+    ASSERT(bp.find_close(open, excess[open]) == i);
+    ASSERT(bp.find_open(i) == open);
+  }
+  ASSERT(stack.empty());
+
+  // Targets are mostly near the excess at `i`, but some are out of reach.
+  for (int query = 0; (size != 0) && (query < 1000); ++query) {
+    const std::size_t i = random_engine() % size;
+    const std::ptrdiff_t target =
+        ((query % 10) == 0)
+            ? -1
+            : (excess[i] - static_cast<std::ptrdiff_t>(random_engine() % 8));
+
+    std::size_t expected = i;
+    while ((expected < size) && (excess[expected + 1] > target)) {
+      ++expected;
+    }
+    ASSERT(bp.fwd_search(i, target) == expected);
+    ASSERT(bp.fwd_search(i, excess[i], target) == expected);
+
+    expected = i;
+    while (excess[expected] > target) {
+      if (expected == 0) {
+        expected = size;
+        break;
+      }
+      --expected;
+    }
+    ASSERT(bp.bwd_search(i, target) == expected);
+  }
+  ASSERT(bp.fwd_search(size, 0) == size);
+}
+
+void TestBpVector() {
+  TEST_START();
+
+  TestBpVector(0);
+  TestBpVector(1);
+  TestBpVector(128);
+  TestBpVector(129);
+  TestBpVector(50000);
+  for (int i = 0; i < 20; ++i) {
+    TestBpVector(static_cast<std::size_t>(random_engine()) % 20000);
+  }
+
+  TEST_END();
+}
+
 }  // namespace
 
 int main() try {
@@ -403,8 +655,11 @@ int main() try {
   TestRankIndex();
 
   TestVector();
+  TestVectorPadding();
   TestFlatVector();
   TestBitVector();
+  TestBitVectorBulk();
+  TestBpVector();
 
   return 0;
 } catch (const std::exception &ex) {
@@ -0,0 +1,163 @@
+#include "line-batch.h"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "marisa/grimoire/algorithm/parallel.h"
+
+namespace {
+
+// Each chunk is split into this number of tasks per thread, so that threads
+// finishing early take over the remaining lines.
+constexpr std::size_t NUM_TASKS_PER_THREAD = 4;
+
+// read_chunk() appends up to `chunk_size` bytes of `input` to `buf`, and
+// returns true at the end of `input`.
+bool read_chunk(std::FILE *input, std::size_t chunk_size,
+                std::vector<char> *buf) {
+  const std::size_t offset = buf->size();
+  buf->resize(offset + chunk_size);
+  const std::size_t size =
+      std::fread(buf->data() + offset, 1, chunk_size, input);
+  buf->resize(offset + size);
+  if (std::ferror(input)) {
+    throw std::runtime_error("failed to read lines");
+  }
+  return size < chunk_size;
+}
+
+void write_outputs(std::FILE *output, const std::vector<std::string> &outs) {
+  for (const std::string &out : outs) {
+    if (std::fwrite(out.data(), 1, out.size(), output) != out.size()) {
+      throw std::runtime_error("failed to write results");
+    }
+  }
+}
+
+// find_line_begin() returns the beginning of the first line that begins at
+// or after `pos`.
+std::size_t find_line_begin(const char *data, std::size_t size,
+                            std::size_t pos) {
+  if (pos == 0) {
+    return 0;
+  }
+  const void *const end_of_line =
+      std::memchr(data + pos - 1, '\n', size - pos + 1);
+  if (end_of_line == nullptr) {
+    return size;
+  }
+  return static_cast<std::size_t>(static_cast<const char *>(end_of_line) -
+                                  data) +
+         1;
+}
+
+// process_lines() processes the lines of task i of `data` into outs[i].
+void process_lines(const char *data, std::size_t size, std::size_t num_threads,
+                   const LineProcessor &process,
+                   std::vector<std::string> *outs) {
+  for (std::string &out : *outs) {
+    out.clear();
+  }
+  split_lines(data, size, outs->size(), num_threads,
+              [&](std::size_t worker_id, std::size_t task_id,
+                  std::string_view line) {
+                process(worker_id, line, &(*outs)[task_id]);
+              });
+}
+
+}  // namespace
+
+std::size_t resolve_num_threads(std::size_t num_threads) {
+  if (num_threads != 0) {
+    return num_threads;
+  }
+  return marisa::grimoire::algorithm::num_hardware_threads();
+}
+
+void split_lines(const char *data, std::size_t size, std::size_t num_tasks,
+                 std::size_t num_threads, const TaskLineProcessor &process) {
+  marisa::grimoire::algorithm::run_in_parallel(
+      num_tasks, num_threads, [&](std::size_t worker_id, std::size_t task_id) {
+        std::size_t begin =
+            find_line_begin(data, size, size * task_id / num_tasks);
+        const std::size_t end =
+            find_line_begin(data, size, size * (task_id + 1) / num_tasks);
+        while (begin < end) {
+          const void *const end_of_line =
+              std::memchr(data + begin, '\n', end - begin);
+          const std::size_t length =
+              (end_of_line != nullptr)
+                  ? static_cast<std::size_t>(
+                        static_cast<const char *>(end_of_line) - data) -
+                        begin
+                  : (end - begin);
+          process(worker_id, task_id, std::string_view(data + begin, length));
+          begin += length + 1;
+        }
+      });
+}
+
+void run_line_batch(std::FILE *input, std::FILE *output,
+                    std::size_t num_threads, const LineProcessor &process,
+                    std::size_t chunk_size) {
+  num_threads = resolve_num_threads(num_threads);
+  chunk_size = std::max(chunk_size, std::size_t{1});
+
+  std::vector<char> chunk;
+  std::vector<char> next_chunk;
+  std::vector<std::string> outs(num_threads * NUM_TASKS_PER_THREAD);
+  std::vector<std::string> prev_outs(outs.size());
+  bool end_of_input = read_chunk(input, chunk_size, &chunk);
+  while (!chunk.empty()) {
+    // Only complete lines are processed unless the input has ended. A line
+    // longer than a chunk is read before the chunk is processed.
+    std::size_t size = chunk.size();
+    if (!end_of_input) {
+      const auto last = std::find(chunk.rbegin(), chunk.rend(), '\n');
+      if (last == chunk.rend()) {
+        end_of_input = read_chunk(input, chunk_size, &chunk);
+        continue;
+      }
+      size = static_cast<std::size_t>(chunk.rend() - last);
+    }
+    next_chunk.assign(chunk.begin() + static_cast<std::ptrdiff_t>(size),
+                      chunk.end());
+
+    // The I/O thread writes the previous outputs and then reads the next
+    // chunk, while the workers process the current chunk.
+    bool next_end_of_input = end_of_input;
+    std::exception_ptr io_exception;
+    std::thread io_thread([&] {
+      try {
+        write_outputs(output, prev_outs);
+        if (!end_of_input) {
+          next_end_of_input = read_chunk(input, chunk_size, &next_chunk);
+        }
+      } catch (...) {
+        io_exception = std::current_exception();
+      }
+    });
+    try {
+      process_lines(chunk.data(), size, num_threads, process, &outs);
+    } catch (...) {
+      io_thread.join();
+      throw;
+    }
+    io_thread.join();
+    if (io_exception) {
+      std::rethrow_exception(io_exception);
+    }
+
+    outs.swap(prev_outs);
+    chunk.swap(next_chunk);
+    end_of_input = next_end_of_input;
+  }
+  write_outputs(output, prev_outs);
+  if (std::fflush(output) != 0) {
+    throw std::runtime_error("failed to write results");
+  }
+}
@@ -0,0 +1,52 @@
+#ifndef MARISA_LINE_BATCH_H_
+#define MARISA_LINE_BATCH_H_
+
+#include <charconv>
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <string_view>
+
+// A LineProcessor is called for each line, without '\n', by the worker
+// `worker_id` in [0, num_threads), and appends the output for the line to
+// `out`. Lines of a chunk are processed concurrently by different workers.
+// As with std::getline(), a '\r' before '\n' is a part of the line, and the
+// last line may lack '\n'.
+using LineProcessor = std::function<void(
+    std::size_t worker_id, std::string_view line, std::string *out)>;
+
+enum { LINE_BATCH_CHUNK_SIZE = 16 << 20 };
+
+// resolve_num_threads() returns `num_threads`, or the number of hardware
+// threads if `num_threads` == 0.
+std::size_t resolve_num_threads(std::size_t num_threads);
+
+// run_line_batch() reads `input` in chunks of `chunk_size` bytes, processes
+// the lines of each chunk on `num_threads` threads, and writes the outputs
+// to `output` in the order of lines. The next chunk is read and the outputs
+// of the previous chunk are written while a chunk is processed. An exception
+// thrown by `process` is rethrown after the running workers stop, and I/O
+// errors are reported as std::runtime_error.
+void run_line_batch(std::FILE *input, std::FILE *output,
+                    std::size_t num_threads, const LineProcessor &process,
+                    std::size_t chunk_size = LINE_BATCH_CHUNK_SIZE);
+
+// split_lines() splits [data, data + size) into `num_tasks` tasks at line
+// boundaries and calls `process` for each line, without '\n', on
+// `num_threads` threads. The lines of a task are processed in order by one
+// worker.
+using TaskLineProcessor = std::function<void(
+    std::size_t worker_id, std::size_t task_id, std::string_view line)>;
+void split_lines(const char *data, std::size_t size, std::size_t num_tasks,
+                 std::size_t num_threads, const TaskLineProcessor &process);
+
+// append_number() appends the decimal representation of `value` to `out`.
+inline void append_number(std::string *out, std::size_t value) {
+  char buf[24];
+  const std::to_chars_result result =
+      std::to_chars(buf, buf + sizeof(buf), value);
+  out->append(buf, result.ptr);
+}
+
+#endif  // MARISA_LINE_BATCH_H_
@@ -1,11 +1,24 @@
+#ifndef _WIN32
+ #include <fcntl.h>
+ #include <sys/resource.h>
+ #include <unistd.h>
+#endif  // _WIN32
+
 #include <marisa.h>
+#include <marisa/async-trie.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
 #include <exception>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -18,9 +31,14 @@ int param_max_num_tries = 5;
 marisa::TailMode param_tail_mode = MARISA_DEFAULT_TAIL;
 marisa::NodeOrder param_node_order = MARISA_DEFAULT_ORDER;
 marisa::CacheLevel param_cache_level = MARISA_DEFAULT_CACHE;
+bool param_centroid_on = false;
+bool param_dfuds_on = false;
 bool param_predict_on = true;
 bool param_reuse_on = true;
 bool param_print_speed = true;
+const char *param_load_filename = nullptr;
+const char *param_async_filename = nullptr;
+const char *param_save_filename = nullptr;
 
 class Clock {
  public:
@@ -39,6 +57,26 @@ class Clock {
   std::clock_t cl_;
 };
 
+// WallClock measures elapsed real time. Clock measures CPU time, which does
+// not include the time spent waiting for page faults and disk reads.
+class WallClock {
+ public:
+  WallClock() : begin_(std::chrono::steady_clock::now()) {}
+
+  void reset() {
+    begin_ = std::chrono::steady_clock::now();
+  }
+
+  double elapsed() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         begin_)
+        .count();
+  }
+
+ private:
+  std::chrono::steady_clock::time_point begin_;
+};
+
 void print_help(const char *cmd) {
   std::cerr
       << "Usage: " << cmd
@@ -56,12 +94,32 @@ void print_help(const char *cmd) {
          "  -l, --label-order   arrange siblings in label order\n"
          "  -c, --cache-level=[N]    specify the cache size"
          " [1, 5] (default: 3)\n"
+         "  -C, --centroid-trie also benchmark a path-decomposed trie, shown"
+         " as\n"
+         "                      #tries `cent'\n"
+         "  -D, --dfuds-trie    also benchmark a trie in DFUDS, shown as"
+         " #tries\n"
+         "                      `dfuds'\n"
          "  -P, --predict-on    include predictive search (default)\n"
          "  -p, --predict-off   skip predictive search\n"
          "  -R, --reuse-on      reuse agents (default)\n"
          "  -r, --reuse-off     don't reuse agents\n"
          "  -S, --print-speed   print speed [1000 keys/s] (default)\n"
          "  -s, --print-time    print time [ns/key]\n"
+         "  -L, --load-bench=[FILE]  save a dictionary to FILE and measure"
+         " mmap(),\n"
+         "                      map(), load() and read() with cold and warm"
+         " page cache\n"
+         "  -A, --async-bench=[FILE]  mmap() an existing dictionary FILE,"
+         " which\n"
+         "                      may be larger than RAM, and look up the input"
+         " keys in\n"
+         "                      random order with cold page cache, blocking"
+         " and async\n"
+         "  -W, --save-bench=[FILE]  mmap() an existing dictionary FILE and"
+         " measure\n"
+         "                      save() to FILE.save with and without"
+         " MARISA_SAVE_ATOMIC\n"
          "  -h, --help          print this help\n"
          "\n";
 }
@@ -174,13 +232,14 @@ int read_keys(const char *const *args, std::size_t num_args,
 }
 
 void benchmark_build(marisa::Keyset &keyset, const std::vector<float> &weights,
-                     int num_tries, marisa::Trie *trie) {
+                     int num_tries, marisa::TrieType trie_type,
+                     marisa::Trie *trie) {
   for (std::size_t i = 0; i < keyset.size(); ++i) {
     keyset[i].set_weight(weights[i]);
   }
   Clock cl;
   trie->build(keyset, num_tries | param_tail_mode | param_node_order |
-                          param_cache_level);
+                          param_cache_level | trie_type);
   std::printf(" %10lu", static_cast<unsigned long>(trie->io_size()));
   print_time_info(keyset.size(), cl.elasped());
 }
@@ -323,16 +382,446 @@ void benchmark_predictive_search(const marisa::Trie &trie,
   print_time_info(keyset.size(), cl.elasped());
 }
 
+// benchmark_predictive_count() counts the keys that start with each key,
+// which a trie in DFUDS does without enumerating them.
+void benchmark_predictive_count(const marisa::Trie &trie,
+                                const marisa::Keyset &keyset) {
+  if (!param_predict_on) {
+    print_time_info(keyset.size(), 0.0);
+    return;
+  }
+
+  Clock cl;
+  marisa::Agent agent;
+  for (std::size_t i = 0; i < keyset.size(); ++i) {
+    agent.set_query(keyset[i].ptr(), keyset[i].length());
+    if (trie.predictive_count(agent) == 0) {
+      std::cerr << "error: predictive_count() failed\n";
+      return;
+    }
+  }
+  print_time_info(keyset.size(), cl.elasped());
+}
+
+#ifndef _WIN32
+
+enum LoadMethod {
+  LOAD_MMAP,
+  LOAD_MMAP_POPULATE,
+  LOAD_MAP,
+  LOAD_LOAD,
+  LOAD_READ,
+};
+
+const char *load_method_name(LoadMethod method) {
+  switch (method) {
+    case LOAD_MMAP: {
+      return "mmap";
+    }
+    case LOAD_MMAP_POPULATE: {
+      return "mmap+populate";
+    }
+    case LOAD_MAP: {
+      return "map";
+    }
+    case LOAD_LOAD: {
+      return "load";
+    }
+    case LOAD_READ: {
+      return "read";
+    }
+  }
+  return "-";
+}
+
+// Writes back dirty pages and drops the file from the page cache, so that the
+// next access has to read it from the disk.
+bool evict_page_cache(const char *filename) {
+  const int fd = ::open(filename, O_RDONLY);
+  if (fd == -1) {
+    return false;
+  }
+  bool success = (::fdatasync(fd) == 0);
+ #ifdef POSIX_FADV_DONTNEED
+  success = success && (::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0);
+ #else   // POSIX_FADV_DONTNEED
+  success = false;
+ #endif  // POSIX_FADV_DONTNEED
+  ::close(fd);
+  return success;
+}
+
+// A dictionary image for TrieSerializer::map(). The buffer is allocated as
+// uint64_t[] because map() requires 8-byte alignment.
+class MapBuffer {
+ public:
+  void read(const char *filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.seekg(0, std::ios::end)) {
+      throw std::runtime_error("failed to seek a dictionary file");
+    }
+    size_ = static_cast<std::size_t>(file.tellg());
+    buf_.reset(new uint64_t[(size_ + 7) / 8]);
+    file.seekg(0, std::ios::beg);
+    if (!file.read(reinterpret_cast<char *>(buf_.get()),
+                   static_cast<std::streamsize>(size_))) {
+      throw std::runtime_error("failed to read a dictionary file");
+    }
+  }
+
+  const void *data() const {
+    return buf_.get();
+  }
+  std::size_t size() const {
+    return size_;
+  }
+
+ private:
+  std::unique_ptr<uint64_t[]> buf_;
+  std::size_t size_ = 0;
+};
+
+void load_trie(LoadMethod method, const char *filename, MapBuffer &buf,
+               marisa::Trie &trie) {
+  marisa::TrieSerializer serializer(trie);
+  switch (method) {
+    case LOAD_MMAP: {
+      serializer.mmap(filename);
+      break;
+    }
+    case LOAD_MMAP_POPULATE: {
+      serializer.mmap(filename, MARISA_MAP_POPULATE);
+      break;
+    }
+    case LOAD_MAP: {
+      buf.read(filename);
+      serializer.map(buf.data(), buf.size());
+      break;
+    }
+    case LOAD_LOAD: {
+      serializer.load(filename);
+      break;
+    }
+    case LOAD_READ: {
+      const int fd = ::open(filename, O_RDONLY);
+      if (fd == -1) {
+        throw std::runtime_error("failed to open a dictionary file");
+      }
+      try {
+        serializer.read(fd);
+      } catch (...) {
+        ::close(fd);
+        throw;
+      }
+      ::close(fd);
+      break;
+    }
+  }
+}
+
+// Returns the latency at the `ratio` quantile. `latencies` is reordered.
+double percentile(std::vector<double> &latencies, double ratio) {
+  if (latencies.empty()) {
+    return 0.0;
+  }
+  const std::size_t pos = std::min(
+      latencies.size() - 1,
+      static_cast<std::size_t>(static_cast<double>(latencies.size()) * ratio));
+  std::nth_element(latencies.begin(),
+                   latencies.begin() + static_cast<std::ptrdiff_t>(pos),
+                   latencies.end());
+  return latencies[pos];
+}
+
+// Looks up all the keys one by one and stores the latency of each lookup in
+// seconds. Returns false if a lookup fails.
+bool timed_lookups(const marisa::Trie &trie, const marisa::Keyset &keyset,
+                   std::vector<double> &latencies) {
+  latencies.resize(keyset.size());
+  marisa::Agent agent;
+  for (std::size_t i = 0; i < keyset.size(); ++i) {
+    WallClock cl;
+    agent.set_query(keyset[i].ptr(), keyset[i].length());
+    const bool found = trie.lookup(agent);
+    latencies[i] = cl.elapsed();
+    if (!found || (agent.key().id() != keyset[i].id())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns the time from the beginning of the first pass until the p99 latency
+// of a window of lookups falls within 1.5x of the p99 latency of the warm
+// pass. The first pass is `cold` and the warm pass is `warm`.
+double steady_state_time(const std::vector<double> &cold,
+                         std::vector<double> warm) {
+  const double steady_p99 = percentile(warm, 0.99);
+  const std::size_t window_size = std::max<std::size_t>(100, cold.size() / 100);
+
+  double total = 0.0;
+  std::vector<double> window;
+  for (std::size_t begin = 0; begin < cold.size(); begin += window_size) {
+    const std::size_t end = std::min(cold.size(), begin + window_size);
+    window.assign(cold.begin() + static_cast<std::ptrdiff_t>(begin),
+                  cold.begin() + static_cast<std::ptrdiff_t>(end));
+    for (std::size_t i = begin; i < end; ++i) {
+      total += cold[i];
+    }
+    if (percentile(window, 0.99) <= (steady_p99 * 1.5)) {
+      return total;
+    }
+  }
+  return total;
+}
+
+void benchmark_load(const char *filename, LoadMethod method, bool cold,
+                    const marisa::Keyset &keyset) {
+  std::printf("%-14s %5s", load_method_name(method), cold ? "cold" : "warm");
+  if (cold && !evict_page_cache(filename)) {
+    std::printf(" %10s\n", "failed to evict the page cache");
+    return;
+  }
+
+  ::rusage usage_before;
+  ::getrusage(RUSAGE_SELF, &usage_before);
+
+  marisa::Trie trie;
+  MapBuffer buf;
+  WallClock cl;
+  load_trie(method, filename, buf, trie);
+  const double load_time = cl.elapsed();
+
+  std::vector<double> first_pass;
+  if (!timed_lookups(trie, keyset, first_pass)) {
+    std::cerr << "error: lookup() failed\n";
+    return;
+  }
+
+  ::rusage usage_after;
+  ::getrusage(RUSAGE_SELF, &usage_after);
+
+  std::vector<double> warm_pass;
+  if (!timed_lookups(trie, keyset, warm_pass)) {
+    std::cerr << "error: lookup() failed\n";
+    return;
+  }
+
+  const double first_time = first_pass.empty() ? 0.0 : first_pass.front();
+  const double steady_time = steady_state_time(first_pass, warm_pass);
+  const double p99 = percentile(warm_pass, 0.99);
+  std::printf(" %10.1f %10.1f %10.1f %8.1f %8ld %8ld\n", load_time * 1000000.0,
+              (load_time + first_time) * 1000000.0,
+              (load_time + steady_time) * 1000000.0, p99 * 1000000000.0,
+              usage_after.ru_minflt - usage_before.ru_minflt,
+              usage_after.ru_majflt - usage_before.ru_majflt);
+}
+
+void benchmark_load(marisa::Keyset &keyset, const std::vector<float> &weights) {
+  for (std::size_t i = 0; i < keyset.size(); ++i) {
+    keyset[i].set_weight(weights[i]);
+  }
+  {
+    marisa::Trie trie;
+    trie.build(keyset, param_max_num_tries | param_tail_mode |
+                           param_node_order | param_cache_level);
+    marisa::TrieSerializer(trie).save(param_load_filename);
+  }
+
+  std::printf("\nDictionary: %s (#tries: %d)\n", param_load_filename,
+              param_max_num_tries);
+  std::printf(
+      "--------------+-----+----------+----------+----------+--------+"
+      "--------+--------\n");
+  std::printf("%-14s %5s %10s %10s %10s %8s %8s %8s\n", "method", "cache",
+              "load", "first", "steady", "p99", "minor", "major");
+  std::printf("%-14s %5s %10s %10s %10s %8s %8s %8s\n", "", "", "", "query",
+              "state", "lookup", "faults", "faults");
+  std::printf("%-14s %5s %10s %10s %10s %8s %8s %8s\n", "", "", "[us]", "[us]",
+              "[us]", "[ns]", "", "");
+  std::printf(
+      "--------------+-----+----------+----------+----------+--------+"
+      "--------+--------\n");
+  const LoadMethod methods[] = {LOAD_MMAP, LOAD_MMAP_POPULATE, LOAD_MAP,
+                                LOAD_LOAD, LOAD_READ};
+  for (const LoadMethod method : methods) {
+    benchmark_load(param_load_filename, method, true, keyset);
+    benchmark_load(param_load_filename, method, false, keyset);
+  }
+  std::printf(
+      "--------------+-----+----------+----------+----------+--------+"
+      "--------+--------\n");
+}
+
+#else   // _WIN32
+
+void benchmark_load(marisa::Keyset &, const std::vector<float> &) {
+  std::cerr << "error: load benchmark is not supported on this platform\n";
+}
+
+#endif  // _WIN32
+
+#if !(defined _WIN32) && (defined MARISA_HAS_ASYNC_TRIE)
+
+// Looks up the keys with cold page cache. Lookups block on page faults if
+// `max_in_flight` is 0, and otherwise run as interleaved AsyncTrie tasks.
+void benchmark_async(const char *filename, std::size_t max_in_flight,
+                     const marisa::Keyset &keyset,
+                     const std::vector<std::size_t> &order) {
+  if (max_in_flight == 0) {
+    std::printf("%-10s", "blocking");
+  } else {
+    std::printf("async x%-3zu", max_in_flight);
+  }
+  if (!evict_page_cache(filename)) {
+    std::printf(" %10s\n", "failed to evict the page cache");
+    return;
+  }
+
+  marisa::Trie trie;
+  marisa::TrieSerializer(trie).mmap(filename);
+  // mmap() reads headers, which may bring the following pages ahead.
+  evict_page_cache(filename);
+  std::vector<marisa::Agent> agents(order.size());
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    agents[i].set_query(keyset[order[i]].ptr(), keyset[order[i]].length());
+  }
+  std::unique_ptr<bool[]> found(new bool[order.size()]);
+
+  ::rusage usage_before;
+  ::getrusage(RUSAGE_SELF, &usage_before);
+
+  std::size_t num_found = 0;
+  std::size_t num_suspensions = 0;
+  WallClock cl;
+  if (max_in_flight == 0) {
+    for (std::size_t i = 0; i < order.size(); ++i) {
+      found[i] = trie.lookup(agents[i]);
+      num_found += found[i] ? 1 : 0;
+    }
+  } else {
+    const marisa::AsyncTrie async_trie(trie);
+    num_found = async_trie.lookup(agents.data(), found.get(), agents.size(),
+                                  max_in_flight);
+    num_suspensions = async_trie.num_suspensions();
+  }
+  const double elapsed = cl.elapsed();
+
+  ::rusage usage_after;
+  ::getrusage(RUSAGE_SELF, &usage_after);
+
+  std::printf(" %10.1f %10.1f %8ld %12zu %10zu\n", elapsed * 1000.0,
+              elapsed * 1000000000.0 / static_cast<double>(order.size()),
+              usage_after.ru_majflt - usage_before.ru_majflt, num_suspensions,
+              num_found);
+}
+
+void benchmark_async(const marisa::Keyset &keyset) {
+  std::vector<std::size_t> order(keyset.size());
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::mt19937 random(0);
+  std::shuffle(order.begin(), order.end(), random);
+
+  std::printf("\nDictionary: %s (#queries: %zu)\n", param_async_filename,
+              order.size());
+  std::printf(
+      "----------+----------+----------+--------+------------+----------\n");
+  std::printf("%-10s %10s %10s %8s %12s %10s\n", "mode", "total", "lookup",
+              "major", "suspensions", "found");
+  std::printf("%-10s %10s %10s %8s %12s %10s\n", "", "[ms]", "[ns]", "faults",
+              "", "");
+  std::printf(
+      "----------+----------+----------+--------+------------+----------\n");
+  const std::size_t max_in_flights[] = {0, 1, 4, 16, 64};
+  for (const std::size_t max_in_flight : max_in_flights) {
+    benchmark_async(param_async_filename, max_in_flight, keyset, order);
+  }
+  std::printf(
+      "----------+----------+----------+--------+------------+----------\n");
+}
+
+#else   // !(defined _WIN32) && (defined MARISA_HAS_ASYNC_TRIE)
+
+void benchmark_async(const marisa::Keyset &) {
+  std::cerr << "error: async benchmark is not supported on this platform\n";
+}
+
+#endif  // !(defined _WIN32) && (defined MARISA_HAS_ASYNC_TRIE)
+
+#ifndef _WIN32
+
+// Saves `trie` to `filename`. A plain save does not flush the file to the
+// disk, so `sync` adds fdatasync() for comparison with an atomic save.
+void benchmark_save(marisa::Trie &trie, const char *filename,
+                    const char *mode, int flags, bool sync) {
+  std::printf("%-10s", mode);
+  std::fflush(stdout);
+
+  WallClock cl;
+  marisa::TrieSerializer(trie).save(filename, flags);
+  if (sync) {
+    const int fd = ::open(filename, O_RDONLY);
+    const bool success = (fd != -1) && (::fdatasync(fd) == 0);
+    if (fd != -1) {
+      ::close(fd);
+    }
+    if (!success) {
+      std::printf(" %10s\n", "failed to sync the file");
+      return;
+    }
+  }
+  const double elapsed = cl.elapsed();
+
+  std::printf(" %10.1f %10.1f\n", elapsed * 1000.0,
+              static_cast<double>(trie.io_size()) / elapsed / 1000000.0);
+}
+
+void benchmark_save() {
+  marisa::Trie trie;
+  marisa::TrieSerializer(trie).mmap(param_save_filename);
+  const std::string filename = std::string(param_save_filename) + ".save";
+
+  std::printf("\nDictionary: %s (size: %zu)\n", param_save_filename,
+              trie.io_size());
+  std::printf("----------+----------+----------\n");
+  std::printf("%-10s %10s %10s\n", "mode", "total", "throughput");
+  std::printf("%-10s %10s %10s\n", "", "[ms]", "[MB/s]");
+  std::printf("----------+----------+----------\n");
+  benchmark_save(trie, filename.c_str(), "save", 0, false);
+  benchmark_save(trie, filename.c_str(), "save+sync", 0, true);
+  benchmark_save(trie, filename.c_str(), "atomic", MARISA_SAVE_ATOMIC, false);
+  std::printf("----------+----------+----------\n");
+  std::remove(filename.c_str());
+}
+
+#else   // _WIN32
+
+void benchmark_save() {
+  std::cerr << "error: save benchmark is not supported on this platform\n";
+}
+
+#endif  // _WIN32
+
 void benchmark(marisa::Keyset &keyset, const std::vector<float> &weights,
-               int num_tries) {
-  std::printf("%6d", num_tries);
+               int num_tries,
+               marisa::TrieType trie_type = MARISA_DEFAULT_TRIE_TYPE) {
+  if (trie_type == MARISA_CENTROID_TRIE) {
+    std::printf("%6s", "cent");
+  } else if (trie_type == MARISA_DFUDS_TRIE) {
+    std::printf("%6s", "dfuds");
+  } else {
+    std::printf("%6d", num_tries);
+  }
   marisa::Trie trie;
-  benchmark_build(keyset, weights, num_tries, &trie);
+  benchmark_build(keyset, weights, num_tries, trie_type, &trie);
   if (!trie.empty()) {
     benchmark_lookup(trie, keyset);
     benchmark_reverse_lookup(trie, keyset);
     benchmark_common_prefix_search(trie, keyset);
     benchmark_predictive_search(trie, keyset);
+    benchmark_predictive_count(trie, keyset);
   }
   std::printf("\n");
 }
@@ -344,26 +833,41 @@ int benchmark(const char *const *args, std::size_t num_args) try {
   if (ret != 0) {
     return ret;
   }
-  std::printf(
-      "------+----------+--------+--------+--------+--------+--------\n");
-  std::printf("%6s %10s %8s %8s %8s %8s %8s\n", "#tries", "size", "build",
-              "lookup", "reverse", "prefix", "predict");
-  std::printf("%6s %10s %8s %8s %8s %8s %8s\n", "", "", "", "", "lookup",
-              "search", "search");
+  std::printf("------+----------+--------+--------+--------+--------+--------+"
+              "--------\n");
+  std::printf("%6s %10s %8s %8s %8s %8s %8s %8s\n", "#tries", "size",
+              "build", "lookup", "reverse", "prefix", "predict", "predict");
+  std::printf("%6s %10s %8s %8s %8s %8s %8s %8s\n", "", "", "", "", "lookup",
+              "search", "search", "count");
   if (param_print_speed) {
-    std::printf("%6s %10s %8s %8s %8s %8s %8s\n", "", "[bytes]", "[K/s]",
-                "[K/s]", "[K/s]", "[K/s]", "[K/s]");
+    std::printf("%6s %10s %8s %8s %8s %8s %8s %8s\n", "", "[bytes]", "[K/s]",
+                "[K/s]", "[K/s]", "[K/s]", "[K/s]", "[K/s]");
   } else {
-    std::printf("%6s %10s %8s %8s %8s %8s %8s\n", "", "[bytes]", "[ns]", "[ns]",
-                "[ns]", "[ns]", "[ns]");
+    std::printf("%6s %10s %8s %8s %8s %8s %8s %8s\n", "", "[bytes]", "[ns]",
+                "[ns]", "[ns]", "[ns]", "[ns]", "[ns]");
   }
-  std::printf(
-      "------+----------+--------+--------+--------+--------+--------\n");
+  std::printf("------+----------+--------+--------+--------+--------+--------+"
+              "--------\n");
   for (int i = param_min_num_tries; i <= param_max_num_tries; ++i) {
     benchmark(keyset, weights, i);
   }
-  std::printf(
-      "------+----------+--------+--------+--------+--------+--------\n");
+  if (param_centroid_on) {
+    benchmark(keyset, weights, MARISA_DEFAULT_NUM_TRIES, MARISA_CENTROID_TRIE);
+  }
+  if (param_dfuds_on) {
+    benchmark(keyset, weights, MARISA_DEFAULT_NUM_TRIES, MARISA_DFUDS_TRIE);
+  }
+  std::printf("------+----------+--------+--------+--------+--------+--------+"
+              "--------\n");
+  if (param_load_filename != nullptr) {
+    benchmark_load(keyset, weights);
+  }
+  if (param_async_filename != nullptr) {
+    benchmark_async(keyset);
+  }
+  if (param_save_filename != nullptr) {
+    benchmark_save();
+  }
   return 0;
 } catch (const std::exception &ex) {
   std::cerr << ex.what() << "\n";
@@ -382,16 +886,21 @@ int main(int argc, char *argv[]) {
                                     {"weight-order", 0, nullptr, 'w'},
                                     {"label-order", 0, nullptr, 'l'},
                                     {"cache-level", 1, nullptr, 'c'},
+                                    {"centroid-trie", 0, nullptr, 'C'},
+                                    {"dfuds-trie", 0, nullptr, 'D'},
                                     {"predict-on", 0, nullptr, 'P'},
                                     {"predict-off", 0, nullptr, 'p'},
                                     {"reuse-on", 0, nullptr, 'R'},
                                     {"reuse-off", 0, nullptr, 'r'},
                                     {"print-speed", 0, nullptr, 'S'},
                                     {"print-time", 0, nullptr, 's'},
+                                    {"load-bench", 1, nullptr, 'L'},
+                                    {"async-bench", 1, nullptr, 'A'},
+                                    {"save-bench", 1, nullptr, 'W'},
                                     {"help", 0, nullptr, 'h'},
                                     {nullptr, 0, nullptr, 0}};
   ::cmdopt_t cmdopt;
-  ::cmdopt_init(&cmdopt, argc, argv, "N:n:tbwlc:PpRrSsh", long_options);
+  ::cmdopt_init(&cmdopt, argc, argv, "N:n:tbwlc:CDPpRrSsL:A:W:h", long_options);
   int label;
   while ((label = ::cmdopt_get(&cmdopt)) != -1) {
     switch (label) {
@@ -456,6 +965,14 @@ int main(int argc, char *argv[]) {
         }
         break;
       }
+      case 'C': {
+        param_centroid_on = true;
+        break;
+      }
+      case 'D': {
+        param_dfuds_on = true;
+        break;
+      }
       case 'P': {
         param_predict_on = true;
         break;
@@ -480,6 +997,18 @@ int main(int argc, char *argv[]) {
         param_print_speed = false;
         break;
       }
+      case 'L': {
+        param_load_filename = cmdopt.optarg;
+        break;
+      }
+      case 'A': {
+        param_async_filename = cmdopt.optarg;
+        break;
+      }
+      case 'W': {
+        param_save_filename = cmdopt.optarg;
+        break;
+      }
       case 'h': {
         print_help(argv[0]);
         return 0;
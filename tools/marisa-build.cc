@@ -2,17 +2,32 @@
  #include <fcntl.h>
  #include <io.h>
  #include <stdio.h>
+#else  // _WIN32
+ #include <fcntl.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
 #endif  // _WIN32
 
 #include <marisa.h>
 
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <exception>
 #include <fstream>
 #include <iostream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
 
 #include "cmdopt.h"
+#include "line-batch.h"
 
 namespace {
 
@@ -20,7 +35,16 @@ int param_num_tries = MARISA_DEFAULT_NUM_TRIES;
 marisa::TailMode param_tail_mode = MARISA_DEFAULT_TAIL;
 marisa::NodeOrder param_node_order = MARISA_DEFAULT_ORDER;
 marisa::CacheLevel param_cache_level = MARISA_DEFAULT_CACHE;
+marisa::TrieType param_trie_type = MARISA_DEFAULT_TRIE_TYPE;
 const char *output_filename = nullptr;
+int save_flags = 0;
+bool compress_flag = false;
+bool deduplicate_flag = false;
+bool verbose_flag = false;
+std::size_t num_threads = 0;
+
+// Each input file is parsed in this number of tasks per thread.
+constexpr std::size_t NUM_PARSE_TASKS_PER_THREAD = 4;
 
 void print_help(const char *cmd) {
   std::cerr
@@ -36,53 +60,180 @@ void print_help(const char *cmd) {
          "  -l, --label-order    arrange siblings in label order\n"
          "  -c, --cache-level=[N]    specify the cache size"
          " [1, 5] (default: 3)\n"
+         "  -C, --centroid-trie  build a path-decomposed trie, which is faster"
+         "\n"
+         "                       for long keys but larger, and ignores the"
+         " above\n"
+         "  -D, --dfuds-trie     build a single-level trie in DFUDS, which is"
+         " faster\n"
+         "                       for predictive search, and ignores the above"
+         " but\n"
+         "                       the tail mode\n"
          "  -o, --output=[FILE]  write tries to FILE (default: stdout)\n"
+         "  -H, --hot-first      place the first trie at the beginning of"
+         " FILE\n"
+         "                       for faster memory-mapped lookups\n"
+         "  -a, --atomic         replace FILE atomically after flushing it to"
+         " the disk\n"
+         "  -z, --compress       write a compressed dictionary to FILE,"
+         " which\n"
+         "                       is read by TrieSerializer::load_compressed()\n"
+         "  -d, --deduplicate    merge duplicate keys and sum their weights"
+         " before\n"
+         "                       building a dictionary\n"
+         "  -j, --threads=[N]    parse input files on N threads"
+         " (default: number of CPUs)\n"
+         "  -v, --verbose        print the input throughput and the time and"
+         " memory\n"
+         "                       of build phases\n"
          "  -h, --help           print this help\n"
          "\n";
 }
 
-void read_keys(std::istream &input, marisa::Keyset *keyset) {
+// push_key() parses a line of "KEY" or "KEY<TAB>WEIGHT". As with
+// std::strtod(), the weight is the number at the beginning of the text after
+// the last tab, and the text is removed from the key only if it is a number
+// as a whole. Unlike std::strtod(), leading spaces and '+' are not accepted.
+void push_key(std::string_view line, marisa::Keyset *keyset) {
+  const std::string_view::size_type delim_pos = line.find_last_of('\t');
+  float weight = 1.0F;
+  if (delim_pos != line.npos) {
+    const char *const first = line.data() + delim_pos + 1;
+    const char *const last = line.data() + line.size();
+    double value = 0.0;
+    const std::from_chars_result result = std::from_chars(first, last, value);
+    weight = (result.ec == std::errc()) ? static_cast<float>(value) : 0.0F;
+    if (result.ptr == last) {
+      line = line.substr(0, delim_pos);
+    }
+  }
+  keyset->push_back(line.data(), line.length(), weight);
+}
+
+void read_keys(std::istream &input, marisa::Keyset *keyset,
+               std::size_t *num_bytes) {
   std::string line;
   while (std::getline(input, line)) {
-    const std::string::size_type delim_pos = line.find_last_of('\t');
-    float weight = 1.0F;
-    if (delim_pos != line.npos) {
-      char *end_of_value;
-      weight =
-          static_cast<float>(std::strtod(&line[delim_pos + 1], &end_of_value));
-      if (*end_of_value == '\0') {
-        line.resize(delim_pos);
+    push_key(line, keyset);
+    *num_bytes += line.length() + 1;
+  }
+}
+
+// read_keys() parses an input file in memory on multiple threads. Each task
+// fills its own keyset, and the keysets are appended in order.
+void read_keys(const char *data, std::size_t size, marisa::Keyset *keyset) {
+  std::vector<marisa::Keyset> keysets(resolve_num_threads(num_threads) *
+                                      NUM_PARSE_TASKS_PER_THREAD);
+  split_lines(data, size, keysets.size(), num_threads,
+              [&keysets](std::size_t, std::size_t task_id,
+                         std::string_view line) {
+                push_key(line, &keysets[task_id]);
+              });
+  for (marisa::Keyset &task_keyset : keysets) {
+    keyset->append(task_keyset);
+  }
+}
+
+// read_file() returns false if `filename` cannot be opened.
+bool read_file(const char *filename, marisa::Keyset *keyset,
+               std::size_t *num_bytes) {
+#ifndef _WIN32
+  // A regular file is mapped into memory and parsed on multiple threads.
+  const int fd = ::open(filename, O_RDONLY);
+  if (fd == -1) {
+    return false;
+  }
+  struct stat st;
+  if ((::fstat(fd, &st) == 0) && S_ISREG(st.st_mode)) {
+    const std::size_t size = static_cast<std::size_t>(st.st_size);
+    void *const ptr =
+        (size != 0) ? ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0)
+                    : nullptr;
+    const int error_value = errno;
+    ::close(fd);
+    if (ptr == MAP_FAILED) {
+      throw std::system_error(error_value, std::generic_category(), "mmap");
+    }
+    if (ptr != nullptr) {
+      ::posix_madvise(ptr, size, POSIX_MADV_SEQUENTIAL);
+      try {
+        read_keys(static_cast<const char *>(ptr), size, keyset);
+      } catch (...) {
+        ::munmap(ptr, size);
+        throw;
       }
+      ::munmap(ptr, size);
     }
-    keyset->push_back(line.c_str(), line.length(), weight);
+    *num_bytes += size;
+    return true;
+  }
+  ::close(fd);
+#endif  // _WIN32
+
+  std::ifstream input_file(filename, std::ios::binary);
+  if (!input_file) {
+    return false;
+  }
+  read_keys(input_file, keyset, num_bytes);
+  return true;
+}
+
+void print_report(const marisa::BuildReport &report) {
+  std::fprintf(stderr, "%-10s %4s %10s %16s %16s\n", "phase", "trie",
+               "time [s]", "allocated [B]", "peak RSS [B]");
+  for (const marisa::BuildPhase &phase : report.phases()) {
+    std::fprintf(stderr, "%-10s %4zu %10.3f %16zu %16zu\n", phase.name(),
+                 phase.trie_id(), phase.seconds(), phase.allocated_bytes(),
+                 phase.peak_resident());
   }
+  std::fprintf(stderr, "%-10s %4s %10.3f %16zu %16zu\n", "total", "",
+               report.total_seconds(), report.total_allocated_bytes(),
+               report.peak_resident());
 }
 
 int build(const char *const *args, std::size_t num_args) {
   marisa::Keyset keyset;
+  std::size_t num_bytes = 0;
+  const auto parse_begin = std::chrono::steady_clock::now();
   if (num_args == 0) try {
-      read_keys(std::cin, &keyset);
+      read_keys(std::cin, &keyset, &num_bytes);
     } catch (const std::exception &ex) {
       std::cerr << ex.what() << ": failed to read keys\n";
       return 10;
     }
 
   for (std::size_t i = 0; i < num_args; ++i) try {
-      std::ifstream input_file(args[i], std::ios::binary);
-      if (!input_file) {
+      if (!read_file(args[i], &keyset, &num_bytes)) {
         std::cerr << "error: failed to open: " << args[i] << "\n";
         return 11;
       }
-      read_keys(input_file, &keyset);
     } catch (const std::exception &ex) {
-      std::cerr << ex.what() << ": failed to read keys\n";
+      std::cerr << ex.what() << ": failed to read keys: " << args[i] << "\n";
       return 12;
     }
+  if (verbose_flag) {
+    const double seconds = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - parse_begin)
+                               .count();
+    std::fprintf(stderr, "input: %zu bytes, %zu keys in %.3f s (%.1f MB/s)\n",
+                 num_bytes, keyset.size(), seconds,
+                 (seconds > 0.0)
+                     ? (static_cast<double>(num_bytes) / seconds / 1000000.0)
+                     : 0.0);
+  }
+
+  if (deduplicate_flag) {
+    const std::size_t num_removed_keys = keyset.deduplicate();
+    std::cerr << "#duplicates: " << num_removed_keys << "\n";
+  }
 
   marisa::Trie trie;
+  marisa::BuildReport report;
   try {
-    trie.build(keyset, param_num_tries | param_tail_mode | param_node_order |
-                           param_cache_level);
+    trie.build(keyset,
+               param_num_tries | param_tail_mode | param_node_order |
+                   param_cache_level | param_trie_type,
+               report);
   } catch (const std::exception &ex) {
     std::cerr << ex.what() << ": failed to build a dictionary\n";
     return 20;
@@ -91,10 +242,19 @@ int build(const char *const *args, std::size_t num_args) {
   std::cerr << "#keys: " << trie.num_keys() << "\n";
   std::cerr << "#nodes: " << trie.num_nodes() << "\n";
   std::cerr << "size: " << trie.io_size() << "\n";
+  if (verbose_flag) {
+    std::cerr << std::flush;
+    print_report(report);
+  }
 
   if (output_filename != nullptr) {
     try {
-      trie.save(output_filename);
+      if (compress_flag) {
+        marisa::TrieSerializer(trie).save_compressed(output_filename,
+                                                     save_flags);
+      } else {
+        marisa::TrieSerializer(trie).save(output_filename, save_flags);
+      }
     } catch (const std::exception &ex) {
       std::cerr << ex.what()
                 << ": failed to write a dictionary to file: " << output_filename
@@ -115,7 +275,12 @@ int build(const char *const *args, std::size_t num_args) {
     }
 #endif  // _WIN32
     try {
-      std::cout << trie;
+      if (save_flags != 0) {
+        std::cout.flush();
+        marisa::TrieSerializer(trie).write(1, save_flags);
+      } else {
+        std::cout << trie;
+      }
     } catch (const std::exception &ex) {
       std::cerr << ex.what()
                 << ": failed to write a dictionary to standard output\n";
@@ -138,11 +303,19 @@ int main(int argc, char *argv[]) {
       {"weight-order", 0, nullptr, 'w'},
       {"label-order", 0, nullptr, 'l'},
       {"cache-level", 1, nullptr, 'c'},
+      {"centroid-trie", 0, nullptr, 'C'},
+      {"dfuds-trie", 0, nullptr, 'D'},
       {"output", 1, nullptr, 'o'},
+      {"hot-first", 0, nullptr, 'H'},
+      {"atomic", 0, nullptr, 'a'},
+      {"compress", 0, nullptr, 'z'},
+      {"deduplicate", 0, nullptr, 'd'},
+      {"threads", 1, nullptr, 'j'},
+      {"verbose", 0, nullptr, 'v'},
       {"help", 0, nullptr, 'h'},
       {nullptr, 0, nullptr, 0}};
   ::cmdopt_t cmdopt;
-  ::cmdopt_init(&cmdopt, argc, argv, "n:tbwlc:o:h", long_options);
+  ::cmdopt_init(&cmdopt, argc, argv, "n:tbwlc:CDo:Hazdj:vh", long_options);
   int label;
   while ((label = ::cmdopt_get(&cmdopt)) != -1) {
     switch (label) {
@@ -195,10 +368,49 @@ int main(int argc, char *argv[]) {
         }
         break;
       }
+      case 'C': {
+        param_trie_type = MARISA_CENTROID_TRIE;
+        break;
+      }
+      case 'D': {
+        param_trie_type = MARISA_DFUDS_TRIE;
+        break;
+      }
       case 'o': {
         output_filename = cmdopt.optarg;
         break;
       }
+      case 'H': {
+        save_flags |= MARISA_SAVE_HOT_FIRST;
+        break;
+      }
+      case 'a': {
+        save_flags |= MARISA_SAVE_ATOMIC;
+        break;
+      }
+      case 'z': {
+        compress_flag = true;
+        break;
+      }
+      case 'd': {
+        deduplicate_flag = true;
+        break;
+      }
+      case 'j': {
+        char *end_of_value;
+        const long value = std::strtol(cmdopt.optarg, &end_of_value, 10);
+        if ((*end_of_value != '\0') || (value < 0)) {
+          std::cerr << "error: option `-j' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 3;
+        }
+        num_threads = static_cast<std::size_t>(value);
+        break;
+      }
+      case 'v': {
+        verbose_flag = true;
+        break;
+      }
       case 'h': {
         print_help(argv[0]);
         return 0;
@@ -208,6 +420,15 @@ int main(int argc, char *argv[]) {
       }
     }
   }
+  if (compress_flag && (output_filename == nullptr)) {
+    std::cerr << "error: --compress requires --output\n";
+    return 1;
+  }
+  if (((save_flags & MARISA_SAVE_ATOMIC) != 0) &&
+      (output_filename == nullptr)) {
+    std::cerr << "error: --atomic requires --output\n";
+    return 1;
+  }
   return build(cmdopt.argv + cmdopt.optind,
                static_cast<std::size_t>(cmdopt.argc - cmdopt.optind));
 }
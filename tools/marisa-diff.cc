@@ -0,0 +1,160 @@
+#include <marisa.h>
+
+#include <exception>
+#include <iostream>
+#include <string>
+
+#include "cmdopt.h"
+
+namespace {
+
+bool mmap_flag = true;
+bool moved_flag = true;
+
+void print_help(const char *cmd) {
+  std::cerr
+      << "Usage: " << cmd
+      << " [OPTION]... OLD_DIC NEW_DIC\n\n"
+         "Prints the keys that differ between two dictionaries in"
+         " lexicographic\n"
+         "order, one per line:\n"
+         "  +<TAB>NEW_ID<TAB>KEY         a key only in NEW_DIC\n"
+         "  -<TAB>OLD_ID<TAB>KEY         a key only in OLD_DIC\n"
+         "  ~<TAB>OLD_ID<TAB>NEW_ID<TAB>KEY  a key whose ID has changed\n"
+         "The numbers of added, removed and moved keys are printed to"
+         " stderr.\n\n"
+         "Options:\n"
+         "  -m, --mmap-dictionary  use memory-mapped I/O to load dictionaries"
+         " (default)\n"
+         "  -r, --read-dictionary  read entire dictionaries into memory\n"
+         "  -M, --no-moved         don't print keys whose IDs have changed\n"
+         "  -h, --help             print this help\n"
+         "\n";
+}
+
+int open_dictionary(const char *filename, marisa::Trie *trie) {
+  if (mmap_flag) {
+    try {
+      marisa::TrieSerializer(*trie).mmap(filename);
+    } catch (const std::exception &ex) {
+      std::cerr << ex.what() << ": failed to mmap a dictionary file: "
+                << filename << "\n";
+      return 20;
+    }
+  } else {
+    try {
+      marisa::TrieSerializer(*trie).load(filename);
+    } catch (const std::exception &ex) {
+      std::cerr << ex.what() << ": failed to load a dictionary file: "
+                << filename << "\n";
+      return 21;
+    }
+  }
+  return 0;
+}
+
+int diff(const char *const *args, std::size_t num_args) {
+  if (num_args < 2) {
+    std::cerr << "error: two dictionaries are required\n";
+    return 10;
+  }
+  if (num_args > 2) {
+    std::cerr << "error: more than two dictionaries are specified\n";
+    return 11;
+  }
+
+  marisa::Trie old_trie;
+  marisa::Trie new_trie;
+  int ret = open_dictionary(args[0], &old_trie);
+  if (ret != 0) {
+    return ret;
+  }
+  ret = open_dictionary(args[1], &new_trie);
+  if (ret != 0) {
+    return ret;
+  }
+
+  std::size_t num_added_keys = 0;
+  std::size_t num_removed_keys = 0;
+  std::size_t num_moved_keys = 0;
+  try {
+    marisa::Trie::diff(
+        old_trie, new_trie, [&](const marisa::KeyDiff &key_diff) {
+          switch (key_diff.type()) {
+            case MARISA_KEY_ADDED: {
+              ++num_added_keys;
+              std::cout << "+\t" << key_diff.new_id() << '\t'
+                        << key_diff.key() << '\n';
+              break;
+            }
+            case MARISA_KEY_REMOVED: {
+              ++num_removed_keys;
+              std::cout << "-\t" << key_diff.old_id() << '\t'
+                        << key_diff.key() << '\n';
+              break;
+            }
+            case MARISA_KEY_MOVED: {
+              ++num_moved_keys;
+              if (moved_flag) {
+                std::cout << "~\t" << key_diff.old_id() << '\t'
+                          << key_diff.new_id() << '\t' << key_diff.key()
+                          << '\n';
+              }
+              break;
+            }
+          }
+        });
+  } catch (const std::exception &ex) {
+    std::cerr << ex.what() << ": failed to compare dictionaries\n";
+    return 30;
+  }
+  if (!std::cout) {
+    std::cerr << "error: failed to write results to standard output\n";
+    return 31;
+  }
+
+  std::cerr << "#added: " << num_added_keys << "\n";
+  std::cerr << "#removed: " << num_removed_keys << "\n";
+  std::cerr << "#moved: " << num_moved_keys << "\n";
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  std::ios::sync_with_stdio(false);
+
+  ::cmdopt_option long_options[] = {{"mmap-dictionary", 0, nullptr, 'm'},
+                                    {"read-dictionary", 0, nullptr, 'r'},
+                                    {"no-moved", 0, nullptr, 'M'},
+                                    {"help", 0, nullptr, 'h'},
+                                    {nullptr, 0, nullptr, 0}};
+  ::cmdopt_t cmdopt;
+  ::cmdopt_init(&cmdopt, argc, argv, "mrMh", long_options);
+  int label;
+  while ((label = ::cmdopt_get(&cmdopt)) != -1) {
+    switch (label) {
+      case 'm': {
+        mmap_flag = true;
+        break;
+      }
+      case 'r': {
+        mmap_flag = false;
+        break;
+      }
+      case 'M': {
+        moved_flag = false;
+        break;
+      }
+      case 'h': {
+        print_help(argv[0]);
+        return 0;
+      }
+      default: {
+        return 1;
+      }
+    }
+  }
+  return diff(cmdopt.argv + cmdopt.optind,
+              static_cast<std::size_t>(cmdopt.argc - cmdopt.optind));
+}
@@ -60,7 +60,7 @@ int dump(const char *filename) {
     std::cerr << "input: " << filename << "\n";
     if (mmap_flag) {
       try {
-        trie.mmap(filename);
+        marisa::TrieSerializer(trie).mmap(filename);
       } catch (const std::exception &ex) {
         std::cerr << ex.what()
                   << ": failed to mmap a dictionary file: " << filename << "\n";
@@ -68,7 +68,7 @@ int dump(const char *filename) {
       }
     } else {
       try {
-        trie.load(filename);
+        marisa::TrieSerializer(trie).load(filename);
       } catch (const std::exception &ex) {
         std::cerr << ex.what()
                   << ": failed to load a dictionary file: " << filename << "\n";
@@ -0,0 +1,305 @@
+#include <marisa.h>
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "cmdopt.h"
+
+namespace {
+
+enum EmbedFormat {
+  EMBED_ARRAY,
+  EMBED_INCBIN,
+  EMBED_DIRECTIVE,
+};
+
+EmbedFormat param_format = EMBED_ARRAY;
+const char *param_name = nullptr;
+const char *output_filename = nullptr;
+
+void print_help(const char *cmd) {
+  std::cerr
+      << "Usage: " << cmd
+      << " [OPTION]... DIC\n\n"
+         "Converts a dictionary into source code that embeds it into an\n"
+         "executable. The program declares\n\n"
+         "  extern \"C\" const unsigned char NAME[];\n"
+         "  extern \"C\" const std::size_t NAME_size;\n"
+         "  const marisa::Trie trie(NAME, NAME_size);\n\n"
+         "and uses the dictionary in place, without copying or file I/O.\n\n"
+         "Options:\n"
+         "  -a, --array        write a C++ source with an array (default)\n"
+         "  -i, --incbin       write an assembly source (.S) with .incbin\n"
+         "  -e, --embed        write a C++ source with #embed (C++26/C23)\n"
+         "  -n, --name=[NAME]  specify the symbol name"
+         " (default: derived from DIC)\n"
+         "  -o, --output=[FILE]  write the source to FILE (default: stdout)\n"
+         "  -h, --help         print this help\n"
+         "\n";
+}
+
+// Derives a C identifier from the base name of `filename`.
+std::string make_name(const char *filename) {
+  const char *base = std::strrchr(filename, '/');
+  base = (base != nullptr) ? (base + 1) : filename;
+  std::string name;
+  for (const char *p = base; *p != '\0'; ++p) {
+    const unsigned char c = static_cast<unsigned char>(*p);
+    name += std::isalnum(c) ? static_cast<char>(c) : '_';
+  }
+  if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0]))) {
+    name.insert(0, "marisa_");
+  }
+  return name;
+}
+
+bool is_valid_name(const std::string &name) {
+  if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0]))) {
+    return false;
+  }
+  for (char c : name) {
+    if (!std::isalnum(static_cast<unsigned char>(c)) && (c != '_')) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Escapes `path` for a string literal.
+std::string quote(const char *path) {
+  std::string quoted = "\"";
+  for (const char *p = path; *p != '\0'; ++p) {
+    if ((*p == '"') || (*p == '\\')) {
+      quoted += '\\';
+    }
+    quoted += *p;
+  }
+  quoted += '"';
+  return quoted;
+}
+
+// The symbols have C linkage, so that their names are the same in every
+// format, including the assembly source of write_incbin().
+void write_declarations(std::ostream &output, const std::string &name) {
+  output << "#include <cstddef>\n\n"
+            "extern \"C\" const unsigned char "
+         << name
+         << "[];\n"
+            "extern \"C\" const std::size_t "
+         << name << "_size;\n\n";
+}
+
+void write_array(std::ostream &output, const std::string &name,
+                 const std::vector<char> &data) {
+  write_declarations(output, name);
+  output << "alignas(8) const unsigned char " << name << "[] = {";
+  char buf[8];
+  for (std::size_t i = 0; i < data.size(); ++i) {
+    if ((i % 16) == 0) {
+      output << "\n   ";
+    }
+    std::snprintf(buf, sizeof(buf), " 0x%02x,",
+                  static_cast<unsigned char>(data[i]));
+    output << buf;
+  }
+  output << "\n};\n"
+            "const std::size_t "
+         << name << "_size = " << data.size() << ";\n";
+}
+
+void write_directive(std::ostream &output, const std::string &name,
+                     const char *filename, std::size_t size) {
+  write_declarations(output, name);
+  output << "alignas(8) const unsigned char " << name
+         << "[] = {\n"
+            "#embed "
+         << quote(filename)
+         << "\n"
+            "};\n"
+            "const std::size_t "
+         << name << "_size = " << size << ";\n";
+}
+
+void write_incbin(std::ostream &output, const std::string &name,
+                  const char *filename, std::size_t size) {
+  // The .S file is preprocessed, so Mach-O and PE/COFF differences are
+  // resolved by the assembler of the target. C symbols have a leading
+  // underscore on Mach-O and 32-bit Windows, and NAME_size is as large as
+  // std::size_t of the target.
+  output << "#if defined(__APPLE__)\n"
+            "  .section __TEXT,__const\n"
+            "# define SYMBOL(name) _##name\n"
+            "#elif defined(_WIN64)\n"
+            "  .section .rdata,\"dr\"\n"
+            "# define SYMBOL(name) name\n"
+            "#elif defined(_WIN32)\n"
+            "  .section .rdata,\"dr\"\n"
+            "# define SYMBOL(name) _##name\n"
+            "#else\n"
+            "  .section .rodata\n"
+            "# define SYMBOL(name) name\n"
+            "#endif\n"
+            "  .balign 8\n"
+            "  .globl SYMBOL("
+         << name
+         << ")\n"
+            "SYMBOL("
+         << name
+         << "):\n"
+            "  .incbin "
+         << quote(filename)
+         << "\n"
+            "  .balign 8\n"
+            "  .globl SYMBOL("
+         << name
+         << "_size)\n"
+            "SYMBOL("
+         << name
+         << "_size):\n"
+            "#if __SIZEOF_SIZE_T__ == 8\n"
+            "  .quad "
+         << size
+         << "\n"
+            "#elif __SIZEOF_SIZE_T__ == 4\n"
+            "  .long "
+         << size
+         << "\n"
+            "#else\n"
+            "# error \"unsupported size of std::size_t\"\n"
+            "#endif\n"
+            "#if defined(__linux__) && defined(__ELF__)\n"
+            "  .section .note.GNU-stack,\"\",%progbits\n"
+            "#endif\n";
+}
+
+int embed(const char *filename) {
+  std::vector<char> data;
+  {
+    std::ifstream input(filename, std::ios::binary);
+    if (!input) {
+      std::cerr << "error: failed to open a dictionary file: " << filename
+                << "\n";
+      return 10;
+    }
+    data.assign(std::istreambuf_iterator<char>(input),
+                std::istreambuf_iterator<char>());
+    if (input.bad()) {
+      std::cerr << "error: failed to read a dictionary file: " << filename
+                << "\n";
+      return 11;
+    }
+  }
+
+  // std::vector<char> is allocated by operator new, so the data is aligned
+  // suitably for Trie.
+  try {
+    const marisa::Trie trie(data.data(), data.size());
+    std::cerr << "#keys: " << trie.num_keys() << "\n";
+  } catch (const std::exception &ex) {
+    std::cerr << ex.what() << ": not a dictionary file: " << filename << "\n";
+    return 12;
+  }
+
+  const std::string name =
+      (param_name != nullptr) ? param_name : make_name(filename);
+  if (!is_valid_name(name)) {
+    std::cerr << "error: invalid symbol name: " << name << "\n";
+    return 13;
+  }
+
+  std::ofstream file;
+  std::ostream *output = &std::cout;
+  if (output_filename != nullptr) {
+    file.open(output_filename, std::ios::binary);
+    if (!file) {
+      std::cerr << "error: failed to open an output file: " << output_filename
+                << "\n";
+      return 20;
+    }
+    output = &file;
+  }
+
+  *output << "// Generated by marisa-embed from " << filename << ".\n";
+  switch (param_format) {
+    case EMBED_ARRAY: {
+      write_array(*output, name, data);
+      break;
+    }
+    case EMBED_INCBIN: {
+      write_incbin(*output, name, filename, data.size());
+      break;
+    }
+    case EMBED_DIRECTIVE: {
+      write_directive(*output, name, filename, data.size());
+      break;
+    }
+  }
+  output->flush();
+  if (!*output) {
+    std::cerr << "error: failed to write the source\n";
+    return 21;
+  }
+  std::cerr << "symbol: " << name << "\n"
+            << "size: " << data.size() << "\n";
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  std::ios::sync_with_stdio(false);
+
+  ::cmdopt_option long_options[] = {{"array", 0, nullptr, 'a'},
+                                    {"incbin", 0, nullptr, 'i'},
+                                    {"embed", 0, nullptr, 'e'},
+                                    {"name", 1, nullptr, 'n'},
+                                    {"output", 1, nullptr, 'o'},
+                                    {"help", 0, nullptr, 'h'},
+                                    {nullptr, 0, nullptr, 0}};
+  ::cmdopt_t cmdopt;
+  ::cmdopt_init(&cmdopt, argc, argv, "aien:o:h", long_options);
+  int label;
+  while ((label = ::cmdopt_get(&cmdopt)) != -1) {
+    switch (label) {
+      case 'a': {
+        param_format = EMBED_ARRAY;
+        break;
+      }
+      case 'i': {
+        param_format = EMBED_INCBIN;
+        break;
+      }
+      case 'e': {
+        param_format = EMBED_DIRECTIVE;
+        break;
+      }
+      case 'n': {
+        param_name = cmdopt.optarg;
+        break;
+      }
+      case 'o': {
+        output_filename = cmdopt.optarg;
+        break;
+      }
+      case 'h': {
+        print_help(argv[0]);
+        return 0;
+      }
+      default: {
+        return 1;
+      }
+    }
+  }
+  if ((cmdopt.argc - cmdopt.optind) != 1) {
+    print_help(argv[0]);
+    return 1;
+  }
+  return embed(cmdopt.argv[cmdopt.optind]);
+}
@@ -1,16 +1,24 @@
 #include <marisa.h>
 
+#include <algorithm>
+#include <cstdio>
 #include <cstdlib>
 #include <exception>
 #include <iostream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "cmdopt.h"
+#include "line-batch.h"
 
 namespace {
 
 std::size_t max_num_results = 10;
 bool mmap_flag = true;
+bool batch_flag = false;
+std::size_t num_threads = 0;
 
 void print_help(const char *cmd) {
   std::cerr
@@ -23,10 +31,55 @@ void print_help(const char *cmd) {
          "  -m, --mmap-dictionary  use memory-mapped I/O to load a dictionary"
          " (default)\n"
          "  -r, --read-dictionary  read an entire dictionary into memory\n"
+         "  -b, --batch            read standard input in large chunks and"
+         " process\n"
+         "                         lines on multiple threads\n"
+         "  -j, --threads=[N]      use N threads in batch mode"
+         " (default: number of CPUs)\n"
          "  -h, --help             print this help\n"
          "\n";
 }
 
+// Searcher searches one line at a time and keeps the results between lines
+// to reuse their memory.
+class Searcher {
+ public:
+  void search(const marisa::Trie &trie, std::string_view str,
+              std::string *out) {
+    agent_.set_query(str);
+    ids_.clear();
+    keys_.clear();
+    ends_.clear();
+    while (trie.predictive_search(agent_)) {
+      ids_.push_back(agent_.key().id());
+      keys_.append(agent_.key().str());
+      ends_.push_back(keys_.size());
+    }
+    if (ids_.empty()) {
+      out->append("not found\n");
+      return;
+    }
+    append_number(out, ids_.size());
+    out->append(" found\n");
+    const std::size_t end = std::min(max_num_results, ids_.size());
+    for (std::size_t i = 0; i < end; ++i) {
+      append_number(out, ids_[i]);
+      out->push_back('\t');
+      const std::size_t begin = (i == 0) ? 0 : ends_[i - 1];
+      out->append(keys_, begin, ends_[i] - begin);
+      out->push_back('\t');
+      out->append(str);
+      out->push_back('\n');
+    }
+  }
+
+ private:
+  marisa::Agent agent_;
+  std::vector<std::size_t> ids_;
+  std::string keys_;
+  std::vector<std::size_t> ends_;
+};
+
 int predictive_search(const char *const *args, std::size_t num_args) {
   if (num_args == 0) {
     std::cerr << "error: dictionary is not specified\n";
@@ -40,7 +93,7 @@ int predictive_search(const char *const *args, std::size_t num_args) {
   marisa::Trie trie;
   if (mmap_flag) {
     try {
-      trie.mmap(args[0]);
+      marisa::TrieSerializer(trie).mmap(args[0]);
     } catch (const std::exception &ex) {
       std::cerr << ex.what()
                 << ": failed to mmap a dictionary file: " << args[0] << "\n";
@@ -48,7 +101,7 @@ int predictive_search(const char *const *args, std::size_t num_args) {
     }
   } else {
     try {
-      trie.load(args[0]);
+      marisa::TrieSerializer(trie).load(args[0]);
     } catch (const std::exception &ex) {
       std::cerr << ex.what()
                 << ": failed to load a dictionary file: " << args[0] << "\n";
@@ -56,29 +109,36 @@ int predictive_search(const char *const *args, std::size_t num_args) {
     }
   }
 
-  marisa::Agent agent;
-  marisa::Keyset keyset;
+  if (batch_flag) {
+    std::vector<Searcher> searchers(resolve_num_threads(num_threads));
+    try {
+      run_line_batch(stdin, stdout, searchers.size(),
+                     [&](std::size_t worker_id, std::string_view str,
+                         std::string *out) {
+                       try {
+                         searchers[worker_id].search(trie, str, out);
+                       } catch (const std::exception &ex) {
+                         throw std::runtime_error(
+                             std::string(ex.what()) +
+                             ": predictive_search() failed: " +
+                             std::string(str));
+                       }
+                     });
+    } catch (const std::exception &ex) {
+      std::cerr << ex.what() << "\n";
+      return 30;
+    }
+    return 0;
+  }
+
+  Searcher searcher;
   std::string str;
+  std::string out;
   while (std::getline(std::cin, str)) {
     try {
-      agent.set_query(str.c_str(), str.length());
-      while (trie.predictive_search(agent)) {
-        keyset.push_back(agent.key());
-      }
-      if (keyset.empty()) {
-        std::cout << "not found\n";
-      } else {
-        std::cout << keyset.size() << " found\n";
-        const std::size_t end = std::min(max_num_results, keyset.size());
-        for (std::size_t i = 0; i < end; ++i) {
-          std::cout << keyset[i].id() << '\t';
-          std::cout.write(keyset[i].ptr(),
-                          static_cast<std::streamsize>(keyset[i].length()))
-              << '\t';
-          std::cout << str << '\n';
-        }
-      }
-      keyset.reset();
+      out.clear();
+      searcher.search(trie, str, &out);
+      std::cout << out;
     } catch (const std::exception &ex) {
       std::cerr << ex.what() << ": predictive_search() failed: " << str << "\n";
       return 30;
@@ -101,10 +161,12 @@ int main(int argc, char *argv[]) {
   ::cmdopt_option long_options[] = {{"max-num-results", 1, nullptr, 'n'},
                                     {"mmap-dictionary", 0, nullptr, 'm'},
                                     {"read-dictionary", 0, nullptr, 'r'},
+                                    {"batch", 0, nullptr, 'b'},
+                                    {"threads", 1, nullptr, 'j'},
                                     {"help", 0, nullptr, 'h'},
                                     {nullptr, 0, nullptr, 0}};
   ::cmdopt_t cmdopt;
-  ::cmdopt_init(&cmdopt, argc, argv, "n:mrh", long_options);
+  ::cmdopt_init(&cmdopt, argc, argv, "n:mrbj:h", long_options);
   int label;
   while ((label = ::cmdopt_get(&cmdopt)) != -1) {
     switch (label) {
@@ -131,6 +193,21 @@ int main(int argc, char *argv[]) {
         mmap_flag = false;
         break;
       }
+      case 'b': {
+        batch_flag = true;
+        break;
+      }
+      case 'j': {
+        char *end_of_value;
+        const long value = std::strtol(cmdopt.optarg, &end_of_value, 10);
+        if ((*end_of_value != '\0') || (value < 0)) {
+          std::cerr << "error: option `-j' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 1;
+        }
+        num_threads = static_cast<std::size_t>(value);
+        break;
+      }
       case 'h': {
         print_help(argv[0]);
         return 0;
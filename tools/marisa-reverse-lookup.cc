@@ -1,14 +1,24 @@
 #include <marisa.h>
 
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
 #include <exception>
 #include <iostream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
 
 #include "cmdopt.h"
+#include "line-batch.h"
 
 namespace {
 
 bool mmap_flag = true;
+bool batch_flag = false;
+std::size_t num_threads = 0;
 
 void print_help(const char *cmd) {
   std::cerr
@@ -18,10 +28,26 @@ void print_help(const char *cmd) {
          "  -m, --mmap-dictionary  use memory-mapped I/O to load a dictionary"
          " (default)\n"
          "  -r, --read-dictionary  read an entire dictionary into memory\n"
+         "  -b, --batch            read standard input in large chunks and"
+         " process\n"
+         "                         lines on multiple threads, one ID per"
+         " line\n"
+         "  -j, --threads=[N]      use N threads in batch mode"
+         " (default: number of CPUs)\n"
          "  -h, --help             print this help\n"
          "\n";
 }
 
+void reverse_lookup_id(const marisa::Trie &trie, marisa::Agent &agent,
+                       std::size_t key_id, std::string *out) {
+  agent.set_query(key_id);
+  trie.reverse_lookup(agent);
+  append_number(out, agent.key().id());
+  out->push_back('\t');
+  out->append(agent.key().str());
+  out->push_back('\n');
+}
+
 int reverse_lookup(const char *const *args, std::size_t num_args) {
   if (num_args == 0) {
     std::cerr << "error: dictionary is not specified\n";
@@ -35,7 +61,7 @@ int reverse_lookup(const char *const *args, std::size_t num_args) {
   marisa::Trie trie;
   if (mmap_flag) {
     try {
-      trie.mmap(args[0]);
+      marisa::TrieSerializer(trie).mmap(args[0]);
     } catch (const std::exception &ex) {
       std::cerr << ex.what()
                 << ": failed to mmap a dictionary file: " << args[0] << "\n";
@@ -43,7 +69,7 @@ int reverse_lookup(const char *const *args, std::size_t num_args) {
     }
   } else {
     try {
-      trie.load(args[0]);
+      marisa::TrieSerializer(trie).load(args[0]);
     } catch (const std::exception &ex) {
       std::cerr << ex.what()
                 << ": failed to load a dictionary file: " << args[0] << "\n";
@@ -51,16 +77,43 @@ int reverse_lookup(const char *const *args, std::size_t num_args) {
     }
   }
 
+  if (batch_flag) {
+    std::vector<marisa::Agent> agents(resolve_num_threads(num_threads));
+    try {
+      run_line_batch(
+          stdin, stdout, agents.size(),
+          [&](std::size_t worker_id, std::string_view str, std::string *out) {
+            std::size_t key_id;
+            const std::from_chars_result result =
+                std::from_chars(str.data(), str.data() + str.size(), key_id);
+            if ((result.ec != std::errc()) ||
+                (result.ptr != (str.data() + str.size()))) {
+              throw std::runtime_error("error: invalid key ID: " +
+                                       std::string(str));
+            }
+            try {
+              reverse_lookup_id(trie, agents[worker_id], key_id, out);
+            } catch (const std::exception &ex) {
+              throw std::runtime_error(std::string(ex.what()) +
+                                       ": reverse_lookup() failed: " +
+                                       std::string(str));
+            }
+          });
+    } catch (const std::exception &ex) {
+      std::cerr << ex.what() << "\n";
+      return 30;
+    }
+    return 0;
+  }
+
   marisa::Agent agent;
   std::size_t key_id;
+  std::string out;
   while (std::cin >> key_id) {
     try {
-      agent.set_query(key_id);
-      trie.reverse_lookup(agent);
-      std::cout << agent.key().id() << '\t';
-      std::cout.write(agent.key().ptr(),
-                      static_cast<std::streamsize>(agent.key().length()))
-          << '\n';
+      out.clear();
+      reverse_lookup_id(trie, agent, key_id, &out);
+      std::cout << out;
     } catch (const std::exception &ex) {
       std::cerr << ex.what() << ": reverse_lookup() failed: " << key_id << "\n";
       return 30;
@@ -82,10 +135,12 @@ int main(int argc, char *argv[]) {
 
   ::cmdopt_option long_options[] = {{"mmap-dictionary", 0, nullptr, 'm'},
                                     {"read-dictionary", 0, nullptr, 'r'},
+                                    {"batch", 0, nullptr, 'b'},
+                                    {"threads", 1, nullptr, 'j'},
                                     {"help", 0, nullptr, 'h'},
                                     {nullptr, 0, nullptr, 0}};
   ::cmdopt_t cmdopt;
-  ::cmdopt_init(&cmdopt, argc, argv, "mrh", long_options);
+  ::cmdopt_init(&cmdopt, argc, argv, "mrbj:h", long_options);
   int label;
   while ((label = ::cmdopt_get(&cmdopt)) != -1) {
     switch (label) {
@@ -97,6 +152,21 @@ int main(int argc, char *argv[]) {
         mmap_flag = false;
         break;
       }
+      case 'b': {
+        batch_flag = true;
+        break;
+      }
+      case 'j': {
+        char *end_of_value;
+        const long value = std::strtol(cmdopt.optarg, &end_of_value, 10);
+        if ((*end_of_value != '\0') || (value < 0)) {
+          std::cerr << "error: option `-j' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 1;
+        }
+        num_threads = static_cast<std::size_t>(value);
+        break;
+      }
       case 'h': {
         print_help(argv[0]);
         return 0;
@@ -0,0 +1,266 @@
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "cmdopt.h"
+#include "server-client.h"
+
+namespace {
+
+std::uint8_t op = SERVER_LOOKUP;
+std::size_t batch_size = 100;
+std::size_t num_clients = 1;
+std::size_t max_num_results = 10;
+std::size_t num_rounds = 1;
+
+void print_help(const char *cmd) {
+  std::cerr
+      << "Usage: " << cmd
+      << " [OPTION]... SOCKET <QUERIES\n\n"
+         "Sends the queries in standard input, one per line, to marisa-server"
+         " in\n"
+         "batches from concurrent clients, and prints the throughput and the"
+         " latency\n"
+         "of requests.\n\n"
+         "Options:\n"
+         "  -o, --operation=[OP]       lookup (default), reverse-lookup,\n"
+         "                             common-prefix-search or"
+         " predictive-search\n"
+         "  -b, --batch-size=[N]       send N queries per request"
+         " (default: 100)\n"
+         "  -c, --clients=[N]          use N connections on N threads"
+         " (default: 1)\n"
+         "  -n, --max-num-results=[N]  limit the number of results to N"
+         " (default: 10)\n"
+         "                             0: no limit\n"
+         "  -r, --rounds=[N]           send all the queries N times per client"
+         " (default: 1)\n"
+         "  -h, --help                 print this help\n"
+         "\n";
+}
+
+struct ClientReport {
+  std::vector<double> latencies;
+  std::size_t num_results = 0;
+  std::string error;
+};
+
+// run_client() sends all the queries `num_rounds` times, starting at
+// `offset` so that clients don't send the same batches at the same time.
+void run_client(const char *socket_path, const std::vector<std::string> &keys,
+                const std::vector<std::uint32_t> &key_ids, std::size_t offset,
+                ClientReport *report) try {
+  ServerClient client;
+  client.connect(socket_path);
+
+  const std::size_t num_queries =
+      (op == SERVER_REVERSE_LOOKUP) ? key_ids.size() : keys.size();
+  std::vector<std::string_view> batch;
+  std::vector<std::uint32_t> id_batch;
+  ServerResults results;
+  for (std::size_t round = 0; round < num_rounds; ++round) {
+    for (std::size_t i = 0; i < num_queries; i += batch_size) {
+      const std::size_t end = std::min(i + batch_size, num_queries);
+      batch.clear();
+      id_batch.clear();
+      for (std::size_t j = i; j < end; ++j) {
+        const std::size_t query_id = (j + offset) % num_queries;
+        if (op == SERVER_REVERSE_LOOKUP) {
+          id_batch.push_back(key_ids[query_id]);
+        } else {
+          batch.push_back(keys[query_id]);
+        }
+      }
+
+      const auto begin = std::chrono::steady_clock::now();
+      if (op == SERVER_REVERSE_LOOKUP) {
+        client.reverse_lookup(id_batch, &results);
+      } else {
+        client.search(static_cast<ServerOp>(op), batch, max_num_results,
+                      &results);
+      }
+      report->latencies.push_back(
+          std::chrono::duration<double, std::micro>(
+              std::chrono::steady_clock::now() - begin)
+              .count());
+      report->num_results += results.end(results.num_queries() - 1);
+    }
+  }
+} catch (const std::exception &ex) {
+  report->error = ex.what();
+}
+
+double percentile(const std::vector<double> &sorted, double ratio) {
+  if (sorted.empty()) {
+    return 0.0;
+  }
+  const std::size_t i = static_cast<std::size_t>(
+      ratio * static_cast<double>(sorted.size() - 1) + 0.5);
+  return sorted[i];
+}
+
+int benchmark(const char *const *args, std::size_t num_args) {
+  if (num_args == 0) {
+    std::cerr << "error: socket is not specified\n";
+    return 10;
+  }
+  if (num_args > 1) {
+    std::cerr << "error: more than one sockets are specified\n";
+    return 11;
+  }
+
+  std::vector<std::string> keys;
+  std::vector<std::uint32_t> key_ids;
+  std::string line;
+  while (std::getline(std::cin, line)) {
+    if (op == SERVER_REVERSE_LOOKUP) {
+      std::uint32_t key_id;
+      const std::from_chars_result result =
+          std::from_chars(line.data(), line.data() + line.size(), key_id);
+      if ((result.ec != std::errc()) ||
+          (result.ptr != (line.data() + line.size()))) {
+        std::cerr << "error: invalid key ID: " << line << "\n";
+        return 20;
+      }
+      key_ids.push_back(key_id);
+    } else {
+      keys.push_back(line);
+    }
+  }
+  if (keys.empty() && key_ids.empty()) {
+    std::cerr << "error: no queries\n";
+    return 20;
+  }
+
+  std::vector<ClientReport> reports(num_clients);
+  const auto begin = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < num_clients; ++i) {
+    const std::size_t offset =
+        (keys.size() + key_ids.size()) * i / num_clients;
+    threads.emplace_back(run_client, args[0], std::cref(keys),
+                         std::cref(key_ids), offset, &reports[i]);
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - begin)
+          .count();
+
+  std::vector<double> latencies;
+  std::size_t num_results = 0;
+  for (const ClientReport &report : reports) {
+    if (!report.error.empty()) {
+      std::cerr << report.error << ": request failed\n";
+      return 30;
+    }
+    latencies.insert(latencies.end(), report.latencies.begin(),
+                     report.latencies.end());
+    num_results += report.num_results;
+  }
+  std::sort(latencies.begin(), latencies.end());
+
+  const std::size_t num_queries =
+      (keys.size() + key_ids.size()) * num_rounds * num_clients;
+  std::printf("#clients:  %zu\n", num_clients);
+  std::printf("#requests: %zu\n", latencies.size());
+  std::printf("#queries:  %zu\n", num_queries);
+  std::printf("#results:  %zu\n", num_results);
+  std::printf("time:      %.3f s\n", seconds);
+  std::printf("queries/s: %.0f\n", static_cast<double>(num_queries) / seconds);
+  std::printf("latency:   p50 %.1f us, p90 %.1f us, p99 %.1f us, max %.1f us\n",
+              percentile(latencies, 0.5), percentile(latencies, 0.9),
+              percentile(latencies, 0.99),
+              latencies.empty() ? 0.0 : latencies.back());
+  return 0;
+}
+
+// parse_size() parses a number not less than `min_value`, and returns false
+// if invalid.
+bool parse_size(const char *option, const char *arg, long long min_value,
+                std::size_t *value) {
+  char *end_of_value;
+  const long long parsed = std::strtoll(arg, &end_of_value, 10);
+  if ((*end_of_value != '\0') || (parsed < min_value)) {
+    std::cerr << "error: option `" << option
+              << "' with an invalid argument: " << arg << "\n";
+    return false;
+  }
+  *value = static_cast<std::size_t>(parsed);
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  std::ios::sync_with_stdio(false);
+
+  ::cmdopt_option long_options[] = {{"operation", 1, nullptr, 'o'},
+                                    {"batch-size", 1, nullptr, 'b'},
+                                    {"clients", 1, nullptr, 'c'},
+                                    {"max-num-results", 1, nullptr, 'n'},
+                                    {"rounds", 1, nullptr, 'r'},
+                                    {"help", 0, nullptr, 'h'},
+                                    {nullptr, 0, nullptr, 0}};
+  ::cmdopt_t cmdopt;
+  ::cmdopt_init(&cmdopt, argc, argv, "o:b:c:n:r:h", long_options);
+  int label;
+  while ((label = ::cmdopt_get(&cmdopt)) != -1) {
+    switch (label) {
+      case 'o': {
+        op = parse_server_op(cmdopt.optarg);
+        if (op == 0) {
+          std::cerr << "error: option `-o' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 1;
+        }
+        break;
+      }
+      case 'b': {
+        if (!parse_size("-b", cmdopt.optarg, 1, &batch_size)) {
+          return 1;
+        }
+        break;
+      }
+      case 'c': {
+        if (!parse_size("-c", cmdopt.optarg, 1, &num_clients)) {
+          return 1;
+        }
+        break;
+      }
+      case 'n': {
+        if (!parse_size("-n", cmdopt.optarg, 0, &max_num_results)) {
+          return 1;
+        }
+        break;
+      }
+      case 'r': {
+        if (!parse_size("-r", cmdopt.optarg, 0, &num_rounds)) {
+          return 1;
+        }
+        break;
+      }
+      case 'h': {
+        print_help(argv[0]);
+        return 0;
+      }
+      default: {
+        return 1;
+      }
+    }
+  }
+  return benchmark(cmdopt.argv + cmdopt.optind,
+                   static_cast<std::size_t>(cmdopt.argc - cmdopt.optind));
+}
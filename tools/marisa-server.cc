@@ -0,0 +1,525 @@
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <marisa.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+
+#include "cmdopt.h"
+#include "server-handler.h"
+
+namespace {
+
+const char *socket_path = nullptr;
+bool mmap_flag = true;
+bool warmup_flag = true;
+long check_interval = 1;
+bool quiet_flag = false;
+ServerLimits limits;
+
+// A connection stops reading requests while this number of bytes of its
+// responses are waiting to be sent.
+constexpr std::size_t MAX_PENDING_OUTPUT = 16 << 20;
+constexpr std::size_t RECV_SIZE = 64 << 10;
+
+void print_help(const char *cmd) {
+  std::cerr
+      << "Usage: " << cmd
+      << " [OPTION]... DIC\n\n"
+         "Serves lookups of a dictionary over a Unix domain socket, so that\n"
+         "processes on a host share one warm copy of it. Requests are\n"
+         "batches of lookup, reverse lookup, common prefix search or\n"
+         "predictive search queries, which are sent by the client in\n"
+         "tools/server-client.h. A dictionary replaced by rename, as with\n"
+         "MARISA_SAVE_ATOMIC, is reloaded when its file changes or on "
+         "SIGHUP.\n\n"
+         "Options:\n"
+         "  -s, --socket=[PATH]    listen on PATH (required)\n"
+         "  -m, --mmap-dictionary  use memory-mapped I/O to load a dictionary"
+         " (default)\n"
+         "  -r, --read-dictionary  read an entire dictionary into memory\n"
+         "  -n, --no-warmup        don't fault in the pages of a memory-mapped"
+         " dictionary\n"
+         "  -i, --check-interval=[N]  check the dictionary file for changes"
+         " every N\n"
+         "                         seconds (default: 1), 0: never\n"
+         "  -l, --max-results=[N]  return at most N results for a query"
+         " (default: 100000)\n"
+         "  -b, --max-response-size=[N]  fail a request whose response"
+         " exceeds N bytes\n"
+         "                         (default: 67108864)\n"
+         "  -q, --quiet            don't print log messages\n"
+         "  -h, --help             print this help\n"
+         "\n";
+}
+
+void log_message(const std::string &message) {
+  if (!quiet_flag) {
+    std::cerr << "marisa-server: " << message << std::endl;
+  }
+}
+
+[[noreturn]] void throw_errno(const char *what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+// Dictionary keeps a trie and the identity of the file it was loaded from,
+// and reloads the trie if the file is replaced or modified.
+class Dictionary {
+ public:
+  explicit Dictionary(const char *path) : path_(path) {}
+
+  void load() {
+    struct stat st = {};
+    if (::stat(path_, &st) == -1) {
+      throw_errno("stat");
+    }
+    marisa::Trie trie;
+    if (mmap_flag) {
+      marisa::TrieSerializer(trie).mmap(path_);
+      if (warmup_flag) {
+        trie.warmup(MARISA_WARMUP_HOT);
+      }
+    } else {
+      marisa::TrieSerializer(trie).load(path_);
+    }
+    trie_.swap(trie);
+    st_ = st;
+  }
+
+  // reload() loads the file again if `force` or if the file has changed. A
+  // file that fails to load is not retried until it changes again, and the
+  // current trie is kept.
+  void reload(bool force) {
+    struct stat st = {};
+    if (::stat(path_, &st) == -1) {
+      return;
+    }
+    if (!force && (st.st_dev == st_.st_dev) && (st.st_ino == st_.st_ino) &&
+        (st.st_size == st_.st_size) &&
+        (st.st_mtim.tv_sec == st_.st_mtim.tv_sec) &&
+        (st.st_mtim.tv_nsec == st_.st_mtim.tv_nsec)) {
+      return;
+    }
+    try {
+      load();
+      log_message("reloaded: " + std::to_string(trie_.num_keys()) + " keys");
+    } catch (const std::exception &ex) {
+      st_ = st;
+      log_message(std::string(ex.what()) + ": failed to reload: " + path_);
+    }
+  }
+
+  const marisa::Trie &trie() const {
+    return trie_;
+  }
+
+ private:
+  const char *path_;
+  marisa::Trie trie_;
+  struct stat st_ = {};
+};
+
+struct Connection {
+  std::string in;
+  std::string out;
+  std::size_t out_pos = 0;
+  std::uint32_t events = 0;
+};
+
+class Server {
+ public:
+  explicit Server(Dictionary &dictionary) : dictionary_(dictionary) {}
+  ~Server() {
+    for (const auto &connection : connections_) {
+      ::close(connection.first);
+    }
+    if (listen_fd_ != -1) {
+      ::close(listen_fd_);
+      ::unlink(socket_path);
+    }
+    if (signal_fd_ != -1) {
+      ::close(signal_fd_);
+    }
+    if (epoll_fd_ != -1) {
+      ::close(epoll_fd_);
+    }
+  }
+
+  Server(const Server &) = delete;
+  Server &operator=(const Server &) = delete;
+
+  void open();
+  void run();
+
+ private:
+  Dictionary &dictionary_;
+  marisa::Agent agent_;
+  int epoll_fd_ = -1;
+  int listen_fd_ = -1;
+  int signal_fd_ = -1;
+  std::unordered_map<int, Connection> connections_;
+
+  void add_fd(int fd, std::uint32_t events);
+  void accept_connections();
+  void close_connection(int fd);
+  bool receive(int fd, Connection &connection);
+  bool send(int fd, Connection &connection);
+  void update_events(int fd, Connection &connection);
+};
+
+void Server::open() {
+  ::sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  if (std::strlen(socket_path) >= sizeof(addr.sun_path)) {
+    throw std::invalid_argument("too long socket path");
+  }
+  std::strcpy(addr.sun_path, socket_path);
+
+  epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd_ == -1) {
+    throw_errno("epoll_create1");
+  }
+
+  // SIGINT and SIGTERM stop the server, and SIGHUP reloads the dictionary.
+  ::sigset_t mask;
+  ::sigemptyset(&mask);
+  ::sigaddset(&mask, SIGINT);
+  ::sigaddset(&mask, SIGTERM);
+  ::sigaddset(&mask, SIGHUP);
+  if (::sigprocmask(SIG_BLOCK, &mask, nullptr) == -1) {
+    throw_errno("sigprocmask");
+  }
+  signal_fd_ = ::signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+  if (signal_fd_ == -1) {
+    throw_errno("signalfd");
+  }
+  add_fd(signal_fd_, EPOLLIN);
+
+  const int fd =
+      ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd == -1) {
+    throw_errno("socket");
+  }
+  // A socket file left by a server that has exited is removed, but a socket
+  // that accepts connections and other files are not.
+  struct stat st;
+  if ((::lstat(socket_path, &st) == 0) && S_ISSOCK(st.st_mode)) {
+    if (::connect(fd, reinterpret_cast<const ::sockaddr *>(&addr),
+                  sizeof(addr)) == 0) {
+      ::close(fd);
+      throw std::runtime_error("socket in use");
+    }
+    if (errno == ECONNREFUSED) {
+      ::unlink(socket_path);
+    }
+  }
+  if ((::bind(fd, reinterpret_cast<const ::sockaddr *>(&addr),
+              sizeof(addr)) == -1) ||
+      (::listen(fd, SOMAXCONN) == -1)) {
+    const int error_value = errno;
+    ::close(fd);
+    throw std::system_error(error_value, std::generic_category(), "bind");
+  }
+  listen_fd_ = fd;
+  add_fd(listen_fd_, EPOLLIN);
+}
+
+void Server::run() {
+  using Clock = std::chrono::steady_clock;
+  const auto interval = std::chrono::seconds(check_interval);
+  auto next_check = Clock::now() + interval;
+
+  ::epoll_event events[64];
+  for (;;) {
+    int timeout = -1;
+    if (check_interval != 0) {
+      const auto now = Clock::now();
+      if (now >= next_check) {
+        dictionary_.reload(false);
+        next_check = now + interval;
+      }
+      timeout = static_cast<int>(
+          std::chrono::ceil<std::chrono::milliseconds>(next_check - now)
+              .count());
+    }
+
+    const int num_events = ::epoll_wait(epoll_fd_, events, 64, timeout);
+    if (num_events == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw_errno("epoll_wait");
+    }
+    for (int i = 0; i < num_events; ++i) {
+      const int fd = events[i].data.fd;
+      if (fd == listen_fd_) {
+        accept_connections();
+      } else if (fd == signal_fd_) {
+        ::signalfd_siginfo info;
+        while (::read(signal_fd_, &info, sizeof(info)) == sizeof(info)) {
+          if (info.ssi_signo == SIGHUP) {
+            dictionary_.reload(true);
+          } else {
+            log_message("stopped");
+            return;
+          }
+        }
+      } else {
+        const auto it = connections_.find(fd);
+        if (it == connections_.end()) {
+          continue;
+        }
+        Connection &connection = it->second;
+        bool ok = true;
+        if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+          ok = receive(fd, connection);
+        }
+        if (ok && (events[i].events & EPOLLOUT)) {
+          ok = send(fd, connection);
+        }
+        if (ok) {
+          update_events(fd, connection);
+        } else {
+          close_connection(fd);
+        }
+      }
+    }
+  }
+}
+
+void Server::add_fd(int fd, std::uint32_t events) {
+  ::epoll_event event = {};
+  event.events = events;
+  event.data.fd = fd;
+  if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) == -1) {
+    throw_errno("epoll_ctl");
+  }
+}
+
+void Server::accept_connections() {
+  for (;;) {
+    const int fd = ::accept4(listen_fd_, nullptr, nullptr,
+                             SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd == -1) {
+      if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR) &&
+          (errno != ECONNABORTED)) {
+        log_message(std::string("accept4: ") + std::strerror(errno));
+      }
+      return;
+    }
+    try {
+      add_fd(fd, EPOLLIN);
+      connections_[fd].events = EPOLLIN;
+    } catch (const std::exception &ex) {
+      ::close(fd);
+      log_message(ex.what());
+    }
+  }
+}
+
+void Server::close_connection(int fd) {
+  ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+  ::close(fd);
+  connections_.erase(fd);
+}
+
+// receive() reads the socket once, processes the complete requests and
+// starts sending the responses. It returns false if the connection should be
+// closed.
+bool Server::receive(int fd, Connection &connection) {
+  std::string &in = connection.in;
+  const std::size_t offset = in.size();
+  in.resize(offset + RECV_SIZE);
+  const ::ssize_t n = ::recv(fd, in.data() + offset, RECV_SIZE, 0);
+  if (n <= 0) {
+    in.resize(offset);
+    return (n == -1) && ((errno == EAGAIN) || (errno == EINTR));
+  }
+  in.resize(offset + static_cast<std::size_t>(n));
+
+  if (!handle_frames(dictionary_.trie(), agent_, limits, &in,
+                     &connection.out)) {
+    return false;
+  }
+  return send(fd, connection);
+}
+
+bool Server::send(int fd, Connection &connection) {
+  while (connection.out_pos < connection.out.size()) {
+    const ::ssize_t n =
+        ::send(fd, connection.out.data() + connection.out_pos,
+               connection.out.size() - connection.out_pos, MSG_NOSIGNAL);
+    if (n == -1) {
+      return (errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR);
+    }
+    connection.out_pos += static_cast<std::size_t>(n);
+  }
+  connection.out.clear();
+  connection.out_pos = 0;
+  return true;
+}
+
+void Server::update_events(int fd, Connection &connection) {
+  const std::size_t pending = connection.out.size() - connection.out_pos;
+  const std::uint32_t events =
+      ((pending < MAX_PENDING_OUTPUT) ? static_cast<std::uint32_t>(EPOLLIN)
+                                      : 0U) |
+      ((pending != 0) ? static_cast<std::uint32_t>(EPOLLOUT) : 0U);
+  if (events != connection.events) {
+    ::epoll_event event = {};
+    event.events = events;
+    event.data.fd = fd;
+    if (::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &event) == 0) {
+      connection.events = events;
+    }
+  }
+}
+
+int serve(const char *const *args, std::size_t num_args) {
+  if (num_args == 0) {
+    std::cerr << "error: dictionary is not specified\n";
+    return 10;
+  }
+  if (num_args > 1) {
+    std::cerr << "error: more than one dictionaries are specified\n";
+    return 11;
+  }
+  if (socket_path == nullptr) {
+    std::cerr << "error: socket is not specified\n";
+    return 12;
+  }
+
+  Dictionary dictionary(args[0]);
+  try {
+    dictionary.load();
+  } catch (const std::exception &ex) {
+    std::cerr << ex.what()
+              << ": failed to load a dictionary file: " << args[0] << "\n";
+    return 20;
+  }
+
+  Server server(dictionary);
+  try {
+    server.open();
+  } catch (const std::exception &ex) {
+    std::cerr << ex.what() << ": failed to listen: " << socket_path << "\n";
+    return 30;
+  }
+  log_message("listening on " + std::string(socket_path) + ": " +
+              std::to_string(dictionary.trie().num_keys()) + " keys");
+
+  try {
+    server.run();
+  } catch (const std::exception &ex) {
+    std::cerr << ex.what() << ": server failed\n";
+    return 31;
+  }
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  std::ios::sync_with_stdio(false);
+
+  ::cmdopt_option long_options[] = {{"socket", 1, nullptr, 's'},
+                                    {"mmap-dictionary", 0, nullptr, 'm'},
+                                    {"read-dictionary", 0, nullptr, 'r'},
+                                    {"no-warmup", 0, nullptr, 'n'},
+                                    {"check-interval", 1, nullptr, 'i'},
+                                    {"max-results", 1, nullptr, 'l'},
+                                    {"max-response-size", 1, nullptr, 'b'},
+                                    {"quiet", 0, nullptr, 'q'},
+                                    {"help", 0, nullptr, 'h'},
+                                    {nullptr, 0, nullptr, 0}};
+  ::cmdopt_t cmdopt;
+  ::cmdopt_init(&cmdopt, argc, argv, "s:mrni:l:b:qh", long_options);
+  int label;
+  while ((label = ::cmdopt_get(&cmdopt)) != -1) {
+    switch (label) {
+      case 's': {
+        socket_path = cmdopt.optarg;
+        break;
+      }
+      case 'm': {
+        mmap_flag = true;
+        break;
+      }
+      case 'r': {
+        mmap_flag = false;
+        break;
+      }
+      case 'n': {
+        warmup_flag = false;
+        break;
+      }
+      case 'i': {
+        char *end_of_value;
+        const long value = std::strtol(cmdopt.optarg, &end_of_value, 10);
+        if ((*end_of_value != '\0') || (value < 0) || (value > 86400)) {
+          std::cerr << "error: option `-i' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 1;
+        }
+        check_interval = value;
+        break;
+      }
+      case 'l': {
+        char *end_of_value;
+        const long long value = std::strtoll(cmdopt.optarg, &end_of_value, 10);
+        if ((*end_of_value != '\0') || (value <= 0)) {
+          std::cerr << "error: option `-l' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 1;
+        }
+        limits.max_num_results = static_cast<std::size_t>(value);
+        break;
+      }
+      case 'b': {
+        char *end_of_value;
+        const long long value = std::strtoll(cmdopt.optarg, &end_of_value, 10);
+        if ((*end_of_value != '\0') || (value <= 0) ||
+            (static_cast<unsigned long long>(value) >
+             std::numeric_limits<std::uint32_t>::max())) {
+          std::cerr << "error: option `-b' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 1;
+        }
+        limits.max_response_size = static_cast<std::size_t>(value);
+        break;
+      }
+      case 'q': {
+        quiet_flag = true;
+        break;
+      }
+      case 'h': {
+        print_help(argv[0]);
+        return 0;
+      }
+      default: {
+        return 1;
+      }
+    }
+  }
+  return serve(cmdopt.argv + cmdopt.optind,
+               static_cast<std::size_t>(cmdopt.argc - cmdopt.optind));
+}
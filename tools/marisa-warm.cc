@@ -0,0 +1,172 @@
+#include <marisa.h>
+
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "cmdopt.h"
+
+namespace {
+
+int param_flags = MARISA_WARMUP_HOT;
+const char *param_sample_filename = nullptr;
+bool param_warmup = true;
+bool param_quiet = false;
+
+void print_help(const char *cmd) {
+  std::cerr
+      << "Usage: " << cmd
+      << " [OPTION]... DIC\n\n"
+         "Memory-maps a dictionary and faults in its pages in priority order:\n"
+         "the cache, LOUDS, flags and labels first, then the pages read by a\n"
+         "query sample, and then the rest. The pages stay in the page cache\n"
+         "after exit, so this warms a dictionary for a process that maps it\n"
+         "next. Resident bytes per section are printed afterwards.\n\n"
+         "Options:\n"
+         "  -s, --sample=[FILE]  look up the keys in FILE, one per line\n"
+         "  -a, --all            fault in all the pages\n"
+         "  -n, --no-warmup      only print the residency\n"
+         "  -q, --quiet          don't print the residency\n"
+         "  -h, --help           print this help\n"
+         "\n";
+}
+
+int read_sample(const char *filename, marisa::Keyset *keyset) {
+  std::ifstream file(filename, std::ios::binary);
+  if (!file) {
+    std::cerr << "error: failed to open a sample file: " << filename << "\n";
+    return 20;
+  }
+  std::string line;
+  while (std::getline(file, line)) {
+    keyset->push_back(line.c_str(), line.length());
+  }
+  if (file.bad()) {
+    std::cerr << "error: failed to read a sample file: " << filename << "\n";
+    return 21;
+  }
+  return 0;
+}
+
+void print_residency(const marisa::ResidencyReport &report) {
+  std::printf("%-16s %5s %14s %14s %7s\n", "section", "trie", "size",
+              "resident", "ratio");
+  for (const marisa::SectionResidency &section : report.sections()) {
+    const double ratio =
+        (section.size() != 0) ? (100.0 * static_cast<double>(
+                                             section.resident_size()) /
+                                 static_cast<double>(section.size()))
+                              : 0.0;
+    std::printf("%-16s %5zu %14zu %14zu %6.1f%%\n", section.name(),
+                section.trie_id(), section.size(), section.resident_size(),
+                ratio);
+  }
+  const double ratio =
+      (report.total_size() != 0)
+          ? (100.0 * static_cast<double>(report.total_resident_size()) /
+             static_cast<double>(report.total_size()))
+          : 0.0;
+  std::printf("%-16s %5s %14zu %14zu %6.1f%%\n", "total", "",
+              report.total_size(), report.total_resident_size(), ratio);
+}
+
+int warm(const char *const *args, std::size_t num_args) {
+  if (num_args == 0) {
+    std::cerr << "error: dictionary is not specified\n";
+    return 10;
+  }
+  if (num_args > 1) {
+    std::cerr << "error: more than one dictionaries are specified\n";
+    return 11;
+  }
+
+  marisa::Keyset sample;
+  if (param_sample_filename != nullptr) {
+    const int ret = read_sample(param_sample_filename, &sample);
+    if (ret != 0) {
+      return ret;
+    }
+    param_flags |= MARISA_WARMUP_SAMPLE;
+  }
+
+  marisa::Trie trie;
+  try {
+    marisa::TrieSerializer(trie).mmap(args[0]);
+  } catch (const std::exception &ex) {
+    std::cerr << ex.what() << ": failed to mmap a dictionary file: " << args[0]
+              << "\n";
+    return 30;
+  }
+
+  if (param_warmup) {
+    const auto begin = std::chrono::steady_clock::now();
+    try {
+      trie.warmup(param_flags, &sample);
+    } catch (const std::exception &ex) {
+      std::cerr << ex.what() << ": failed to warm up a dictionary\n";
+      return 31;
+    }
+    const double elapsed = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - begin)
+                               .count();
+    std::cerr << "warmup: " << (elapsed * 1000.0) << " ms\n";
+  }
+
+  if (!param_quiet) {
+    try {
+      print_residency(trie.residency());
+    } catch (const std::exception &ex) {
+      std::cerr << ex.what() << ": failed to get the residency\n";
+      return 32;
+    }
+  }
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  std::ios::sync_with_stdio(false);
+
+  ::cmdopt_option long_options[] = {{"sample", 1, nullptr, 's'},
+                                    {"all", 0, nullptr, 'a'},
+                                    {"no-warmup", 0, nullptr, 'n'},
+                                    {"quiet", 0, nullptr, 'q'},
+                                    {"help", 0, nullptr, 'h'},
+                                    {nullptr, 0, nullptr, 0}};
+  ::cmdopt_t cmdopt;
+  ::cmdopt_init(&cmdopt, argc, argv, "s:anqh", long_options);
+  int label;
+  while ((label = ::cmdopt_get(&cmdopt)) != -1) {
+    switch (label) {
+      case 's': {
+        param_sample_filename = cmdopt.optarg;
+        break;
+      }
+      case 'a': {
+        param_flags |= MARISA_WARMUP_ALL;
+        break;
+      }
+      case 'n': {
+        param_warmup = false;
+        break;
+      }
+      case 'q': {
+        param_quiet = true;
+        break;
+      }
+      case 'h': {
+        print_help(argv[0]);
+        return 0;
+      }
+      default: {
+        return 1;
+      }
+    }
+  }
+  return warm(cmdopt.argv + cmdopt.optind,
+              static_cast<std::size_t>(cmdopt.argc - cmdopt.optind));
+}
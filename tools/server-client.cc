@@ -0,0 +1,181 @@
+#include "server-client.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <system_error>
+
+namespace {
+
+[[noreturn]] void throw_errno(const char *what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+[[noreturn]] void throw_malformed() {
+  throw std::runtime_error("malformed response");
+}
+
+}  // namespace
+
+ServerClient::~ServerClient() {
+  close();
+}
+
+void ServerClient::connect(const char *socket_path) {
+  close();
+
+  ::sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  if (std::strlen(socket_path) >= sizeof(addr.sun_path)) {
+    throw std::invalid_argument("too long socket path");
+  }
+  std::strcpy(addr.sun_path, socket_path);
+
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd == -1) {
+    throw_errno("socket");
+  }
+  if (::connect(fd, reinterpret_cast<const ::sockaddr *>(&addr),
+                sizeof(addr)) == -1) {
+    const int error_value = errno;
+    ::close(fd);
+    throw std::system_error(error_value, std::generic_category(), "connect");
+  }
+  fd_ = fd;
+}
+
+void ServerClient::close() noexcept {
+  if (fd_ != -1) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+}
+
+void ServerClient::search(ServerOp op, const std::string_view *queries,
+                          std::size_t num_queries, std::size_t max_num_results,
+                          ServerResults *results) {
+  if ((op == SERVER_REVERSE_LOOKUP) ||
+      (max_num_results > std::numeric_limits<std::uint32_t>::max())) {
+    throw std::invalid_argument("invalid search request");
+  }
+  buf_.clear();
+  put_u32(&buf_, 0);
+  put_header(&buf_, op, 0);
+  put_u32(&buf_, static_cast<std::uint32_t>(max_num_results));
+  put_u32(&buf_, static_cast<std::uint32_t>(num_queries));
+  for (std::size_t i = 0; i < num_queries; ++i) {
+    put_u32(&buf_, static_cast<std::uint32_t>(queries[i].length()));
+    buf_.append(queries[i]);
+  }
+  request(op, results);
+}
+
+void ServerClient::reverse_lookup(const std::uint32_t *key_ids,
+                                  std::size_t num_key_ids,
+                                  ServerResults *results) {
+  buf_.clear();
+  put_u32(&buf_, 0);
+  put_header(&buf_, SERVER_REVERSE_LOOKUP, 0);
+  put_u32(&buf_, 0);
+  put_u32(&buf_, static_cast<std::uint32_t>(num_key_ids));
+  for (std::size_t i = 0; i < num_key_ids; ++i) {
+    put_u32(&buf_, key_ids[i]);
+  }
+  request(SERVER_REVERSE_LOOKUP, results);
+}
+
+void ServerClient::request(std::uint8_t op, ServerResults *results) {
+  if (fd_ == -1) {
+    throw std::logic_error("not connected");
+  }
+  if ((buf_.size() - 4) > SERVER_MAX_REQUEST_SIZE) {
+    throw std::length_error("too large request");
+  }
+  set_u32(&buf_, 0, static_cast<std::uint32_t>(buf_.size() - 4));
+  const std::uint32_t num_queries = get_u32(buf_.data() + 12);
+  send_all(buf_.data(), buf_.size());
+
+  char size_buf[4];
+  recv_all(size_buf, sizeof(size_buf));
+  buf_.resize(get_u32(size_buf));
+  recv_all(buf_.data(), buf_.size());
+
+  ServerReader reader(buf_.data(), buf_.size());
+  std::uint8_t status;
+  std::uint8_t response_op;
+  std::uint32_t value;
+  if (!reader.read_u8(&status) || !reader.read_u8(&response_op) ||
+      !reader.skip(2) || !reader.read_u32(&value) || (response_op != op)) {
+    throw_malformed();
+  }
+  if (status != SERVER_OK) {
+    std::string_view message;
+    if (!reader.read_bytes(value, &message)) {
+      throw_malformed();
+    }
+    throw std::runtime_error(std::string(message));
+  }
+  if (value != num_queries) {
+    throw_malformed();
+  }
+
+  results->clear();
+  for (std::uint32_t i = 0; i < num_queries; ++i) {
+    std::uint32_t num_results;
+    if (!reader.read_u32(&num_results)) {
+      throw_malformed();
+    }
+    for (std::uint32_t j = 0; j < num_results; ++j) {
+      std::uint32_t key_id;
+      std::uint32_t length;
+      std::string_view key;
+      if (!reader.read_u32(&key_id) || !reader.read_u32(&length) ||
+          !reader.read_bytes(length, &key)) {
+        throw_malformed();
+      }
+      results->ids_.push_back(key_id);
+      results->keys_.append(key);
+      results->key_ends_.push_back(results->keys_.size());
+    }
+    results->ends_.push_back(results->ids_.size());
+  }
+  if (reader.avail() != 0) {
+    throw_malformed();
+  }
+}
+
+void ServerClient::send_all(const char *ptr, std::size_t size) {
+  while (size != 0) {
+    const ::ssize_t n = ::send(fd_, ptr, size, MSG_NOSIGNAL);
+    if (n == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw_errno("send");
+    }
+    ptr += n;
+    size -= static_cast<std::size_t>(n);
+  }
+}
+
+void ServerClient::recv_all(char *ptr, std::size_t size) {
+  while (size != 0) {
+    const ::ssize_t n = ::recv(fd_, ptr, size, 0);
+    if (n == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw_errno("recv");
+    }
+    if (n == 0) {
+      throw std::runtime_error("connection closed by server");
+    }
+    ptr += n;
+    size -= static_cast<std::size_t>(n);
+  }
+}
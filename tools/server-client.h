@@ -0,0 +1,94 @@
+#ifndef MARISA_SERVER_CLIENT_H_
+#define MARISA_SERVER_CLIENT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "server-protocol.h"
+
+// ServerResults keeps the results of a request. The results of query i are
+// [begin(i), end(i)) of ids() and keys(), and their memory is reused by the
+// next request.
+class ServerResults {
+ public:
+  std::size_t num_queries() const {
+    return ends_.size();
+  }
+  std::size_t begin(std::size_t i) const {
+    return (i == 0) ? 0 : ends_[i - 1];
+  }
+  std::size_t end(std::size_t i) const {
+    return ends_[i];
+  }
+  std::uint32_t id(std::size_t j) const {
+    return ids_[j];
+  }
+  std::string_view key(std::size_t j) const {
+    const std::size_t key_begin = (j == 0) ? 0 : key_ends_[j - 1];
+    return std::string_view(keys_.data() + key_begin,
+                            key_ends_[j] - key_begin);
+  }
+
+ private:
+  friend class ServerClient;
+
+  std::vector<std::size_t> ends_;
+  std::vector<std::uint32_t> ids_;
+  std::string keys_;
+  std::vector<std::size_t> key_ends_;
+
+  void clear() {
+    ends_.clear();
+    ids_.clear();
+    keys_.clear();
+    key_ends_.clear();
+  }
+};
+
+// ServerClient sends requests to marisa-server and waits for the responses.
+// Errors are reported as std::system_error or std::runtime_error.
+class ServerClient {
+ public:
+  ServerClient() = default;
+  ~ServerClient();
+
+  ServerClient(const ServerClient &) = delete;
+  ServerClient &operator=(const ServerClient &) = delete;
+
+  void connect(const char *socket_path);
+  void close() noexcept;
+
+  bool is_open() const {
+    return fd_ != -1;
+  }
+
+  // search() sends a lookup, common prefix search or predictive search
+  // request for `queries`.
+  void search(ServerOp op, const std::string_view *queries,
+              std::size_t num_queries, std::size_t max_num_results,
+              ServerResults *results);
+  void search(ServerOp op, const std::vector<std::string_view> &queries,
+              std::size_t max_num_results, ServerResults *results) {
+    search(op, queries.data(), queries.size(), max_num_results, results);
+  }
+
+  void reverse_lookup(const std::uint32_t *key_ids, std::size_t num_key_ids,
+                      ServerResults *results);
+  void reverse_lookup(const std::vector<std::uint32_t> &key_ids,
+                      ServerResults *results) {
+    reverse_lookup(key_ids.data(), key_ids.size(), results);
+  }
+
+ private:
+  int fd_ = -1;
+  std::string buf_;
+
+  void request(std::uint8_t op, ServerResults *results);
+  void send_all(const char *ptr, std::size_t size);
+  void recv_all(char *ptr, std::size_t size);
+};
+
+#endif  // MARISA_SERVER_CLIENT_H_
@@ -0,0 +1,141 @@
+#include "server-handler.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+
+// search() appends the results of a query to `out`, and throws
+// std::length_error as soon as `out` exceeds `max_size` bytes.
+void search(const marisa::Trie &trie, marisa::Agent &agent, std::uint8_t op,
+            std::size_t max_num_results, std::size_t max_size,
+            std::string *out) {
+  const std::size_t num_results_pos = out->size();
+  put_u32(out, 0);
+  std::size_t num_results = 0;
+  switch (op) {
+    case SERVER_LOOKUP: {
+      if (trie.lookup(agent)) {
+        put_u32(out, static_cast<std::uint32_t>(agent.key().id()));
+        put_u32(out, 0);
+        num_results = 1;
+      }
+      break;
+    }
+    case SERVER_REVERSE_LOOKUP: {
+      trie.reverse_lookup(agent);
+      put_u32(out, static_cast<std::uint32_t>(agent.key().id()));
+      put_u32(out, static_cast<std::uint32_t>(agent.key().length()));
+      out->append(agent.key().str());
+      num_results = 1;
+      break;
+    }
+    default: {
+      const bool is_prefix_search = (op == SERVER_COMMON_PREFIX_SEARCH);
+      while ((num_results < max_num_results) &&
+             (is_prefix_search ? trie.common_prefix_search(agent)
+                               : trie.predictive_search(agent))) {
+        put_u32(out, static_cast<std::uint32_t>(agent.key().id()));
+        put_u32(out, static_cast<std::uint32_t>(agent.key().length()));
+        out->append(agent.key().str());
+        ++num_results;
+        if (out->size() > max_size) {
+          throw std::length_error("too large response");
+        }
+      }
+      break;
+    }
+  }
+  set_u32(out, num_results_pos, static_cast<std::uint32_t>(num_results));
+}
+
+}  // namespace
+
+bool handle_request(const marisa::Trie &trie, marisa::Agent &agent,
+                    const ServerLimits &limits, const char *body,
+                    std::size_t size, std::string *out) {
+  ServerReader reader(body, size);
+  std::uint8_t op;
+  std::uint32_t request_max_num_results;
+  std::uint32_t num_queries;
+  if (!reader.read_u8(&op) || !reader.skip(3) ||
+      !reader.read_u32(&request_max_num_results) ||
+      !reader.read_u32(&num_queries)) {
+    return false;
+  }
+
+  const std::size_t frame_pos = out->size();
+  put_u32(out, 0);
+  try {
+    if ((op < SERVER_LOOKUP) || (op > SERVER_PREDICTIVE_SEARCH)) {
+      throw std::invalid_argument("unknown operation: " + std::to_string(op));
+    }
+    put_header(out, SERVER_OK, op);
+    put_u32(out, num_queries);
+    // A request gets at most `max_num_results` results for each query, even
+    // if it asks for no limit.
+    const std::size_t limit =
+        (request_max_num_results == 0)
+            ? limits.max_num_results
+            : std::min<std::size_t>(request_max_num_results,
+                                    limits.max_num_results);
+    const std::size_t max_size = frame_pos + 4 + limits.max_response_size;
+    for (std::uint32_t i = 0; i < num_queries; ++i) {
+      if (op == SERVER_REVERSE_LOOKUP) {
+        std::uint32_t key_id;
+        if (!reader.read_u32(&key_id)) {
+          return false;
+        }
+        agent.set_query(static_cast<std::size_t>(key_id));
+      } else {
+        std::uint32_t length;
+        std::string_view query;
+        if (!reader.read_u32(&length) || !reader.read_bytes(length, &query)) {
+          return false;
+        }
+        agent.set_query(query);
+      }
+      search(trie, agent, op, limit, max_size, out);
+      if (out->size() > max_size) {
+        throw std::length_error("too large response");
+      }
+    }
+    if (reader.avail() != 0) {
+      return false;
+    }
+  } catch (const std::exception &ex) {
+    const std::string_view message = ex.what();
+    out->resize(frame_pos + 4);
+    put_header(out, SERVER_ERROR, op);
+    put_u32(out, static_cast<std::uint32_t>(message.length()));
+    out->append(message);
+  }
+  set_u32(out, frame_pos,
+          static_cast<std::uint32_t>(out->size() - frame_pos - 4));
+  return true;
+}
+
+bool handle_frames(const marisa::Trie &trie, marisa::Agent &agent,
+                   const ServerLimits &limits, std::string *in,
+                   std::string *out) {
+  std::size_t pos = 0;
+  while ((in->size() - pos) >= 4) {
+    const std::size_t size = get_u32(in->data() + pos);
+    if (size > SERVER_MAX_REQUEST_SIZE) {
+      return false;
+    }
+    if ((in->size() - pos - 4) < size) {
+      break;
+    }
+    if (!handle_request(trie, agent, limits, in->data() + pos + 4, size,
+                        out)) {
+      return false;
+    }
+    pos += 4 + size;
+  }
+  in->erase(0, pos);
+  return true;
+}
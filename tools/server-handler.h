@@ -0,0 +1,34 @@
+#ifndef MARISA_SERVER_HANDLER_H_
+#define MARISA_SERVER_HANDLER_H_
+
+#include <marisa.h>
+
+#include <cstddef>
+#include <string>
+
+#include "server-protocol.h"
+
+// ServerLimits limits the results of a query and the body of a response,
+// because a request with no limit may ask for the whole dictionary.
+struct ServerLimits {
+  std::size_t max_num_results = 100000;
+  std::size_t max_response_size = 64 << 20;
+};
+
+// handle_request() appends the response frame to a request body to `out`,
+// and returns false if the request is malformed. A request that fails, such
+// as one with an unknown operation, gets an error response instead.
+bool handle_request(const marisa::Trie &trie, marisa::Agent &agent,
+                    const ServerLimits &limits, const char *body,
+                    std::size_t size, std::string *out);
+
+// handle_frames() handles the complete request frames at the beginning of
+// `in`, appends the responses to `out` and removes the frames from `in`, so
+// that `in` keeps a truncated frame until the rest arrives. It returns false
+// if a frame is malformed or larger than SERVER_MAX_REQUEST_SIZE, in which
+// case the connection should be closed.
+bool handle_frames(const marisa::Trie &trie, marisa::Agent &agent,
+                   const ServerLimits &limits, std::string *in,
+                   std::string *out);
+
+#endif  // MARISA_SERVER_HANDLER_H_
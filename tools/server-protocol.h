@@ -0,0 +1,138 @@
+#ifndef MARISA_SERVER_PROTOCOL_H_
+#define MARISA_SERVER_PROTOCOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// marisa-server and its clients exchange frames over a Unix domain socket.
+// A frame is a body size followed by the body, and all integers are 32-bit
+// little-endian.
+//
+// A request body is a header and `num_queries` queries.
+//   u8 op, u8 0, u16 0, u32 max_num_results, u32 num_queries
+//   SERVER_REVERSE_LOOKUP: u32 key_id
+//   others: u32 length, bytes
+// max_num_results limits the results of each query, and 0 means no limit
+// other than that of the server (marisa-server -l). A request whose response
+// body would exceed the server limit (marisa-server -b) fails with
+// "too large response".
+//
+// A response body has the results of the queries in order.
+//   u8 SERVER_OK, u8 op, u16 0, u32 num_queries
+//   for each query: u32 num_results, {u32 key_id, u32 length, bytes}...
+// A lookup returns its key ID with an empty key. If a request fails, the
+// response is the following instead, and the connection stays open.
+//   u8 SERVER_ERROR, u8 op, u16 0, u32 length, message
+// A server closes a connection that sends a malformed frame.
+
+enum ServerOp : std::uint8_t {
+  SERVER_LOOKUP = 1,
+  SERVER_REVERSE_LOOKUP = 2,
+  SERVER_COMMON_PREFIX_SEARCH = 3,
+  SERVER_PREDICTIVE_SEARCH = 4,
+};
+
+enum ServerStatus : std::uint8_t {
+  SERVER_OK = 0,
+  SERVER_ERROR = 1,
+};
+
+enum {
+  SERVER_HEADER_SIZE = 12,
+  SERVER_MAX_REQUEST_SIZE = 64 << 20,
+};
+
+// parse_server_op() returns the ServerOp named `name`, or 0 if unknown.
+inline std::uint8_t parse_server_op(std::string_view name) {
+  if (name == "lookup") {
+    return SERVER_LOOKUP;
+  } else if (name == "reverse-lookup") {
+    return SERVER_REVERSE_LOOKUP;
+  } else if (name == "common-prefix-search") {
+    return SERVER_COMMON_PREFIX_SEARCH;
+  } else if (name == "predictive-search") {
+    return SERVER_PREDICTIVE_SEARCH;
+  }
+  return 0;
+}
+
+inline void put_u32(std::string *buf, std::uint32_t value) {
+  const char bytes[4] = {
+      static_cast<char>(value), static_cast<char>(value >> 8),
+      static_cast<char>(value >> 16), static_cast<char>(value >> 24)};
+  buf->append(bytes, 4);
+}
+
+inline std::uint32_t get_u32(const char *ptr) {
+  const unsigned char *const bytes =
+      reinterpret_cast<const unsigned char *>(ptr);
+  return static_cast<std::uint32_t>(bytes[0]) |
+         (static_cast<std::uint32_t>(bytes[1]) << 8) |
+         (static_cast<std::uint32_t>(bytes[2]) << 16) |
+         (static_cast<std::uint32_t>(bytes[3]) << 24);
+}
+
+inline void set_u32(std::string *buf, std::size_t pos, std::uint32_t value) {
+  (*buf)[pos] = static_cast<char>(value);
+  (*buf)[pos + 1] = static_cast<char>(value >> 8);
+  (*buf)[pos + 2] = static_cast<char>(value >> 16);
+  (*buf)[pos + 3] = static_cast<char>(value >> 24);
+}
+
+// put_header() appends the first 8 bytes of a request or response header.
+inline void put_header(std::string *buf, std::uint8_t status_or_op,
+                       std::uint8_t op) {
+  buf->push_back(static_cast<char>(status_or_op));
+  buf->push_back(static_cast<char>(op));
+  buf->append(2, '\0');
+}
+
+// ServerReader reads a body and reports a truncated body as failure.
+class ServerReader {
+ public:
+  ServerReader(const char *ptr, std::size_t size) : ptr_(ptr), avail_(size) {}
+
+  bool read_u8(std::uint8_t *value) {
+    if (avail_ < 1) {
+      return false;
+    }
+    *value = static_cast<std::uint8_t>(*ptr_);
+    ++ptr_;
+    --avail_;
+    return true;
+  }
+  bool read_u32(std::uint32_t *value) {
+    if (avail_ < 4) {
+      return false;
+    }
+    *value = get_u32(ptr_);
+    ptr_ += 4;
+    avail_ -= 4;
+    return true;
+  }
+  bool read_bytes(std::size_t size, std::string_view *bytes) {
+    if (avail_ < size) {
+      return false;
+    }
+    *bytes = std::string_view(ptr_, size);
+    ptr_ += size;
+    avail_ -= size;
+    return true;
+  }
+  bool skip(std::size_t size) {
+    std::string_view bytes;
+    return read_bytes(size, &bytes);
+  }
+
+  std::size_t avail() const {
+    return avail_;
+  }
+
+ private:
+  const char *ptr_;
+  std::size_t avail_;
+};
+
+#endif  // MARISA_SERVER_PROTOCOL_H_